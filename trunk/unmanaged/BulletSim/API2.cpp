@@ -168,6 +168,8 @@ EXTERN_C DLL_EXPORT void ResetConstraintSolver(BulletSim* sim)
  * @param maxSubSteps Clamps the maximum number of fixed duration sub steps taken this step.
  * @param fixedTimeStep Length in seconds of the sub steps Bullet actually uses for simulation. Example: 1.0 / TARGET_FPS.
  * @param updatedEntityCount Pointer to the number of EntityProperties generated this call.
+ *    If the 'useCompactUpdates' parameter is set, this is the number of compact update records
+ *    written into the update array instead (see COMPACT_UPDATE_* in APIData.h).
  * @param updatedEntities Pointer to an array of pointers to EntityProperties containing physics updates generated this call.
  * @param collidersCount Pointer to the number of colliders detected this call.
  * @param colliders Pointer to an array of colliding object IDs (in pairs of two).
@@ -255,7 +257,7 @@ EXTERN_C DLL_EXPORT btCollisionShape* CreateConvexHullShape2(BulletSim* sim,
 
 EXTERN_C DLL_EXPORT btCollisionShape* CreateCompoundShape2(BulletSim* sim, bool enableDynamicAabbTree)
 {
-	btCompoundShape* cShape = new btCompoundShape(enableDynamicAabbTree);
+	btCompoundShape* cShape = sim->CreateCompoundShape(enableDynamicAabbTree);
 	bsDebug_RememberCollisionShape(cShape);
 	return cShape;
 }
@@ -316,25 +318,7 @@ EXTERN_C DLL_EXPORT Quaternion GetCompoundChildOrientation2(btCompoundShape* cSh
 
 EXTERN_C DLL_EXPORT btCollisionShape* BuildNativeShape2(BulletSim* sim, ShapeData shapeData)
 {
-	btCollisionShape* shape = NULL;
-	switch ((int)shapeData.Type)
-	{
-		case ShapeData::SHAPE_BOX:
-			// btBoxShape subtracts the collision margin from the half extents, so no 
-			// fiddling with scale necessary
-			// boxes are defined by their half extents
-			shape = new btBoxShape(btVector3(0.5, 0.5, 0.5));	// this is really a unit box
-			break;
-		case ShapeData::SHAPE_CONE:	// TODO:
-			shape = new btConeShapeZ(0.5, 1.0);
-			break;
-		case ShapeData::SHAPE_CYLINDER:	// TODO:
-			shape = new btCylinderShapeZ(btVector3(0.5f, 0.5f, 0.5f));
-			break;
-		case ShapeData::SHAPE_SPHERE:
-			shape = new btSphereShape(0.5);		// this is really a unit sphere
-			break;
-	}
+	btCollisionShape* shape = sim->CreateNativeShape((int)shapeData.Type);
 	if (shape != NULL)
 	{
 		shape->setMargin(btScalar(sim->getWorldData()->params->collisionMargin));
@@ -373,7 +357,7 @@ EXTERN_C DLL_EXPORT void SetShapeCollisionMargin(btCollisionShape* shape, float
 
 EXTERN_C DLL_EXPORT btCollisionShape* BuildCapsuleShape2(BulletSim* sim, float radius, float height, Vector3 scale)
 {
-	btCollisionShape* shape = new btCapsuleShapeZ(btScalar(radius), btScalar(height));
+	btCollisionShape* shape = sim->CreateCapsuleShape(btScalar(radius), btScalar(height));
 	if (shape)
 	{
 		shape->setMargin(sim->getWorldData()->params->collisionMargin);
@@ -388,7 +372,7 @@ EXTERN_C DLL_EXPORT bool DeleteCollisionShape2(BulletSim* sim, btCollisionShape*
 {
 	bsDebug_AssertIsKnownCollisionShape(shape, "DeleteCollisionShape2: not known shape");
 	bsDebug_ForgetCollisionShape(shape);
-	delete shape;
+	sim->DestroyCollisionShape(shape);
 	return true;
 }
 
@@ -418,7 +402,7 @@ EXTERN_C DLL_EXPORT btCollisionShape* DuplicateCollisionShape2(BulletSim* sim, b
 		{
 			btCompoundShape* srcCompShape = (btCompoundShape*)src;
 
-			btCompoundShape* newCompoundShape = new btCompoundShape(false);
+			btCompoundShape* newCompoundShape = sim->CreateCompoundShape(false);
 			int childCount = srcCompShape->getNumChildShapes();
 			btCompoundShapeChild* children = srcCompShape->getChildList();
 
@@ -459,9 +443,9 @@ EXTERN_C DLL_EXPORT btCollisionObject* CreateBodyFromShape2(BulletSim* sim, btCo
 	btTransform bodyTransform(rot.GetBtQuaternion(), pos.GetBtVector3());
 
 	// Use the BulletSim motion state so motion updates will be sent up
-	SimMotionState* motionState = new SimMotionState(id, bodyTransform, &(sim->getWorldData()->updatesThisFrame));
+	SimMotionState* motionState = sim->CreateMotionState(id, bodyTransform);
 	btRigidBody::btRigidBodyConstructionInfo cInfo(0.0, motionState, shape);
-	btRigidBody* body = new btRigidBody(cInfo);
+	btRigidBody* body = sim->CreateRigidBody(cInfo);
 	motionState->RigidBody = body;
 
 	body->setUserPointer(PACKLOCALID(id));
@@ -586,7 +570,7 @@ EXTERN_C DLL_EXPORT void DestroyObject2(BulletSim* sim, btCollisionObject* obj)
 		// If we added a motionState to the object, delete that
 		btMotionState* motionState = rb->getMotionState();
 		if (motionState)
-			delete motionState;
+			sim->DestroyMotionState(motionState);
 	}
 	
 	// Delete the rest of the memory allocated to this object
@@ -595,7 +579,7 @@ EXTERN_C DLL_EXPORT void DestroyObject2(BulletSim* sim, btCollisionObject* obj)
 	{
 		bsDebug_AssertIsKnownCollisionShape(shape, "DestroyObject2: unknown collisionShape");
 		bsDebug_ForgetCollisionShape(shape);
-		delete shape;
+		sim->DestroyCollisionShape(shape);
 	}
 
 	// Remove from special collision objects. A NOOP if not in the list.
@@ -604,7 +588,7 @@ EXTERN_C DLL_EXPORT void DestroyObject2(BulletSim* sim, btCollisionObject* obj)
 
 	// finally make the object itself go away
 	bsDebug_ForgetCollisionObject(obj);
-	delete obj;
+	sim->DestroyCollisionObject(obj);
 }
 
 // =====================================================================
@@ -1856,6 +1840,7 @@ EXTERN_C DLL_EXPORT bool AddObjectToWorld2(BulletSim* sim, btCollisionObject* ob
 {
 	bsDebug_AssertIsKnownCollisionObject(obj, "AddObjectToWorld2: unknown collisionObject");
 	bsDebug_AssertCollisionObjectIsNotInWorld(sim, obj, "AddObjectToWorld2: collisionObject already in world");
+	sim->EnsureBroadphaseRoom();
 	btRigidBody* rb = btRigidBody::upcast(obj);
 	if (rb)
 		sim->getDynamicsWorld()->addRigidBody(rb);
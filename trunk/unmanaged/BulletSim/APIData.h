@@ -317,6 +317,28 @@ struct EntityProperties
 	}
 };
 
+// Compact property updates.
+// If ParamBlock.useCompactUpdates is set, PhysicsStep2 does not return an array of
+//    EntityProperties. Instead the same pinned memory is filled with a stream of
+//    variable length, byte packed, little endian records and the returned update count
+//    is the number of records. Each record is:
+//        uint32_t ID
+//        uint8_t  fields         // COMPACT_UPDATE_* bits saying which of the following are present
+//        int24_t  position[3]    // region relative fixed point, 1/COMPACT_POSITION_SCALE meters
+//        uint32_t rotation       // smallest three: 2 bit index of the dropped component,
+//                                //    then three 10 bit components scaled from [-1/sqrt(2), 1/sqrt(2)]
+//        uint16_t velocity[3]    // IEEE half floats
+//        uint16_t angularVelocity[3]  // IEEE half floats
+// A record with all fields is 30 bytes compared to the 68 bytes of an EntityProperties.
+#define COMPACT_UPDATE_POSITION          (0x01)
+#define COMPACT_UPDATE_ROTATION          (0x02)
+#define COMPACT_UPDATE_VELOCITY          (0x04)
+#define COMPACT_UPDATE_ANGULARVELOCITY   (0x08)
+#define COMPACT_UPDATE_ALL               (0x0F)
+
+#define COMPACT_POSITION_SCALE (1024.0f)
+#define COMPACT_UPDATE_MAX_RECORD_SIZE (30)
+
 // added values for collision CFM and ERP setting so we can set all axis at once
 #define COLLISION_AXIS_LINEAR_ALL (20)
 #define COLLISION_AXIS_ANGULAR_ALL (21)
@@ -347,8 +369,22 @@ struct ParamBlock
 	float globalContactBreakingThreshold;
 
 	float physicsLoggingFrames;
+
+	float useCompactUpdates;		// if true, return property updates in the compact format
+
+	float broadphaseType;			// one of BS_BROADPHASE_* below
+	float broadphaseMaxProxies;		// max objects for the sweep and prune broadphases. Zero for default.
+										//    When full, the world switches to btDbvtBroadphase.
 };
 
+// Values for ParamBlock.broadphaseType
+#define BS_BROADPHASE_DBVT (0)			// btDbvtBroadphase. Dynamic AABB trees. Unbounded.
+#define BS_BROADPHASE_AXISSWEEP (1)		// btAxisSweep3. Sweep and prune over the region bounds. 16 bit handles.
+#define BS_BROADPHASE_AXISSWEEP32 (2)	// bt32BitAxisSweep3. Same as above with 32 bit handles for large regions.
+
+#define BS_BROADPHASE_DEFAULT_MAX_PROXIES (16384)
+#define BS_BROADPHASE_AXISSWEEP_MAX_PROXIES (32766)	// btAxisSweep3 limit
+
 
 // Block of parameters for HACD algorithm
 struct HACDParams
@@ -64,6 +64,9 @@ BulletSim::BulletSim(btScalar maxX, btScalar maxY, btScalar maxZ)
 
 	// Make sure structures that will be created in initPhysics are marked as not created
 	m_worldData.dynamicsWorld = NULL;
+	m_broadphase = NULL;
+	m_broadphaseType = BS_BROADPHASE_DBVT;
+	m_broadphaseMaxProxies = 0;
 
 	m_worldData.sim = this;
 
@@ -207,7 +210,7 @@ void BulletSim::initPhysics2(ParamBlock* parms,
 		m_worldData.BSLog("initPhysics2: adding CD_DISABLE_CONTACTPOOL_DYNAMIC_ALLOCATION to dispatcherFlags");
 	}
 
-	m_broadphase = new btDbvtBroadphase();
+	m_broadphase = CreateBroadphase();
 
 	// the following is needed to enable GhostObjects
 	m_broadphase->getOverlappingPairCache()->setInternalGhostPairCallback(new btGhostPairCallback());
@@ -304,6 +307,107 @@ void BulletSim::initPhysics2(ParamBlock* parms,
 
 }
 
+// Create the broadphase selected in the parameter block.
+// The sweep and prune broadphases need the bounds of the world. Objects can wander
+//    outside the region (crossings, falling below the terrain) so the region bounds
+//    are padded. Objects outside the bounds still work but are not pruned efficiently.
+btBroadphaseInterface* BulletSim::CreateBroadphase()
+{
+	btBroadphaseInterface* broadphase = NULL;
+
+	int broadphaseType = (int)m_worldData.params->broadphaseType;
+	int maxProxies = (int)m_worldData.params->broadphaseMaxProxies;
+	if (maxProxies <= 0)
+		maxProxies = BS_BROADPHASE_DEFAULT_MAX_PROXIES;
+
+	btVector3 padding = (m_worldData.MaxPosition - m_worldData.MinPosition) * 0.5;
+	btVector3 worldAabbMin = m_worldData.MinPosition - padding;
+	btVector3 worldAabbMax = m_worldData.MaxPosition + padding;
+
+	// The 16 bit version can only handle so many objects. Use the 32 bit one for more.
+	if (broadphaseType == BS_BROADPHASE_AXISSWEEP && maxProxies > BS_BROADPHASE_AXISSWEEP_MAX_PROXIES)
+	{
+		m_worldData.BSLog("initPhysics2: maxProxies=%d is too many for btAxisSweep3. Using bt32BitAxisSweep3", maxProxies);
+		broadphaseType = BS_BROADPHASE_AXISSWEEP32;
+	}
+
+	switch (broadphaseType)
+	{
+		case BS_BROADPHASE_AXISSWEEP:
+			broadphase = new btAxisSweep3(worldAabbMin, worldAabbMax, (unsigned short)maxProxies);
+			m_worldData.BSLog("initPhysics2: using btAxisSweep3 broadphase. maxProxies=%d", maxProxies);
+			break;
+		case BS_BROADPHASE_AXISSWEEP32:
+			broadphase = new bt32BitAxisSweep3(worldAabbMin, worldAabbMax, (unsigned int)maxProxies);
+			m_worldData.BSLog("initPhysics2: using bt32BitAxisSweep3 broadphase. maxProxies=%d", maxProxies);
+			break;
+		case BS_BROADPHASE_DBVT:
+		default:
+			broadphaseType = BS_BROADPHASE_DBVT;
+			maxProxies = 0;
+			broadphase = new btDbvtBroadphase();
+			break;
+	}
+	m_broadphaseType = broadphaseType;
+	m_broadphaseMaxProxies = maxProxies;
+	return broadphase;
+}
+
+// The sweep and prune broadphases have a fixed number of handles and Bullet only asserts
+//    when they run out, which corrupts the free handle list in a release build.
+//    When the sweep and prune broadphase is full, move all the objects into a
+//    btDbvtBroadphase, which has no limit, so the region keeps working.
+void BulletSim::EnsureBroadphaseRoom()
+{
+	if (m_broadphaseMaxProxies <= 0)
+		return;
+
+	int numProxies;
+	if (m_broadphaseType == BS_BROADPHASE_AXISSWEEP)
+		numProxies = ((btAxisSweep3*)m_broadphase)->getNumHandles();
+	else
+		numProxies = ((bt32BitAxisSweep3*)m_broadphase)->getNumHandles();
+
+	// Handle zero is reserved so there is room for one less than the max
+	if (numProxies < m_broadphaseMaxProxies - 1)
+		return;
+
+	m_worldData.BSLog("EnsureBroadphaseRoom: sweep and prune broadphase full with %d objects. Switching to btDbvtBroadphase", numProxies);
+
+	btDynamicsWorld* world = m_worldData.dynamicsWorld;
+	btBroadphaseInterface* newBroadphase = new btDbvtBroadphase();
+	newBroadphase->getOverlappingPairCache()->setInternalGhostPairCallback(new btGhostPairCallback());
+
+	// Take every object out of the world, remembering its collision filter. The base
+	//    class calls only remove the broadphase proxy and the collision object entry,
+	//    rigid bodies stay in the dynamics world lists.
+	btCollisionObjectArray objects = world->getCollisionObjectArray();
+	btAlignedObjectArray<int> groups;
+	btAlignedObjectArray<int> masks;
+	groups.resize(objects.size());
+	masks.resize(objects.size());
+	for (int ii = 0; ii < objects.size(); ii++)
+	{
+		btCollisionObject* obj = objects[ii];
+		btBroadphaseProxy* proxy = obj->getBroadphaseHandle();
+		groups[ii] = proxy ? proxy->m_collisionFilterGroup : btBroadphaseProxy::DefaultFilter;
+		masks[ii] = proxy ? proxy->m_collisionFilterMask : btBroadphaseProxy::AllFilter;
+		world->btCollisionWorld::removeCollisionObject(obj);
+	}
+
+	world->setBroadphase(newBroadphase);
+	delete m_broadphase;
+	m_broadphase = newBroadphase;
+	m_broadphaseType = BS_BROADPHASE_DBVT;
+	m_broadphaseMaxProxies = 0;
+
+	// Put them back in the same order
+	for (int ii = 0; ii < objects.size(); ii++)
+	{
+		world->btCollisionWorld::addCollisionObject(objects[ii], groups[ii], masks[ii]);
+	}
+}
+
 void BulletSim::exitPhysics2()
 {
 	if (m_worldData.dynamicsWorld == NULL)
@@ -338,6 +442,125 @@ void BulletSim::exitPhysics2()
 	}
 }
 
+// =====================================================================
+// Pooled object allocation.
+// The objects created for every prim (the body, its motion state and, usually, a simple
+//    shape) are allocated from per-world slabs. The pools are freed all at once when
+//    this BulletSim is deleted.
+SimMotionState* BulletSim::CreateMotionState(IDTYPE id, const btTransform& startTransform)
+{
+	return new (m_motionStatePool.allocate()) SimMotionState(id, startTransform, &m_worldData);
+}
+
+btRigidBody* BulletSim::CreateRigidBody(const btRigidBody::btRigidBodyConstructionInfo& cInfo)
+{
+	return new (m_rigidBodyPool.allocate()) btRigidBody(cInfo);
+}
+
+// Create one of the unit sized native shapes. Returns NULL if the type is not a native shape.
+btCollisionShape* BulletSim::CreateNativeShape(int shapeType)
+{
+	btCollisionShape* shape = NULL;
+	switch (shapeType)
+	{
+		case ShapeData::SHAPE_BOX:
+			// btBoxShape subtracts the collision margin from the half extents, so no 
+			// fiddling with scale necessary
+			// boxes are defined by their half extents
+			shape = new (m_boxShapePool.allocate()) btBoxShape(btVector3(0.5, 0.5, 0.5));	// this is really a unit box
+			break;
+		case ShapeData::SHAPE_CONE:	// TODO:
+			shape = new (m_coneShapePool.allocate()) btConeShapeZ(0.5, 1.0);
+			break;
+		case ShapeData::SHAPE_CYLINDER:	// TODO:
+			shape = new (m_cylinderShapePool.allocate()) btCylinderShapeZ(btVector3(0.5f, 0.5f, 0.5f));
+			break;
+		case ShapeData::SHAPE_SPHERE:
+			shape = new (m_sphereShapePool.allocate()) btSphereShape(0.5);		// this is really a unit sphere
+			break;
+	}
+	return shape;
+}
+
+btCollisionShape* BulletSim::CreateCapsuleShape(btScalar radius, btScalar height)
+{
+	return new (m_capsuleShapePool.allocate()) btCapsuleShapeZ(radius, height);
+}
+
+btCompoundShape* BulletSim::CreateCompoundShape(bool enableDynamicAabbTree)
+{
+	return new (m_compoundShapePool.allocate()) btCompoundShape(enableDynamicAabbTree);
+}
+
+void BulletSim::DestroyMotionState(btMotionState* motionState)
+{
+	if (m_motionStatePool.owns(motionState))
+		m_motionStatePool.release((SimMotionState*)motionState);
+	else
+		delete motionState;
+}
+
+void BulletSim::DestroyCollisionObject(btCollisionObject* obj)
+{
+	if (m_rigidBodyPool.owns(obj))
+		m_rigidBodyPool.release((btRigidBody*)obj);
+	else
+		delete obj;
+}
+
+// Note: like DeleteCollisionShape2, this does not do a deep deletion of compound shapes.
+void BulletSim::DestroyCollisionShape(btCollisionShape* shape)
+{
+	switch (shape->getShapeType())
+	{
+		case BOX_SHAPE_PROXYTYPE:
+			if (m_boxShapePool.owns(shape))
+			{
+				m_boxShapePool.release((btBoxShape*)shape);
+				return;
+			}
+			break;
+		case SPHERE_SHAPE_PROXYTYPE:
+			if (m_sphereShapePool.owns(shape))
+			{
+				m_sphereShapePool.release((btSphereShape*)shape);
+				return;
+			}
+			break;
+		case CONE_SHAPE_PROXYTYPE:
+			if (m_coneShapePool.owns(shape))
+			{
+				m_coneShapePool.release((btConeShapeZ*)shape);
+				return;
+			}
+			break;
+		case CYLINDER_SHAPE_PROXYTYPE:
+			if (m_cylinderShapePool.owns(shape))
+			{
+				m_cylinderShapePool.release((btCylinderShapeZ*)shape);
+				return;
+			}
+			break;
+		case CAPSULE_SHAPE_PROXYTYPE:
+			if (m_capsuleShapePool.owns(shape))
+			{
+				m_capsuleShapePool.release((btCapsuleShapeZ*)shape);
+				return;
+			}
+			break;
+		case COMPOUND_SHAPE_PROXYTYPE:
+			if (m_compoundShapePool.owns(shape))
+			{
+				m_compoundShapePool.release((btCompoundShape*)shape);
+				return;
+			}
+			break;
+		default:
+			break;
+	}
+	delete shape;
+}
+
 // Step the simulation forward by one full step and potentially some number of substeps
 int BulletSim::PhysicsStep2(btScalar timeStep, int maxSubSteps, btScalar fixedTimeStep, int* updatedEntityCount, int* collidersCount)
 {
@@ -370,13 +593,21 @@ int BulletSim::PhysicsStep2(btScalar timeStep, int maxSubSteps, btScalar fixedTi
 		int updates = 0;
 		if (m_worldData.updatesThisFrame.size() > 0)
 		{
-			WorldData::UpdatesThisFrameMapType::const_iterator it = m_worldData.updatesThisFrame.begin(); 
-			for (; it != m_worldData.updatesThisFrame.end(); it++)
+			if (m_worldData.params->useCompactUpdates != ParamFalse)
 			{
-				m_updatesThisFrameArray[updates] = *(it->second);
-				updates++;
-				if (updates >= m_maxUpdatesPerFrame) 
-					break;
+				updates = PackCompactUpdates();
+			}
+			else
+			{
+				WorldData::UpdatesThisFrameMapType::const_iterator it = m_worldData.updatesThisFrame.begin(); 
+				for (; it != m_worldData.updatesThisFrame.end(); it++)
+				{
+					m_updatesThisFrameArray[updates] = it->second->GetProperties();
+					it->second->ClearUpdatedFields();
+					updates++;
+					if (updates >= m_maxUpdatesPerFrame) 
+						break;
+				}
 			}
 			m_worldData.updatesThisFrame.clear();
 		}
@@ -390,6 +621,147 @@ int BulletSim::PhysicsStep2(btScalar timeStep, int maxSubSteps, btScalar fixedTi
 	return numSimSteps;
 }
 
+// Helpers for writing the compact update records. All values are written little endian
+//    a byte at a time so the layout does not depend on the architecture.
+static unsigned char* PackUInt16(unsigned char* dst, uint16_t val)
+{
+	dst[0] = (unsigned char)(val);
+	dst[1] = (unsigned char)(val >> 8);
+	return dst + 2;
+}
+
+static unsigned char* PackUInt32(unsigned char* dst, uint32_t val)
+{
+	dst[0] = (unsigned char)(val);
+	dst[1] = (unsigned char)(val >> 8);
+	dst[2] = (unsigned char)(val >> 16);
+	dst[3] = (unsigned char)(val >> 24);
+	return dst + 4;
+}
+
+// Region relative fixed point in a signed 24 bit value. Out of range values are clamped.
+static unsigned char* PackFixed24(unsigned char* dst, float val)
+{
+	float scaled = val * COMPACT_POSITION_SCALE;
+	int32_t fixed;
+	if (scaled >= 8388607.0f)
+		fixed = 8388607;
+	else if (scaled <= -8388608.0f)
+		fixed = -8388608;
+	else
+		fixed = (int32_t)floorf(scaled + 0.5f);
+	uint32_t bits = (uint32_t)fixed;
+	dst[0] = (unsigned char)(bits);
+	dst[1] = (unsigned char)(bits >> 8);
+	dst[2] = (unsigned char)(bits >> 16);
+	return dst + 3;
+}
+
+// Convert a float to an IEEE 754 half float with round to nearest.
+// Values too large for a half become the largest half. Values too small become zero.
+static uint16_t FloatToHalf(float val)
+{
+	union { float f; uint32_t u; } bits;
+	bits.f = val;
+	uint16_t sign = (uint16_t)((bits.u >> 16) & 0x8000);
+	uint32_t absBits = bits.u & 0x7fffffff;
+
+	if (absBits > 0x7f800000)
+		return sign | 0x7e00;			// NaN
+	if (absBits >= 0x477ff000)
+		return sign | 0x7bff;			// clamp to 65504
+	if (absBits < 0x38800000)
+	{
+		// Result is a denormal half or zero
+		if (absBits < 0x33000000)
+			return sign;
+		uint32_t mant = (absBits & 0x007fffff) | 0x00800000;
+		int shift = 126 - (int)(absBits >> 23);
+		uint32_t half = mant >> shift;
+		if ((mant >> (shift - 1)) & 1)
+			half++;
+		return sign | (uint16_t)half;
+	}
+	uint32_t half = ((absBits - 0x38000000) >> 13);
+	if (absBits & 0x00001000)
+		half++;
+	return sign | (uint16_t)half;
+}
+
+static unsigned char* PackHalfVector(unsigned char* dst, const Vector3& vec)
+{
+	dst = PackUInt16(dst, FloatToHalf(vec.X));
+	dst = PackUInt16(dst, FloatToHalf(vec.Y));
+	dst = PackUInt16(dst, FloatToHalf(vec.Z));
+	return dst;
+}
+
+// Smallest three quaternion compression. The largest component is dropped (it can be
+//    recomputed from the other three since the quaternion is normalized) and its sign
+//    is folded into the others. Each remaining component fits in [-1/sqrt(2), 1/sqrt(2)].
+static uint32_t PackSmallestThree(const Quaternion& rot)
+{
+	float comp[4] = { rot.X, rot.Y, rot.Z, rot.W };
+	int largest = 0;
+	for (int ii = 1; ii < 4; ii++)
+	{
+		if (fabsf(comp[ii]) > fabsf(comp[largest]))
+			largest = ii;
+	}
+	float sign = comp[largest] < 0.0f ? -1.0f : 1.0f;
+
+	uint32_t packed = (uint32_t)largest << 30;
+	int shift = 20;
+	for (int ii = 0; ii < 4; ii++)
+	{
+		if (ii == largest)
+			continue;
+		float normalized = (comp[ii] * sign * SIMD_SQRT12 * 2.0f + 1.0f) * 0.5f;	// 0..1
+		if (normalized < 0.0f) normalized = 0.0f;
+		if (normalized > 1.0f) normalized = 1.0f;
+		packed |= ((uint32_t)(normalized * 1023.0f + 0.5f)) << shift;
+		shift -= 10;
+	}
+	return packed;
+}
+
+// Write the updates for this frame as compact records into the pinned update memory.
+// Returns the number of records written.
+int BulletSim::PackCompactUpdates()
+{
+	unsigned char* dst = (unsigned char*)m_updatesThisFrameArray;
+	unsigned char* end = dst + (size_t)m_maxUpdatesPerFrame * sizeof(EntityProperties);
+	int updates = 0;
+
+	WorldData::UpdatesThisFrameMapType::const_iterator it = m_worldData.updatesThisFrame.begin(); 
+	for (; it != m_worldData.updatesThisFrame.end(); it++)
+	{
+		if (dst + COMPACT_UPDATE_MAX_RECORD_SIZE > end)
+			break;
+
+		const EntityProperties& props = it->second->GetProperties();
+		unsigned char fields = it->second->GetUpdatedFields();
+		it->second->ClearUpdatedFields();
+
+		dst = PackUInt32(dst, props.ID);
+		*dst++ = fields;
+		if (fields & COMPACT_UPDATE_POSITION)
+		{
+			dst = PackFixed24(dst, props.Position.X - m_worldData.MinPosition.getX());
+			dst = PackFixed24(dst, props.Position.Y - m_worldData.MinPosition.getY());
+			dst = PackFixed24(dst, props.Position.Z - m_worldData.MinPosition.getZ());
+		}
+		if (fields & COMPACT_UPDATE_ROTATION)
+			dst = PackUInt32(dst, PackSmallestThree(props.Rotation));
+		if (fields & COMPACT_UPDATE_VELOCITY)
+			dst = PackHalfVector(dst, props.Velocity);
+		if (fields & COMPACT_UPDATE_ANGULARVELOCITY)
+			dst = PackHalfVector(dst, props.AngularVelocity);
+		updates++;
+	}
+	return updates;
+}
+
 void BulletSim::RecordCollision(const btCollisionObject* objA, const btCollisionObject* objB, 
 					const btVector3& contact, const btVector3& norm, const float penetration)
 {
@@ -563,7 +935,7 @@ btCollisionShape* BulletSim::CreateGImpactShape2(int indicesCount, int* indices,
 btCollisionShape* BulletSim::CreateHullShape2(int hullCount, float* hulls )
 {
 	// Create a compound shape that will wrap the set of convex hulls
-	btCompoundShape* compoundShape = new btCompoundShape(false);
+	btCompoundShape* compoundShape = CreateCompoundShape(false);
 
 	btTransform childTrans;
 	childTrans.setIdentity();
@@ -688,7 +1060,7 @@ btCollisionShape* BulletSim::BuildHullShapeFromMesh2(btCollisionShape* mesh, HAC
 	m_worldData.BSLog("HACD: After compute. nHulls=%d", nHulls);	// DEBUG DEBUG
 
 	// Create the compound shape all the hulls will be added to
-	btCompoundShape* compoundShape = new btCompoundShape(true);
+	btCompoundShape* compoundShape = CreateCompoundShape(true);
 	compoundShape->setMargin(m_worldData.params->collisionMargin);
 
 	// Convert each of the built hulls into btConvexHullShape objects and add to the compoundShape
@@ -881,7 +1253,7 @@ btCollisionShape* BulletSim::BuildVHACDHullShapeFromMesh2(btCollisionShape* mesh
 	m_worldData.BSLog("VHACD: After compute. nHulls=%d", nConvexHulls);	// DEBUG DEBUG
 
 	// Create the compound shape all the hulls will be added to
-	btCompoundShape* compoundShape = new btCompoundShape(true);
+	btCompoundShape* compoundShape = CreateCompoundShape(true);
 	compoundShape->setMargin(m_worldData.params->collisionMargin);
 
 	// Convert each of the built hulls into btConvexHullShape objects and add to the compoundShape
@@ -34,6 +34,7 @@
 #include "ArchStuff.h"
 #include "APIData.h"
 #include "WorldData.h"
+#include "ObjectPool.h"
 
 #include "BulletCollision/CollisionDispatch/btGhostObject.h"
 #include "LinearMath/btAlignedObjectArray.h"
@@ -57,7 +58,9 @@
 // #define USEVHACD 1
 
 // TODO: find a way to build this
-static char BulletSimVersionString[] = "v0003";
+// Bumped when ParamBlock or another block shared with the managed code changes layout
+//    (v0004: ParamBlock.useCompactUpdates, v0005: ParamBlock.broadphaseType and broadphaseMaxProxies)
+static char BulletSimVersionString[] = "v0005";
 
 // Helper method to determine if an object is phantom or not
 static bool IsPhantom(const btCollisionObject* obj)
@@ -79,18 +82,25 @@ public:
 	btRigidBody* RigidBody;
 	Vector3 ZeroVect;
 
-    SimMotionState(IDTYPE id, const btTransform& startTransform, std::map<IDTYPE, EntityProperties*>* updatesThisFrame)
+    SimMotionState(IDTYPE id, const btTransform& startTransform, WorldData* worldData)
 		: m_properties(id, startTransform), m_lastProperties(id, startTransform)
 	{
         m_xform = startTransform;
-		m_updatesThisFrame = updatesThisFrame;
+		m_worldData = worldData;
+		m_updatedFields = 0;
     }
 
     virtual ~SimMotionState()
 	{
-		m_updatesThisFrame->erase(m_properties.ID);
+		m_worldData->updatesThisFrame.erase(m_properties.ID);
     }
 
+	const EntityProperties& GetProperties() const { return m_properties; }
+
+	// The COMPACT_UPDATE_* bits for the properties that changed since the last fetch
+	unsigned char GetUpdatedFields() const { return m_updatedFields; }
+	void ClearUpdatedFields() { m_updatedFields = 0; }
+
     virtual void getWorldTransform(btTransform& worldTrans) const
 	{
         worldTrans = m_xform;
@@ -135,27 +145,53 @@ public:
 		// TODO: decide of this 'if' statement is needed. Since the updates are kept by ID,
 		//     couldn't we just always put any update into the map? The only down side would
 		//     be sending updates every tick for very small jiggles which happen over a long period of time.
-		if (force
-			|| !m_properties.Position.AlmostEqual(m_lastProperties.Position, POSITION_TOLERANCE)
-			|| !m_properties.Rotation.AlmostEqual(m_lastProperties.Rotation, ROTATION_TOLERANCE)
-			// If the Velocity and AngularVelocity are zero, most likely the object has
-			//    been deactivated. If they both are zero and they have become zero recently,
-			//    make sure a property update is sent so the zeros make it to the viewer.
-			|| ((m_properties.Velocity == ZeroVect && m_properties.AngularVelocity == ZeroVect)
-				&& (m_properties.Velocity != m_lastProperties.Velocity || m_properties.AngularVelocity != m_lastProperties.AngularVelocity))
-			//	If Velocity and AngularVelocity are non-zero but have changed, send an update.
-			|| !m_properties.Velocity.AlmostEqual(m_lastProperties.Velocity, VELOCITY_TOLERANCE)
-			|| !m_properties.AngularVelocity.AlmostEqual(m_lastProperties.AngularVelocity, ANGULARVELOCITY_TOLERANCE)
-			)
+		unsigned char changed = 0;
+		if (force)
+			changed = COMPACT_UPDATE_ALL;
+		if (!m_properties.Position.AlmostEqual(m_lastProperties.Position, POSITION_TOLERANCE))
+			changed |= COMPACT_UPDATE_POSITION;
+		if (!m_properties.Rotation.AlmostEqual(m_lastProperties.Rotation, ROTATION_TOLERANCE))
+			changed |= COMPACT_UPDATE_ROTATION;
+		// If the Velocity and AngularVelocity are zero, most likely the object has
+		//    been deactivated. If they both are zero and they have become zero recently,
+		//    make sure a property update is sent so the zeros make it to the viewer.
+		if ((m_properties.Velocity == ZeroVect && m_properties.AngularVelocity == ZeroVect)
+			&& (m_properties.Velocity != m_lastProperties.Velocity || m_properties.AngularVelocity != m_lastProperties.AngularVelocity))
+			changed |= COMPACT_UPDATE_VELOCITY | COMPACT_UPDATE_ANGULARVELOCITY;
+		//	If Velocity and AngularVelocity are non-zero but have changed, send an update.
+		if (!m_properties.Velocity.AlmostEqual(m_lastProperties.Velocity, VELOCITY_TOLERANCE))
+			changed |= COMPACT_UPDATE_VELOCITY;
+		if (!m_properties.AngularVelocity.AlmostEqual(m_lastProperties.AngularVelocity, ANGULARVELOCITY_TOLERANCE))
+			changed |= COMPACT_UPDATE_ANGULARVELOCITY;
+
+		if (changed != 0)
 		{
+			if (m_worldData->params->useCompactUpdates != ParamFalse)
+			{
+				// Compact updates only carry the changed fields so only those become the
+				//    new reference. Otherwise small changes could creep by unreported.
+				if (changed & COMPACT_UPDATE_POSITION)
+					m_lastProperties.Position = m_properties.Position;
+				if (changed & COMPACT_UPDATE_ROTATION)
+					m_lastProperties.Rotation = m_properties.Rotation;
+				if (changed & COMPACT_UPDATE_VELOCITY)
+					m_lastProperties.Velocity = m_properties.Velocity;
+				if (changed & COMPACT_UPDATE_ANGULARVELOCITY)
+					m_lastProperties.AngularVelocity = m_properties.AngularVelocity;
+			}
+			else
+			{
+				m_lastProperties = m_properties;
+			}
 			// Add this update to the list of updates for this frame.
-			m_lastProperties = m_properties;
-			(*m_updatesThisFrame)[m_properties.ID] = &m_properties;
+			m_updatedFields |= changed;
+			m_worldData->updatesThisFrame[m_properties.ID] = this;
 		}
     }
 
 private:
-	std::map<IDTYPE, EntityProperties*>* m_updatesThisFrame;
+	WorldData* m_worldData;
+	unsigned char m_updatedFields;
     btTransform m_xform;
 	EntityProperties m_properties;
 	EntityProperties m_lastProperties;
@@ -261,6 +297,10 @@ class BulletSim
 private:
 	// Bullet world objects
 	btBroadphaseInterface* m_broadphase;
+	// The kind of broadphase and, for the sweep and prune ones, how many handles it was
+	//    created with. Zero for btDbvtBroadphase which has no limit.
+	int m_broadphaseType;
+	int m_broadphaseMaxProxies;
 	btCollisionDispatcher* m_dispatcher;
 	btConstraintSolver*	m_solver;
 	btDefaultCollisionConfiguration* m_collisionConfiguration;
@@ -278,6 +318,18 @@ private:
 	CollisionDesc* m_collidersThisFrameArray;
 	std::set<COLLIDERKEYTYPE> m_collidersThisFrame;
 
+	// Per-world pools for the objects created for every prim. Allocating these from
+	//    slabs rather than individually keeps them close together in memory and makes
+	//    region load and teardown much cheaper. Objects not from a pool are heap allocated.
+	ObjectPool<SimMotionState> m_motionStatePool;
+	ObjectPool<btRigidBody> m_rigidBodyPool;
+	ObjectPool<btBoxShape> m_boxShapePool;
+	ObjectPool<btSphereShape> m_sphereShapePool;
+	ObjectPool<btConeShapeZ> m_coneShapePool;
+	ObjectPool<btCylinderShapeZ> m_cylinderShapePool;
+	ObjectPool<btCapsuleShapeZ> m_capsuleShapePool;
+	ObjectPool<btCompoundShape> m_compoundShapePool;
+
 public:
 
 	BulletSim(btScalar maxX, btScalar maxY, btScalar maxZ);
@@ -300,6 +352,18 @@ public:
 	btCollisionShape* BuildConvexHullShapeFromMesh2(btCollisionShape* mesh);
 	btCollisionShape* CreateConvexHullShape2(int indicesCount, int* indices, int verticesCount, float* vertices);
 
+	// Allocation of pooled objects. These must be released with the Destroy* routines below.
+	SimMotionState* CreateMotionState(IDTYPE id, const btTransform& startTransform);
+	btRigidBody* CreateRigidBody(const btRigidBody::btRigidBodyConstructionInfo& cInfo);
+	btCollisionShape* CreateNativeShape(int shapeType);
+	btCollisionShape* CreateCapsuleShape(btScalar radius, btScalar height);
+	btCompoundShape* CreateCompoundShape(bool enableDynamicAabbTree);
+
+	// Release an object to its pool or, if it did not come from a pool, delete it
+	void DestroyMotionState(btMotionState* motionState);
+	void DestroyCollisionObject(btCollisionObject* obj);
+	void DestroyCollisionShape(btCollisionShape* shape);
+
 	// Collisions: called to add a collision record to the collisions for a simulation step
 	int maxCollisionsPerFrame;
 	int collisionsThisFrame;
@@ -314,10 +378,15 @@ public:
 	WorldData* getWorldData() { return &m_worldData; }
 	btDynamicsWorld* getDynamicsWorld() { return m_worldData.dynamicsWorld; };
 
+	// Called before an object is added to the world
+	void EnsureBroadphaseRoom();
+
 	bool UpdateParameter2(IDTYPE localID, const char* parm, float value);
 	void DumpPhysicsStats();
 
 protected:
+	btBroadphaseInterface* CreateBroadphase();
+	int PackCompactUpdates();
 	void CreateGroundPlane();
 	void CreateTerrain();
 };
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) Contributors, http://opensimulator.org/
+ * See CONTRIBUTORS.TXT for a full list of copyright holders.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyrightD
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the OpenSimulator Project nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE DEVELOPERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include "LinearMath/btScalar.h"
+#include "LinearMath/btAlignedAllocator.h"
+#include "LinearMath/btAlignedObjectArray.h"
+
+#include <new>
+
+// Alignment of pool elements. Bullet math types want 16 byte alignment for SIMD.
+#define OBJECT_POOL_ALIGNMENT 16
+
+// Default number of elements allocated in one slab when the pool needs to grow.
+#define OBJECT_POOL_DEFAULT_SLAB_ELEMENTS 1024
+
+// ============================================================================================
+// A growable slab allocator for one type of object.
+// Memory is requested from the system in slabs of many elements so a region with tens
+//    of thousands of prims does not make tens of thousands of small heap allocations.
+//    Released elements go on a free list and are reused by the next allocation.
+// Like btPoolAllocator, but the pool grows by adding slabs rather than being fixed size.
+// Slabs are only returned to the system when the pool is destroyed. Any objects still
+//    allocated at that time are NOT destructed, so the pool should only be destroyed
+//    when the objects are no longer referenced (i.e. when the BulletSim is deleted).
+template <class T>
+class ObjectPool
+{
+public:
+	ObjectPool(int slabElements = OBJECT_POOL_DEFAULT_SLAB_ELEMENTS)
+		: m_slabElements(slabElements), m_liveCount(0), m_firstFree(NULL)
+	{
+		// Round the element size up so every element is aligned and can hold the free list link
+		size_t size = sizeof(T) < sizeof(void*) ? sizeof(void*) : sizeof(T);
+		m_elemSize = (size + (OBJECT_POOL_ALIGNMENT - 1)) & ~(size_t)(OBJECT_POOL_ALIGNMENT - 1);
+	}
+
+	~ObjectPool()
+	{
+		for (int ii = 0; ii < m_slabs.size(); ii++)
+		{
+			btAlignedFree(m_slabs[ii]);
+		}
+		m_slabs.clear();
+	}
+
+	// Return uninitialized memory for one element. Use with placement new.
+	void* allocate()
+	{
+		if (m_firstFree == NULL)
+			addSlab();
+		void* result = m_firstFree;
+		m_firstFree = *(void**)m_firstFree;
+		m_liveCount++;
+		return result;
+	}
+
+	// Destruct an object that was allocated from this pool and put its memory on the free list
+	void release(T* obj)
+	{
+		if (obj != NULL)
+		{
+			btAssert(owns(obj));
+			obj->~T();
+			*(void**)obj = m_firstFree;
+			m_firstFree = obj;
+			m_liveCount--;
+		}
+	}
+
+	// Return 'true' if the passed pointer is an element of this pool
+	bool owns(const void* ptr) const
+	{
+		const unsigned char* p = (const unsigned char*)ptr;
+		size_t slabBytes = m_elemSize * m_slabElements;
+		for (int ii = 0; ii < m_slabs.size(); ii++)
+		{
+			if (p >= m_slabs[ii] && p < m_slabs[ii] + slabBytes)
+				return true;
+		}
+		return false;
+	}
+
+	int getLiveCount() const { return m_liveCount; }
+	int getCapacity() const { return m_slabs.size() * m_slabElements; }
+
+private:
+	// Allocate another slab and thread all of its elements onto the free list.
+	// Elements are linked in address order so successive allocations are adjacent in memory.
+	void addSlab()
+	{
+		unsigned char* slab = (unsigned char*)btAlignedAlloc(m_elemSize * m_slabElements, OBJECT_POOL_ALIGNMENT);
+		m_slabs.push_back(slab);
+
+		unsigned char* p = slab;
+		for (int ii = 0; ii < m_slabElements - 1; ii++)
+		{
+			*(void**)p = p + m_elemSize;
+			p += m_elemSize;
+		}
+		*(void**)p = m_firstFree;
+		m_firstFree = slab;
+	}
+
+	size_t m_elemSize;
+	int m_slabElements;
+	int m_liveCount;
+	void* m_firstFree;
+	btAlignedObjectArray<unsigned char*> m_slabs;
+
+	// Pools are owned by one BulletSim instance and are not copyable
+	ObjectPool(const ObjectPool&);
+	ObjectPool& operator=(const ObjectPool&);
+};
+
+#endif // OBJECT_POOL_H
@@ -44,6 +44,7 @@ class HeightMapData;
 class IPhysObject;
 class TerrainObject;
 class GroundPlaneObject;
+class SimMotionState;
 
 // template for debugging call
 typedef void DebugLogCallback(const char*);
@@ -63,7 +64,7 @@ struct WorldData
 	btVector3 MaxPosition;
 
 	// Used to expose updates from Bullet to the BulletSim API
-	typedef std::map<IDTYPE, EntityProperties*> UpdatesThisFrameMapType;
+	typedef std::map<IDTYPE, SimMotionState*> UpdatesThisFrameMapType;
 	UpdatesThisFrameMapType updatesThisFrame;
 
 	// Some collisionObjects can set themselves up for special collision processing.
@@ -9,7 +9,7 @@
  *	- CPU comparisons used when appropriate
  *	- lazy evaluation sometimes saves some work in case of early exits (unlike SOLID)
  *
- *	\param		ea	[in] extents from box A
+ *	\param		box_ea	[in] extents from box A, before the temporal coherence margin
  *	\param		ca	[in] center from box A
  *	\param		eb	[in] extents from box B
  *	\param		cb	[in] center from box B
@@ -17,11 +17,14 @@
  */
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-inline_ BOOL AABBTreeCollider::BoxBoxOverlap(const Point& ea, const Point& ca, const Point& eb, const Point& cb)
+inline_ BOOL AABBTreeCollider::BoxBoxOverlap(const Point& box_ea, const Point& ca, const Point& eb, const Point& cb)
 {
 	// Stats
 	mNbBVBVTests++;
 
+	// Box A grown by the temporal coherence margin, zero outside of coherence queries
+	const Point ea(box_ea.x + mMargin, box_ea.y + mMargin, box_ea.z + mMargin);
+
 	float t,t2;
 
 	// Class I : A's basis vectors
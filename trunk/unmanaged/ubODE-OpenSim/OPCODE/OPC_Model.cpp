@@ -178,6 +178,45 @@ bool Model::Build(const OPCODECREATE& create)
 	return true;
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Sets up a collision model from a tree written by AABBNoLeafTree::ExportNodes, without building it.
+ *	\param		imesh		[in] mesh interface the tree was built for
+ *	\param		nodes		[in] exported nodes (none for 1-triangle meshes)
+ *	\param		nb_nodes	[in] number of nodes
+ *	\return		true if success
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Model::Import(const MeshInterface* imesh, const udword* nodes, udword nb_nodes)
+{
+	// Checkings
+	if(!imesh || !imesh->IsValid())	return false;
+
+	Release();
+	mModelCode &= ~OPC_SINGLE_NODE;
+
+	SetMeshInterface(imesh);
+
+	// Special case for 1-triangle meshes, as in Build()
+	udword NbTris = imesh->GetNbTriangles();
+	if(NbTris==1)
+	{
+		if(nb_nodes)	return false;
+		mModelCode |= OPC_SINGLE_NODE;
+		return true;
+	}
+
+	if(!CreateTree())	return false;
+
+	// CreateTree() always makes a no-leaf tree
+	if(!static_cast<AABBNoLeafTree*>(mTree)->ImportNodes(nodes, nb_nodes, NbTris))
+	{
+		DELETESINGLE(mTree);
+		return false;
+	}
+	return true;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  *	Gets the number of bytes used by the tree.
@@ -36,6 +36,17 @@
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		override(BaseModel)	bool				Build(const OPCODECREATE& create);
 
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Sets up a collision model from a tree written by AABBNoLeafTree::ExportNodes, without building it.
+		 *	\param		imesh		[in] mesh interface the tree was built for
+		 *	\param		nodes		[in] exported nodes (none for 1-triangle meshes)
+		 *	\param		nb_nodes	[in] number of nodes
+		 *	\return		true if success
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+							bool				Import(const MeshInterface* imesh, const udword* nodes, udword nb_nodes);
+
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		/**
 		 *	Gets the number of bytes used by the tree.
@@ -399,6 +399,80 @@ bool AABBNoLeafTree::Refit(const MeshInterface* mesh_interface)
 }
 
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Writes a relocatable copy of the nodes.
+ *	\param		data		[out] mNbNodes * OPC_NOLEAF_EXPORT_SIZE udwords
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void AABBNoLeafTree::ExportNodes(udword* data) const
+{
+	for(udword i=0;i<mNbNodes;i++)
+	{
+		const AABBNoLeafNode& Current = mNodes[i];
+		CopyMemory(data, &Current.mAABB.mCenter.x, 3*sizeof(float));
+		CopyMemory(data+3, &Current.mAABB.mExtents.x, 3*sizeof(float));
+
+		// Children as node indices, leaves are kept as they are
+		if(Current.HasPosLeaf())	data[6] = udword(Current.mPosData);
+		else						data[6] = udword(Current.GetPos() - mNodes)<<1;
+		if(Current.HasNegLeaf())	data[7] = udword(Current.mNegData);
+		else						data[7] = udword(Current.GetNeg() - mNodes)<<1;
+
+		data += OPC_NOLEAF_EXPORT_SIZE;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Sets the nodes from a copy written by ExportNodes. Children must come after their parent, as
+ *	Build() puts them, so a damaged copy can not make the collision queries loop.
+ *	\param		data		[in] nodes as written by ExportNodes
+ *	\param		nb_nodes	[in] number of nodes
+ *	\param		nb_prims	[in] number of primitives of the mesh, to check the copy
+ *	\return		true if success, false if the copy is not a valid tree
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool AABBNoLeafTree::ImportNodes(const udword* data, udword nb_nodes, udword nb_prims)
+{
+	// Checkings
+	if(!data || nb_prims<2 || nb_nodes!=nb_prims-1)	return false;
+
+	for(udword i=0;i<nb_nodes;i++)
+	{
+		const udword* Links = data + i*OPC_NOLEAF_EXPORT_SIZE + 6;
+		for(udword j=0;j<2;j++)
+		{
+			udword Index = Links[j]>>1;
+			if(Links[j]&1)	{ if(Index>=nb_prims)				return false; }
+			else			{ if(Index<=i || Index>=nb_nodes)	return false; }
+		}
+	}
+
+	if(mNbNodes!=nb_nodes)
+	{
+		mNbNodes = nb_nodes;
+		DELETEARRAY(mNodes);
+		mNodes = new AABBNoLeafNode[mNbNodes];
+		CHECKALLOC(mNodes);
+	}
+
+	for(udword i=0;i<mNbNodes;i++)
+	{
+		AABBNoLeafNode& Current = mNodes[i];
+		CopyMemory(&Current.mAABB.mCenter.x, data, 3*sizeof(float));
+		CopyMemory(&Current.mAABB.mExtents.x, data+3, 3*sizeof(float));
+
+		if(data[6]&1)	Current.mPosData = size_t(data[6]);
+		else			Current.mPosData = (size_t)&mNodes[data[6]>>1];
+		if(data[7]&1)	Current.mNegData = size_t(data[7]);
+		else			Current.mNegData = (size_t)&mNodes[data[7]>>1];
+
+		data += OPC_NOLEAF_EXPORT_SIZE;
+	}
+	return true;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  *	Walks the tree and call the user back for each node.
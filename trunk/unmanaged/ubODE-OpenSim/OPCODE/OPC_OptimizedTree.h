@@ -159,9 +159,34 @@
 		IMPLEMENT_COLLISION_TREE(AABBCollisionTree, AABBCollisionNode)
 	};
 
+	//! Size of a node in a relocatable copy of a no-leaf tree, in udwords
+	#define OPC_NOLEAF_EXPORT_SIZE	8
+
 	class OPCODE_API AABBNoLeafTree : public AABBOptimizedTree
 	{
 		IMPLEMENT_COLLISION_TREE(AABBNoLeafTree, AABBNoLeafNode)
+
+		public:
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Writes a relocatable copy of the nodes: OPC_NOLEAF_EXPORT_SIZE udwords per node, the box
+		 *	center and extents as float bits then the positive and negative data, with node indices
+		 *	instead of node pointers.
+		 *	\param		data			[out] mNbNodes * OPC_NOLEAF_EXPORT_SIZE udwords
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+						void				ExportNodes(udword* data)	const;
+
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Sets the nodes from a copy written by ExportNodes.
+		 *	\param		data			[in] nodes as written by ExportNodes
+		 *	\param		nb_nodes		[in] number of nodes
+		 *	\param		nb_prims		[in] number of primitives of the mesh, to check the copy
+		 *	eturn		true if success, false if the copy is not a valid tree
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+						bool				ImportNodes(const udword* data, udword nb_nodes, udword nb_prims);
 	};
 
 #endif // __OPC_OPTIMIZEDTREE_H__
@@ -48,6 +48,10 @@ AABBTreeCollider::AABBTreeCollider() :
 	mNbBVBVTests		(0),
 	mNbPrimPrimTests	(0),
 	mNbBVPrimTests		(0),
+	mCandidates			(null),
+	mMargin				(0.0f),
+	mNodes0				(null),
+	mNodes1				(null),
 	mFullBoxBoxTest		(true),
 	mFullPrimBoxTest	(true)
 {
@@ -333,6 +337,43 @@ void AABBTreeCollider::_Collide(const AABBCollisionNode* b0, const AABBCollision
 // No-leaf trees
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Kinds of the pairs of a kept walk, in the low bits of their first entry
+#define OPC_TC_BOX_BOX	0		//!< Node from A and node from B
+#define OPC_TC_TRI_BOX	1		//!< Leaf triangle from A and node from B
+#define OPC_TC_BOX_TRI	2		//!< Node from A and leaf triangle from B
+#define OPC_TC_TRI_TRI	3		//!< Two triangles
+#define OPC_TC_KIND		3
+#define OPC_TC_ROBUST	4		//!< Box pairs: they overlap with the box shrunk by the margin
+#define OPC_TC_LEAF1	4		//!< Triangle pairs: the leaf triangle is from B
+#define OPC_TC_SHIFT	3
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Keeps a pair reached by a coherence walk. Its subtree is taken as empty until EndCandidate() is called.
+ *	\param		code	[in] kind and flags of the pair
+ *	\param		id0		[in] node or triangle index from A
+ *	\param		id1		[in] node or triangle index from B
+ *	\return		the entry of the pair
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+inline_ udword AABBTreeCollider::KeepCandidate(udword code, udword id0, udword id1)
+{
+	const udword Entry = mCandidates->GetNbEntries();
+	mCandidates->Add((id0<<OPC_TC_SHIFT)|code).Add(id1).Add(Entry+3);
+	return Entry;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Ends the subtree of a kept pair, a query that finds the pair separated goes on after it.
+ *	\param		entry	[in] entry of the pair
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+inline_ void AABBTreeCollider::EndCandidate(udword entry)
+{
+	mCandidates->GetEntries()[entry+2] = mCandidates->GetNbEntries();
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  *	Leaf-leaf test for two primitive indices.
@@ -372,6 +413,9 @@ void AABBTreeCollider::PrimTest(udword id0, udword id1)
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 inline_ void AABBTreeCollider::PrimTestTriIndex(udword id1)
 {
+	// Coherence walks only keep the pair, the kept walk is run afterwards
+	if(mCandidates)	{ KeepCandidate(OPC_TC_TRI_TRI, mLeafIndex, id1);	return; }
+
 	// Request vertices from the app
 	VertexPointers VP;
 	mIMesh1->GetTriangle(VP, id1);
@@ -394,6 +438,9 @@ inline_ void AABBTreeCollider::PrimTestTriIndex(udword id1)
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 inline_ void AABBTreeCollider::PrimTestIndexTri(udword id0)
 {
+	// Coherence walks only keep the pair, the kept walk is run afterwards
+	if(mCandidates)	{ KeepCandidate(OPC_TC_TRI_TRI|OPC_TC_LEAF1, id0, mLeafIndex);	return; }
+
 	// Request vertices from the app
 	VertexPointers VP;
 	mIMesh0->GetTriangle(VP, id0);
@@ -419,6 +466,16 @@ void AABBTreeCollider::_CollideTriBox(const AABBNoLeafNode* b)
 	// Perform triangle-box overlap test
 	if(!TriBoxOverlap(b->mAABB.mCenter, b->mAABB.mExtents))	return;
 
+	// Keep the pair for temporal coherence
+	udword Entry = 0;
+	if(mCandidates)
+	{
+		mMargin = -mMargin;
+		const udword Robust = TriBoxOverlap(b->mAABB.mCenter, b->mAABB.mExtents) ? OPC_TC_ROBUST : 0;
+		mMargin = -mMargin;
+		Entry = KeepCandidate(OPC_TC_TRI_BOX|Robust, mLeafIndex, udword(b - mNodes1));
+	}
+
 	// Keep same triangle, deal with first child
 	if(b->HasPosLeaf())	PrimTestTriIndex(b->GetPosPrimitive());
 	else				_CollideTriBox(b->GetPos());
@@ -428,6 +485,8 @@ void AABBTreeCollider::_CollideTriBox(const AABBNoLeafNode* b)
 	// Keep same triangle, deal with second child
 	if(b->HasNegLeaf())	PrimTestTriIndex(b->GetNegPrimitive());
 	else				_CollideTriBox(b->GetNeg());
+
+	if(mCandidates)	EndCandidate(Entry);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -441,6 +500,16 @@ void AABBTreeCollider::_CollideBoxTri(const AABBNoLeafNode* b)
 	// Perform triangle-box overlap test
 	if(!TriBoxOverlap(b->mAABB.mCenter, b->mAABB.mExtents))	return;
 
+	// Keep the pair for temporal coherence
+	udword Entry = 0;
+	if(mCandidates)
+	{
+		mMargin = -mMargin;
+		const udword Robust = TriBoxOverlap(b->mAABB.mCenter, b->mAABB.mExtents) ? OPC_TC_ROBUST : 0;
+		mMargin = -mMargin;
+		Entry = KeepCandidate(OPC_TC_BOX_TRI|Robust, udword(b - mNodes0), mLeafIndex);
+	}
+
 	// Keep same triangle, deal with first child
 	if(b->HasPosLeaf())	PrimTestIndexTri(b->GetPosPrimitive());
 	else				_CollideBoxTri(b->GetPos());
@@ -450,6 +519,8 @@ void AABBTreeCollider::_CollideBoxTri(const AABBNoLeafNode* b)
 	// Keep same triangle, deal with second child
 	if(b->HasNegLeaf())	PrimTestIndexTri(b->GetNegPrimitive());
 	else				_CollideBoxTri(b->GetNeg());
+
+	if(mCandidates)	EndCandidate(Entry);
 }
 
 //! Request triangle vertices from the app and transform them
@@ -474,6 +545,16 @@ void AABBTreeCollider::_Collide(const AABBNoLeafNode* a, const AABBNoLeafNode* b
 	// Perform BV-BV overlap test
 	if(!BoxBoxOverlap(a->mAABB.mExtents, a->mAABB.mCenter, b->mAABB.mExtents, b->mAABB.mCenter))	return;
 
+	// Keep the pair for temporal coherence
+	udword Entry = 0;
+	if(mCandidates)
+	{
+		mMargin = -mMargin;
+		const udword Robust = BoxBoxOverlap(a->mAABB.mExtents, a->mAABB.mCenter, b->mAABB.mExtents, b->mAABB.mCenter) ? OPC_TC_ROBUST : 0;
+		mMargin = -mMargin;
+		Entry = KeepCandidate(OPC_TC_BOX_BOX|Robust, udword(a - mNodes0), udword(b - mNodes1));
+	}
+
 	// Catch leaf status
 	BOOL BHasPosLeaf = b->HasPosLeaf();
 	BOOL BHasNegLeaf = b->HasNegLeaf();
@@ -547,6 +628,208 @@ void AABBTreeCollider::_Collide(const AABBNoLeafNode* a, const AABBNoLeafNode* b
 		}
 		else _Collide(a->GetNeg(), b->GetNeg());
 	}
+
+	if(mCandidates)	EndCandidate(Entry);
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Temporal coherence
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//! Margin the boxes are grown by for a coherence walk, relative to the smaller model
+#define OPC_COHERENCE_MARGIN	0.005f
+//! Most queries run without the cache after walks that were not used
+#define OPC_COHERENCE_MAX_SKIP	16
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Bounds how far a rotation change moves a point: the Frobenius norm of the difference of the matrices.
+ *	\param		a		[in] first rotation
+ *	\param		b		[in] second rotation
+ *	\return		the largest distance a point at unit distance from the origin can move
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static inline_ float RotationDistance(const Matrix3x3& a, const Matrix3x3& b)
+{
+	float Sum = 0.0f;
+	for(udword i=0;i<3;i++)
+	{
+		for(udword j=0;j<3;j++)
+		{
+			const float d = a.m[i][j] - b.m[i][j];
+			Sum += d*d;
+		}
+	}
+	return sqrtf(Sum);
+}
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Collision query for no-leaf models with temporal coherence. While the relative motion since the walk was kept is
+ *	under half its margin, only the tests left over the kept walk are run. Else the trees are walked again with grown
+ *	boxes and the walk is kept, unless the last kept walk was not used: pairs that keep moving that much are walked
+ *	without the cache for a growing number of queries.
+ *
+ *	\param		cache			[in/out] collision cache for model pointers and the kept walk
+ *	\param		world0			[in] world matrix for first object
+ *	\param		world1			[in] world matrix for second object
+ *	\return		true if success
+ *	\warning	SCALE NOT SUPPORTED. The matrices must contain rotation & translation parts only.
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool AABBTreeCollider::Collide(BVTCoherenceCache& cache, const Matrix4x4* world0, const Matrix4x4* world1)
+{
+	// Checkings
+	if(!cache.Model0 || !cache.Model1)								return false;
+	if(!Setup(cache.Model0->GetMeshInterface(), cache.Model1->GetMeshInterface()))	return false;
+
+	mNodes0 = ((const AABBNoLeafTree*)cache.Model0->GetTree())->GetNodes();
+	mNodes1 = ((const AABBNoLeafTree*)cache.Model1->GetTree())->GetNodes();
+
+	// Init collision query
+	InitQuery(world0, world1);
+
+	// First contact queries stop at the first pair, they are not cached
+	if(FirstContactEnabled())
+	{
+		cache.ResetCoherence();
+		_Collide(mNodes0, mNodes1);
+		return true;
+	}
+
+	if(cache.mValid && cache.mCachedModel0==cache.Model0 && cache.mCachedModel1==cache.Model1)
+	{
+		// Motion of the points of each model, seen from the other one. Either bound will do, a NaN
+		// in the matrices fails both.
+		const float Radius0 = mNodes0->mAABB.mCenter.Magnitude() + mNodes0->mAABB.mExtents.Magnitude();
+		const float Radius1 = mNodes1->mAABB.mCenter.Magnitude() + mNodes1->mAABB.mExtents.Magnitude();
+		const float Moved0 = RotationDistance(mR0to1, cache.mR0to1) * Radius0 + (mT0to1 - cache.mT0to1).Magnitude();
+		const float Moved1 = RotationDistance(mR1to0, cache.mR1to0) * Radius1 + (mT1to0 - cache.mT1to0).Magnitude();
+
+		// The other half of the margin is left for rounding errors
+		const float Limit = cache.mMargin * 0.5f;
+		if(Moved0<=Limit || Moved1<=Limit)
+		{
+			cache.mReused = true;
+			_CollideCandidates(cache.mCandidates);
+			return true;
+		}
+	}
+
+	if(cache.mValid)
+	{
+		if(cache.mReused)		cache.mBackoff = 0;
+		else if(!cache.mBackoff)	cache.mBackoff = 1;
+		else if(cache.mBackoff<OPC_COHERENCE_MAX_SKIP)	cache.mBackoff *= 2;
+		cache.mSkip = cache.mBackoff;
+		cache.mValid = false;
+	}
+
+	if(cache.mSkip)
+	{
+		cache.mSkip--;
+		_Collide(mNodes0, mNodes1);
+		return true;
+	}
+
+	// Walk the trees with grown boxes and keep the walk. Grown boxes reach more triangle pairs, so
+	// the pairs come from running the kept walk
+	const float Size0 = mNodes0->mAABB.mExtents.Magnitude();
+	const float Size1 = mNodes1->mAABB.mExtents.Magnitude();
+	cache.mMargin = OPC_COHERENCE_MARGIN * (Size0 < Size1 ? Size0 : Size1);
+	cache.mCandidates.Reset();
+
+	mCandidates	= &cache.mCandidates;
+	mMargin		= cache.mMargin;
+	_Collide(mNodes0, mNodes1);
+	mCandidates	= null;
+	mMargin		= 0.0f;
+
+	cache.mR0to1		= mR0to1;
+	cache.mR1to0		= mR1to0;
+	cache.mT0to1		= mT0to1;
+	cache.mT1to0		= mT1to0;
+	cache.mCachedModel0	= cache.Model0;
+	cache.mCachedModel1	= cache.Model1;
+	cache.mValid		= true;
+	cache.mReused		= false;
+
+	_CollideCandidates(cache.mCandidates);
+	return true;
+}
+
+//! Fetches a leaf triangle unless it is the last one fetched
+#define FETCH_CANDIDATE_LEAF(key, prim_index, imesh, rot, trans)	\
+	if(Fetched!=(key))												\
+	{																\
+		FETCH_LEAF(prim_index, imesh, rot, trans)					\
+		Fetched = (key);											\
+	}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Runs a kept walk again. Pairs that overlapped with the box shrunk by the margin are not tested, the subtree of a
+ *	pair found separated is skipped, and triangle pairs get the leaf-leaf test that reached them.
+ *	\param		candidates	[in] the kept walk
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void AABBTreeCollider::_CollideCandidates(const Container& candidates)
+{
+	const udword* Entries = candidates.GetEntries();
+	const udword NbEntries = candidates.GetNbEntries();
+
+	// Leaf triangle in mLeafVerts, as (index<<1)|tree
+	udword Fetched = INVALID_ID;
+
+	udword i = 0;
+	while(i<NbEntries)
+	{
+		const udword Code = Entries[i];
+		const udword Id0 = Code>>OPC_TC_SHIFT;
+		const udword Id1 = Entries[i+1];
+
+		switch(Code & OPC_TC_KIND)
+		{
+			case OPC_TC_BOX_BOX:
+			if(!(Code & OPC_TC_ROBUST))
+			{
+				const AABBNoLeafNode* a = mNodes0 + Id0;
+				const AABBNoLeafNode* b = mNodes1 + Id1;
+				if(!BoxBoxOverlap(a->mAABB.mExtents, a->mAABB.mCenter, b->mAABB.mExtents, b->mAABB.mCenter))	{ i = Entries[i+2];	continue; }
+			}
+			break;
+
+			case OPC_TC_TRI_BOX:
+			if(!(Code & OPC_TC_ROBUST))
+			{
+				FETCH_CANDIDATE_LEAF(Id0<<1, Id0, mIMesh0, mR0to1, mT0to1)
+				const AABBNoLeafNode* b = mNodes1 + Id1;
+				if(!TriBoxOverlap(b->mAABB.mCenter, b->mAABB.mExtents))	{ i = Entries[i+2];	continue; }
+			}
+			break;
+
+			case OPC_TC_BOX_TRI:
+			if(!(Code & OPC_TC_ROBUST))
+			{
+				FETCH_CANDIDATE_LEAF((Id1<<1)|1, Id1, mIMesh1, mR1to0, mT1to0)
+				const AABBNoLeafNode* b = mNodes0 + Id0;
+				if(!TriBoxOverlap(b->mAABB.mCenter, b->mAABB.mExtents))	{ i = Entries[i+2];	continue; }
+			}
+			break;
+
+			case OPC_TC_TRI_TRI:
+			if(Code & OPC_TC_LEAF1)
+			{
+				FETCH_CANDIDATE_LEAF((Id1<<1)|1, Id1, mIMesh1, mR1to0, mT1to0)
+				PrimTestIndexTri(Id0);
+			}
+			else
+			{
+				FETCH_CANDIDATE_LEAF(Id0<<1, Id0, mIMesh0, mR0to1, mT0to1)
+				PrimTestTriIndex(Id1);
+			}
+			break;
+		}
+		i += 3;
+	}
+}
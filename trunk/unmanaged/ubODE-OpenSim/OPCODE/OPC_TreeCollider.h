@@ -49,6 +49,44 @@
 		const Model*		Model1;	//!< Model for second object
 	};
 
+	//! This structure holds the temporal coherence data of a pair of no-leaf models. The query that builds it
+	//! walks the trees with the boxes grown by a margin and keeps the part of the walk that overlapped, in
+	//! walk order. Each box pair kept is marked when it still overlaps with the box shrunk by the margin.
+	//! While the relative motion since then is under half the margin, a pair that failed with grown boxes
+	//! can not overlap and a marked one can not fail, so later queries only run the tests left over the kept
+	//! walk. They run them in the same order and with the same arithmetic, so the colliding pairs are the
+	//! same as without the cache.
+	struct OPCODE_API BVTCoherenceCache : BVTCache
+	{
+		//! Constructor
+		inline_				BVTCoherenceCache() :
+								mMargin(0.0f), mValid(false), mReused(false), mBackoff(0), mSkip(0),
+								mCachedModel0(null), mCachedModel1(null)	{}
+
+		//! Forgets the kept walk, next query walks the trees again
+		inline_		void	ResetCoherence()
+							{
+								mCandidates.Reset();
+								mValid		= false;
+								mReused		= false;
+								mBackoff	= 0;
+								mSkip		= 0;
+							}
+
+				Container	mCandidates;	//!< Kept walk, 3 entries per pair
+				Matrix3x3	mR0to1;			//!< Rotation from object0 to object1 at the walk
+				Matrix3x3	mR1to0;			//!< Rotation from object1 to object0 at the walk
+				Point		mT0to1;			//!< Translation from object0 to object1 at the walk
+				Point		mT1to0;			//!< Translation from object1 to object0 at the walk
+				float		mMargin;		//!< Margin the boxes were grown by
+				bool		mValid;			//!< The kept walk can be used
+				bool		mReused;		//!< The kept walk has been used since it was built
+				udword		mBackoff;		//!< Queries to run without the cache after the next useless walk
+				udword		mSkip;			//!< Queries left to run without the cache
+		const	Model*		mCachedModel0;	//!< Model0 of the walk
+		const	Model*		mCachedModel1;	//!< Model1 of the walk
+	};
+
 	class OPCODE_API AABBTreeCollider : public Collider
 	{
 		public:
@@ -73,6 +111,20 @@
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 							bool			Collide(BVTCache& cache, const Matrix4x4* world0=null, const Matrix4x4* world1=null);
 
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		/**
+		 *	Collision query for no-leaf models with temporal coherence. The triangle pairs found are the same,
+		 *	in the same order, as with Collide(BVTCache&, ...). First contact mode does not use the cache.
+		 *
+		 *	\param		cache			[in/out] collision cache for model pointers and the triangle pairs of the last tree walk
+		 *	\param		world0			[in] world matrix for first object, or null
+		 *	\param		world1			[in] world matrix for second object, or null
+		 *	\return		true if success
+		 *	\warning	SCALE NOT SUPPORTED. The matrices must contain rotation & translation parts only.
+		 */
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+							bool			Collide(BVTCoherenceCache& cache, const Matrix4x4* world0=null, const Matrix4x4* world1=null);
+
 		// Collision queries
 							bool			Collide(const AABBCollisionTree* tree0, const AABBCollisionTree* tree1,				const Matrix4x4* world0=null, const Matrix4x4* world1=null, Pair* cache=null);
 							bool			Collide(const AABBNoLeafTree* tree0, const AABBNoLeafTree* tree1,					const Matrix4x4* world0=null, const Matrix4x4* world1=null, Pair* cache=null);
@@ -182,6 +234,11 @@
 		// Leaf description
 							Point			mLeafVerts[3];		//!< Triangle vertices
 							udword			mLeafIndex;			//!< Triangle index
+		// Temporal coherence
+							Container*		mCandidates;		//!< Where to keep the walk, or null
+							float			mMargin;			//!< Margin the boxes are grown by
+					const	AABBNoLeafNode*	mNodes0;			//!< Nodes of the first tree, for a kept walk
+					const	AABBNoLeafNode*	mNodes1;			//!< Nodes of the second tree, for a kept walk
 		// Settings
 							bool			mFullBoxBoxTest;	//!< Perform full BV-BV tests (true) or SAT-lite tests (false)
 							bool			mFullPrimBoxTest;	//!< Perform full Primitive-BV tests (true) or SAT-lite tests (false)
@@ -193,6 +250,10 @@
 							void			_CollideTriBox(const AABBNoLeafNode* b);
 							void			_CollideBoxTri(const AABBNoLeafNode* b);
 							void			_Collide(const AABBNoLeafNode* a, const AABBNoLeafNode* b);
+			// Temporal coherence
+							void			_CollideCandidates(const Container& candidates);
+			inline_			udword			KeepCandidate(udword code, udword id0, udword id1);
+			inline_			void			EndCandidate(udword entry);
 			// Overlap tests
 							void			PrimTest(udword id0, udword id1);
 			inline_			void			PrimTestTriIndex(udword id1);
@@ -120,15 +120,18 @@ inline_ BOOL planeBoxOverlap(const Point& normal, const float d, const Point& ma
  *	- and perhaps with some more minor modifs...
  *
  *	\param		center		[in] box center
- *	\param		extents		[in] box extents
+ *	\param		box_extents	[in] box extents, before the temporal coherence margin
  *	\return		true if triangle & box overlap
  */
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-inline_ BOOL AABBTreeCollider::TriBoxOverlap(const Point& center, const Point& extents)
+inline_ BOOL AABBTreeCollider::TriBoxOverlap(const Point& center, const Point& box_extents)
 {
     // Stats
     mNbBVPrimTests++;
 
+    // Box grown by the temporal coherence margin, zero outside of coherence queries
+    const Point extents(box_extents.x + mMargin, box_extents.y + mMargin, box_extents.z + mMargin);
+
     // use separating axis theorem to test overlap between triangle and box 
     // need to test for overlap in these directions: 
     // 1) the {x,y,z}-directions (actually, since we use the AABB of the triangle 
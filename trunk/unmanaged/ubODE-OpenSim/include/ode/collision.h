@@ -293,6 +293,7 @@ ODE_API dSpaceID dGeomGetSpace (dGeomID);
  *  @li dSimpleSpaceClass
  *  @li dHashSpaceClass
  *  @li dQuadTreeSpaceClass
+ *  @li dBVHSpaceClass
  *  @li dFirstUserClass
  *  @li dLastUserClass
  *
@@ -862,6 +863,102 @@ ODE_API void dSpaceCollide (dSpaceID space, void *data, dNearCallback *callback)
  */
 ODE_API void dSpaceCollide2 (dGeomID space1, dGeomID space2, void *data, dNearCallback *callback);
 
+/**
+ * @brief Finds the candidate pairs of a space and generates their contacts
+ * with the threads of a world.
+ *
+ * The pairs are found as by dSpaceCollide. Spaces contained in the space are
+ * recursed into with dSpaceCollide2. Each pair is given to the filter, which
+ * returns the dCollide flags for it, and then dCollide is called for all the
+ * kept pairs, spread over the threads of the world threading. The contacts
+ * callback is then called for the pairs that have contacts, in the order
+ * the filter saw them, so the results are the same as calling dCollide from
+ * a dNearCallback, whatever the number of threads.
+ *
+ * Both callbacks are called on the calling thread only. Pairs involving a
+ * trimesh, heightfield, terrain, geom transform or user class geom are
+ * collided on the calling thread too, as their colliders keep data in the
+ * geoms or in global caches.
+ *
+ * @param space The space to test.
+ * @param world The world whose threading is used, or 0 to collide all the
+ * pairs on the calling thread.
+ * @param data Passed to both callbacks.
+ * @param filter Chooses the pairs to collide and their flags.
+ * @param callback Receives the contacts of each pair.
+ *
+ * @sa dSpaceCollide
+ * @sa dWorldSetStepThreadPoolSize
+ * @ingroup collide
+ */
+ODE_API void dSpaceCollideParallel (dSpaceID space, dWorldID world, void *data,
+                                    dNearFilterCallback *filter, dNearContactsCallback *callback);
+
+/**
+ * @brief Like dSpaceCollideParallel, for the candidate pairs dSpaceCollide2
+ * finds between two geoms or spaces.
+ *
+ * @sa dSpaceCollideParallel
+ * @sa dSpaceCollide2
+ * @ingroup collide
+ */
+ODE_API void dSpaceCollide2Parallel (dGeomID space1, dGeomID space2, dWorldID world, void *data,
+                                     dNearFilterCallback *filter, dNearContactsCallback *callback);
+
+/**
+ * @brief A ray of dSpaceRayCastBatch.
+ *
+ * The ray goes from start along dir (need not be normalized) for length.
+ * It hits the geoms a ray geom with these category and collide bits would
+ * be given to a dNearCallback for.
+ *
+ * @ingroup collide
+ */
+typedef struct dRayCastQuery {
+  dVector3 start;
+  dVector3 dir;
+  dReal length;
+  unsigned long category_bits;
+  unsigned long collide_bits;
+} dRayCastQuery;
+
+/* dSpaceRayCastBatch flags, besides the maximum number of hits */
+#define dRAYCAST_BACKFACECULL   0x10000
+
+/**
+ * @brief Casts many rays against the geoms of a space, without ray geoms.
+ *
+ * Each ray is tested only against the geoms whose AABB it crosses, as found
+ * by the space (a BVH space descends its tree, nearest nodes first), and
+ * the spaces inside the space are recursed into. A geom hit gives the
+ * contact dCollide would give for a ray geom with the closest hit flag set
+ * and that geom, so trimesh, heightfield, terrain and convex geoms are
+ * supported along with the primitive classes. Geoms farther than the hits
+ * already found are not tested.
+ *
+ * @param space The space with the geoms to hit.
+ * @param rays The rays.
+ * @param n The number of rays.
+ * @param results Room for the maximum number of hits of each ray, those of
+ * ray i starting at results[i * maximum]. The hits of a ray are sorted by
+ * depth, the distance from its start. g1 is 0, g2 the geom hit and side2
+ * the triangle hit on a trimesh.
+ * @param counts Receives the number of hits of each ray.
+ * @param flags The lower 16 bits are the maximum number of hits to return
+ * for each ray, 1 for the closest hit only, each from a different geom.
+ * dRAYCAST_BACKFACECULL may be added to skip back faces, as with
+ * dGeomRaySetBackfaceCull.
+ *
+ * @returns The number of hits of all the rays.
+ *
+ * @sa dCollide
+ * @sa dGeomRaySetClosestHit
+ * @sa dGeomRaySetBackfaceCull
+ * @ingroup collide
+ */
+ODE_API int dSpaceRayCastBatch (dSpaceID space, const dRayCastQuery *rays, int n,
+                                dContactGeom *results, int *counts, int flags);
+
 
 /* ************************************************************************ */
 /* standard classes */
@@ -890,7 +987,8 @@ enum {
   dHashSpaceClass,
   dSweepAndPruneSpaceClass, /* SAP */
   dQuadTreeSpaceClass,
-  dLastSpaceClass = dQuadTreeSpaceClass,
+  dBVHSpaceClass,
+  dLastSpaceClass = dBVHSpaceClass,
 
   dFirstUserClass,
   dLastUserClass = dFirstUserClass + dMaxUserClasses - 1,
@@ -1488,6 +1586,15 @@ ODE_API void dGeomOSTerrainDataBuild( dOSTerrainDataID d,
 ODE_API void dGeomOSTerrainDataSetBounds( dOSTerrainDataID d,
 				dReal minHeight, dReal maxHeight );
 
+/* Call after changing heights minX..maxX, minY..maxY (sample indexes, inclusive).
+ * Build precomputes cell normals and a min/max height pyramid from the heights;
+ * this updates them, and the height bounds, for the changed samples only.
+ * If the data was built with bCopyHeightData, pHeightData is the full new
+ * height array (same layout as in Build) and the changed samples are copied
+ * from it. If the data is referenced, change it in place and pass NULL. */
+ODE_API void dGeomOSTerrainDataUpdate( dOSTerrainDataID d, const float* pHeightData,
+				int minX, int minY, int maxX, int maxY );
+
 
 ODE_API void dGeomOSTerrainSetData( dGeomID g, dOSTerrainDataID d );
 
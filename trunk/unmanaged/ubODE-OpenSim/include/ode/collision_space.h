@@ -48,11 +48,70 @@ struct dContactGeom;
  */
 typedef void dNearCallback (void *data, dGeomID o1, dGeomID o2);
 
+/**
+ * @brief Parallel collide pair filter.
+ *
+ * Called by dSpaceCollideParallel on the calling thread for each candidate
+ * pair, in the order the spaces report them.
+ *
+ * @returns the dCollide flags to use for the pair, with the maximum number
+ * of contacts in the lower 16 bits, or 0 to skip the pair.
+ *
+ * @ingroup collide
+ */
+typedef int dNearFilterCallback (void *data, dGeomID o1, dGeomID o2);
+
+/**
+ * @brief Parallel collide contacts callback.
+ *
+ * Called by dSpaceCollideParallel on the calling thread for each pair that
+ * has contacts, in the order the pairs were given to the filter, with the
+ * contacts dCollide generated for it. The contacts are only valid during
+ * the call.
+ *
+ * @ingroup collide
+ */
+typedef void dNearContactsCallback (void *data, dGeomID o1, dGeomID o2,
+                                    struct dContactGeom *contacts, int count);
+
 
 ODE_API dSpaceID dSimpleSpaceCreate (dSpaceID space);
 ODE_API dSpaceID dHashSpaceCreate (dSpaceID space);
+
+/**
+ * @brief Create a hash space that keeps its cells between collisions.
+ *
+ * It behaves like a space made by dHashSpaceCreate and has the same class,
+ * so dHashSpaceSetLevels and dHashSpaceGetLevels apply to it. Only geoms
+ * moved with dGeomMoved (or made dirty by their body) are hashed again, and
+ * the pairs found by dSpaceCollide are kept for the geoms that did not move,
+ * so mostly static spaces cost little. dSpaceCollide2 looks up the cells of
+ * the other geom instead of testing all geoms of the space.
+ *
+ * Pairs are reported in a different order than by a plain hash space.
+ * Removing a geom makes the next dSpaceCollide find all pairs again.
+ *
+ * @param space The parent space, or 0.
+ * @ingroup collide
+ */
+ODE_API dSpaceID dPersistentHashSpaceCreate (dSpaceID space);
 ODE_API dSpaceID dQuadTreeSpaceCreate (dSpaceID space, const dVector3 Center, const dVector3 Extents, int Depth);
 
+/**
+ * @brief Create a space that keeps its geoms in a dynamic AABB tree.
+ *
+ * Each geom is a leaf holding its AABB grown by a margin, so geoms that move
+ * a little do not change the tree. The tree is refit for geoms that leave
+ * their margin and a few of them are inserted again at every collide to keep
+ * it balanced. It suits spaces mixing very large and very small geoms.
+ * dSpaceCollide2 descends the tree with the AABB of the other geom, and when
+ * both arguments are BVH spaces it descends both trees together.
+ *
+ * @param space The parent space, or 0.
+ * @ingroup collide
+ */
+ODE_API dSpaceID dBVHSpaceCreate (dSpaceID space);
+
 
 /* SAP */
 /* Order XZY or ZXY usually works best, if your Y is up. */
@@ -63,6 +122,12 @@ ODE_API dSpaceID dQuadTreeSpaceCreate (dSpaceID space, const dVector3 Center, co
 #define dSAP_AXES_ZXY  ((2)|(0<<2)|(1<<4))
 #define dSAP_AXES_ZYX  ((2)|(1<<2)|(0<<4))
 
+/* Or into axisorder to get an incremental SAP space. It keeps the AABB ends
+ * sorted and the overlapping pairs between collides, updating them for the
+ * geoms that moved only, which suits large spaces of mostly resting geoms.
+ * Pairs are reported in a different order than by the plain SAP space. */
+#define dSAP_INCREMENTAL  (1<<6)
+
 ODE_API dSpaceID dSweepAndPruneSpaceCreate( dSpaceID space, int axisorder );
 
 
@@ -161,6 +226,7 @@ ODE_API dGeomID dSpaceGetGeom (dSpaceID, int i);
  *  @li dHashSpaceClass
  *  @li dSweepAndPruneSpaceClass
  *  @li dQuadTreeSpaceClass
+ *  @li dBVHSpaceClass
  *  @li dFirstUserClass
  *  @li dLastUserClass
  *
@@ -108,6 +108,33 @@ ODE_API void dGeomTriMeshDataPreprocess(dTriMeshDataID g);
 ODE_API void dGeomTriMeshDataGetBuffer(dTriMeshDataID g, unsigned char** buf, int* bufLen);
 ODE_API void dGeomTriMeshDataSetBuffer(dTriMeshDataID g, unsigned char* buf);
 
+/*
+ * Save a built TriMesh data object into a relocatable memory block: the vertices,
+ * triangles, collision tree and, if it was preprocessed, the use flags. The block can
+ * be kept in memory or written to disk and given later to dGeomTriMeshDataLoad.
+ * Returns the size of the block. Nothing is written if buf is NULL or bufSize is less
+ * than that, so call it first with NULL to get the size. Returns 0 if the data was not
+ * built.
+ */
+ODE_API size_t dGeomTriMeshDataSave(dTriMeshDataID g, void* buf, size_t bufSize);
+/*
+ * Create a TriMesh data object from a block written by dGeomTriMeshDataSave, without
+ * building the collision tree again. The data keeps its own copy of the vertices and
+ * triangles, so the block can be freed after the call. buf must be aligned on 4 bytes.
+ * Returns NULL if the block was not written by this build of the library (other index
+ * size, precision or byte order) or is damaged.
+ */
+ODE_API dTriMeshDataID dGeomTriMeshDataLoad(const void* buf, size_t bufSize);
+
+/*
+ * Set and get a key the application gives to a TriMesh data object, like the hash of
+ * the mesh asset. dWorldSnapshot saves the key of the data of trimesh geoms instead of
+ * the data, and dWorldRestore only restores a trimesh geom that has data with the same
+ * key. The key of new data is 0.
+ */
+ODE_API void dGeomTriMeshDataSetUserKey(dTriMeshDataID g, duint64 key);
+ODE_API duint64 dGeomTriMeshDataGetUserKey(dTriMeshDataID g);
+
 
 /*
  * Per triangle callback. Allows the user to say if he wants a collision with
@@ -156,7 +183,8 @@ ODE_API void dGeomTriMeshSetData(dGeomID g, dTriMeshDataID Data);
 ODE_API dTriMeshDataID dGeomTriMeshGetData(dGeomID g);
 
 
-/* enable/disable/check temporal coherence*/
+/* enable/disable/check temporal coherence, for each class of the other geom: dSphereClass,
+ * dBoxClass, dCapsuleClass or dTriMeshClass. Trimesh pairs use it if either mesh has it enabled. */
 ODE_API void dGeomTriMeshEnableTC(dGeomID g, int geomClass, int enable);
 ODE_API int dGeomTriMeshIsTCEnabled(dGeomID g, int geomClass);
 
@@ -148,9 +148,10 @@ ODE_API dReal dWorldGetCFM (dWorldID);
  * individual stepping memory buffer for each of those threads. The size of buffers
  * allocated is the size needed to handle the largest island in the world.
  *
- * Note: Setting a limit for island stepping does not affect threading at lower
- * levels in stepper functions. The sub-calls scheduled from them can be executed
- * in as many threads as there are available in the pool.
+ * Note: Each island is stepped by a single thread, so the results of a step
+ * do not depend on the number of threads used. Geom AABB invalidation and body
+ * moved callbacks are run by the thread that called the step function, in
+ * island order, after all the islands have been stepped.
  *
  * @param w The world affected
  * @param count Thread count limit value for island stepping
@@ -363,6 +364,62 @@ ODE_API int dWorldSetStepMemoryManager(dWorldID w, const dWorldStepMemoryFunctio
  */
 ODE_API void dWorldSetStepThreadingImplementation(dWorldID w, const dThreadingFunctionsInfo *functions_info, dThreadingImplementationID threading_impl);
 
+/**
+ * @brief Make the world step islands with a thread pool it owns.
+ *
+ * A built-in multi-threaded threading implementation and a pool of 
+ * @p thread_count threads serving it are created and assigned to the world,
+ * replacing any implementation set before. They are released when the
+ * thread count is changed again or when the world is destroyed.
+ * Use @c dWorldSetStepIslandsProcessingMaxThreadCount to limit the threads
+ * actually used for stepping.
+ *
+ * @param w The world to change threading for.
+ * @param thread_count Number of pool threads, or 0 to go back to the
+ * default single threaded stepping.
+ * @returns 1 for success and 0 for failure (e.g. if the library is built
+ * without the built-in threading implementation). On failure the world uses
+ * the default single threaded stepping.
+ *
+ * @ingroup world
+ * @see dWorldGetStepThreadPoolSize
+ */
+ODE_API int dWorldSetStepThreadPoolSize(dWorldID w, unsigned thread_count);
+
+/**
+ * @brief Get the number of threads in the world owned stepping pool.
+ * @returns The thread count set with @c dWorldSetStepThreadPoolSize, the
+ * thread count of the shared pool if @c dWorldSetStepSharedThreadPool was
+ * used, or 0 if the world steps without a pool.
+ * @ingroup world
+ */
+ODE_API unsigned dWorldGetStepThreadPoolSize(dWorldID w);
+
+/**
+ * @brief Make the world step islands with a thread pool shared by worlds.
+ *
+ * All the worlds given this call use the same built-in multi-threaded
+ * threading implementation and pool of threads, so a process with many
+ * worlds stepped by threads of their own (like the regions of a simulator)
+ * does not need a pool for each one. The first world creates the pool with
+ * @p thread_count threads, the other ones use it as it is. The pool is
+ * released when the last world using it is destroyed or given another
+ * threading. Each island is still stepped by one thread, so the results do
+ * not depend on the pool.
+ *
+ * @param w The world to change threading for.
+ * @param thread_count Number of pool threads if the pool is created by this
+ * call, or 0 to go back to the default single threaded stepping.
+ * @returns 1 for success and 0 for failure (e.g. if the library is built
+ * without the built-in threading implementation). On failure the world uses
+ * the default single threaded stepping.
+ *
+ * @ingroup world
+ * @see dWorldSetStepThreadPoolSize
+ * @see dWorldGetStepThreadPoolSize
+ */
+ODE_API int dWorldSetStepSharedThreadPool(dWorldID w, unsigned thread_count);
+
 /**
  * @brief Step the world.
  *
@@ -482,6 +539,274 @@ ODE_API void dWorldSetQuickStepW (dWorldID, dReal over_relaxation);
  */
 ODE_API dReal dWorldGetQuickStepW (dWorldID);
 
+/**
+ * @brief Set how much of the previous step contact impulses QuickStep
+ *        starts from (warm starting).
+ * @ingroup world
+ * @remarks
+ * Contact joints are usually recreated every step, so QuickStep normally
+ * starts each solve of a resting contact from zero and needs many
+ * iterations to rebuild the impulse that holds a stack or pile up.
+ * With warm starting the world keeps the normal and friction impulses of
+ * every contact at the end of a step. A new contact joint of the same geoms,
+ * with the same side1/side2 and a contact position close to the old one,
+ * starts the next solve from factor times those impulses. Contacts that are
+ * not generated again are forgotten after one step.
+ * With warm starting, dWorldSetQuickStepNumIterations can usually be lowered
+ * a lot for scenes dominated by resting contacts.
+ * Only dWorldQuickStep uses it.
+ * @param factor In [0,1]. 0, the default, disables warm starting and frees
+ * the cache. Values a little below 1 (0.8 to 0.95) are recommended.
+ */
+ODE_API void dWorldSetQuickStepWarmStarting (dWorldID, dReal factor);
+
+/**
+ * @brief Get the QuickStep contact warm starting factor
+ * @ingroup world
+ * @returns the factor, 0 if warm starting is disabled
+ */
+ODE_API dReal dWorldGetQuickStepWarmStarting (dWorldID);
+
+
+/**
+ * @brief Set contact reuse across substeps.
+ * @ingroup world
+ *
+ * When the spaces are collided before each of several steps of a frame, the
+ * contacts dCollide finds for a pair of geoms can be kept and carried along
+ * with the geoms by the next collides of that pair, instead of running the
+ * collider again. A pair is collided again when its geoms moved more than
+ * distance from each other since the contacts were found, when they are from
+ * more than steps world steps ago, or when a geom changed class or its
+ * bounding box size changed by more than distance. Kept contacts have their
+ * depth changed by how much the geoms got closer along the kept normal, and
+ * are dropped when it becomes negative. New contacts that the geoms would
+ * start within that motion are not found, so distance should be small against
+ * the prims sizes. Pairs need a body in the world, rays and spaces are
+ * always collided.
+ * @param steps how many steps the contacts are kept. 0, the default, disables
+ * contact reuse and frees what was kept. The number of substeps per frame
+ * less one is recommended.
+ * @param distance the largest motion of the geoms from each other that keeps
+ * the contacts, 0.005 to 0.02 is recommended.
+ */
+ODE_API void dWorldSetContactReuse (dWorldID, int steps, dReal distance);
+
+/**
+ * @brief Get the contact reuse steps
+ * @ingroup world
+ * @returns the steps, 0 if contact reuse is disabled
+ */
+ODE_API int dWorldGetContactReuseSteps (dWorldID);
+
+/**
+ * @brief Get the contact reuse distance
+ * @ingroup world
+ * @returns the distance, 0 if contact reuse is disabled
+ */
+ODE_API dReal dWorldGetContactReuseDistance (dWorldID);
+
+
+/* World snapshots */
+
+/**
+ * @brief Save the dynamic state of a world into a memory block.
+ * @ingroup world
+ *
+ * The block holds the world parameters, and for every body, in the order of
+ * the world body list, its flags (enabled, kinematic, gravity, damping...),
+ * mass, position, orientation, velocities, force and torque accumulators,
+ * auto-disable and damping parameters and counters, and the class, enable
+ * state, category and collide bits and offset of each of its geoms. Trimesh
+ * geoms are only referenced by the user key of their data (see
+ * dGeomTriMeshDataSetUserKey). Then, for every joint that is not a contact
+ * joint, in the order of the world joint list, its type, bodies, flags,
+ * last step lambdas and all its parameters (anchors, axes, limits, motors).
+ * The block has no pointers in it, but it can only be restored by the same
+ * build of the library.
+ * Contact joints and static geoms are not saved, the plugin collides again.
+ * @param buf where to write, can be NULL.
+ * @param bufSize the size of buf.
+ * @returns the size of the block. Nothing is written if buf is NULL or
+ * bufSize is less than that, so call it first with NULL to get the size.
+ * @see dWorldRestore
+ */
+ODE_API size_t dWorldSnapshot (dWorldID, void *buf, size_t bufSize);
+
+/**
+ * @brief Restore the state saved by dWorldSnapshot.
+ * @ingroup world
+ *
+ * The world must have as many bodies, with the same geoms classes and trimesh
+ * keys, and as many joints that are not contacts, with the same types, in the
+ * same list order as when the block was saved. That is the case for the world
+ * it was saved from if no body, geom or joint was added or removed since, or
+ * for a world made again by creating its objects in the same order (bodies
+ * and joints are listed newest first). The saved state is copied bit for
+ * bit, and joints are attached to their saved bodies again.
+ * The contacts kept for warm starting and for contact reuse are dropped,
+ * since they refer to geoms not in the block. The geoms of the world are
+ * moved to the front of their spaces, in the block order, so that simple and
+ * hash spaces report the pairs in the same order after each restore (the
+ * other spaces keep pair or tree data from the steps before).
+ * Stepping after a restore then gives the same results each time, here or in
+ * a world made again. It can differ from stepping on from the snapshot, whose
+ * pair order came from the steps before.
+ * @param buf a block written by dWorldSnapshot.
+ * @param bufSize the size of the block.
+ * @returns 1 if the state was restored. 0 if the block is damaged, was saved
+ * by another build or does not match the world objects, and then the world
+ * is not changed.
+ * @see dWorldSnapshot
+ */
+ODE_API int dWorldRestore (dWorldID, const void *buf, size_t bufSize);
+
+
+/* World step profiling */
+
+/**
+ * @brief The parts of a simulation step timed by the step profiler.
+ * @ingroup world
+ * @see dWorldSetStepProfiling
+ */
+enum
+{
+  dStepProfileStep,        /* the whole dWorldStep/dWorldQuickStep call */
+  dStepProfileCollision,   /* between dWorldStepProfileCollisionBegin and End */
+  dStepProfileIslands,     /* auto-disabling and island building */
+  dStepProfileFreeBodies,  /* bodies without joints (QuickStep only) */
+  dStepProfileIsland,      /* stepping islands with joints, all stages */
+  dStepProfileStage0,      /* QuickStep: inertia and joint info */
+  dStepProfileStage1,      /* QuickStep: joint row counts and memory */
+  dStepProfileStage2,      /* QuickStep: Jacobians and right hand side */
+  dStepProfileStage3,      /* QuickStep: solver setup */
+  dStepProfileStage4,      /* QuickStep: SOR LCP iterations */
+  dStepProfileStage5,      /* QuickStep: constraint forces */
+  dStepProfileStage6,      /* QuickStep: velocity and position integration */
+
+  dStepProfileCount
+};
+
+/** @brief Number of steps the profile percentiles are taken over */
+#define dSTEPPROFILE_WINDOW 128
+
+/**
+ * @brief Number of island size classes in dWorldStepProfile.
+ * Class i holds islands of 2^(i-1)+1 to 2^i bodies (class 0 is single bodies)
+ * and the last class also holds all bigger islands.
+ */
+#define dSTEPPROFILE_ISLAND_SIZE_CLASSES 8
+
+/**
+ * @struct dStepProfileTiming
+ * @brief Time spent in one part of the step, in seconds.
+ *
+ * @c last is the time in the most recent step and @c count the number of
+ * times the part ran in that step (for example the number of islands).
+ * @c average is a moving average over about the last 32 steps.
+ * @c p50, @c p90, @c p99 and @c max are taken over the last
+ * @c dSTEPPROFILE_WINDOW steps.
+ *
+ * @ingroup world
+ */
+typedef struct dStepProfileTiming
+{
+  double last;
+  double average;
+  double p50, p90, p99, max;
+  unsigned count;
+
+} dStepProfileTiming;
+
+/**
+ * @struct dWorldStepProfile
+ * @brief Step profiler results, filled in by dWorldGetStepProfile.
+ *
+ * @c steps is the number of steps recorded since profiling was enabled or
+ * reset, and @c window the number of them the percentiles are taken over.
+ *
+ * @c stage is indexed by the @c dStepProfile constants. The QuickStep stages
+ * add up over all islands of a step, so with several island threads they can
+ * add up to more than @c dStepProfileIsland wall time.
+ *
+ * @c lcp_rows and @c lcp_iterations are the constraint rows and the SOR
+ * iterations (both passes, summed over the islands) of the last step.
+ * @c lcp_iterations_average is their moving average.
+ *
+ * @c island_count and @c island_time are the islands with joints of each
+ * size class and their stepping time in the last step, and
+ * @c island_average the moving average time of one island of the class.
+ *
+ * @ingroup world
+ */
+typedef struct dWorldStepProfile
+{
+  unsigned steps;
+  unsigned window;
+  dStepProfileTiming stage[dStepProfileCount];
+
+  unsigned lcp_rows;
+  unsigned lcp_iterations;
+  double lcp_iterations_average;
+
+  unsigned island_count[dSTEPPROFILE_ISLAND_SIZE_CLASSES];
+  double island_time[dSTEPPROFILE_ISLAND_SIZE_CLASSES];
+  double island_average[dSTEPPROFILE_ISLAND_SIZE_CLASSES];
+
+} dWorldStepProfile;
+
+/**
+ * @brief Enable or disable the step profiler of a world.
+ * @ingroup world
+ * @remarks
+ * While enabled, dWorldStep and dWorldQuickStep record the wall time of
+ * island building, free bodies, each island and each QuickStep stage, the
+ * SOR iteration counts and the island sizes. The cost is a clock read at
+ * each stage boundary, about ten per island; disabled, it is a pointer test.
+ * Collision is not run by the world. Put dSpaceCollide and the contact
+ * joint creation between dWorldStepProfileCollisionBegin and
+ * dWorldStepProfileCollisionEnd to have it in the profile of the next step.
+ * Disabling frees the recorded data.
+ * @param enable Nonzero to enable.
+ * @returns 1 for success and 0 for a memory allocation failure.
+ * @see dWorldGetStepProfile
+ */
+ODE_API int dWorldSetStepProfiling (dWorldID, int enable);
+
+/**
+ * @brief Get whether the step profiler of a world is enabled.
+ * @ingroup world
+ */
+ODE_API int dWorldGetStepProfiling (dWorldID);
+
+/**
+ * @brief Clear the data recorded by the step profiler.
+ * @ingroup world
+ */
+ODE_API void dWorldResetStepProfile (dWorldID);
+
+/**
+ * @brief Copy the step profiler results into @a profile.
+ * @ingroup world
+ * @returns 1 if the profiler is enabled, 0 (and @a profile zeroed) if not.
+ */
+ODE_API int dWorldGetStepProfile (dWorldID, dWorldStepProfile *profile);
+
+/**
+ * @brief Mark the start of collision detection for the step profiler.
+ * @ingroup world
+ * @remarks Does nothing if profiling is disabled.
+ */
+ODE_API void dWorldStepProfileCollisionBegin (dWorldID);
+
+/**
+ * @brief Mark the end of collision detection for the step profiler.
+ * @ingroup world
+ * @remarks The time since dWorldStepProfileCollisionBegin goes into the
+ * profile of the next step.
+ */
+ODE_API void dWorldStepProfileCollisionEnd (dWorldID);
+
 /* World contact parameter functions */
 
 /**
@@ -111,6 +111,12 @@ ODE_API void dInitODE(void);
  * @c dSpaceSetManualCleanup must be called to set manual cleanup mode for every
  * space object right after creation. Failure to do so may lead to resource leaks.
  *
+ * @note
+ * @c dInitODE2 and @c dCloseODE are not thread safe. Call them from one thread,
+ * before the threads that use ODE start and after they end. In between, each
+ * thread can step and collide its own worlds and spaces at the same time as
+ * the others, as long as no object is used by two threads at once.
+ *
  * @see dInitODEFlags
  * @see dCloseODE
  * @see dSpaceSetManualCleanup
@@ -38,6 +38,7 @@
 #include "collision_kernel.h"
 #include "collision_std.h"
 #include "collision_util.h"
+#include "threadingutils.h"
 
 #ifdef _MSC_VER
 #pragma warning(disable:4291)  // for VC++, no complaints about "no matching operator delete found"
@@ -54,6 +55,8 @@ dxBox::dxBox (dSpaceID space, dReal lx, dReal ly, dReal lz) : dxGeom (space,1)
     halfside[1] = REAL(0.5) * ly;
     halfside[2] = REAL(0.5) * lz;
     updateZeroSizedFlag(!lx || !ly || !lz);
+    for (int i = 0; i < dBOX_SEPCACHE_SIZE; i++)
+        sepcache[i] = 0;
 }
 
 void dxBox::computeAABB()
@@ -351,11 +354,15 @@ void cullPoints (int n, dReal p[], int m, int i0, int iret[])
 // fields.
 
 
-int dBoxBox (const dVector3 p1, const dMatrix3 R1,
-             const dVector3 A, const dVector3 p2,
-             const dMatrix3 R2, const dVector3 B,
-             dVector3 normal, dReal *depth,
-             int flags, dContactGeom *contact, int skip)
+// `separating' returns, when there is no contact, the code of the separating
+// axis that was found (numbered as return_code above) or 0.
+
+static int boxBox (const dVector3 p1, const dMatrix3 R1,
+                   const dVector3 A, const dVector3 p2,
+                   const dMatrix3 R2, const dVector3 B,
+                   dVector3 normal, dReal *depth,
+                   int flags, dContactGeom *contact, int skip,
+                   int *separating)
 {
     const dReal fudge_factor = REAL(1.2);
     dVector3 p, pp, normalC = {0, 0, 0};
@@ -412,7 +419,10 @@ int dBoxBox (const dVector3 p1, const dMatrix3 R1,
     expr2_val = (expr2); \
     s2 = dFabs(expr1_val) - (expr2_val); \
     if (s2 > 0) \
+    { \
+        *separating = (cc); \
         return 0; \
+    } \
     if (s2 > s) \
     { \
         s = s2; \
@@ -477,7 +487,10 @@ int dBoxBox (const dVector3 p1, const dMatrix3 R1,
     expr2_val = (expr2); /* Avoid duplicate evaluation of expr1 */ \
     s2 = dFabs(expr1_val) - (expr2_val); \
     if (s2 > 0) \
+    { \
+        *separating = (cc); \
         return 0; \
+    } \
     l = (n2)*(n2) + (n3)*(n3); \
     if (l > dEpsilon) \
     { \
@@ -510,7 +523,10 @@ int dBoxBox (const dVector3 p1, const dMatrix3 R1,
     expr2_val = (expr2); /* Avoid duplicate evaluation of expr1 */ \
     s2 = dFabs(expr1_val) - (expr2_val); \
     if (s2 > 0) \
+    { \
+        *separating = (cc); \
         return 0; \
+    } \
     l = (n1)*(n1) + (n3)*(n3); \
     if (l > dEpsilon) \
     { \
@@ -540,7 +556,10 @@ int dBoxBox (const dVector3 p1, const dMatrix3 R1,
     expr2_val = (expr2); /* Avoid duplicate evaluation of expr1 */ \
     s2 = dFabs(expr1_val) - (expr2_val); \
     if (s2 > 0) \
+    { \
+        *separating = (cc); \
         return 0; \
+    } \
     l = (n1)*(n1) + (n2)*(n2); \
     if (l > dEpsilon) \
     { \
@@ -566,6 +585,7 @@ int dBoxBox (const dVector3 p1, const dMatrix3 R1,
 #undef TST
     } while (0);
 
+    *separating = 0;
     if (!code)
         return 0;
 
@@ -883,6 +903,133 @@ int dBoxBox (const dVector3 p1, const dMatrix3 R1,
     return cnum;
 }
 
+int dBoxBox (const dVector3 p1, const dMatrix3 R1,
+             const dVector3 A, const dVector3 p2,
+             const dMatrix3 R2, const dVector3 B,
+             dVector3 normal, dReal *depth,
+             int flags, dContactGeom *contact, int skip)
+{
+    int separating;
+    return boxBox (p1, R1, A, p2, R2, B, normal, depth, flags, contact, skip,
+                   &separating);
+}
+
+// test only the separating axis `code' of boxBox, doing the same arithmetic,
+// so this returns 1 exactly when boxBox would find that this axis separates
+// the boxes.
+
+static int boxBoxAxisSeparates (const dVector3 p1, const dMatrix3 R1,
+                                const dVector3 A, const dVector3 p2,
+                                const dMatrix3 R2, const dVector3 B,
+                                int code)
+{
+    dVector3 p, pp;
+    dVector3 R1x, R2x, R3x;
+    dVector3 Q1x, Q2x, Q3x;
+    dReal expr1_val, expr2_val;
+
+    dSubtractVectors3r4(p, p2, p1);
+    dMultiply1_331 (pp, R1, p);
+
+    if (code >= 1 && code <= 3)
+    {
+        // a face of box 1 only needs its row of the relative rotation
+        const dReal *r1ptr = R1 + (code - 1);
+        R11 = dCalcVectorDot3_44(r1ptr, R2);
+        R12 = dCalcVectorDot3_44(r1ptr, R2 + 1);
+        R13 = dCalcVectorDot3_44(r1ptr, R2 + 2);
+        dFabsVector3r4(Q1x, R1x);
+        expr1_val = pp[code - 1];
+        expr2_val = A[code - 1] + dCalcVectorDot3(B, Q1x);
+        return dFabs(expr1_val) - expr2_val > 0;
+    }
+
+    R11 = dCalcVectorDot3_44(R1, R2);
+    R12 = dCalcVectorDot3_44(R1, R2 + 1);
+    R13 = dCalcVectorDot3_44(R1, R2 + 2);
+    R21 = dCalcVectorDot3_44(R1 + 1, R2);
+    R22 = dCalcVectorDot3_44(R1 + 1, R2 + 1);
+    R23 = dCalcVectorDot3_44(R1 + 1, R2 + 2);
+    R31 = dCalcVectorDot3_44(R1 + 2, R2);
+    R32 = dCalcVectorDot3_44(R1 + 2, R2 + 1);
+    R33 = dCalcVectorDot3_44(R1 + 2, R2 + 2);
+    dFabsVector3r4(Q1x, R1x);
+    dFabsVector3r4(Q2x, R2x);
+    dFabsVector3r4(Q3x, R3x);
+
+    switch (code)
+    {
+    case 4:
+        expr1_val = dCalcVectorDot3_41(R2, p);
+        expr2_val = A[0] * Q11 + A[1] * Q21 + A[2] * Q31 + B[0];
+        break;
+    case 5:
+        expr1_val = dCalcVectorDot3_41(R2 + 1, p);
+        expr2_val = A[0] * Q12 + A[1] * Q22 + A[2] * Q32 + B[1];
+        break;
+    case 6:
+        expr1_val = dCalcVectorDot3_41(R2 + 2, p);
+        expr2_val = A[0] * Q13 + A[1] * Q23 + A[2] * Q33 + B[2];
+        break;
+    case 7:
+        expr1_val = pp[2] * R21 - pp[1] * R31;
+        expr2_val = A[1] * Q31 + A[2] * Q21 + B[1] * Q13 + B[2] * Q12;
+        break;
+    case 8:
+        expr1_val = pp[2] * R22 - pp[1] * R32;
+        expr2_val = A[1] * Q32 + A[2] * Q22 + B[0] * Q13 + B[2] * Q11;
+        break;
+    case 9:
+        expr1_val = pp[2] * R23 - pp[1] * R33;
+        expr2_val = A[1] * Q33 + A[2] * Q23 + B[0] * Q12 + B[1] * Q11;
+        break;
+    case 10:
+        expr1_val = pp[0] * R31 - pp[2] * R11;
+        expr2_val = A[0] * Q31 + A[2] * Q11 + B[1] * Q23 + B[2] * Q22;
+        break;
+    case 11:
+        expr1_val = pp[0] * R32 - pp[2] * R12;
+        expr2_val = A[0] * Q32 + A[2] * Q12 + B[0] * Q23 + B[2] * Q21;
+        break;
+    case 12:
+        expr1_val = pp[0] * R33 - pp[2] * R13;
+        expr2_val = A[0] * Q33 + A[2] * Q13 + B[0] * Q22 + B[1] * Q21;
+        break;
+    case 13:
+        expr1_val = pp[1] * R11 - pp[0] * R21;
+        expr2_val = A[0] * Q21 + A[1] * Q11 + B[1] * Q33 + B[2] * Q32;
+        break;
+    case 14:
+        expr1_val = pp[1] * R12 - pp[0] * R22;
+        expr2_val = A[0] * Q22 + A[1] * Q12 + B[0] * Q33 + B[2] * Q31;
+        break;
+    case 15:
+        expr1_val = pp[1] * R13 - pp[0] * R23;
+        expr2_val = A[0] * Q23 + A[1] * Q13 + B[0] * Q32 + B[1] * Q31;
+        break;
+    default:
+        return 0;
+    }
+    return dFabs(expr1_val) - expr2_val > 0;
+}
+
+// the separating axis cache: each box keeps, for a few other boxes, the code
+// of the axis that separated them the last time they were collided. boxes
+// that stay near each other without touching (AABBs overlapping) are then
+// rejected with a single axis test.
+// an entry is the tag of the other geom shifted left 4 bits, or'ed with the
+// axis code. entries are only hints checked again before use, so a geom with
+// the same tag, a reused geom address, or another thread updating the entry
+// at the same time (see dSpaceCollideParallel) only cost a full test. as the
+// threads can do that, entries are read and written as relaxed atomics.
+
+static inline unsigned int boxSepCacheTag (const dxGeom *g)
+{
+    size_t h = (size_t)g >> 4;
+    h ^= h >> 14;
+    return (unsigned int)h & 0x0fffffff;
+}
+
 int dCollideBoxBox (dxGeom *o1, dxGeom *o2, int flags,
                     dContactGeom *contact, int skip)
 {
@@ -897,9 +1044,32 @@ int dCollideBoxBox (dxGeom *o1, dxGeom *o2, int flags,
     dxBox *b2 = (dxBox*) o2;
     dxPosR *posr1 = o1->GetRecomputePosR();
     dxPosR *posr2 = o2->GetRecomputePosR();
-    int num = dBoxBox (posr1->pos, posr1->R, b1->halfside,
+
+    unsigned int tag = boxSepCacheTag(o2);
+    volatile atomicord32 *slot = &b1->sepcache[tag & (dBOX_SEPCACHE_SIZE - 1)];
+    unsigned int entry = (unsigned int)ThrsafeLoadRelaxed(slot);
+    bool ours = (entry >> 4) == tag;
+
+    // with CONTACTS_UNIMPORTANT boxBox stops at the first axis that does not
+    // separate, so using the cache there could change its result
+    if (ours && !(flags & CONTACTS_UNIMPORTANT) &&
+        boxBoxAxisSeparates (posr1->pos, posr1->R, b1->halfside,
+                             posr2->pos, posr2->R, b2->halfside, entry & 15))
+        return 0;
+
+    int separating;
+    int num = boxBox (posr1->pos, posr1->R, b1->halfside,
                     posr2->pos, posr2->R, b2->halfside,
-                    normal, &depth, flags, contact, skip);
+                    normal, &depth, flags, contact, skip, &separating);
+    if (separating)
+    {
+        unsigned int newentry = (tag << 4) | (unsigned int)separating;
+        if (newentry != entry)
+            ThrsafeStoreRelaxed(slot, (atomicord32)newentry);
+    }
+    else if (ours)
+        ThrsafeStoreRelaxed(slot, 0);
+
     for (int i=0; i<num; i++)
     {
         dContactGeom *currContact = CONTACT(contact,i * skip);
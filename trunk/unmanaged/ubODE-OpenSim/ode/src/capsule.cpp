@@ -399,7 +399,7 @@ int dCollideCapsulePlane(dxGeom *o1, dxGeom *o2, int flags,
         {
             dContactGeom *c2 = CONTACT(contact,skip);
             dCopyVector3r4(c2->normal, planeNorm);
-            dAddScaledVector3r4(contact->pos, p, planeNorm, -capRadius);
+            dAddScaledVector3r4(c2->pos, p, planeNorm, -capRadius);
             c2->depth = depth;
             ncontacts = 2;
         }
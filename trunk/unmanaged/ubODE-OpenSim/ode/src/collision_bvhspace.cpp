@@ -0,0 +1,896 @@
+/*************************************************************************
+ *                                                                       *
+ * Open Dynamics Engine, Copyright (C) 2001,2002 Russell L. Smith.       *
+ * All rights reserved.  Email: russ@q12.org   Web: www.q12.org          *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of EITHER:                                  *
+ *   (1) The GNU Lesser General Public License as published by the Free  *
+ *       Software Foundation; either version 2.1 of the License, or (at  *
+ *       your option) any later version. The text of the GNU Lesser      *
+ *       General Public License is included with this library in the     *
+ *       file LICENSE.TXT.                                               *
+ *   (2) The BSD-style license that is included with this library in     *
+ *       the file LICENSE-BSD.TXT.                                       *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+ * LICENSE.TXT and LICENSE-BSD.TXT for more details.                     *
+ *                                                                       *
+ *************************************************************************/
+
+
+/*
+ *  BVH space.
+ *
+ *  A dynamic AABB tree. Every geom is a leaf and every internal node has two
+ *  children and the union of their AABBs. Leaves hold a fat AABB, the geom
+ *  AABB grown by a margin, so geoms that move a little do not change the
+ *  tree at all. A geom that leaves its fat AABB gets a new one and the nodes
+ *  above it are refit; such leaves are queued and a few of them are taken
+ *  out and inserted again at each cleanGeoms, which rebalances the tree
+ *  locally. A leaf is inserted next to the node that grows the surface of
+ *  the tree the least, and the nodes on its path are rotated when that
+ *  shrinks the surface further.
+ *
+ *  Geoms with an infinite AABB (planes) are kept out of the tree, in a list.
+ *  The tree is descended against itself by collide, with the AABB of the
+ *  geom by collide2, and two BVH spaces given to dSpaceCollide2 are
+ *  collided by descending both trees together. Rays of dSpaceRayCastBatch
+ *  descend it nearest node first.
+ *
+ *  Each geom has a leaf node, its index is kept in the geom tome_ex pointer.
+ */
+
+#include <ode/common.h>
+#include <ode/matrix.h>
+#include <ode/collision_space.h>
+#include <ode/collision.h>
+#include "config.h"
+#include "collision_kernel.h"
+#include "collision_space_internal.h"
+#include "collision_raycast.h"
+#include "array.h"
+
+#define GEOM_ENABLED(g) (((g)->gflags & GEOM_ENABLE_TEST_MASK) == GEOM_ENABLE_TEST_VALUE)
+
+#define GEOM_SET_LEAF(g,leaf) { (g)->tome_ex = (dxGeom**)(size_t)(leaf); }
+#define GEOM_GET_LEAF(g) ((int)(size_t)(g)->tome_ex)
+
+#define dxBVH_NULL          (-1)
+
+// where a leaf is, when not an index in the list of infinite geoms
+#define dxBVH_IN_TREE       (-1)
+#define dxBVH_NOT_PLACED    (-2)    // added, AABB not known yet
+
+// fat AABB margin on each side: absolute plus a part of the geom size
+#define dxBVH_MARGIN        REAL(0.05)
+#define dxBVH_MARGIN_SCALE  REAL(0.0625)
+
+// least number of refit leaves inserted again by each cleanGeoms
+#define dxBVH_REINSERT_MIN  4
+
+static inline bool aabbsOverlap(const dReal *bounds1, const dReal *bounds2)
+{
+    return !(bounds1[0] > bounds2[1] ||
+        bounds1[1] < bounds2[0] ||
+        bounds1[2] > bounds2[3] ||
+        bounds1[3] < bounds2[2] ||
+        bounds1[4] > bounds2[5] ||
+        bounds1[5] < bounds2[4]);
+}
+
+static inline bool aabbContains(const dReal *outer, const dReal *inner)
+{
+    return outer[0] <= inner[0] && outer[1] >= inner[1] &&
+        outer[2] <= inner[2] && outer[3] >= inner[3] &&
+        outer[4] <= inner[4] && outer[5] >= inner[5];
+}
+
+static inline bool aabbInfinite(const dReal *bounds)
+{
+    return bounds[0] <= -dInfinity || bounds[1] >= dInfinity ||
+        bounds[2] <= -dInfinity || bounds[3] >= dInfinity ||
+        bounds[4] <= -dInfinity || bounds[5] >= dInfinity;
+}
+
+static inline void aabbUnion(dReal *out, const dReal *a, const dReal *b)
+{
+    out[0] = a[0] < b[0] ? a[0] : b[0];
+    out[1] = a[1] > b[1] ? a[1] : b[1];
+    out[2] = a[2] < b[2] ? a[2] : b[2];
+    out[3] = a[3] > b[3] ? a[3] : b[3];
+    out[4] = a[4] < b[4] ? a[4] : b[4];
+    out[5] = a[5] > b[5] ? a[5] : b[5];
+}
+
+// half the surface area, the insertion cost
+static inline dReal aabbArea(const dReal *bounds)
+{
+    dReal dx = bounds[1] - bounds[0];
+    dReal dy = bounds[3] - bounds[2];
+    dReal dz = bounds[5] - bounds[4];
+    return dx * dy + dy * dz + dz * dx;
+}
+
+static inline dReal aabbUnionArea(const dReal *a, const dReal *b)
+{
+    dReal u[6];
+    aabbUnion(u, a, b);
+    return aabbArea(u);
+}
+
+static inline void collideLeaves(dxGeom *g1, dxGeom *g2, void *data, dNearCallback *callback)
+{
+    if (GEOM_ENABLED(g1) && GEOM_ENABLED(g2))
+        collideAABBs(g1, g2, data, callback);
+}
+
+// stack for the tree descents, on the C stack unless the tree is very deep
+template <class T> struct dxBVHStack
+{
+    enum { FIXED_SIZE = 128 };
+
+    dxBVHStack() : items(fixed), count(0), capacity(FIXED_SIZE) {}
+    ~dxBVHStack()
+    {
+        if (items != fixed)
+            dFree(items, capacity * sizeof(T));
+    }
+
+    bool empty() const { return count == 0; }
+    T pop() { return items[--count]; }
+    void push(const T &item)
+    {
+        if (count == capacity)
+        {
+            T *grown = (T*)dAlloc(2 * capacity * sizeof(T));
+            memcpy(grown, items, count * sizeof(T));
+            if (items != fixed)
+                dFree(items, capacity * sizeof(T));
+            items = grown;
+            capacity *= 2;
+        }
+        items[count++] = item;
+    }
+
+    T fixed[FIXED_SIZE];
+    T *items;
+    int count;
+    int capacity;
+};
+
+struct dxBVHSpace : public dxSpace
+{
+    dxBVHSpace(dSpaceID _space);
+    ~dxBVHSpace();
+
+    // dxSpace
+    virtual void add(dxGeom *g);
+    virtual void remove(dxGeom *g);
+    virtual void computeAABB();
+    virtual void cleanGeoms();
+    virtual void collide(void *data, dNearCallback *callback);
+    virtual void collide2(void *data, dxGeom *geom, dNearCallback *callback);
+    virtual void castRay(dxRayCast *cast);
+
+    static void collideSpaces(dxBVHSpace *s1, dxBVHSpace *s2, void *data, dNearCallback *callback);
+
+private:
+    struct Node
+    {
+        dReal aabb[6];  // fat AABB for leaves, union of the children for the others
+        int parent;     // dxBVH_NULL for the root, next free node for free nodes
+        int child1;     // dxBVH_NULL for leaves
+        int child2;
+        int height;     // 0 for leaves, -1 for free nodes
+        dxGeom *geom;   // leaves only, as are the next two
+        int big;        // index in bigs, or dxBVH_IN_TREE or dxBVH_NOT_PLACED
+        bool stale;     // refit since it was inserted, in the stale queue
+    };
+
+    struct NodePair
+    {
+        int a;
+        int b;
+    };
+
+    struct NodeEnter
+    {
+        int node;
+        dReal t;        // where the ray enters its AABB
+    };
+
+    bool isLeaf(int i) const { return nodes[i].child1 == dxBVH_NULL; }
+
+    // which node of an overlapping pair to split. the bigger one, so a huge
+    // leaf is reached at once instead of being met again under every node
+    // of the other side
+    static inline bool descendFirst(const Node &A, const Node &B)
+    {
+        if (B.child1 == dxBVH_NULL)
+            return true;
+        return A.child1 != dxBVH_NULL && aabbArea(A.aabb) >= aabbArea(B.aabb);
+    }
+
+    int  allocNode();
+    void freeNode(int i);
+    void fixNode(int i);
+    void rotate(int iA);
+    void insertLeaf(int leaf);
+    void removeLeaf(int leaf);
+    void refit(int i);
+    void updateLeaf(int leaf);
+    void removeBig(int leaf);
+    void dropStale(int leaf);
+    void reinsertStale();
+
+    dArray<Node> nodes;
+    int root;
+    int free_node;
+
+    dArray<int> bigs;       // leaves of geoms with infinite AABBs, not in the tree
+    dArray<int> stale;      // refit leaves to insert again, from stale_head on
+    int stale_head;
+};
+
+dxBVHSpace::dxBVHSpace(dSpaceID _space) : dxSpace(_space)
+{
+    type = dBVHSpaceClass;
+    root = dxBVH_NULL;
+    free_node = dxBVH_NULL;
+    stale_head = 0;
+}
+
+dxBVHSpace::~dxBVHSpace()
+{
+    // the geoms are removed by ~dxSpace, the nodes go with the arrays
+}
+
+//****************************************************************************
+// tree
+
+int dxBVHSpace::allocNode()
+{
+    int i = free_node;
+    if (i != dxBVH_NULL)
+        free_node = nodes[i].parent;
+    else
+    {
+        i = nodes.size();
+        nodes.setSize(i + 1);
+    }
+    Node &node = nodes[i];
+    node.parent = dxBVH_NULL;
+    node.child1 = dxBVH_NULL;
+    node.child2 = dxBVH_NULL;
+    node.height = 0;
+    node.geom = 0;
+    node.big = dxBVH_IN_TREE;
+    node.stale = false;
+    return i;
+}
+
+void dxBVHSpace::freeNode(int i)
+{
+    nodes[i].parent = free_node;
+    nodes[i].height = -1;
+    free_node = i;
+}
+
+// recomputes the height and AABB of an internal node from its children
+void dxBVHSpace::fixNode(int i)
+{
+    Node &node = nodes[i];
+    const Node &c1 = nodes[node.child1];
+    const Node &c2 = nodes[node.child2];
+    node.height = 1 + (c1.height > c2.height ? c1.height : c2.height);
+    aabbUnion(node.aabb, c1.aabb, c2.aabb);
+}
+
+// swaps a child of iA with a child of its other child when that shrinks the
+// AABB of the node between them. it keeps huge leaves high in the tree, where
+// they are met once, and not pushed down under many nodes by rotations that
+// only look at heights
+void dxBVHSpace::rotate(int iA)
+{
+    Node &A = nodes[iA];
+    if (A.height < 2)
+        return;
+
+    int iB = A.child1;
+    int iC = A.child2;
+    Node &B = nodes[iB];
+    Node &C = nodes[iC];
+
+    // candidates: the child of A moved down, the grandchild moved up
+    int bestUp = dxBVH_NULL;
+    int bestDown = dxBVH_NULL;
+    dReal bestGain = 0;
+
+    if (C.child1 != dxBVH_NULL)
+    {
+        dReal area = aabbArea(C.aabb);
+        dReal gain = area - aabbUnionArea(B.aabb, nodes[C.child2].aabb);
+        if (gain > bestGain)
+        {
+            bestGain = gain;
+            bestDown = iB;
+            bestUp = C.child1;
+        }
+        gain = area - aabbUnionArea(B.aabb, nodes[C.child1].aabb);
+        if (gain > bestGain)
+        {
+            bestGain = gain;
+            bestDown = iB;
+            bestUp = C.child2;
+        }
+    }
+    if (B.child1 != dxBVH_NULL)
+    {
+        dReal area = aabbArea(B.aabb);
+        dReal gain = area - aabbUnionArea(C.aabb, nodes[B.child2].aabb);
+        if (gain > bestGain)
+        {
+            bestGain = gain;
+            bestDown = iC;
+            bestUp = B.child1;
+        }
+        gain = area - aabbUnionArea(C.aabb, nodes[B.child1].aabb);
+        if (gain > bestGain)
+        {
+            bestGain = gain;
+            bestDown = iC;
+            bestUp = B.child2;
+        }
+    }
+    if (bestUp == dxBVH_NULL)
+        return;
+
+    int iM = nodes[bestUp].parent;
+    Node &M = nodes[iM];
+    if (M.child1 == bestUp)
+        M.child1 = bestDown;
+    else
+        M.child2 = bestDown;
+    if (A.child1 == bestDown)
+        A.child1 = bestUp;
+    else
+        A.child2 = bestUp;
+    nodes[bestDown].parent = iM;
+    nodes[bestUp].parent = iA;
+
+    fixNode(iM);
+    fixNode(iA);
+}
+
+// inserts a leaf with its fat AABB set
+void dxBVHSpace::insertLeaf(int leaf)
+{
+    nodes[leaf].big = dxBVH_IN_TREE;
+    if (root == dxBVH_NULL)
+    {
+        root = leaf;
+        nodes[leaf].parent = dxBVH_NULL;
+        return;
+    }
+
+    // find the best sibling, going down while it is cheaper to put the
+    // leaf under a child than next to the node
+    const dReal *bounds = nodes[leaf].aabb;
+    int index = root;
+    while (!isLeaf(index))
+    {
+        const Node &node = nodes[index];
+        dReal area = aabbArea(node.aabb);
+        dReal unionArea = aabbUnionArea(node.aabb, bounds);
+
+        // cost of a new parent for this node and the leaf
+        dReal cost = 2 * unionArea;
+        // least cost of pushing the leaf further down
+        dReal inheritance = 2 * (unionArea - area);
+
+        const Node &c1 = nodes[node.child1];
+        dReal cost1 = aabbUnionArea(c1.aabb, bounds) + inheritance;
+        if (c1.child1 != dxBVH_NULL)
+            cost1 -= aabbArea(c1.aabb);
+
+        const Node &c2 = nodes[node.child2];
+        dReal cost2 = aabbUnionArea(c2.aabb, bounds) + inheritance;
+        if (c2.child1 != dxBVH_NULL)
+            cost2 -= aabbArea(c2.aabb);
+
+        if (cost < cost1 && cost < cost2)
+            break;
+        index = cost1 < cost2 ? node.child1 : node.child2;
+    }
+
+    int sibling = index;
+    int newParent = allocNode();
+    int oldParent = nodes[sibling].parent;
+
+    Node &parent = nodes[newParent];
+    parent.parent = oldParent;
+    parent.child1 = sibling;
+    parent.child2 = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+    if (oldParent != dxBVH_NULL)
+    {
+        Node &P = nodes[oldParent];
+        if (P.child1 == sibling)
+            P.child1 = newParent;
+        else
+            P.child2 = newParent;
+    }
+    else
+        root = newParent;
+
+    for (index = newParent; index != dxBVH_NULL; index = nodes[index].parent)
+    {
+        fixNode(index);
+        rotate(index);
+    }
+}
+
+void dxBVHSpace::removeLeaf(int leaf)
+{
+    if (leaf == root)
+    {
+        root = dxBVH_NULL;
+        return;
+    }
+
+    int parent = nodes[leaf].parent;
+    int grandParent = nodes[parent].parent;
+    int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+    freeNode(parent);
+
+    nodes[sibling].parent = grandParent;
+    if (grandParent == dxBVH_NULL)
+    {
+        root = sibling;
+        return;
+    }
+
+    Node &G = nodes[grandParent];
+    if (G.child1 == parent)
+        G.child1 = sibling;
+    else
+        G.child2 = sibling;
+
+    for (int index = grandParent; index != dxBVH_NULL; index = nodes[index].parent)
+        fixNode(index);
+}
+
+// updates the AABBs above a leaf that changed, up to the first that does not change
+void dxBVHSpace::refit(int i)
+{
+    for (; i != dxBVH_NULL; i = nodes[i].parent)
+    {
+        Node &node = nodes[i];
+        dReal bounds[6];
+        aabbUnion(bounds, nodes[node.child1].aabb, nodes[node.child2].aabb);
+        if (memcmp(bounds, node.aabb, sizeof(bounds)) == 0)
+            break;
+        memcpy(node.aabb, bounds, sizeof(bounds));
+    }
+}
+
+//****************************************************************************
+// geoms
+
+void dxBVHSpace::add(dxGeom *g)
+{
+    int leaf = allocNode();
+    nodes[leaf].geom = g;
+    nodes[leaf].big = dxBVH_NOT_PLACED;
+
+    dxSpace::add(g);
+    GEOM_SET_LEAF(g, leaf);
+
+    // make sure cleanGeoms sees it, it may have come clean from another space
+    dGeomMoved(g);
+}
+
+void dxBVHSpace::remove(dxGeom *g)
+{
+    CHECK_NOT_LOCKED(this);
+    int leaf = GEOM_GET_LEAF(g);
+    dIASSERT(nodes[leaf].geom == g);
+
+    if (nodes[leaf].big == dxBVH_IN_TREE)
+        removeLeaf(leaf);
+    else if (nodes[leaf].big >= 0)
+        removeBig(leaf);
+    if (nodes[leaf].stale)
+        dropStale(leaf);
+    freeNode(leaf);
+
+    dxSpace::remove(g);
+}
+
+void dxBVHSpace::removeBig(int leaf)
+{
+    int i = nodes[leaf].big;
+    int last = bigs[bigs.size() - 1];
+    bigs[i] = last;
+    nodes[last].big = i;
+    bigs.setSize(bigs.size() - 1);
+}
+
+void dxBVHSpace::dropStale(int leaf)
+{
+    for (int i = stale_head; i < stale.size(); i++)
+    {
+        if (stale[i] == leaf)
+        {
+            stale[i] = dxBVH_NULL;
+            break;
+        }
+    }
+    nodes[leaf].stale = false;
+}
+
+// called for dirty geoms once their AABB is computed
+void dxBVHSpace::updateLeaf(int leaf)
+{
+    const dReal *bounds = nodes[leaf].geom->aabb;
+    int big = nodes[leaf].big;
+
+    if (aabbInfinite(bounds))
+    {
+        if (big >= 0)
+            return;
+        if (big == dxBVH_IN_TREE)
+            removeLeaf(leaf);
+        nodes[leaf].big = bigs.size();
+        bigs.push(leaf);
+        return;
+    }
+
+    if (big == dxBVH_IN_TREE && aabbContains(nodes[leaf].aabb, bounds))
+        return; // still inside its fat AABB
+
+    dReal fat[6];
+    for (int i = 0; i < 6; i += 2)
+    {
+        dReal margin = dxBVH_MARGIN + (bounds[i + 1] - bounds[i]) * dxBVH_MARGIN_SCALE;
+        fat[i] = bounds[i] - margin;
+        fat[i + 1] = bounds[i + 1] + margin;
+    }
+
+    if (big == dxBVH_IN_TREE && aabbsOverlap(fat, nodes[leaf].aabb))
+    {
+        // moved a little out of it, refit and let reinsertStale find it a
+        // better place later
+        memcpy(nodes[leaf].aabb, fat, sizeof(fat));
+        refit(nodes[leaf].parent);
+        if (!nodes[leaf].stale)
+        {
+            nodes[leaf].stale = true;
+            stale.push(leaf);
+        }
+        return;
+    }
+
+    // new, no longer infinite, or far from where it was
+    if (big == dxBVH_IN_TREE)
+        removeLeaf(leaf);
+    else if (big >= 0)
+        removeBig(leaf);
+    memcpy(nodes[leaf].aabb, fat, sizeof(fat));
+    insertLeaf(leaf);
+}
+
+// takes out some of the refit leaves and inserts them again
+void dxBVHSpace::reinsertStale()
+{
+    int budget = dxBVH_REINSERT_MIN + (stale.size() - stale_head) / 8;
+    while (budget > 0 && stale_head < stale.size())
+    {
+        int leaf = stale[stale_head++];
+        if (leaf == dxBVH_NULL)
+            continue;
+        nodes[leaf].stale = false;
+        if (nodes[leaf].big == dxBVH_IN_TREE)
+        {
+            removeLeaf(leaf);
+            insertLeaf(leaf);
+            budget--;
+        }
+    }
+
+    if (stale_head == stale.size())
+    {
+        stale.setSize(0);
+        stale_head = 0;
+    }
+    else if (stale_head > 64 && 2 * stale_head > stale.size())
+    {
+        int n = stale.size() - stale_head;
+        memmove(stale.data(), stale.data() + stale_head, n * sizeof(int));
+        stale.setSize(n);
+        stale_head = 0;
+    }
+}
+
+void dxBVHSpace::cleanGeoms()
+{
+    // compute the AABBs of all dirty geoms, clear the dirty flags
+    // and update their leaves
+    lock_count++;
+    for (dxGeom *g = first; g && (g->gflags & GEOM_DIRTY); g = g->next)
+    {
+        if (IS_SPACE(g))
+        {
+            ((dxSpace*)g)->cleanGeoms();
+        }
+        g->recomputeAABB();
+        dIASSERT((g->gflags & GEOM_AABB_BAD) == 0);
+        g->gflags &= ~GEOM_DIRTY;
+        updateLeaf(GEOM_GET_LEAF(g));
+    }
+    if (stale_head < stale.size())
+        reinsertStale();
+    lock_count--;
+}
+
+void dxBVHSpace::computeAABB()
+{
+    // the tree is only current after cleanGeoms
+    cleanGeoms();
+
+    if (root != dxBVH_NULL)
+        memcpy(aabb, nodes[root].aabb, sizeof(aabb));
+    else if (bigs.size())
+        memcpy(aabb, nodes[bigs[0]].geom->aabb, sizeof(aabb));
+    else
+    {
+        dSetZero(aabb, 6);
+        return;
+    }
+    for (int i = 0; i < bigs.size(); i++)
+        aabbUnion(aabb, aabb, nodes[bigs[i]].geom->aabb);
+}
+
+//****************************************************************************
+// collision
+
+void dxBVHSpace::collide(void *data, dNearCallback *callback)
+{
+    dAASSERT(callback);
+
+    lock_count++;
+    cleanGeoms();
+
+    // descend the tree against itself, a node against itself gives
+    // its children against themselves and each other
+    if (root != dxBVH_NULL)
+    {
+        dxBVHStack<NodePair> stack;
+        NodePair pair = { root, root };
+        stack.push(pair);
+        while (!stack.empty())
+        {
+            pair = stack.pop();
+            const Node &A = nodes[pair.a];
+            if (pair.a == pair.b)
+            {
+                if (A.child1 != dxBVH_NULL)
+                {
+                    NodePair p1 = { A.child1, A.child1 };
+                    NodePair p2 = { A.child2, A.child2 };
+                    NodePair p3 = { A.child1, A.child2 };
+                    stack.push(p1);
+                    stack.push(p2);
+                    stack.push(p3);
+                }
+                continue;
+            }
+
+            const Node &B = nodes[pair.b];
+            if (!aabbsOverlap(A.aabb, B.aabb))
+                continue;
+            if (A.child1 == dxBVH_NULL && B.child1 == dxBVH_NULL)
+                collideLeaves(A.geom, B.geom, data, callback);
+            else if (descendFirst(A, B))
+            {
+                NodePair p1 = { A.child1, pair.b };
+                NodePair p2 = { A.child2, pair.b };
+                stack.push(p1);
+                stack.push(p2);
+            }
+            else
+            {
+                NodePair p1 = { pair.a, B.child1 };
+                NodePair p2 = { pair.a, B.child2 };
+                stack.push(p1);
+                stack.push(p2);
+            }
+        }
+    }
+
+    // infinite AABBs against everything else, and the later infinite ones
+    for (int i = 0; i < bigs.size(); i++)
+    {
+        dxGeom *big = nodes[bigs[i]].geom;
+        for (dxGeom *g = first; g; g = g->next)
+        {
+            int b = nodes[GEOM_GET_LEAF(g)].big;
+            if (b == dxBVH_IN_TREE || b > i)
+                collideLeaves(big, g, data, callback);
+        }
+    }
+
+    lock_count--;
+}
+
+void dxBVHSpace::collide2(void *data, dxGeom *geom, dNearCallback *callback)
+{
+    dAASSERT(geom && callback);
+
+    lock_count++;
+    cleanGeoms();
+    geom->recomputeAABB();
+
+    if (root != dxBVH_NULL)
+    {
+        const dReal *bounds = geom->aabb;
+        dxBVHStack<int> stack;
+        stack.push(root);
+        while (!stack.empty())
+        {
+            const Node &node = nodes[stack.pop()];
+            if (!aabbsOverlap(node.aabb, bounds))
+                continue;
+            if (node.child1 == dxBVH_NULL)
+            {
+                if (GEOM_ENABLED(node.geom))
+                    collideAABBs(node.geom, geom, data, callback);
+            }
+            else
+            {
+                stack.push(node.child1);
+                stack.push(node.child2);
+            }
+        }
+    }
+
+    for (int i = 0; i < bigs.size(); i++)
+    {
+        dxGeom *big = nodes[bigs[i]].geom;
+        if (GEOM_ENABLED(big))
+            collideAABBs(big, geom, data, callback);
+    }
+
+    lock_count--;
+}
+
+// descends the nodes the ray crosses, the one it enters first before the
+// other, so the first hits found cut the ray short for the rest
+void dxBVHSpace::castRay(dxRayCast *cast)
+{
+    lock_count++;
+    cleanGeoms();
+
+    // planes first, a hit on the ground often leaves little of the ray
+    for (int i = 0; i < bigs.size(); i++)
+    {
+        dxGeom *big = nodes[bigs[i]].geom;
+        if (GEOM_ENABLED(big) && cast->enter(big->aabb) < dInfinity)
+            cast->test(big);
+    }
+
+    if (root != dxBVH_NULL)
+    {
+        dxBVHStack<NodeEnter> stack;
+        NodeEnter item = { root, cast->enter(nodes[root].aabb) };
+        if (item.t < dInfinity)
+            stack.push(item);
+        while (!stack.empty())
+        {
+            item = stack.pop();
+            if (item.t > cast->maxt)
+                continue;   // hits were found nearer since it was pushed
+            const Node &node = nodes[item.node];
+            if (node.child1 == dxBVH_NULL)
+            {
+                dxGeom *g = node.geom;
+                if (GEOM_ENABLED(g) && cast->enter(g->aabb) < dInfinity)
+                    cast->test(g);
+                continue;
+            }
+
+            NodeEnter c1 = { node.child1, cast->enter(nodes[node.child1].aabb) };
+            NodeEnter c2 = { node.child2, cast->enter(nodes[node.child2].aabb) };
+            if (c1.t > c2.t)
+            {
+                NodeEnter c = c1;
+                c1 = c2;
+                c2 = c;
+            }
+            if (c2.t < dInfinity)
+                stack.push(c2);
+            if (c1.t < dInfinity)
+                stack.push(c1);
+        }
+    }
+
+    lock_count--;
+}
+
+// reports the pairs of a geom of s1 and a geom of s2, in that order
+void dxBVHSpace::collideSpaces(dxBVHSpace *s1, dxBVHSpace *s2, void *data, dNearCallback *callback)
+{
+    s1->cleanGeoms();
+    s2->cleanGeoms();
+    s1->lock_count++;
+    s2->lock_count++;
+
+    if (s1->root != dxBVH_NULL && s2->root != dxBVH_NULL)
+    {
+        dxBVHStack<NodePair> stack;
+        NodePair pair = { s1->root, s2->root };
+        stack.push(pair);
+        while (!stack.empty())
+        {
+            pair = stack.pop();
+            const Node &A = s1->nodes[pair.a];
+            const Node &B = s2->nodes[pair.b];
+            if (!aabbsOverlap(A.aabb, B.aabb))
+                continue;
+            if (A.child1 == dxBVH_NULL && B.child1 == dxBVH_NULL)
+                collideLeaves(A.geom, B.geom, data, callback);
+            else if (descendFirst(A, B))
+            {
+                NodePair p1 = { A.child1, pair.b };
+                NodePair p2 = { A.child2, pair.b };
+                stack.push(p1);
+                stack.push(p2);
+            }
+            else
+            {
+                NodePair p1 = { pair.a, B.child1 };
+                NodePair p2 = { pair.a, B.child2 };
+                stack.push(p1);
+                stack.push(p2);
+            }
+        }
+    }
+
+    // infinite AABBs of s1 against all of s2, those of s2 against the tree of s1
+    for (int i = 0; i < s1->bigs.size(); i++)
+    {
+        dxGeom *big = s1->nodes[s1->bigs[i]].geom;
+        for (dxGeom *g = s2->first; g; g = g->next)
+            collideLeaves(big, g, data, callback);
+    }
+    for (int i = 0; i < s2->bigs.size(); i++)
+    {
+        dxGeom *big = s2->nodes[s2->bigs[i]].geom;
+        for (dxGeom *g = s1->first; g; g = g->next)
+        {
+            if (s1->nodes[GEOM_GET_LEAF(g)].big == dxBVH_IN_TREE)
+                collideLeaves(g, big, data, callback);
+        }
+    }
+
+    s2->lock_count--;
+    s1->lock_count--;
+}
+
+//****************************************************************************
+// space functions
+
+dxSpace *dBVHSpaceCreate(dxSpace *space)
+{
+    return new dxBVHSpace(space);
+}
+
+void dCollideBVHSpaces(dxSpace *s1, dxSpace *s2, void *data, dNearCallback *callback)
+{
+    dIASSERT(s1->type == dBVHSpaceClass && s2->type == dBVHSpaceClass);
+    dxBVHSpace::collideSpaces((dxBVHSpace*)s1, (dxBVHSpace*)s2, data, callback);
+}
@@ -1043,7 +1043,8 @@ int dCollideCylinderTrimesh(dxGeom *o1, dxGeom *o2, int flags, dContactGeom *con
 
     const unsigned uiTLSKind = Trimesh->getParentSpaceTLSKind();
     dIASSERT(uiTLSKind == Cylinder->getParentSpaceTLSKind()); // The colliding spaces must use matching cleanup method
-    TrimeshCollidersCache *pccColliderCache = GetTrimeshCollidersCache(uiTLSKind);
+    TrimeshCollidersCacheHolder ccHolder(uiTLSKind);
+    TrimeshCollidersCache *pccColliderCache = ccHolder.GetCache();
     OBBCollider& Collider = pccColliderCache->_OBBCollider;
 
     dQueryCTLPotentialCollisionTriangles(Collider, cData, Cylinder, Trimesh, pccColliderCache->defaultBoxCache);
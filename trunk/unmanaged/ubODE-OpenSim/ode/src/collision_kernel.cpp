@@ -39,6 +39,8 @@ for geometry objects
 #include "collision_transform.h"
 #include "collision_trimesh_internal.h"
 #include "collision_space_internal.h"
+#include "contact_reuse.h"
+#include "threadingutils.h"
 #include "odeou.h"
 
 #ifdef dLIBCCD_ENABLED
@@ -253,6 +255,9 @@ static void setAllColliders (int i, dColliderFn *fn)
 //    setCollider (dRayClass,dConvexClass,&dCollideRayConvex);
     //<-- Convex Collision
 */
+    // rays can hit convex geoms, even with the other convex colliders left out
+    setCollider (dRayClass,dConvexClass,&dCollideRayConvex);
+
     //--> dHeightfield Collision
     setCollider (dHeightfieldClass,dRayClass,&dCollideHeightfield);
     setCollider (dHeightfieldClass,dSphereClass,&dCollideHeightfield);
@@ -329,6 +334,22 @@ int dCollide (dxGeom *o1, dxGeom *o2, int flags, dContactGeom *contact, int skip
     int count = 0;
     if (ce->fn)
     {
+        // contacts kept from an earlier substep, if the world has reuse enabled
+        dxBody *body = o1->body != NULL ? o1->body : o2->body;
+        dxContactReuse *reuse = body != NULL ? body->world->contact_reuse : NULL;
+        if (reuse != NULL)
+        {
+            if (!dxContactReuse::Reusable(o1) || !dxContactReuse::Reusable(o2))
+                reuse = NULL;
+            else
+            {
+                count = reuse->Reuse(o1, o2, flags, contact, skip);
+                if (count >= 0)
+                    return count;
+                count = 0;
+            }
+        }
+
         if (ce->reverse)
         {
             count = (*ce->fn) (o2, o1, flags, contact, skip);
@@ -347,6 +368,9 @@ int dCollide (dxGeom *o1, dxGeom *o2, int flags, dContactGeom *contact, int skip
         else {
             count = (*ce->fn) (o1, o2, flags, contact, skip);
         }
+
+        if (reuse != NULL)
+            reuse->Store(o1, o2, flags, contact, skip, count);
     }
     return count;
 }
@@ -354,6 +378,8 @@ int dCollide (dxGeom *o1, dxGeom *o2, int flags, dContactGeom *contact, int skip
 //****************************************************************************
 // dxGeom
 
+static volatile atomicord32 geom_serial = 0;
+
 dxGeom::dxGeom (dSpaceID _space, int is_placeable)
 {
     // setup body vars. invalid type of -1 must be changed by the constructor.
@@ -382,6 +408,7 @@ dxGeom::dxGeom (dSpaceID _space, int is_placeable)
     dSetZero (aabb,6);
     category_bits = ~0;
     collide_bits = ~0;
+    serial = ThrsafeExchangeAdd(&geom_serial, 1);
 
     // put this geom in a space if required
     if (_space) dSpaceAdd (_space,this);
@@ -116,6 +116,7 @@ struct dxGeom : public dBase
     dxSpace *parent_space;// the space this geom is contained in, 0 if none
     dReal aabb[6];	// cached AABB for this space
     unsigned long category_bits,collide_bits;
+    unsigned serial;	// creation number, tells this geom from an earlier one at the same address
 
     dxGeom (dSpaceID _space, int is_placeable);
     virtual ~dxGeom();
@@ -227,6 +228,8 @@ struct dxGeom : public dBase
 #define dSPACE_TLS_KIND_MANUAL_VALUE 0
 #endif
 
+struct dxRayCast;    // in collision_raycast.h
+
 struct dxSpace : public dxGeom
 {
     int count;			// number of geoms in this space
@@ -272,6 +275,11 @@ struct dxSpace : public dxGeom
 
     virtual void collide (void *data, dNearCallback *callback)=0;
     virtual void collide2 (void *data, dxGeom *geom, dNearCallback *callback)=0;
+
+    // give cast->test() the enabled geoms whose AABB the ray crosses before
+    // cast->maxt, which test() lowers as it finds hits. the default uses a
+    // tree built for the batch, or tests the AABBs of all geoms
+    virtual void castRay (dxRayCast *cast);
 };
 
 //////////////////////////////////////////////////////////////////////////
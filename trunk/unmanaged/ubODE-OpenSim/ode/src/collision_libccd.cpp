@@ -240,25 +240,18 @@ static void ccdSupportSphere(const void *obj, const ccd_vec3_t *_dir, ccd_vec3_t
 static void ccdSupportConvex(const void *obj, const ccd_vec3_t *_dir, ccd_vec3_t *v)
 {
     const ccd_convex_t *c = (const ccd_convex_t *)obj;
-    ccd_vec3_t dir, p;
-    ccd_real_t maxdot, dot;
-    size_t i;
-    dReal *curp;
+    ccd_vec3_t dir;
+    dVector3 rdir;
+    const dReal *curp;
 
     ccdVec3Copy(&dir, _dir);
     ccdQuatRotVec(&dir, &c->o.rot_inv);
 
-    maxdot = -CCD_REAL_MAX;
-    curp = c->convex->points;
-    for (i = 0; i < c->convex->pointcount; i++, curp += 3){
-        ccdVec3Set(&p, curp[0], curp[1], curp[2]);
-        dot = ccdVec3Dot(&dir, &p);
-        if (dot > maxdot){
-            ccdVec3Copy(v, &p);
-            maxdot = dot;
-        }
-    }
-
+    rdir[0] = ccdVec3X(&dir);
+    rdir[1] = ccdVec3Y(&dir);
+    rdir[2] = ccdVec3Z(&dir);
+    curp = c->convex->points + (c->convex->SupportIndexLocal(rdir) * 3);
+    ccdVec3Set(v, curp[0], curp[1], curp[2]);
 
     // transform support vertex
     ccdQuatRotVec(v, &c->o.rot);
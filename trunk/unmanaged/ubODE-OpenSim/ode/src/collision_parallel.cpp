@@ -0,0 +1,234 @@
+/*************************************************************************
+ *                                                                       *
+ * Open Dynamics Engine, Copyright (C) 2001,2002 Russell L. Smith.       *
+ * All rights reserved.  Email: russ@q12.org   Web: www.q12.org          *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of EITHER:                                  *
+ *   (1) The GNU Lesser General Public License as published by the Free  *
+ *       Software Foundation; either version 2.1 of the License, or (at  *
+ *       your option) any later version. The text of the GNU Lesser      *
+ *       General Public License is included with this library in the     *
+ *       file LICENSE.TXT.                                               *
+ *   (2) The BSD-style license that is included with this library in     *
+ *       the file LICENSE-BSD.TXT.                                       *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+ * LICENSE.TXT and LICENSE-BSD.TXT for more details.                     *
+ *                                                                       *
+ *************************************************************************/
+
+
+/*
+ *  Parallel space collide.
+ *
+ *  The candidate pairs are gathered first, with the space collide and the
+ *  user filter, on the calling thread. dCollide is then called for them by
+ *  the threads of the world threading, each thread taking runs of pairs and
+ *  putting their contacts in a buffer of its own. Last the contacts of each
+ *  pair are given to the user, in the order the pairs were gathered, so the
+ *  results do not depend on which thread collided which pair.
+ *
+ *  Only pairs of the primitive classes (sphere to convex) are given to the
+ *  threads. Trimesh, heightfield and terrain colliders keep scratch data in
+ *  the geoms or in global caches, a geom transform keeps the placement of
+ *  its geom in itself and nothing is known of user classes, so their pairs
+ *  are collided by the calling thread, while the other threads work.
+ */
+
+#include <ode/common.h>
+#include <ode/collision_space.h>
+#include <ode/collision.h>
+#include "config.h"
+#include "objects.h"
+#include "collision_kernel.h"
+#include "threadingutils.h"
+#include "array.h"
+
+// number of pairs a thread takes at once
+#define dxPARALLEL_PAIRS_PER_TAKE   16
+
+struct dxParallelPair {
+    dxGeom *g1, *g2;
+    int flags;
+    int buffer;         // buffer with the contacts, -1 if not collided yet
+    int first;          // first contact in the buffer
+    int count;
+};
+
+struct dxParallelCollider {
+    void *data;
+    dNearFilterCallback *filter;
+    dArray<dxParallelPair> pairs;       // in the order they were gathered
+    dArray<int> threaded;               // pairs any thread may collide
+    dArray<dContactGeom> *buffers;      // one for each thread
+    volatile atomicord32 take_index;
+    unsigned take_count;
+
+    dxParallelCollider(void *_data, dNearFilterCallback *_filter):
+        data(_data), filter(_filter), buffers(NULL), take_index(0), take_count(0) {}
+    ~dxParallelCollider() { delete[] buffers; }
+
+    static void gatherCallback(void *data, dxGeom *o1, dxGeom *o2);
+    void run(dxWorld *world, dNearContactsCallback *callback);
+
+    void collidePair(dxParallelPair &pair, unsigned buffer_index);
+    void collideTaken(unsigned buffer_index);
+
+    static int ThreadedGroup_Callback(void *callContext, dcallindex_t callInstanceIndex, dCallReleaseeID callThisReleasee);
+    static int ThreadedCollide_Callback(void *callContext, dcallindex_t callInstanceIndex, dCallReleaseeID callThisReleasee);
+};
+
+#define IS_THREAD_SAFE_COLLIDER(g) ((g)->type >= dSphereClass && (g)->type <= dConvexClass)
+
+void dxParallelCollider::gatherCallback(void *data, dxGeom *o1, dxGeom *o2)
+{
+    dxParallelCollider *collider = (dxParallelCollider *)data;
+
+    if (IS_SPACE(o1) || IS_SPACE(o2)) {
+        dSpaceCollide2(o1, o2, data, &gatherCallback);
+        return;
+    }
+
+    int flags = collider->filter(collider->data, o1, o2);
+    if ((flags & NUMC_MASK) == 0) return;
+
+    dxParallelPair pair;
+    pair.g1 = o1;
+    pair.g2 = o2;
+    pair.flags = flags;
+    pair.buffer = -1;
+    pair.first = 0;
+    pair.count = 0;
+    collider->pairs.push(pair);
+}
+
+void dxParallelCollider::collidePair(dxParallelPair &pair, unsigned buffer_index)
+{
+    dArray<dContactGeom> &buffer = buffers[buffer_index];
+    int first = buffer.size();
+    buffer.setSize(first + (pair.flags & NUMC_MASK));
+    int count = dCollide(pair.g1, pair.g2, pair.flags, buffer.data() + first, sizeof(dContactGeom));
+    buffer.setSize(first + count);
+
+    pair.buffer = (int)buffer_index;
+    pair.first = first;
+    pair.count = count;
+}
+
+void dxParallelCollider::collideTaken(unsigned buffer_index)
+{
+    const int threaded_count = threaded.size();
+    unsigned take;
+    while ((take = ThrsafeIncrementIntUpToLimit(&take_index, take_count)) != take_count) {
+        int i = (int)take * dxPARALLEL_PAIRS_PER_TAKE;
+        int end = i + dxPARALLEL_PAIRS_PER_TAKE < threaded_count ? i + dxPARALLEL_PAIRS_PER_TAKE : threaded_count;
+        for (; i < end; i++) {
+            collidePair(pairs[threaded[i]], buffer_index);
+        }
+    }
+}
+
+int dxParallelCollider::ThreadedGroup_Callback(void *callContext, dcallindex_t callInstanceIndex, dCallReleaseeID callThisReleasee)
+{
+    (void)callContext; // unused
+    (void)callInstanceIndex; // unused
+    (void)callThisReleasee; // unused
+    // Do nothing - it's just a wrapper call
+    return true;
+}
+
+int dxParallelCollider::ThreadedCollide_Callback(void *callContext, dcallindex_t callInstanceIndex, dCallReleaseeID callThisReleasee)
+{
+    (void)callThisReleasee; // unused
+    static_cast<dxParallelCollider *>(callContext)->collideTaken((unsigned)callInstanceIndex);
+    return true;
+}
+
+void dxParallelCollider::run(dxWorld *world, dNearContactsCallback *callback)
+{
+    const int pair_count = pairs.size();
+
+    // positions are made valid here, as dCollide would do it from any thread
+    for (int i = 0; i < pair_count; i++) {
+        dxParallelPair &pair = pairs[i];
+        if (IS_THREAD_SAFE_COLLIDER(pair.g1) && IS_THREAD_SAFE_COLLIDER(pair.g2)) {
+            pair.g1->recomputePosr();
+            pair.g2->recomputePosr();
+            threaded.push(i);
+        }
+    }
+
+    take_count = (unsigned)(threaded.size() + dxPARALLEL_PAIRS_PER_TAKE - 1) / dxPARALLEL_PAIRS_PER_TAKE;
+
+    // the calling thread takes pairs as well, after the ones it keeps
+    unsigned thread_count = 0;
+    if (world != NULL && take_count > 1) {
+        thread_count = world->RetrieveThreadingThreadCount();
+        if (thread_count > take_count - 1) thread_count = take_count - 1;
+    }
+
+    buffers = new dArray<dContactGeom>[thread_count + 1];
+    const unsigned own_buffer = thread_count;
+
+    bool threads_posted = false;
+    dCallWaitID call_wait = NULL;
+    if (thread_count != 0) {
+        call_wait = world->AllocThreadedCallWait();
+        if (call_wait != NULL && world->PreallocateResourcesForThreadedCalls(thread_count + 1)) {
+            dCallReleaseeID group_releasee;
+            world->PostThreadedCall(NULL, &group_releasee, thread_count, NULL, call_wait,
+                &ThreadedGroup_Callback, (void *)this, 0, "Parallel Collide Group");
+            world->PostThreadedCallsGroup(NULL, thread_count, group_releasee,
+                &ThreadedCollide_Callback, (void *)this, "Parallel Collide");
+            threads_posted = true;
+        }
+    }
+
+    for (int i = 0; i < pair_count; i++) {
+        dxParallelPair &pair = pairs[i];
+        if (!IS_THREAD_SAFE_COLLIDER(pair.g1) || !IS_THREAD_SAFE_COLLIDER(pair.g2)) {
+            collidePair(pair, own_buffer);
+        }
+    }
+
+    collideTaken(own_buffer);
+
+    if (threads_posted) {
+        world->WaitThreadedCallExclusively(NULL, call_wait, NULL, "Parallel Collide Wait");
+    }
+    if (call_wait != NULL) {
+        world->FreeThreadedCallWait(call_wait);
+    }
+
+    for (int i = 0; i < pair_count; i++) {
+        const dxParallelPair &pair = pairs[i];
+        dIASSERT(pair.buffer != -1);
+        if (pair.count != 0) {
+            callback(data, pair.g1, pair.g2, buffers[pair.buffer].data() + pair.first, pair.count);
+        }
+    }
+}
+
+void dSpaceCollideParallel(dxSpace *space, dxWorld *world, void *data,
+                           dNearFilterCallback *filter, dNearContactsCallback *callback)
+{
+    dAASSERT(space && filter && callback);
+    dUASSERT(dGeomIsSpace(space), "argument not a space");
+
+    dxParallelCollider collider(data, filter);
+    space->collide(&collider, &dxParallelCollider::gatherCallback);
+    collider.run(world, callback);
+}
+
+void dSpaceCollide2Parallel(dxGeom *g1, dxGeom *g2, dxWorld *world, void *data,
+                            dNearFilterCallback *filter, dNearContactsCallback *callback)
+{
+    dAASSERT(g1 && g2 && filter && callback);
+
+    dxParallelCollider collider(data, filter);
+    dSpaceCollide2(g1, g2, &collider, &dxParallelCollider::gatherCallback);
+    collider.run(world, callback);
+}
@@ -0,0 +1,691 @@
+/*************************************************************************
+ *                                                                       *
+ * Open Dynamics Engine, Copyright (C) 2001,2002 Russell L. Smith.       *
+ * All rights reserved.  Email: russ@q12.org   Web: www.q12.org          *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of EITHER:                                  *
+ *   (1) The GNU Lesser General Public License as published by the Free  *
+ *       Software Foundation; either version 2.1 of the License, or (at  *
+ *       your option) any later version. The text of the GNU Lesser      *
+ *       General Public License is included with this library in the     *
+ *       file LICENSE.TXT.                                               *
+ *   (2) The BSD-style license that is included with this library in     *
+ *       the file LICENSE-BSD.TXT.                                       *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+ * LICENSE.TXT and LICENSE-BSD.TXT for more details.                     *
+ *                                                                       *
+ *************************************************************************/
+
+
+/*
+ *  Persistent hash space.
+ *
+ *  Same multi resolution grid as the hash space, but the cells are kept from
+ *  one collide to the next and only geoms made dirty by dGeomMoved, or whose
+ *  AABB changed, are hashed again. The overlapping pairs found by collide are
+ *  also kept, so geoms that do not move cost nothing until something moves
+ *  near them. collide2 looks up the cells the geom covers instead of testing
+ *  every geom of the space.
+ *
+ *  Each geom has an entry, reached with its tome_ex pointer. An entry is put
+ *  in the (up to 8) cells of its own level, like the hash space does, and also,
+ *  as a "subtree" node, in the cells it covers at every populated level above
+ *  it. So an AABB looking up the cells of its level finds all smaller AABBs
+ *  near it, and the cells of the levels above give the bigger ones.
+ *  Cells live in one hash table of nodes kept in a heap array with a free list.
+ */
+
+#include <ode/common.h>
+#include <ode/collision_space.h>
+#include <ode/collision.h>
+#include "config.h"
+#include "collision_kernel.h"
+#include "collision_space_internal.h"
+#include "array.h"
+
+#define GEOM_ENABLED(g) (((g)->gflags & GEOM_ENABLE_TEST_MASK) == GEOM_ENABLE_TEST_VALUE)
+
+// entry levels that are not a grid level
+#define dxHASH_LEVEL_NONE   (-MAXINT)   // not hashed yet
+#define dxHASH_LEVEL_BIG    MAXINT      // too big for the grid, kept in the big list
+
+#define dxHASH_MIN_TABLE_SIZE 1024
+
+// per geom data
+struct dxHashEntry : public dBase
+{
+    dxGeom *geom;
+    dReal aabb[6];      // AABB the cells were computed from
+    int level;          // cell level, or one of the dxHASH_LEVEL values
+    int dbounds[6];     // AABB discretized to the cell size of level
+    int index;          // in the entries list
+    int first_node;     // first of the nodes of this entry, -1 if none
+    unsigned stamp;     // last query that found this entry
+    bool moved;         // in the moved list
+};
+
+static inline bool aabbsOverlap(const dReal *bounds1, const dReal *bounds2)
+{
+    return !(bounds1[0] > bounds2[1] ||
+        bounds1[1] < bounds2[0] ||
+        bounds1[2] > bounds2[3] ||
+        bounds1[3] < bounds2[2] ||
+        bounds1[4] > bounds2[5] ||
+        bounds1[5] < bounds2[4]);
+}
+
+struct dxPersistentHashSpace : public dxHashSpace
+{
+    dxPersistentHashSpace(dSpaceID _space);
+    ~dxPersistentHashSpace();
+
+    // dxHashSpace
+    virtual void setLevels(int minlevel, int maxlevel);
+
+    // dxSpace
+    virtual void add(dxGeom *g);
+    virtual void remove(dxGeom *g);
+    virtual void cleanGeoms();
+    virtual void collide(void *data, dNearCallback *callback);
+    virtual void collide2(void *data, dxGeom *geom, dNearCallback *callback);
+
+private:
+    // an entry in a cell
+    struct Node
+    {
+        int next;       // next node in the hash table chain, or in the free list
+        int prev;       // previous node in the hash table chain, -1 if first
+        int entry_next; // next node of the same entry
+        int key;        // 2 * level, +1 for subtree nodes
+        int x, y, z;    // cell position, discretized to the cell size of level
+        dxHashEntry *entry;
+    };
+
+    struct Pair
+    {
+        dxHashEntry *e1;
+        dxHashEntry *e2;
+    };
+
+    static inline unsigned hashCell(int key, int x, int y, int z)
+    {
+        return ((unsigned)x * 73856093u) ^ ((unsigned)y * 19349663u) ^
+            ((unsigned)z * 83492791u) ^ ((unsigned)key * 2654435761u);
+    }
+
+    static inline void shiftBounds(int *db, int shift)
+    {
+        for (int i = 0; i < 6; i++)
+            db[i] >>= shift;
+    }
+
+    bool isLevelIndexed(int level) const { return level_indexed[level - global_minlevel] != 0; }
+
+    int  allocNode();
+    void insertNode(dxHashEntry *e, int key, int x, int y, int z);
+    void insertCells(dxHashEntry *e, int key, const int *db);
+    void removeNodes(dxHashEntry *e);
+    void growTable();
+    void insertSubtreeNodes(dxHashEntry *e, int level);
+    void indexLevel(int level);
+    void hashEntry(dxHashEntry *e);
+    void updateEntry(dxHashEntry *e);
+    void removeBig(dxHashEntry *e);
+    void resetLevels();
+    void invalidatePairs();
+    void scanCells(int key, const int *db, const dReal *bounds, const dxHashEntry *self);
+    void query(const dReal *bounds, int level, const int *db, const dxHashEntry *self);
+    void addPairs(dxHashEntry *e);
+
+    dArray<dxHashEntry*> entries;   // all entries, entry->index is the position
+    dArray<dxHashEntry*> bigs;      // entries too big for the grid
+    dArray<dxHashEntry*> moved;     // entries hashed or changed since the last collide
+    dArray<dxHashEntry*> found;     // query results
+    dArray<Pair> pairs;             // entries with overlapping AABBs, as of the last collide
+    bool pairs_valid;
+
+    dArray<Node> nodes;
+    int free_node;
+    int node_count;
+    dArray<int> table;              // first node of each hash chain, -1 if none
+    unsigned table_mask;
+
+    dArray<char> level_indexed;     // levels where all lower entries have subtree nodes
+    int max_indexed_level;
+    unsigned stamp;
+};
+
+dxPersistentHashSpace::dxPersistentHashSpace(dSpaceID _space) : dxHashSpace(_space)
+{
+    pairs_valid = false;
+    free_node = -1;
+    node_count = 0;
+    table.setSize(dxHASH_MIN_TABLE_SIZE);
+    table_mask = dxHASH_MIN_TABLE_SIZE - 1;
+    for (int i = 0; i < dxHASH_MIN_TABLE_SIZE; i++)
+        table[i] = -1;
+    stamp = 0;
+    resetLevels();
+}
+
+dxPersistentHashSpace::~dxPersistentHashSpace()
+{
+    // the geoms are removed by ~dxSpace, which does not know about entries
+    for (int i = 0; i < entries.size(); i++)
+        delete entries[i];
+}
+
+void dxPersistentHashSpace::resetLevels()
+{
+    int numLevels = global_maxlevel - global_minlevel + 1;
+    level_indexed.setSize(numLevels);
+    for (int i = 0; i < numLevels; i++)
+        level_indexed[i] = 0;
+    max_indexed_level = global_minlevel - 1;
+}
+
+void dxPersistentHashSpace::setLevels(int minlevel, int maxlevel)
+{
+    CHECK_NOT_LOCKED(this);
+    dxHashSpace::setLevels(minlevel, maxlevel);
+
+    // hash everything again with the new levels
+    for (int i = 0; i < entries.size(); i++)
+    {
+        dxHashEntry *e = entries[i];
+        removeNodes(e);
+        e->level = dxHASH_LEVEL_NONE;
+    }
+    bigs.setSize(0);
+    resetLevels();
+    invalidatePairs();
+    for (int i = 0; i < entries.size(); i++)
+    {
+        if ((entries[i]->geom->gflags & GEOM_AABB_BAD) == 0)
+            updateEntry(entries[i]);
+    }
+}
+
+//****************************************************************************
+// cells
+
+int dxPersistentHashSpace::allocNode()
+{
+    int i = free_node;
+    if (i >= 0)
+        free_node = nodes[i].next;
+    else
+    {
+        i = nodes.size();
+        nodes.setSize(i + 1);
+    }
+    node_count++;
+    return i;
+}
+
+void dxPersistentHashSpace::insertNode(dxHashEntry *e, int key, int x, int y, int z)
+{
+    int i = allocNode();
+    Node &node = nodes[i];
+    node.key = key;
+    node.x = x;
+    node.y = y;
+    node.z = z;
+    node.entry = e;
+    node.entry_next = e->first_node;
+    e->first_node = i;
+
+    unsigned hi = hashCell(key, x, y, z) & table_mask;
+    node.prev = -1;
+    node.next = table[hi];
+    if (node.next >= 0)
+        nodes[node.next].prev = i;
+    table[hi] = i;
+}
+
+void dxPersistentHashSpace::insertCells(dxHashEntry *e, int key, const int *db)
+{
+    for (int xi = db[0]; xi <= db[1]; xi++)
+        for (int yi = db[2]; yi <= db[3]; yi++)
+            for (int zi = db[4]; zi <= db[5]; zi++)
+                insertNode(e, key, xi, yi, zi);
+}
+
+void dxPersistentHashSpace::removeNodes(dxHashEntry *e)
+{
+    int i = e->first_node;
+    while (i >= 0)
+    {
+        Node &node = nodes[i];
+        if (node.prev >= 0)
+            nodes[node.prev].next = node.next;
+        else
+            table[hashCell(node.key, node.x, node.y, node.z) & table_mask] = node.next;
+        if (node.next >= 0)
+            nodes[node.next].prev = node.prev;
+
+        int next = node.entry_next;
+        node.next = free_node;
+        free_node = i;
+        node_count--;
+        i = next;
+    }
+    e->first_node = -1;
+}
+
+// doubles the hash table and puts all nodes in their new chains
+void dxPersistentHashSpace::growTable()
+{
+    int size = table.size() * 2;
+    table.setSize(size);
+    table_mask = size - 1;
+    for (int i = 0; i < size; i++)
+        table[i] = -1;
+
+    for (int k = 0; k < entries.size(); k++)
+    {
+        for (int i = entries[k]->first_node; i >= 0; i = nodes[i].entry_next)
+        {
+            Node &node = nodes[i];
+            unsigned hi = hashCell(node.key, node.x, node.y, node.z) & table_mask;
+            node.prev = -1;
+            node.next = table[hi];
+            if (node.next >= 0)
+                nodes[node.next].prev = i;
+            table[hi] = i;
+        }
+    }
+}
+
+void dxPersistentHashSpace::insertSubtreeNodes(dxHashEntry *e, int level)
+{
+    int db[6];
+    memcpy(db, e->dbounds, sizeof(db));
+    shiftBounds(db, level - e->level);
+    insertCells(e, 2 * level + 1, db);
+}
+
+// makes the cells of level find all the entries of lower levels
+void dxPersistentHashSpace::indexLevel(int level)
+{
+    level_indexed[level - global_minlevel] = 1;
+    if (level > max_indexed_level)
+        max_indexed_level = level;
+
+    for (int i = 0; i < entries.size(); i++)
+    {
+        dxHashEntry *e = entries[i];
+        if (e->level < level && e->level != dxHASH_LEVEL_NONE)
+            insertSubtreeNodes(e, level);
+    }
+    if (node_count > 2 * table.size())
+        growTable();
+}
+
+// puts the entry in the cells for its current AABB
+void dxPersistentHashSpace::hashEntry(dxHashEntry *e)
+{
+    if (e->level == dxHASH_LEVEL_BIG)
+    {
+        bigs.push(e);
+        return;
+    }
+
+    if (!isLevelIndexed(e->level))
+        indexLevel(e->level);
+
+    insertCells(e, 2 * e->level, e->dbounds);
+    for (int l = e->level + 1; l <= max_indexed_level; l++)
+    {
+        if (isLevelIndexed(l))
+            insertSubtreeNodes(e, l);
+    }
+    if (node_count > 2 * table.size())
+        growTable();
+}
+
+void dxPersistentHashSpace::removeBig(dxHashEntry *e)
+{
+    for (int i = 0; i < bigs.size(); i++)
+    {
+        if (bigs[i] == e)
+        {
+            bigs[i] = bigs[bigs.size() - 1];
+            bigs.setSize(bigs.size() - 1);
+            return;
+        }
+    }
+}
+
+// called for dirty geoms once their AABB is computed
+void dxPersistentHashSpace::updateEntry(dxHashEntry *e)
+{
+    const dReal *aabb = e->geom->aabb;
+    if (e->level != dxHASH_LEVEL_NONE && memcmp(e->aabb, aabb, sizeof(e->aabb)) == 0)
+        return; // did not really move
+
+    memcpy(e->aabb, aabb, sizeof(e->aabb));
+
+    int level = findLevel(aabb);
+    if (level < global_minlevel)
+        level = global_minlevel;
+    int db[6];
+    if (level <= global_maxlevel)
+    {
+        // cellsize = 2^level
+        dReal cellSizeRecip = dRecip((dReal)ldexp(1.0, level));
+        for (int i = 0; i < 6; i++)
+            db[i] = (int)floor(aabb[i] * cellSizeRecip);
+    }
+    else
+        level = dxHASH_LEVEL_BIG;
+
+    if (level != e->level || (level != dxHASH_LEVEL_BIG && memcmp(db, e->dbounds, sizeof(db)) != 0))
+    {
+        if (e->level == dxHASH_LEVEL_BIG)
+            removeBig(e);
+        else
+            removeNodes(e);
+        e->level = level;
+        memcpy(e->dbounds, db, sizeof(db));
+        hashEntry(e);
+    }
+
+    if (!e->moved)
+    {
+        e->moved = true;
+        moved.push(e);
+    }
+}
+
+//****************************************************************************
+// geoms
+
+void dxPersistentHashSpace::add(dxGeom *g)
+{
+    dxHashEntry *e = new dxHashEntry;
+    e->geom = g;
+    e->level = dxHASH_LEVEL_NONE;
+    e->index = entries.size();
+    e->first_node = -1;
+    e->stamp = 0;
+    e->moved = false;
+    entries.push(e);
+
+    dxSpace::add(g);
+    g->tome_ex = (dxGeom**)e;
+
+    // make sure cleanGeoms sees it, it may have come clean from another space
+    dGeomMoved(g);
+}
+
+void dxPersistentHashSpace::remove(dxGeom *g)
+{
+    CHECK_NOT_LOCKED(this);
+    dxHashEntry *e = (dxHashEntry*)g->tome_ex;
+    dIASSERT(e && e->geom == g);
+
+    // cheaper to find all pairs again than to pick out the ones of e
+    invalidatePairs();
+
+    if (e->level == dxHASH_LEVEL_BIG)
+        removeBig(e);
+    else
+        removeNodes(e);
+
+    dxHashEntry *last = entries[entries.size() - 1];
+    entries[e->index] = last;
+    last->index = e->index;
+    entries.setSize(entries.size() - 1);
+    delete e;
+
+    dxSpace::remove(g);
+}
+
+void dxPersistentHashSpace::invalidatePairs()
+{
+    for (int i = 0; i < moved.size(); i++)
+        moved[i]->moved = false;
+    moved.setSize(0);
+    pairs.setSize(0);
+    pairs_valid = false;
+}
+
+void dxPersistentHashSpace::cleanGeoms()
+{
+    // compute the AABBs of all dirty geoms, clear the dirty flags
+    // and update their cells
+    lock_count++;
+    for (dxGeom *g = first; g && (g->gflags & GEOM_DIRTY); g = g->next)
+    {
+        if (IS_SPACE(g))
+        {
+            ((dxSpace*)g)->cleanGeoms();
+        }
+        g->recomputeAABB();
+        dIASSERT((g->gflags & GEOM_AABB_BAD) == 0);
+        g->gflags &= ~GEOM_DIRTY;
+        updateEntry((dxHashEntry*)g->tome_ex);
+    }
+    lock_count--;
+}
+
+//****************************************************************************
+// queries
+
+void dxPersistentHashSpace::scanCells(int key, const int *db, const dReal *bounds,
+    const dxHashEntry *self)
+{
+    for (int xi = db[0]; xi <= db[1]; xi++)
+    {
+        for (int yi = db[2]; yi <= db[3]; yi++)
+        {
+            for (int zi = db[4]; zi <= db[5]; zi++)
+            {
+                unsigned hi = hashCell(key, xi, yi, zi) & table_mask;
+                for (int i = table[hi]; i >= 0; i = nodes[i].next)
+                {
+                    const Node &node = nodes[i];
+                    if (node.key != key || node.x != xi || node.y != yi || node.z != zi)
+                        continue;
+                    dxHashEntry *e = node.entry;
+                    if (e == self || e->stamp == stamp)
+                        continue;
+                    e->stamp = stamp;
+                    if (aabbsOverlap(bounds, e->aabb))
+                        found.push(e);
+                }
+            }
+        }
+    }
+}
+
+// finds the grid entries whose AABB overlaps bounds
+// level must be indexed and db be bounds discretized to its cell size
+void dxPersistentHashSpace::query(const dReal *bounds, int level, const int *db,
+    const dxHashEntry *self)
+{
+    dIASSERT(isLevelIndexed(level));
+    found.setSize(0);
+    if (++stamp == 0)
+    {
+        for (int i = 0; i < entries.size(); i++)
+            entries[i]->stamp = 0;
+        stamp = 1;
+    }
+
+    int dbl[6];
+    memcpy(dbl, db, sizeof(dbl));
+
+    // lower levels, and this one
+    scanCells(2 * level + 1, dbl, bounds, self);
+    scanCells(2 * level, dbl, bounds, self);
+
+    // higher levels
+    for (int l = level + 1; l <= max_indexed_level; l++)
+    {
+        shiftBounds(dbl, 1);
+        if (isLevelIndexed(l))
+            scanCells(2 * l, dbl, bounds, self);
+    }
+}
+
+// adds the pairs of a moved entry. pairs of two moved entries are
+// added by the one with the lowest index
+void dxPersistentHashSpace::addPairs(dxHashEntry *e)
+{
+    Pair pair;
+    pair.e1 = e;
+
+    if (e->level == dxHASH_LEVEL_BIG)
+    {
+        for (int i = 0; i < entries.size(); i++)
+        {
+            dxHashEntry *e2 = entries[i];
+            if (e2 == e || e2->level == dxHASH_LEVEL_NONE || (e2->moved && e2->index < e->index))
+                continue;
+            if (aabbsOverlap(e->aabb, e2->aabb))
+            {
+                pair.e2 = e2;
+                pairs.push(pair);
+            }
+        }
+        return;
+    }
+
+    query(e->aabb, e->level, e->dbounds, e);
+    for (int i = 0; i < found.size(); i++)
+    {
+        dxHashEntry *e2 = found[i];
+        if (e2->moved && e2->index < e->index)
+            continue;
+        pair.e2 = e2;
+        pairs.push(pair);
+    }
+    for (int i = 0; i < bigs.size(); i++)
+    {
+        dxHashEntry *e2 = bigs[i];
+        if (e2->moved && e2->index < e->index)
+            continue;
+        if (aabbsOverlap(e->aabb, e2->aabb))
+        {
+            pair.e2 = e2;
+            pairs.push(pair);
+        }
+    }
+}
+
+void dxPersistentHashSpace::collide(void *cdata, dNearCallback *callback)
+{
+    dAASSERT(callback);
+
+    // 0 or 1 geoms can't collide with anything
+    if (count < 2) return;
+
+    lock_count++;
+    cleanGeoms();
+
+    if (!pairs_valid)
+    {
+        // find all pairs
+        for (int i = 0; i < entries.size(); i++)
+        {
+            dxHashEntry *e = entries[i];
+            if (!e->moved && e->level != dxHASH_LEVEL_NONE)
+            {
+                e->moved = true;
+                moved.push(e);
+            }
+        }
+        pairs_valid = true;
+    }
+    else if (moved.size() != 0)
+    {
+        // drop the pairs of the moved entries
+        int n = 0;
+        for (int i = 0; i < pairs.size(); i++)
+        {
+            if (!pairs[i].e1->moved && !pairs[i].e2->moved)
+                pairs[n++] = pairs[i];
+        }
+        pairs.setSize(n);
+    }
+
+    for (int i = 0; i < moved.size(); i++)
+        addPairs(moved[i]);
+    for (int i = 0; i < moved.size(); i++)
+        moved[i]->moved = false;
+    moved.setSize(0);
+
+    for (int i = 0; i < pairs.size(); i++)
+    {
+        dxGeom *g1 = pairs[i].e1->geom;
+        dxGeom *g2 = pairs[i].e2->geom;
+        if (GEOM_ENABLED(g1) && GEOM_ENABLED(g2) && testCollideAABBs(g1, g2))
+            callback(cdata, g1, g2);
+    }
+
+    lock_count--;
+}
+
+void dxPersistentHashSpace::collide2(void *cdata, dxGeom *geom, dNearCallback *callback)
+{
+    dAASSERT(geom && callback);
+
+    lock_count++;
+    cleanGeoms();
+    geom->recomputeAABB();
+
+    int level = findLevel(geom->aabb);
+    if (level < global_minlevel)
+        level = global_minlevel;
+
+    if (level > global_maxlevel)
+    {
+        // too big for the grid
+        for (int i = 0; i < entries.size(); i++)
+        {
+            dxGeom *g = entries[i]->geom;
+            if (g != geom && GEOM_ENABLED(g) && testCollideAABBs(g, geom))
+                callback(cdata, g, geom);
+        }
+        lock_count--;
+        return;
+    }
+
+    if (!isLevelIndexed(level))
+        indexLevel(level);
+
+    int db[6];
+    dReal cellSizeRecip = dRecip((dReal)ldexp(1.0, level));
+    for (int i = 0; i < 6; i++)
+        db[i] = (int)floor(geom->aabb[i] * cellSizeRecip);
+
+    query(geom->aabb, level, db, 0);
+    for (int i = 0; i < found.size(); i++)
+    {
+        dxGeom *g = found[i]->geom;
+        if (g != geom && GEOM_ENABLED(g) && testCollideAABBs(g, geom))
+            callback(cdata, g, geom);
+    }
+    for (int i = 0; i < bigs.size(); i++)
+    {
+        dxGeom *g = bigs[i]->geom;
+        if (g != geom && GEOM_ENABLED(g) && testCollideAABBs(g, geom))
+            callback(cdata, g, geom);
+    }
+
+    lock_count--;
+}
+
+//****************************************************************************
+// space functions
+
+dxSpace *dPersistentHashSpaceCreate(dxSpace *space)
+{
+    return new dxPersistentHashSpace(space);
+}
@@ -0,0 +1,379 @@
+/*************************************************************************
+ *                                                                       *
+ * Open Dynamics Engine, Copyright (C) 2001,2002 Russell L. Smith.       *
+ * All rights reserved.  Email: russ@q12.org   Web: www.q12.org          *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of EITHER:                                  *
+ *   (1) The GNU Lesser General Public License as published by the Free  *
+ *       Software Foundation; either version 2.1 of the License, or (at  *
+ *       your option) any later version. The text of the GNU Lesser      *
+ *       General Public License is included with this library in the     *
+ *       file LICENSE.TXT.                                               *
+ *   (2) The BSD-style license that is included with this library in     *
+ *       the file LICENSE-BSD.TXT.                                       *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+ * LICENSE.TXT and LICENSE-BSD.TXT for more details.                     *
+ *                                                                       *
+ *************************************************************************/
+
+
+/*
+ *  Batched ray casts.
+ *
+ *  dSpaceRayCastBatch casts its rays with one ray geom of its own, that is
+ *  in no space, so no ray geom has to be made, placed and added for each
+ *  query, and no dNearCallback is called for each candidate geom. Each
+ *  space finds the geoms a ray may hit with castRay. A BVH space descends
+ *  its tree nearest child first. The other spaces have no tree a ray can
+ *  follow, so when the batch has enough rays a tree of their geoms is built
+ *  on the first ray that reaches them, kept for the rest of the batch and
+ *  descended the same way; otherwise the AABBs of all their geoms are slab
+ *  tested. The geoms found are collided with dCollide, so all classes with
+ *  a ray collider are supported, with the closest hit flag set on the ray
+ *  so trimesh and terrain give their nearest triangle only.
+ *
+ *  When a ray has all the hits it asks for, its length is cut down to the
+ *  farthest one, so the spaces skip what is behind it and the trimesh and
+ *  terrain colliders only look for nearer triangles.
+ */
+
+#include <ode/common.h>
+#include <ode/odemath.h>
+#include <ode/collision_space.h>
+#include <ode/collision.h>
+#include "config.h"
+#include "collision_kernel.h"
+#include "collision_std.h"
+#include "collision_raycast.h"
+#include "array.h"
+
+#define GEOM_ENABLED(g) (((g)->gflags & GEOM_ENABLE_TEST_MASK) == GEOM_ENABLE_TEST_VALUE)
+
+// directions closer than this to an axis plane are taken as parallel to it
+#define dxRAYCAST_PARALLEL      REAL(1e-12)
+
+// a batch tree is built for a space of this many geoms or more, when the
+// batch has this many rays or more
+#define dxRAYCAST_TREE_GEOMS    32
+#define dxRAYCAST_TREE_RAYS     32
+
+// most geoms in a leaf of a batch tree
+#define dxRAYCAST_LEAF_GEOMS    4
+
+//****************************************************************************
+// batch trees
+
+// a bounding volume tree of the geoms of a space, built by splitting the
+// geoms at the middle of their centers along the longest axis. the geoms
+// are copied with their AABBs, so building and descending it reads them in
+// order. the two children of a node follow each other in nodes
+struct dxRayCastTree
+{
+    struct Item
+    {
+        dReal aabb[6];
+        dxGeom *geom;
+    };
+
+    struct Node
+    {
+        dReal aabb[6];
+        int first;      // first child, or first item for leaves
+        int count;      // items of a leaf, 0 for the other nodes
+    };
+
+    struct NodeEnter
+    {
+        int node;
+        dReal t;        // where the ray enters its AABB
+    };
+
+    dxSpace *space;
+    dArray<Node> nodes;
+    dArray<Item> items;
+    dArray<dxGeom*> bigs;       // geoms with infinite AABBs, not in the tree
+    dArray<NodeEnter> stack;
+
+    dxRayCastTree(dxSpace *_space);
+    void build(int node, int begin, int end);
+    void castRay(dxRayCast *cast);
+};
+
+static inline bool aabbInfinite(const dReal *bounds)
+{
+    return bounds[0] <= -dInfinity || bounds[1] >= dInfinity ||
+        bounds[2] <= -dInfinity || bounds[3] >= dInfinity ||
+        bounds[4] <= -dInfinity || bounds[5] >= dInfinity;
+}
+
+dxRayCastTree::dxRayCastTree(dxSpace *_space) : space(_space)
+{
+    items.setSize(space->count);
+    int n = 0;
+    for (dxGeom *g = space->first; g; g = g->next)
+    {
+        if (!GEOM_ENABLED(g))
+            continue;
+        if (aabbInfinite(g->aabb))
+            bigs.push(g);
+        else
+        {
+            memcpy(items[n].aabb, g->aabb, sizeof(items[n].aabb));
+            items[n].geom = g;
+            n++;
+        }
+    }
+    items.setSize(n);
+    if (n)
+    {
+        nodes.setSize(1);
+        build(0, 0, n);
+    }
+}
+
+void dxRayCastTree::build(int node, int begin, int end)
+{
+    Item *item = items.data();
+
+    // AABB of the items and bounds of their centers, doubled
+    dReal aabb[6], centers[6];
+    memcpy(aabb, item[begin].aabb, sizeof(aabb));
+    for (int j = 0; j < 3; j++)
+        centers[2 * j] = centers[2 * j + 1] = aabb[2 * j] + aabb[2 * j + 1];
+    for (int i = begin + 1; i < end; i++)
+    {
+        const dReal *b = item[i].aabb;
+        for (int j = 0; j < 3; j++)
+        {
+            aabb[2 * j] = b[2 * j] < aabb[2 * j] ? b[2 * j] : aabb[2 * j];
+            aabb[2 * j + 1] = b[2 * j + 1] > aabb[2 * j + 1] ? b[2 * j + 1] : aabb[2 * j + 1];
+            dReal c = b[2 * j] + b[2 * j + 1];
+            centers[2 * j] = c < centers[2 * j] ? c : centers[2 * j];
+            centers[2 * j + 1] = c > centers[2 * j + 1] ? c : centers[2 * j + 1];
+        }
+    }
+    memcpy(nodes[node].aabb, aabb, sizeof(aabb));
+
+    if (end - begin <= dxRAYCAST_LEAF_GEOMS)
+    {
+        nodes[node].first = begin;
+        nodes[node].count = end - begin;
+        return;
+    }
+
+    int axis = 0;
+    for (int j = 1; j < 3; j++)
+    {
+        if (centers[2 * j + 1] - centers[2 * j] > centers[2 * axis + 1] - centers[2 * axis])
+            axis = j;
+    }
+    const dReal middle = (centers[2 * axis] + centers[2 * axis + 1]) * REAL(0.5);
+
+    // the side of each item is as good as random, so swap without a branch
+    int split = begin;
+    for (int i = begin; i < end; i++)
+    {
+        const dReal *b = item[i].aabb;
+        int low = (b[2 * axis] + b[2 * axis + 1] < middle) ? 1 : 0;
+        Item tmp = item[i];
+        item[i] = item[split];
+        item[split] = tmp;
+        split += low;
+    }
+    if (split == begin || split == end)
+        split = (begin + end) / 2;  // all centers the same
+
+    int children = nodes.size();
+    nodes.setSize(children + 2);
+    nodes[node].first = children;
+    nodes[node].count = 0;
+    build(children, begin, split);
+    build(children + 1, split, end);
+}
+
+void dxRayCastTree::castRay(dxRayCast *cast)
+{
+    for (int i = 0; i < bigs.size(); i++)
+    {
+        if (cast->enter(bigs[i]->aabb) < dInfinity)
+            cast->test(bigs[i]);
+    }
+
+    if (nodes.size() == 0)
+        return;
+
+    NodeEnter item = { 0, cast->enter(nodes[0].aabb) };
+    if (item.t >= dInfinity)
+        return;
+    stack.setSize(0);
+    stack.push(item);
+    while (stack.size())
+    {
+        item = stack[stack.size() - 1];
+        stack.setSize(stack.size() - 1);
+        if (item.t > cast->maxt)
+            continue;   // hits were found nearer since it was pushed
+
+        const Node &node = nodes[item.node];
+        if (node.count)
+        {
+            for (int i = node.first; i < node.first + node.count; i++)
+            {
+                if (cast->enter(items[i].aabb) < dInfinity)
+                    cast->test(items[i].geom);
+            }
+            continue;
+        }
+
+        NodeEnter c1 = { node.first, cast->enter(nodes[node.first].aabb) };
+        NodeEnter c2 = { node.first + 1, cast->enter(nodes[node.first + 1].aabb) };
+        if (c1.t > c2.t)
+        {
+            NodeEnter c = c1;
+            c1 = c2;
+            c2 = c;
+        }
+        if (c2.t < dInfinity)
+            stack.push(c2);
+        if (c1.t < dInfinity)
+            stack.push(c1);
+    }
+}
+
+//****************************************************************************
+// ray casts
+
+dxRayCast::~dxRayCast()
+{
+    for (int i = 0; i < trees.size(); i++)
+        delete trees[i];
+}
+
+dxRayCastTree *dxRayCast::getTree(dxSpace *space)
+{
+    if (!buildtrees || space->count < dxRAYCAST_TREE_GEOMS)
+        return 0;
+    for (int i = 0; i < trees.size(); i++)
+    {
+        if (trees[i]->space == space)
+            return trees[i];
+    }
+    dxRayCastTree *tree = new dxRayCastTree(space);
+    trees.push(tree);
+    return tree;
+}
+
+void dxSpace::castRay(dxRayCast *cast)
+{
+    lock_count++;
+    cleanGeoms();
+    dxRayCastTree *tree = cast->getTree(this);
+    if (tree)
+        tree->castRay(cast);
+    else
+    {
+        for (dxGeom *g = first; g; g = g->next)
+        {
+            if (GEOM_ENABLED(g) && cast->enter(g->aabb) < dInfinity)
+                cast->test(g);
+        }
+    }
+    lock_count--;
+}
+
+void dxRayCast::test(dxGeom *g)
+{
+    // as collideAABBs, a ray geom with the cast bits would not be given g
+    if (((category_bits & g->collide_bits) || (g->category_bits & collide_bits)) == 0)
+        return;
+
+    if (IS_SPACE(g))
+    {
+        ((dxSpace*)g)->castRay(this);
+        return;
+    }
+
+    dContactGeom contact;
+    if (dCollide(ray, g, 1, &contact, sizeof(dContactGeom)) == 0)
+        return;
+    if (contact.depth > maxt || (count == maxhits && contact.depth >= maxt))
+        return;
+
+    contact.g1 = 0;
+
+    // insert it in depth order, the farthest hit goes when full
+    int i = (count < maxhits) ? count++ : count - 1;
+    for (; i > 0 && hits[i - 1].depth > contact.depth; i--)
+        hits[i] = hits[i - 1];
+    hits[i] = contact;
+
+    if (count == maxhits)
+    {
+        maxt = hits[count - 1].depth;
+        ray->length = maxt;
+        ray->computeAABB();
+    }
+}
+
+int dSpaceRayCastBatch(dxSpace *space, const dRayCastQuery *rays, int n,
+                       dContactGeom *results, int *counts, int flags)
+{
+    dAASSERT(space && ((rays && results && counts) || n == 0));
+    dUASSERT(dGeomIsSpace(space), "argument not a space");
+
+    int maxhits = flags & NUMC_MASK;
+    dUASSERT(maxhits > 0, "no hits requested");
+    if (maxhits == 0)
+        return 0;
+
+    dxRay ray(0, 1);
+    ray.gflags |= RAY_CLOSEST_HIT;
+    if (flags & dRAYCAST_BACKFACECULL)
+        ray.gflags |= RAY_BACKFACECULL;
+
+    dxRayCast cast;
+    cast.ray = &ray;
+    cast.buildtrees = n >= dxRAYCAST_TREE_RAYS;
+
+    int total = 0;
+    for (int i = 0; i < n; i++)
+    {
+        const dRayCastQuery &query = rays[i];
+        counts[i] = 0;
+
+        dVector3 dir;
+        dCopyVector3(dir, query.dir);
+        if (!dSafeNormalize3(dir) || !(query.length > 0))
+            continue;
+
+        dCopyVector3(cast.start, query.start);
+        dCopyVector3(cast.dir, dir);
+        for (int j = 0; j < 3; j++)
+            cast.inv[j] = (dFabs(dir[j]) > dxRAYCAST_PARALLEL) ? REAL(1.0) / dir[j] : REAL(0.0);
+        cast.maxt = query.length;
+        cast.category_bits = query.category_bits;
+        cast.collide_bits = query.collide_bits;
+        cast.hits = results + i * maxhits;
+        cast.count = 0;
+        cast.maxhits = maxhits;
+
+        dxPosR *posr = ray.final_posr;
+        dCopyVector3(posr->pos, query.start);
+        posr->R[2] = dir[0];
+        posr->R[6] = dir[1];
+        posr->R[10] = dir[2];
+        ray.length = query.length;
+        ray.computeAABB();
+        ray.gflags &= ~(GEOM_DIRTY | GEOM_AABB_BAD);
+
+        space->castRay(&cast);
+
+        counts[i] = cast.count;
+        total += cast.count;
+    }
+    return total;
+}
@@ -0,0 +1,107 @@
+/*************************************************************************
+ *                                                                       *
+ * Open Dynamics Engine, Copyright (C) 2001-2003 Russell L. Smith.       *
+ * All rights reserved.  Email: russ@q12.org   Web: www.q12.org          *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of EITHER:                                  *
+ *   (1) The GNU Lesser General Public License as published by the Free  *
+ *       Software Foundation; either version 2.1 of the License, or (at  *
+ *       your option) any later version. The text of the GNU Lesser      *
+ *       General Public License is included with this library in the     *
+ *       file LICENSE.TXT.                                               *
+ *   (2) The BSD-style license that is included with this library in     *
+ *       the file LICENSE-BSD.TXT.                                       *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+ * LICENSE.TXT and LICENSE-BSD.TXT for more details.                     *
+ *                                                                       *
+ *************************************************************************/
+
+
+// Ray casts of dSpaceRayCastBatch.
+// A space gives test() the geoms whose AABB a ray crosses, which dCollides
+// the ray geom of the cast with them and keeps the nearest hits. Once the
+// cast has all the hits it wants, maxt is the depth of the farthest one, so
+// geoms and tree nodes the ray only enters after it are skipped.
+// Spaces with no tree of their own get one built for the whole batch, when
+// it has enough rays to pay for it.
+
+#ifndef _ODE_COLLISION_RAYCAST_H_
+#define _ODE_COLLISION_RAYCAST_H_
+
+#include <ode/common.h>
+#include <ode/odemath.h>
+#include "collision_kernel.h"
+#include "collision_std.h"
+#include "array.h"
+
+
+struct dxRayCastTree;
+
+struct dxRayCast
+{
+    dxRay *ray;             // start and direction in final_posr, length maxt
+    dVector3 start;
+    dVector3 dir;           // normalized
+    dVector3 inv;           // 1 / dir, 0 where dir is 0
+    dReal maxt;             // farthest depth still wanted
+    unsigned long category_bits;
+    unsigned long collide_bits;
+
+    dContactGeom *hits;     // sorted by depth
+    int count;
+    int maxhits;
+
+    bool buildtrees;                // the batch has enough rays for trees
+    dArray<dxRayCastTree*> trees;   // built for the spaces met so far
+
+    dxRayCast() : buildtrees(false) {}
+    ~dxRayCast();
+
+    // distance along the ray to where it enters the box, or dInfinity if it
+    // misses it before maxt
+    dReal enter(const dReal *aabb) const
+    {
+        dReal tmin = 0;
+        dReal tmax = maxt;
+        for (int i = 0; i < 3; i++)
+        {
+            const dReal lo = aabb[2 * i];
+            const dReal hi = aabb[2 * i + 1];
+            if (inv[i] == 0)
+            {
+                if (start[i] < lo || start[i] > hi)
+                    return dInfinity;
+                continue;
+            }
+            dReal t1 = (lo - start[i]) * inv[i];
+            dReal t2 = (hi - start[i]) * inv[i];
+            if (t1 > t2)
+            {
+                dReal t = t1;
+                t1 = t2;
+                t2 = t;
+            }
+            if (t1 > tmin)
+                tmin = t1;
+            if (t2 < tmax)
+                tmax = t2;
+            if (tmin > tmax)
+                return dInfinity;
+        }
+        return tmin;
+    }
+
+    // collides the ray with a geom the space found, or casts it into a space
+    void test(dxGeom *g);
+
+    // the tree of a space for this batch, built on first use. 0 when the
+    // space is too small or the batch too short for one
+    dxRayCastTree *getTree(dxSpace *space);
+};
+
+
+#endif
@@ -209,9 +209,122 @@ private:
     RaixSortContext	sortContext;
 };
 
+
+
+// --------------------------------------------------------------------------
+//  Incremental SAP space code
+// --------------------------------------------------------------------------
+
+/*
+ *  Temporally coherent sweep and prune, used when dSweepAndPruneSpaceCreate
+ *  gets dSAP_INCREMENTAL.
+ *
+ *  The min and max ends of every AABB are kept sorted on each of the three
+ *  axes, from one collide to the next. Moved geoms have their ends moved
+ *  along the lists by insertion sort, and every time an end passes an end
+ *  of another AABB their overlap on that axis starts or stops. If they
+ *  overlap on the other two axes too, the pair is added to or removed from
+ *  the set of overlapping pairs, which collide then reports. Geoms that do
+ *  not move cost nothing.
+ *
+ *  Adding, removing or moving far a large part of the geoms at once would
+ *  take many swaps, so then the lists and pairs are built from scratch.
+ */
+struct dxIncrementalSAPSpace : public dxSpace
+{
+    dxIncrementalSAPSpace( dSpaceID _space, int axisorder );
+    ~dxIncrementalSAPSpace();
+
+    // dxSpace
+    virtual void add(dxGeom* g);
+    virtual void remove(dxGeom* g);
+    virtual void computeAABB();
+    virtual void cleanGeoms();
+    virtual void collide( void *data, dNearCallback *callback );
+    virtual void collide2( void *data, dxGeom *geom, dNearCallback *callback );
+
+private:
+
+    enum
+    {
+        PROXY_FREE,     // slot can be reused
+        PROXY_NEW,      // geom added, ends not in the lists yet
+        PROXY_LIVE,
+        PROXY_DEAD      // geom removed, ends still in the lists until the next rebuild
+    };
+
+    struct Proxy
+    {
+        dxGeom *geom;
+        int min[3];     // position of the min end in each axis list
+        int max[3];     // position of the max end in each axis list
+        int state;
+        int next_free;
+    };
+
+    struct EndPoint
+    {
+        dReal value;
+        int data;       // proxy handle << 1, | 1 for max ends
+    };
+
+    struct IndexPair
+    {
+        int id0;        // proxy handles, id0 < id1
+        int id1;
+    };
+
+    static inline bool endPointLess(const EndPoint &a, const EndPoint &b)
+    {
+        // at equal values min ends come first, so touching AABBs overlap
+        return a.value < b.value || (a.value == b.value && (a.data & 1) < (b.data & 1));
+    }
+    static int endPointCompare(const void *a, const void *b);
+
+    int  allocProxy();
+    bool overlapOnOtherAxes(const Proxy &p, const Proxy &q, int axis) const;
+    void overlapBegins(int h0, int h1, int axis);
+    void overlapEnds(int h0, int h1, int axis);
+    void sortMinDown(int axis, int handle);
+    void sortMinUp(int axis, int handle);
+    void sortMaxDown(int axis, int handle);
+    void sortMaxUp(int axis, int handle);
+    void insertProxy(int handle);
+    void moveProxy(int handle);
+    void rebuild();
+
+    static inline unsigned pairHash(int id0, int id1)
+    {
+        return ((unsigned)id0 * 0x9E3779B1u) ^ ((unsigned)id1 * 0x85EBCA6Bu);
+    }
+    int  findPairSlot(int id0, int id1) const;
+    void addPair(int id0, int id1);
+    void removePair(int id0, int id1);
+    void rehashPairs(int tableSize);
+
+    // aabb index of the min of each axis, axis 0 is the one swept by rebuild
+    int axidx[3];
+
+    dArray<Proxy> proxies;          // handle 0 is the sentinel at both ends of the lists
+    int free_proxy;
+    int dead_count;
+    bool dead_pairs;                // pairs of dead proxies not dropped yet
+
+    dArray<EndPoint> ends[3];       // sorted ends on each axis
+
+    dArray<int> pending;            // dirty proxies found by cleanGeoms, new or moved
+    int pending_new;
+
+    dArray<IndexPair> pairs;        // overlapping pairs
+    dArray<int> pair_table;         // open addressing index of pairs, -1 empty, -2 deleted
+    int pair_deleted;
+};
+
 // Creation
 dSpaceID dSweepAndPruneSpaceCreate( dxSpace* space, int axisorder )
 {
+    if ( axisorder & dSAP_INCREMENTAL )
+        return new dxIncrementalSAPSpace( space, axisorder );
     return new dxSAPSpace( space, axisorder );
 }
 
@@ -508,6 +621,599 @@ void dxSAPSpace::collide2( void *data, dxGeom *geom, dNearCallback *callback )
     lock_count--;
 }
 
+//==============================================================================
+// Incremental SAP space
+
+// the proxy handle of each geom is kept in its 'tome_ex' member
+#define GEOM_SET_PROXY(g,h) { (g)->tome_ex = (dxGeom**)(size_t)(h); }
+#define GEOM_GET_PROXY(g) ((int)(size_t)(g)->tome_ex)
+
+dxIncrementalSAPSpace::dxIncrementalSAPSpace( dSpaceID _space, int axisorder ) : dxSpace( _space )
+{
+    type = dSweepAndPruneSpaceClass;
+
+    // Init AABB to infinity
+    aabb[0] = -dInfinity;
+    aabb[1] = dInfinity;
+    aabb[2] = -dInfinity;
+    aabb[3] = dInfinity;
+    aabb[4] = -dInfinity;
+    aabb[5] = dInfinity;
+
+    axidx[0] = ( ( axisorder ) & 3 ) << 1;
+    axidx[1] = ( ( axisorder >> 2 ) & 3 ) << 1;
+    axidx[2] = ( ( axisorder >> 4 ) & 3 ) << 1;
+
+    free_proxy = -1;
+    dead_count = 0;
+    dead_pairs = false;
+    pending_new = 0;
+
+    // the sentinel ends the lists on both sides, so sorts need no bound checks
+    proxies.setSize( 1 );
+    Proxy &sentinel = proxies[ 0 ];
+    sentinel.geom = 0;
+    sentinel.state = PROXY_LIVE;
+    for ( int k = 0; k < 3; ++k )
+    {
+        ends[ k ].setSize( 2 );
+        ends[ k ][ 0 ].value = -dInfinity;
+        ends[ k ][ 0 ].data = 0;
+        ends[ k ][ 1 ].value = dInfinity;
+        ends[ k ][ 1 ].data = 1;
+        sentinel.min[ k ] = 0;
+        sentinel.max[ k ] = 1;
+    }
+
+    rehashPairs( 64 );
+}
+
+dxIncrementalSAPSpace::~dxIncrementalSAPSpace()
+{
+    // geoms are removed by ~dxSpace
+}
+
+int dxIncrementalSAPSpace::allocProxy()
+{
+    int handle = free_proxy;
+    if ( handle >= 0 )
+        free_proxy = proxies[ handle ].next_free;
+    else
+    {
+        handle = proxies.size();
+        proxies.setSize( handle + 1 );
+    }
+    return handle;
+}
+
+void dxIncrementalSAPSpace::add( dxGeom* g )
+{
+    CHECK_NOT_LOCKED (this);
+    dAASSERT(g);
+    dUASSERT(g->tome_ex == 0 && g->next_ex == 0, "geom is already in a space");
+
+    int handle = allocProxy();
+    Proxy &p = proxies[ handle ];
+    p.geom = g;
+    p.state = PROXY_NEW;
+    pending_new++;
+
+    dxSpace::add( g );
+    GEOM_SET_PROXY( g, handle );
+
+    // the ends are placed by cleanGeoms, make sure it sees the geom
+    dGeomMoved( g );
+}
+
+void dxIncrementalSAPSpace::remove( dxGeom* g )
+{
+    CHECK_NOT_LOCKED(this);
+    dAASSERT(g);
+    dUASSERT(g->parent_space == this,"object is not in this space");
+
+    int handle = GEOM_GET_PROXY( g );
+    Proxy &p = proxies[ handle ];
+    dIASSERT( p.geom == g );
+    p.geom = 0;
+
+    if ( p.state == PROXY_NEW )
+    {
+        // not in the lists yet
+        p.state = PROXY_FREE;
+        p.next_free = free_proxy;
+        free_proxy = handle;
+        pending_new--;
+    }
+    else
+    {
+        // its ends stay until the next rebuild, its pairs are dropped by collide
+        p.state = PROXY_DEAD;
+        dead_count++;
+        dead_pairs = true;
+    }
+
+    dxSpace::remove( g );
+}
+
+void dxIncrementalSAPSpace::computeAABB()
+{
+    // TODO?
+}
+
+//------------------------------------------------------------------------------
+// overlapping pairs
+
+int dxIncrementalSAPSpace::findPairSlot( int id0, int id1 ) const
+{
+    const unsigned mask = pair_table.size() - 1;
+    for ( unsigned s = pairHash( id0, id1 ) & mask; ; s = ( s + 1 ) & mask )
+    {
+        const int i = pair_table[ s ];
+        if ( i == -1 )
+            return -1;
+        if ( i >= 0 && pairs[ i ].id0 == id0 && pairs[ i ].id1 == id1 )
+            return s;
+    }
+}
+
+void dxIncrementalSAPSpace::rehashPairs( int tableSize )
+{
+    pair_table.setSize( tableSize );
+    for ( int s = 0; s < tableSize; ++s )
+        pair_table[ s ] = -1;
+    pair_deleted = 0;
+
+    const unsigned mask = tableSize - 1;
+    for ( int i = 0; i < pairs.size(); ++i )
+    {
+        unsigned s = pairHash( pairs[ i ].id0, pairs[ i ].id1 ) & mask;
+        while ( pair_table[ s ] != -1 )
+            s = ( s + 1 ) & mask;
+        pair_table[ s ] = i;
+    }
+}
+
+void dxIncrementalSAPSpace::addPair( int id0, int id1 )
+{
+    if ( id0 > id1 )
+    {
+        int tmp = id0;
+        id0 = id1;
+        id1 = tmp;
+    }
+    if ( findPairSlot( id0, id1 ) >= 0 )
+        return;
+
+    // keep the table at most half used, deleted slots included
+    int tableSize = pair_table.size();
+    if ( ( pairs.size() + pair_deleted + 1 ) * 2 > tableSize )
+    {
+        while ( ( pairs.size() + 1 ) * 4 > tableSize )
+            tableSize *= 2;
+        rehashPairs( tableSize );
+    }
+
+    const unsigned mask = tableSize - 1;
+    unsigned s = pairHash( id0, id1 ) & mask;
+    while ( pair_table[ s ] >= 0 )
+        s = ( s + 1 ) & mask;
+    if ( pair_table[ s ] == -2 )
+        pair_deleted--;
+    pair_table[ s ] = pairs.size();
+
+    IndexPair pair;
+    pair.id0 = id0;
+    pair.id1 = id1;
+    pairs.push( pair );
+}
+
+void dxIncrementalSAPSpace::removePair( int id0, int id1 )
+{
+    if ( id0 > id1 )
+    {
+        int tmp = id0;
+        id0 = id1;
+        id1 = tmp;
+    }
+    const int s = findPairSlot( id0, id1 );
+    if ( s < 0 )
+        return;
+
+    const int i = pair_table[ s ];
+    pair_table[ s ] = -2;
+    pair_deleted++;
+
+    // move the last pair in its place
+    const int last = pairs.size() - 1;
+    if ( i != last )
+    {
+        const IndexPair moved = pairs[ last ];
+        pair_table[ findPairSlot( moved.id0, moved.id1 ) ] = i;
+        pairs[ i ] = moved;
+    }
+    pairs.setSize( last );
+}
+
+//------------------------------------------------------------------------------
+// sorted ends
+
+// overlap on the axes other than axis, from the order of the ends
+bool dxIncrementalSAPSpace::overlapOnOtherAxes( const Proxy &p, const Proxy &q, int axis ) const
+{
+    for ( int k = 0; k < 3; ++k )
+    {
+        if ( k != axis && ( p.max[ k ] < q.min[ k ] || q.max[ k ] < p.min[ k ] ) )
+            return false;
+    }
+    return true;
+}
+
+void dxIncrementalSAPSpace::overlapBegins( int h0, int h1, int axis )
+{
+    const Proxy &q = proxies[ h1 ];
+    if ( h1 == 0 || q.state != PROXY_LIVE )
+        return;
+    if ( overlapOnOtherAxes( proxies[ h0 ], q, axis ) )
+        addPair( h0, h1 );
+}
+
+void dxIncrementalSAPSpace::overlapEnds( int h0, int h1, int axis )
+{
+    const Proxy &q = proxies[ h1 ];
+    if ( h1 == 0 || q.state != PROXY_LIVE )
+        return;
+    if ( overlapOnOtherAxes( proxies[ h0 ], q, axis ) )
+        removePair( h0, h1 );
+}
+
+// the min end of handle moved down, it starts overlapping the AABBs whose max end it passes
+void dxIncrementalSAPSpace::sortMinDown( int axis, int handle )
+{
+    EndPoint *list = ends[ axis ].data();
+    int i = proxies[ handle ].min[ axis ];
+    const EndPoint cur = list[ i ];
+
+    while ( endPointLess( cur, list[ i - 1 ] ) )
+    {
+        const EndPoint prev = list[ i - 1 ];
+        Proxy &q = proxies[ prev.data >> 1 ];
+        if ( prev.data & 1 )
+        {
+            // other axes are tested with the old position of this end
+            overlapBegins( handle, prev.data >> 1, axis );
+            q.max[ axis ] = i;
+        }
+        else
+            q.min[ axis ] = i;
+        list[ i-- ] = prev;
+    }
+    list[ i ] = cur;
+    proxies[ handle ].min[ axis ] = i;
+}
+
+// the min end of handle moved up, it stops overlapping the AABBs whose max end it passes
+void dxIncrementalSAPSpace::sortMinUp( int axis, int handle )
+{
+    EndPoint *list = ends[ axis ].data();
+    int i = proxies[ handle ].min[ axis ];
+    const EndPoint cur = list[ i ];
+
+    while ( endPointLess( list[ i + 1 ], cur ) )
+    {
+        const EndPoint next = list[ i + 1 ];
+        Proxy &q = proxies[ next.data >> 1 ];
+        if ( next.data & 1 )
+        {
+            overlapEnds( handle, next.data >> 1, axis );
+            q.max[ axis ] = i;
+        }
+        else
+            q.min[ axis ] = i;
+        list[ i++ ] = next;
+    }
+    list[ i ] = cur;
+    proxies[ handle ].min[ axis ] = i;
+}
+
+// the max end of handle moved down, it stops overlapping the AABBs whose min end it passes
+void dxIncrementalSAPSpace::sortMaxDown( int axis, int handle )
+{
+    EndPoint *list = ends[ axis ].data();
+    int i = proxies[ handle ].max[ axis ];
+    const EndPoint cur = list[ i ];
+
+    while ( endPointLess( cur, list[ i - 1 ] ) )
+    {
+        const EndPoint prev = list[ i - 1 ];
+        Proxy &q = proxies[ prev.data >> 1 ];
+        if ( prev.data & 1 )
+            q.max[ axis ] = i;
+        else
+        {
+            overlapEnds( handle, prev.data >> 1, axis );
+            q.min[ axis ] = i;
+        }
+        list[ i-- ] = prev;
+    }
+    list[ i ] = cur;
+    proxies[ handle ].max[ axis ] = i;
+}
+
+// the max end of handle moved up, it starts overlapping the AABBs whose min end it passes
+void dxIncrementalSAPSpace::sortMaxUp( int axis, int handle )
+{
+    EndPoint *list = ends[ axis ].data();
+    int i = proxies[ handle ].max[ axis ];
+    const EndPoint cur = list[ i ];
+
+    while ( endPointLess( list[ i + 1 ], cur ) )
+    {
+        const EndPoint next = list[ i + 1 ];
+        Proxy &q = proxies[ next.data >> 1 ];
+        if ( next.data & 1 )
+            q.max[ axis ] = i;
+        else
+        {
+            overlapBegins( handle, next.data >> 1, axis );
+            q.min[ axis ] = i;
+        }
+        list[ i++ ] = next;
+    }
+    list[ i ] = cur;
+    proxies[ handle ].max[ axis ] = i;
+}
+
+// puts the ends of a new proxy last on every axis, where it overlaps
+// nothing, and sorts them down to their place
+void dxIncrementalSAPSpace::insertProxy( int handle )
+{
+    Proxy &p = proxies[ handle ];
+    const dReal *bounds = p.geom->aabb;
+    p.state = PROXY_LIVE;
+
+    for ( int k = 0; k < 3; ++k )
+    {
+        dArray<EndPoint> &list = ends[ k ];
+        const int last = list.size() - 1;
+        list.setSize( last + 3 );
+        list[ last + 2 ] = list[ last ];
+        proxies[ 0 ].max[ k ] = last + 2;
+
+        list[ last ].value = bounds[ axidx[ k ] ];
+        list[ last ].data = handle << 1;
+        list[ last + 1 ].value = bounds[ axidx[ k ] + 1 ];
+        list[ last + 1 ].data = ( handle << 1 ) | 1;
+        p.min[ k ] = last;
+        p.max[ k ] = last + 1;
+    }
+
+    // pairs are only found once the last axis is sorted
+    for ( int k = 0; k < 3; ++k )
+    {
+        sortMinDown( k, handle );
+        sortMaxDown( k, handle );
+    }
+}
+
+void dxIncrementalSAPSpace::moveProxy( int handle )
+{
+    Proxy &p = proxies[ handle ];
+    const dReal *bounds = p.geom->aabb;
+
+    for ( int k = 0; k < 3; ++k )
+    {
+        EndPoint &emin = ends[ k ][ p.min[ k ] ];
+        EndPoint &emax = ends[ k ][ p.max[ k ] ];
+        const dReal dmin = bounds[ axidx[ k ] ] - emin.value;
+        const dReal dmax = bounds[ axidx[ k ] + 1 ] - emax.value;
+        emin.value = bounds[ axidx[ k ] ];
+        emax.value = bounds[ axidx[ k ] + 1 ];
+
+        // grow first and shrink last, so the min end never passes the max end
+        if ( dmin < 0 )
+            sortMinDown( k, handle );
+        if ( dmax > 0 )
+            sortMaxUp( k, handle );
+        if ( dmin > 0 )
+            sortMinUp( k, handle );
+        if ( dmax < 0 )
+            sortMaxDown( k, handle );
+    }
+}
+
+int dxIncrementalSAPSpace::endPointCompare( const void *a, const void *b )
+{
+    const EndPoint *ea = (const EndPoint *)a;
+    const EndPoint *eb = (const EndPoint *)b;
+    if ( ea->value != eb->value )
+        return ea->value < eb->value ? -1 : 1;
+    // min ends first, then by handle
+    if ( ( ea->data & 1 ) != ( eb->data & 1 ) )
+        return ( ea->data & 1 ) - ( eb->data & 1 );
+    return ea->data - eb->data;
+}
+
+// sorts the ends of all geoms and finds all pairs from scratch,
+// dropping the removed geoms and adding the new ones
+void dxIncrementalSAPSpace::rebuild()
+{
+    int live = 0;
+    for ( int h = 1; h < proxies.size(); ++h )
+    {
+        Proxy &p = proxies[ h ];
+        if ( p.state == PROXY_DEAD )
+        {
+            p.state = PROXY_FREE;
+            p.next_free = free_proxy;
+            free_proxy = h;
+        }
+        else if ( p.state != PROXY_FREE )
+        {
+            p.state = PROXY_LIVE;
+            live++;
+        }
+    }
+    dead_count = 0;
+    dead_pairs = false;
+    pending_new = 0;
+
+    for ( int k = 0; k < 3; ++k )
+    {
+        dArray<EndPoint> &list = ends[ k ];
+        list.setSize( 2 * live + 2 );
+        int n = 1;
+        for ( int h = 1; h < proxies.size(); ++h )
+        {
+            const Proxy &p = proxies[ h ];
+            if ( p.state != PROXY_LIVE )
+                continue;
+            list[ n ].value = p.geom->aabb[ axidx[ k ] ];
+            list[ n++ ].data = h << 1;
+            list[ n ].value = p.geom->aabb[ axidx[ k ] + 1 ];
+            list[ n++ ].data = ( h << 1 ) | 1;
+        }
+        list[ n ].value = dInfinity;
+        list[ n ].data = 1;
+
+        qsort( list.data() + 1, 2 * live, sizeof( EndPoint ), endPointCompare );
+
+        for ( int i = 0; i < list.size(); ++i )
+        {
+            const int data = list[ i ].data;
+            if ( data & 1 )
+                proxies[ data >> 1 ].max[ k ] = i;
+            else
+                proxies[ data >> 1 ].min[ k ] = i;
+        }
+    }
+
+    // sweep the first axis: each AABB overlaps there the ones whose min end
+    // lies between its own ends
+    pairs.setSize( 0 );
+    const EndPoint *list = ends[ 0 ].data();
+    const int last = ends[ 0 ].size() - 1;
+    for ( int i = 1; i < last; ++i )
+    {
+        if ( list[ i ].data & 1 )
+            continue;
+        const int h0 = list[ i ].data >> 1;
+        const Proxy &p = proxies[ h0 ];
+        for ( int j = i + 1; j < p.max[ 0 ]; ++j )
+        {
+            if ( list[ j ].data & 1 )
+                continue;
+            const int h1 = list[ j ].data >> 1;
+            if ( overlapOnOtherAxes( p, proxies[ h1 ], 0 ) )
+            {
+                IndexPair pair;
+                pair.id0 = h0 < h1 ? h0 : h1;
+                pair.id1 = h0 < h1 ? h1 : h0;
+                pairs.push( pair );
+            }
+        }
+    }
+
+    int tableSize = 64;
+    while ( pairs.size() * 4 > tableSize )
+        tableSize *= 2;
+    rehashPairs( tableSize );
+}
+
+void dxIncrementalSAPSpace::cleanGeoms()
+{
+    // compute the AABBs of all dirty geoms, clear the dirty flags
+    // and move their ends
+    lock_count++;
+
+    for ( dxGeom *g = first; g && ( g->gflags & GEOM_DIRTY ); g = g->next )
+    {
+        if ( IS_SPACE(g) )
+        {
+            ((dxSpace*)g)->cleanGeoms();
+        }
+        g->recomputeAABB();
+        dIASSERT( (g->gflags & GEOM_AABB_BAD) == 0 );
+        g->gflags &= ~GEOM_DIRTY;
+        pending.push( GEOM_GET_PROXY( g ) );
+    }
+
+    // many new or removed geoms are cheaper to sort all at once
+    if ( ( pending_new + dead_count ) * 4 > count + 256 )
+        rebuild();
+    else
+    {
+        for ( int i = 0; i < pending.size(); ++i )
+        {
+            const int handle = pending[ i ];
+            if ( proxies[ handle ].state == PROXY_NEW )
+            {
+                insertProxy( handle );
+                pending_new--;
+            }
+            else
+                moveProxy( handle );
+        }
+    }
+    pending.setSize( 0 );
+
+    lock_count--;
+}
+
+void dxIncrementalSAPSpace::collide( void *data, dNearCallback *callback )
+{
+    dAASSERT (callback);
+
+    lock_count++;
+
+    cleanGeoms();
+
+    if ( dead_pairs )
+    {
+        // drop the pairs of removed geoms
+        int n = 0;
+        for ( int i = 0; i < pairs.size(); ++i )
+        {
+            if ( proxies[ pairs[ i ].id0 ].state == PROXY_LIVE &&
+                proxies[ pairs[ i ].id1 ].state == PROXY_LIVE )
+                pairs[ n++ ] = pairs[ i ];
+        }
+        pairs.setSize( n );
+        rehashPairs( pair_table.size() );
+        dead_pairs = false;
+    }
+
+    const int pairCount = pairs.size();
+    for ( int i = 0; i < pairCount; ++i )
+    {
+        dxGeom* g1 = proxies[ pairs[ i ].id0 ].geom;
+        dxGeom* g2 = proxies[ pairs[ i ].id1 ].geom;
+        if ( GEOM_ENABLED(g1) && GEOM_ENABLED(g2) )
+            collideGeomsNoAABBs( g1, g2, data, callback );
+    }
+
+    lock_count--;
+}
+
+void dxIncrementalSAPSpace::collide2( void *data, dxGeom *geom, dNearCallback *callback )
+{
+    dAASSERT (geom && callback);
+
+    // TODO: This is just a simple N^2 implementation
+
+    lock_count++;
+
+    cleanGeoms();
+    geom->recomputeAABB();
+
+    // intersect bounding boxes
+    for ( dxGeom *g = first; g; g = g->next ) {
+        if ( GEOM_ENABLED(g) )
+            collideAABBs (g,geom,data,callback);
+    }
+
+    lock_count--;
+}
+
 
 void dxSAPSpace::BoxPruning( int count, const dxGeom** geoms, dArray< Pair >& pairs )
 {
@@ -344,12 +344,6 @@ void dxSimpleSpace::collide2(void *cdata, dxGeom *geom,
 //****************************************************************************
 // utility stuff for hash table space
 
-// kind of silly, but oh well...
-#ifndef MAXINT
-#define MAXINT ((int)((((unsigned int)(-1)) << 1) >> 1))
-#endif
-
-
 // prime[i] is the largest prime smaller than 2^i
 #define NUM_PRIMES 31
 static const long int prime[NUM_PRIMES] = { 1L,2L,3L,7L,13L,31L,61L,127L,251L,509L,
@@ -377,36 +371,6 @@ struct Node {
 };
 
 
-// return the `level' of an AABB. the AABB will be put into cells at this
-// level - the cell size will be 2^level. the level is chosen to be the
-// smallest value such that the AABB occupies no more than 8 cells, regardless
-// of its placement. this means that:
-//	size/2 < q <= size
-// where q is the maximum AABB dimension.
-
-static int findLevel(dReal bounds[6])
-{
-    if (bounds[0] <= -dInfinity || bounds[1] >= dInfinity ||
-        bounds[2] <= -dInfinity || bounds[3] >= dInfinity ||
-        bounds[4] <= -dInfinity || bounds[5] >= dInfinity) {
-        return MAXINT;
-    }
-
-    // compute q
-    dReal q, q2;
-    q = bounds[1] - bounds[0];	// x bounds
-    q2 = bounds[3] - bounds[2];	// y bounds
-    if (q2 > q) q = q2;
-    q2 = bounds[5] - bounds[4];	// z bounds
-    if (q2 > q) q = q2;
-
-    // find level such that 0.5 * 2^level < q <= 2^level
-    int level;
-    frexp(q, &level);	// q = (0.5 .. 1.0) * 2^level (definition of frexp)
-    return level;
-}
-
-
 // find a virtual memory address for a cell at the given level and x,y,z
 // position.
 // @@@ currently this is not very sophisticated, e.g. the scaling
@@ -421,20 +385,6 @@ static unsigned long getVirtualAddress(int level, int x, int y, int z)
 //****************************************************************************
 // hash space
 
-struct dxHashSpace : public dxSpace {
-    int global_minlevel;	// smallest hash table level to put AABBs in
-    int global_maxlevel;	// objects that need a level larger than this will be
-              // put in a "big objects" list instead of a hash table
-
-    dxHashSpace(dSpaceID _space);
-    void setLevels(int minlevel, int maxlevel);
-    void getLevels(int *minlevel, int *maxlevel);
-    void cleanGeoms();
-    void collide(void *data, dNearCallback *callback);
-    void collide2(void *data, dxGeom *geom, dNearCallback *callback);
-};
-
-
 dxHashSpace::dxHashSpace(dSpaceID _space) : dxSpace(_space)
 {
     type = dHashSpaceClass;
@@ -640,7 +590,7 @@ void dxHashSpace::collide(void *cdata, dNearCallback *callback)
         for (dxAABB *aabb2 = big_boxes; aabb2; aabb2 = aabb2->next)
         {
             if (testCollideAABBs(aabb->geom, aabb2->geom))
-                callback(data, aabb->geom, aabb2->geom);
+                callback(cdata, aabb->geom, aabb2->geom);
         }
     }
 
@@ -650,7 +600,7 @@ void dxHashSpace::collide(void *cdata, dNearCallback *callback)
         for (dxAABB *aabb2 = aabb->next; aabb2; aabb2 = aabb2->next)
         {
             if (testCollideAABBs(aabb->geom, aabb2->geom))
-                callback(data, aabb->geom, aabb2->geom);
+                callback(cdata, aabb->geom, aabb2->geom);
         }
     }
 
@@ -877,6 +827,10 @@ void dSpaceCollide2(dxGeom *g1, dxGeom *g2, void *data, dNearCallback *callback)
                 // collide a space with itself --> interior collision
                 s1->collide(data, callback);
             }
+            else if (s1->type == dBVHSpaceClass && s2->type == dBVHSpaceClass)
+            {
+                dCollideBVHSpaces(s1, s2, data, callback);
+            }
             else
             {
                 // iterate through the space that has the fewest geoms, calling
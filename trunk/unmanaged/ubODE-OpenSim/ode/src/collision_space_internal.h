@@ -107,4 +107,61 @@ static inline bool testCollideAABBs(dxGeom *g1, dxGeom *g2)
     return true;
 }
 
+//****************************************************************************
+// hash space, shared with the persistent hash space
+
+// kind of silly, but oh well...
+#ifndef MAXINT
+#define MAXINT ((int)((((unsigned int)(-1)) << 1) >> 1))
+#endif
+
+// return the `level' of an AABB. the AABB will be put into cells at this
+// level - the cell size will be 2^level. the level is chosen to be the
+// smallest value such that the AABB occupies no more than 8 cells, regardless
+// of its placement. this means that:
+//	size/2 < q <= size
+// where q is the maximum AABB dimension.
+
+static inline int findLevel(const dReal bounds[6])
+{
+    if (bounds[0] <= -dInfinity || bounds[1] >= dInfinity ||
+        bounds[2] <= -dInfinity || bounds[3] >= dInfinity ||
+        bounds[4] <= -dInfinity || bounds[5] >= dInfinity) {
+        return MAXINT;
+    }
+
+    // compute q
+    dReal q, q2;
+    q = bounds[1] - bounds[0];	// x bounds
+    q2 = bounds[3] - bounds[2];	// y bounds
+    if (q2 > q) q = q2;
+    q2 = bounds[5] - bounds[4];	// z bounds
+    if (q2 > q) q = q2;
+
+    // find level such that 0.5 * 2^level < q <= 2^level
+    int level;
+    frexp(q, &level);	// q = (0.5 .. 1.0) * 2^level (definition of frexp)
+    return level;
+}
+
+struct dxHashSpace : public dxSpace {
+    int global_minlevel;	// smallest hash table level to put AABBs in
+    int global_maxlevel;	// objects that need a level larger than this will be
+              // put in a "big objects" list instead of a hash table
+
+    dxHashSpace(dSpaceID _space);
+    virtual void setLevels(int minlevel, int maxlevel);
+    void getLevels(int *minlevel, int *maxlevel);
+    void cleanGeoms();
+    void collide(void *data, dNearCallback *callback);
+    void collide2(void *data, dxGeom *geom, dNearCallback *callback);
+};
+
+//****************************************************************************
+// BVH space
+
+// reports the overlapping pairs of a geom of s1 and one of s2 by descending
+// both trees, for dSpaceCollide2 on two BVH spaces
+void dCollideBVHSpaces(dxSpace *s1, dxSpace *s2, void *data, dNearCallback *callback);
+
 #endif
@@ -31,6 +31,7 @@ the standard ODE geometry primitives.
 
 #include <ode/common.h>
 #include "collision_kernel.h"
+#include "odeou.h"
 
 
 // primitive collision functions - these have the dColliderFn interface, i.e.
@@ -65,6 +66,8 @@ int dCollideRayPlane (dxGeom *o1, dxGeom *o2, int flags,
                       dContactGeom *contact, int skip);
 int dCollideRayCylinder (dxGeom *o1, dxGeom *o2, int flags,
                          dContactGeom *contact, int skip);
+int dCollideRayConvex (dxGeom *o1, dxGeom *o2, int flags,
+                       dContactGeom *contact, int skip);
 
 // Cylinder - Box/Sphere by (C) CroTeam
 // Ported by Nguyen Binh
@@ -87,8 +90,6 @@ int dCollideConvexCapsule (dxGeom *o1, dxGeom *o2,
                            int flags, dContactGeom *contact, int skip);
 int dCollideConvexConvex (dxGeom *o1, dxGeom *o2, int flags, 
                           dContactGeom *contact, int skip);
-int dCollideRayConvex (dxGeom *o1, dxGeom *o2, int flags, 
-                       dContactGeom *contact, int skip);
 //<-- Convex Collision
 */
 
@@ -109,8 +110,12 @@ struct dxSphere : public dxGeom {
 };
 
 
+// number of separating axis hints kept by each box, a power of 2
+#define dBOX_SEPCACHE_SIZE 4
+
 struct dxBox : public dxGeom {
     dVector3 halfside;	// side half lengths (x,y,z)
+    volatile atomicord32 sepcache[dBOX_SEPCACHE_SIZE];	// separating axis hints, see box.cpp
     dxBox (dSpaceID space, dReal lx, dReal ly, dReal lz);
     void computeAABB();
 };
@@ -143,6 +148,9 @@ struct dxRay : public dxGeom {
     void computeAABB();
 };
 
+// hulls with fewer points are searched linearly for support points
+#define dCONVEX_CLIMB_MIN_POINTS 32
+
 struct dxConvex : public dxGeom 
 {  
     dReal *planes; /*!< An array of planes in the form:
@@ -163,6 +171,8 @@ struct dxConvex : public dxGeom
     ~dxConvex()
     {
         if((edgecount!=0)&&(edges!=NULL)) delete[] edges;
+        if(adjacency!=NULL) delete[] adjacency;
+        if(adjacencystart!=NULL) delete[] adjacencystart;
     }
     void computeAABB();
     struct edge
@@ -171,6 +181,9 @@ struct dxConvex : public dxGeom
         unsigned int second;
     };
     edge* edges;
+    unsigned int *adjacencystart; /*!< First entry in adjacency of each point, pointcount+1 entries */
+    unsigned int *adjacency; /*!< Indices into edges of the edges of each point, in increasing order */
+    unsigned int extremes[6]; /*!< Points with the least and greatest x, y and z */
 
     /*! \brief A Support mapping function for convex shapes
     \param dir [IN] direction to find the Support Point for
@@ -179,8 +192,19 @@ struct dxConvex : public dxGeom
     inline unsigned int SupportIndex(dVector3 dir)
     {
         dVector3 rdir;
-        unsigned int index=0;
         dMultiply1_331 (rdir,final_posr->R,dir);
+        return SupportIndexLocal(rdir);
+    }
+
+    /*! \brief Support mapping for a direction in the convex frame
+    \param rdir [IN] direction in the convex frame
+    \return the index of the first vertex furthest along rdir.
+    */
+    inline unsigned int SupportIndexLocal(const dReal *rdir) const
+    {
+        if (pointcount >= dCONVEX_CLIMB_MIN_POINTS)
+            return SupportIndexClimb(rdir);
+        unsigned int index=0;
         dReal max = dCalcVectorDot3(points,rdir);
         dReal tmp;
         for (unsigned int i = 1; i < pointcount; ++i) 
@@ -195,11 +219,18 @@ struct dxConvex : public dxGeom
         return index;
     }
 
-private:
-    // For Internal Use Only
-    /*! \brief Fills the edges dynamic array based on points and polygons.
+    /*! \brief Support mapping by hill climbing on the point adjacency, for
+    hulls with at least dCONVEX_CLIMB_MIN_POINTS points.
+    */
+    unsigned int SupportIndexClimb(const dReal *rdir) const;
+
+    /*! \brief Fills the edges dynamic array and the point adjacency based on
+    points and polygons.
     */
     void FillEdges();
+
+private:
+    // For Internal Use Only
 #if 0
     /*
     What this does is the same as the Support function by doing some preprocessing
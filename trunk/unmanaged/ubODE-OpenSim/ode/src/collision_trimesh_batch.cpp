@@ -0,0 +1,287 @@
+/*************************************************************************
+ *                                                                       *
+ * Open Dynamics Engine, Copyright (C) 2001-2003 Russell L. Smith.       *
+ * All rights reserved.  Email: russ@q12.org   Web: www.q12.org          *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of EITHER:                                  *
+ *   (1) The GNU Lesser General Public License as published by the Free  *
+ *       Software Foundation; either version 2.1 of the License, or (at  *
+ *       your option) any later version. The text of the GNU Lesser      *
+ *       General Public License is included with this library in the     *
+ *       file LICENSE.TXT.                                               *
+ *   (2) The BSD-style license that is included with this library in     *
+ *       the file LICENSE-BSD.TXT.                                       *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+ * LICENSE.TXT and LICENSE-BSD.TXT for more details.                     *
+ *                                                                       *
+ *************************************************************************/
+
+
+// trimesh triangle batch kernels with run time selection (see collision_trimesh_batch.h)
+
+#include <ode/common.h>
+#include <ode/odemath.h>
+#include "config.h"
+#include "error.h"
+#include "collision_trimesh_batch.h"
+
+#if defined(dSINGLE) && (defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64))
+#define dxTRIMESH_SSE_KERNELS 1
+#else
+#define dxTRIMESH_SSE_KERNELS 0
+#endif
+
+#if dxTRIMESH_SSE_KERNELS
+#include <xmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__GNUC__) && !defined(__SSE__)
+#define dxSSE_KERNEL __attribute__((target("sse")))
+#else
+#define dxSSE_KERNEL
+#endif
+#endif
+
+// margin added to the bounds of each triangle, as
+// LOCAL * (|point - v0| + |v1 - v0| + |v2 - v0|) + ABS * (1 + |point|) (1 norms).
+// the sphere contact code gets the squared distance to the triangle by
+// differences of squares, so its distance error grows as the square root of
+// the rounding error, hence the large local term. the absolute term covers
+// the plane distance of the colliders, found as a difference of dot products
+// in world space
+#define dTRIMESH_BATCH_LOCAL_TOLERANCE REAL(4e-3)
+#define dTRIMESH_BATCH_ABS_TOLERANCE   REAL(1e-5)
+
+
+//****************************************************************************
+// scalar kernels
+
+static inline dReal Min3(dReal a, dReal b, dReal c)
+{
+    dReal m = a < b ? a : b;
+    return m < c ? m : c;
+}
+
+static inline dReal Max3(dReal a, dReal b, dReal c)
+{
+    dReal m = a > b ? a : b;
+    return m > c ? m : c;
+}
+
+static unsigned TriangleCandidates_Scalar(const dxTriangleBatch *batch, const dxTriangleBatchBounds *bounds)
+{
+    const dReal *p = bounds->point;
+    const dReal *aabb = bounds->aabb;
+    const dReal ptol = dTRIMESH_BATCH_ABS_TOLERANCE *
+        (REAL(1.0) + dFabs(p[0]) + dFabs(p[1]) + dFabs(p[2]));
+
+    unsigned mask = 0;
+    for (int i = 0; i < batch->count; i++)
+    {
+        const dVector3 *v = batch->vertices[i];
+
+        dVector3 e0, e1, d;
+        dSubtractVectors3(e0, v[1], v[0]);
+        dSubtractVectors3(e1, v[2], v[0]);
+        dSubtractVectors3(d, p, v[0]);
+
+        dVector3 n;
+        dCalcVectorCross3(n, e0, e1);
+        dReal dist = dCalcVectorDot3(n, d);
+        dReal len = dSqrt(dCalcVectorLengthSquare3(n));
+
+        dReal tol = ptol + dTRIMESH_BATCH_LOCAL_TOLERANCE *
+            (dFabs(d[0]) + dFabs(d[1]) + dFabs(d[2]) +
+             dFabs(e0[0]) + dFabs(e0[1]) + dFabs(e0[2]) +
+             dFabs(e1[0]) + dFabs(e1[1]) + dFabs(e1[2]));
+
+        // written so a degenerate or NaN triangle is kept
+        if (dist > (bounds->above + tol) * len || dist < -(bounds->below + tol) * len)
+            continue;
+
+        if (Min3(v[0][0], v[1][0], v[2][0]) > aabb[1] + tol ||
+            Max3(v[0][0], v[1][0], v[2][0]) < aabb[0] - tol ||
+            Min3(v[0][1], v[1][1], v[2][1]) > aabb[3] + tol ||
+            Max3(v[0][1], v[1][1], v[2][1]) < aabb[2] - tol ||
+            Min3(v[0][2], v[1][2], v[2][2]) > aabb[5] + tol ||
+            Max3(v[0][2], v[1][2], v[2][2]) < aabb[4] - tol)
+            continue;
+
+        mask |= 1U << i;
+    }
+
+    return mask;
+}
+
+static const dxTrimeshBatchKernels g_scalar_kernels =
+{
+    &TriangleCandidates_Scalar,
+    "scalar"
+};
+
+
+//****************************************************************************
+// SSE kernels (dReal is float)
+
+#if dxTRIMESH_SSE_KERNELS
+
+static inline dxSSE_KERNEL __m128 Abs_SSE(__m128 a)
+{
+    return _mm_andnot_ps(_mm_set1_ps(-0.0f), a);
+}
+
+// the four triangles are loaded one vertex at a time and transposed, so each
+// register holds one coordinate of that vertex for all of them. unused slots
+// hold copies of the first triangle
+static dxSSE_KERNEL unsigned TriangleCandidates_SSE(const dxTriangleBatch *batch, const dxTriangleBatchBounds *bounds)
+{
+    __m128 x0 = _mm_loadu_ps(batch->vertices[0][0]);
+    __m128 y0 = _mm_loadu_ps(batch->vertices[1][0]);
+    __m128 z0 = _mm_loadu_ps(batch->vertices[2][0]);
+    __m128 w0 = _mm_loadu_ps(batch->vertices[3][0]);
+    _MM_TRANSPOSE4_PS(x0, y0, z0, w0);
+
+    __m128 x1 = _mm_loadu_ps(batch->vertices[0][1]);
+    __m128 y1 = _mm_loadu_ps(batch->vertices[1][1]);
+    __m128 z1 = _mm_loadu_ps(batch->vertices[2][1]);
+    __m128 w1 = _mm_loadu_ps(batch->vertices[3][1]);
+    _MM_TRANSPOSE4_PS(x1, y1, z1, w1);
+
+    __m128 x2 = _mm_loadu_ps(batch->vertices[0][2]);
+    __m128 y2 = _mm_loadu_ps(batch->vertices[1][2]);
+    __m128 z2 = _mm_loadu_ps(batch->vertices[2][2]);
+    __m128 w2 = _mm_loadu_ps(batch->vertices[3][2]);
+    _MM_TRANSPOSE4_PS(x2, y2, z2, w2);
+
+    const dReal *p = bounds->point;
+    const dReal *aabb = bounds->aabb;
+    const dReal ptol = dTRIMESH_BATCH_ABS_TOLERANCE *
+        (REAL(1.0) + dFabs(p[0]) + dFabs(p[1]) + dFabs(p[2]));
+
+    __m128 e0x = _mm_sub_ps(x1, x0);
+    __m128 e0y = _mm_sub_ps(y1, y0);
+    __m128 e0z = _mm_sub_ps(z1, z0);
+    __m128 e1x = _mm_sub_ps(x2, x0);
+    __m128 e1y = _mm_sub_ps(y2, y0);
+    __m128 e1z = _mm_sub_ps(z2, z0);
+    __m128 dx = _mm_sub_ps(_mm_set1_ps(p[0]), x0);
+    __m128 dy = _mm_sub_ps(_mm_set1_ps(p[1]), y0);
+    __m128 dz = _mm_sub_ps(_mm_set1_ps(p[2]), z0);
+
+    __m128 nx = _mm_sub_ps(_mm_mul_ps(e0y, e1z), _mm_mul_ps(e0z, e1y));
+    __m128 ny = _mm_sub_ps(_mm_mul_ps(e0z, e1x), _mm_mul_ps(e0x, e1z));
+    __m128 nz = _mm_sub_ps(_mm_mul_ps(e0x, e1y), _mm_mul_ps(e0y, e1x));
+
+    __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, dx), _mm_mul_ps(ny, dy)), _mm_mul_ps(nz, dz));
+    __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz)));
+
+    __m128 sum = _mm_add_ps(_mm_add_ps(Abs_SSE(dx), Abs_SSE(dy)), Abs_SSE(dz));
+    sum = _mm_add_ps(sum, _mm_add_ps(_mm_add_ps(Abs_SSE(e0x), Abs_SSE(e0y)), Abs_SSE(e0z)));
+    sum = _mm_add_ps(sum, _mm_add_ps(_mm_add_ps(Abs_SSE(e1x), Abs_SSE(e1y)), Abs_SSE(e1z)));
+    __m128 tol = _mm_add_ps(_mm_set1_ps(ptol), _mm_mul_ps(_mm_set1_ps(dTRIMESH_BATCH_LOCAL_TOLERANCE), sum));
+
+    // ordered compares are false for NaN, so degenerate or NaN triangles are kept
+    __m128 above = _mm_mul_ps(_mm_add_ps(_mm_set1_ps(bounds->above), tol), len);
+    __m128 below = _mm_mul_ps(_mm_add_ps(_mm_set1_ps(bounds->below), tol), len);
+    __m128 reject = _mm_or_ps(_mm_cmpgt_ps(dist, above),
+                              _mm_cmplt_ps(dist, _mm_sub_ps(_mm_setzero_ps(), below)));
+
+    __m128 lo = _mm_min_ps(_mm_min_ps(x0, x1), x2);
+    __m128 hi = _mm_max_ps(_mm_max_ps(x0, x1), x2);
+    reject = _mm_or_ps(reject, _mm_cmpgt_ps(lo, _mm_add_ps(_mm_set1_ps(aabb[1]), tol)));
+    reject = _mm_or_ps(reject, _mm_cmplt_ps(hi, _mm_sub_ps(_mm_set1_ps(aabb[0]), tol)));
+
+    lo = _mm_min_ps(_mm_min_ps(y0, y1), y2);
+    hi = _mm_max_ps(_mm_max_ps(y0, y1), y2);
+    reject = _mm_or_ps(reject, _mm_cmpgt_ps(lo, _mm_add_ps(_mm_set1_ps(aabb[3]), tol)));
+    reject = _mm_or_ps(reject, _mm_cmplt_ps(hi, _mm_sub_ps(_mm_set1_ps(aabb[2]), tol)));
+
+    lo = _mm_min_ps(_mm_min_ps(z0, z1), z2);
+    hi = _mm_max_ps(_mm_max_ps(z0, z1), z2);
+    reject = _mm_or_ps(reject, _mm_cmpgt_ps(lo, _mm_add_ps(_mm_set1_ps(aabb[5]), tol)));
+    reject = _mm_or_ps(reject, _mm_cmplt_ps(hi, _mm_sub_ps(_mm_set1_ps(aabb[4]), tol)));
+
+    unsigned mask = ~(unsigned)_mm_movemask_ps(reject);
+    return mask & ((1U << batch->count) - 1);
+}
+
+static const dxTrimeshBatchKernels g_sse_kernels =
+{
+    &TriangleCandidates_SSE,
+    "SSE"
+};
+
+static bool CPUHasSSE()
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    return true; // SSE is part of the x86-64 base instruction set
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 25)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse") != 0;
+#endif
+}
+
+#endif // dxTRIMESH_SSE_KERNELS
+
+
+//****************************************************************************
+// selection
+
+const dxTrimeshBatchKernels *g_trimesh_batch_kernels = &g_scalar_kernels;
+
+void dxSelectTrimeshBatchKernels()
+{
+    const dxTrimeshBatchKernels *kernels = &g_scalar_kernels;
+
+#if dxTRIMESH_SSE_KERNELS
+    if (CPUHasSSE())
+        kernels = &g_sse_kernels;
+#endif
+
+    g_trimesh_batch_kernels = kernels;
+}
+
+
+//****************************************************************************
+// walker
+
+// the trimesh callback is called for the next batch before the colliders see
+// its triangles, so it may be called for up to three triangles after the
+// collider stopped on its contact count
+bool dxTriangleBatchWalker::Fill()
+{
+    int count = 0;
+    while (count < dTRIMESH_BATCH_SIZE && m_next < m_count)
+    {
+        const int index = m_triangles[m_next++];
+        if (m_usecallback && !Callback(m_trimesh, m_geom, index))
+            continue;
+
+        m_batch.indices[count] = index;
+        FetchTriangle(m_trimesh, index, m_position, m_rotation, m_batch.vertices[count]);
+        count++;
+    }
+
+    if (count == 0)
+        return false;
+
+    for (int i = count; i < dTRIMESH_BATCH_SIZE; i++)
+    {
+        memcpy(m_batch.vertices[i], m_batch.vertices[0], sizeof(m_batch.vertices[0]));
+    }
+
+    m_batch.count = count;
+    m_mask = g_trimesh_batch_kernels->candidates(&m_batch, &m_bounds);
+    m_slot = 0;
+    return true;
+}
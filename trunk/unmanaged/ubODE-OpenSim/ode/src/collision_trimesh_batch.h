@@ -0,0 +1,131 @@
+/*************************************************************************
+ *                                                                       *
+ * Open Dynamics Engine, Copyright (C) 2001-2003 Russell L. Smith.       *
+ * All rights reserved.  Email: russ@q12.org   Web: www.q12.org          *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of EITHER:                                  *
+ *   (1) The GNU Lesser General Public License as published by the Free  *
+ *       Software Foundation; either version 2.1 of the License, or (at  *
+ *       your option) any later version. The text of the GNU Lesser      *
+ *       General Public License is included with this library in the     *
+ *       file LICENSE.TXT.                                               *
+ *   (2) The BSD-style license that is included with this library in     *
+ *       the file LICENSE-BSD.TXT.                                       *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+ * LICENSE.TXT and LICENSE-BSD.TXT for more details.                     *
+ *                                                                       *
+ *************************************************************************/
+
+
+// Rejection of trimesh candidate triangles a batch at a time.
+// The colliders fetch the triangles OPCODE found in batches of 4 and a kernel
+// tests the whole batch against the plane distance range and AABB the other
+// geom allows. Only the triangles it can not reject go through the per
+// triangle contact code, which is left as it was. The kernels only reject
+// triangles that are farther than the contact code allows by a margin above
+// its rounding errors, so the contacts do not change.
+// As for the quickstep kernels, a scalar and, on x86 single precision builds,
+// an SSE version exist, selected at library initialization.
+
+#ifndef _ODE_COLLISION_TRIMESH_BATCH_H_
+#define _ODE_COLLISION_TRIMESH_BATCH_H_
+
+#include <ode/common.h>
+#include "collision_trimesh_internal.h"
+
+
+#define dTRIMESH_BATCH_SIZE 4
+
+struct dxTriangleBatch
+{
+    int count;
+    int indices[dTRIMESH_BATCH_SIZE];
+    dVector3 vertices[dTRIMESH_BATCH_SIZE][3];  // world space, as FetchTriangle
+};
+
+// what the other geom accepts. with N = (v1 - v0) x (v2 - v0) normalized, a
+// triangle is kept if -below <= N.(point - v0) <= above and its AABB overlaps
+// aabb (minx, maxx, miny, maxy, minz, maxz)
+struct dxTriangleBatchBounds
+{
+    dVector3 point;
+    dReal below;
+    dReal above;
+    dReal aabb[6];
+};
+
+struct dxTrimeshBatchKernels
+{
+    // returns a bit for each triangle of the batch that may be in bounds
+    unsigned (*candidates)(const dxTriangleBatch *batch, const dxTriangleBatchBounds *bounds);
+
+    const char *name;
+};
+
+// kernels in use. valid (scalar) even before dxSelectTrimeshBatchKernels() is called
+extern const dxTrimeshBatchKernels *g_trimesh_batch_kernels;
+
+// pick the fastest kernels the CPU supports. called from library initialization
+void dxSelectTrimeshBatchKernels();
+
+
+// returns, in their order, the triangles of a collider result that the kernels
+// did not reject, fetched in world space. triangles refused by the trimesh
+// callback are skipped first when usecallback is set
+class dxTriangleBatchWalker
+{
+public:
+    dxTriangleBatchWalker(dxTriMesh *trimesh, dxGeom *geom, const int *triangles, int count,
+        const dVector3 position, const dMatrix3 rotation, bool usecallback,
+        const dxTriangleBatchBounds &bounds):
+        m_trimesh(trimesh), m_geom(geom), m_triangles(triangles), m_count(count), m_next(0),
+        m_position(position), m_rotation(rotation), m_usecallback(usecallback),
+        m_bounds(bounds), m_mask(0), m_slot(0)
+    {
+        m_batch.count = 0;
+    }
+
+    bool Next(int &index, dVector3 *&vertices)
+    {
+        for (;;)
+        {
+            while (m_slot < m_batch.count)
+            {
+                int slot = m_slot++;
+                if (m_mask & (1U << slot))
+                {
+                    index = m_batch.indices[slot];
+                    vertices = m_batch.vertices[slot];
+                    return true;
+                }
+            }
+
+            if (!Fill())
+                return false;
+        }
+    }
+
+private:
+    bool Fill();
+
+    dxTriMesh *m_trimesh;
+    dxGeom *m_geom;
+    const int *m_triangles;
+    int m_count;
+    int m_next;
+    const dReal *m_position;
+    const dReal *m_rotation;
+    bool m_usecallback;
+    const dxTriangleBatchBounds &m_bounds;
+
+    dxTriangleBatch m_batch;
+    unsigned m_mask;
+    int m_slot;
+};
+
+
+#endif
@@ -672,25 +672,25 @@ void sTrimeshBoxColliderData::_cldClipping(const dVector3 &v0, const dVector3 &v
         dVector3 vub, vPb, vPa;
         dCopyVector3r4(vPa, m_vHullBoxPos);
 
-        dVector3 *rot = (dVector3*)m_BoxRotTransposed;
+        const dReal *rot = m_BoxRotTransposed;
 
         // calculate point on box edge
-        if(dCalcVectorDot3(m_vBestNormal, *rot) > 0)
-            dAddScaledVector3r4(vPa, *rot, m_vBoxHalfSize[0]);
+        if(dCalcVectorDot3(m_vBestNormal, rot) > 0)
+            dAddScaledVector3r4(vPa, rot, m_vBoxHalfSize[0]);
         else
-            dAddScaledVector3r4(vPa, *rot, -m_vBoxHalfSize[0]);
+            dAddScaledVector3r4(vPa, rot, -m_vBoxHalfSize[0]);
         
         rot += 4;
-        if (dCalcVectorDot3(m_vBestNormal, *rot) > 0)
-            dAddScaledVector3r4(vPa, *rot, m_vBoxHalfSize[1]);
+        if (dCalcVectorDot3(m_vBestNormal, rot) > 0)
+            dAddScaledVector3r4(vPa, rot, m_vBoxHalfSize[1]);
         else
-            dAddScaledVector3r4(vPa, *rot, -m_vBoxHalfSize[1]);
+            dAddScaledVector3r4(vPa, rot, -m_vBoxHalfSize[1]);
 
         rot += 4;
-        if (dCalcVectorDot3(m_vBestNormal, *rot))
-            dAddScaledVector3r4(vPa, *rot, m_vBoxHalfSize[2]);
+        if (dCalcVectorDot3(m_vBestNormal, rot) > 0)
+            dAddScaledVector3r4(vPa, rot, m_vBoxHalfSize[2]);
         else
-            dAddScaledVector3r4(vPa, *rot, -m_vBoxHalfSize[2]);
+            dAddScaledVector3r4(vPa, rot, -m_vBoxHalfSize[2]);
 
         int iEdge = (m_iBestAxis - 5) % 3;
 
@@ -1119,7 +1119,8 @@ int dCollideBTL(dxGeom* g1, dxGeom* BoxGeom, int Flags, dContactGeom* Contacts,
 
     const unsigned uiTLSKind = TriMesh->getParentSpaceTLSKind();
     dIASSERT(uiTLSKind == BoxGeom->getParentSpaceTLSKind()); // The colliding spaces must use matching cleanup method
-    TrimeshCollidersCache *pccColliderCache = GetTrimeshCollidersCache(uiTLSKind);
+    TrimeshCollidersCacheHolder ccHolder(uiTLSKind);
+    TrimeshCollidersCache *pccColliderCache = ccHolder.GetCache();
     OBBCollider& Collider = pccColliderCache->_OBBCollider;
 
     dQueryBTLPotentialCollisionTriangles(Collider, cData, TriMesh, BoxGeom, pccColliderCache->defaultBoxCache);
@@ -58,6 +58,7 @@
 #include "collision_util.h"
 #include "collision_std.h"
 #include "collision_trimesh_internal.h"
+#include "collision_trimesh_batch.h"
 #include "util.h"
 
 
@@ -938,7 +939,8 @@ int dCollideCCTL(dxGeom *o1, dxGeom *o2, int flags, dContactGeom *contact, int s
 
     const unsigned uiTLSKind = TriMesh->getParentSpaceTLSKind();
     dIASSERT(uiTLSKind == Capsule->getParentSpaceTLSKind()); // The colliding spaces must use matching cleanup method
-    TrimeshCollidersCache *pccColliderCache = GetTrimeshCollidersCache(uiTLSKind);
+    TrimeshCollidersCacheHolder ccHolder(uiTLSKind);
+    TrimeshCollidersCache *pccColliderCache = ccHolder.GetCache();
     OBBCollider& Collider = pccColliderCache->_OBBCollider;
 
     // Will it better to use LSS here? -> confirm Pierre.
@@ -975,16 +977,27 @@ int dCollideCCTL(dxGeom *o1, dxGeom *o2, int flags, dContactGeom *contact, int s
 
             uint8* UseFlags = TriMesh->Data->UseFlags;
 
+            // triangles whose plane is farther from the capsule center than
+            // its half size are rejected a batch at a time. the OBB collider
+            // already tested the triangles against the capsule box
+            dxTriangleBatchBounds Bounds;
+            dCopyVector3(Bounds.point, cData.m_vCapsulePosition);
+            Bounds.below = singleSide ? REAL(0.0) : cData.m_fCapsuleSize;
+            Bounds.above = cData.m_fCapsuleSize;
+            Bounds.aabb[0] = Bounds.aabb[2] = Bounds.aabb[4] = -dInfinity;
+            Bounds.aabb[1] = Bounds.aabb[3] = Bounds.aabb[5] = dInfinity;
+
+            dxTriangleBatchWalker Walker(TriMesh, Capsule, Triangles, TriCount,
+                cData.m_mTriMeshPos, cData.m_mTriMeshRot, false, Bounds);
+
+            int Triint;
+            dVector3 *dv;
+
             // loop through all intersecting triangles
             if (UseFlags)
             {
-                for (int i = 0; i < TriCount; i++)
+                while (Walker.Next(Triint, dv))
                 {
-                    const int Triint = Triangles[i];
-
-                    dVector3 dv[3];
-                    FetchTriangle(TriMesh, Triint, cData.m_mTriMeshPos, cData.m_mTriMeshRot, dv);
-
                     bool bFinishSearching;
                     ctContacts0 = cData.TestCollisionForSingleTriangle(ctContacts0, Triint, dv, UseFlags[Triint], bFinishSearching, singleSide);
 
@@ -996,12 +1009,8 @@ int dCollideCCTL(dxGeom *o1, dxGeom *o2, int flags, dContactGeom *contact, int s
             }
             else
             {
-                for (int i = 0; i < TriCount; i++)
+                while (Walker.Next(Triint, dv))
                 {
-                    const int Triint = Triangles[i];
-                    dVector3 dv[3];
-                    FetchTriangle(TriMesh, Triint, cData.m_mTriMeshPos, cData.m_mTriMeshRot, dv);
-
                     bool bFinishSearching;
                     ctContacts0 = cData.TestCollisionForSingleTriangle(ctContacts0, Triint, dv, (uint8)dxTriMeshData::kUseAll, bFinishSearching, singleSide);
 
@@ -125,7 +125,8 @@ private:
 
 struct TrimeshCollidersCache
 {
-    TrimeshCollidersCache()
+    TrimeshCollidersCache():
+        pccNextFree(NULL)
     {
         InitOPCODECaches();
     }
@@ -157,28 +158,54 @@ struct TrimeshCollidersCache
 
     // Trimesh-plane collision vertex use cache
     VertexUseCache VertexUses;
+
+    // Next free cache of the pool, without TLS
+    TrimeshCollidersCache *pccNextFree;
 };
 
 #if dTLS_ENABLED
 
-inline TrimeshCollidersCache *GetTrimeshCollidersCache(unsigned uiTLSKind)
+inline TrimeshCollidersCache *AcquireTrimeshCollidersCache(unsigned uiTLSKind)
 {
     return COdeTls::GetTrimeshCollidersCache((EODETLSKIND)uiTLSKind);
 }
 
+inline void ReleaseTrimeshCollidersCache(TrimeshCollidersCache *pccColliderCache)
+{
+    (void)pccColliderCache; // unused
+}
+
 
 #else // dTLS_ENABLED
 
-inline TrimeshCollidersCache *GetTrimeshCollidersCache(unsigned uiTLSKind)
+// Without TLS a collider takes a cache from a pool for the length of the
+// collide, so trimeshes (of different worlds) can be collided by several
+// threads at the same time. A single thread always gets the same cache back.
+TrimeshCollidersCache *AcquireTrimeshCollidersCache(unsigned uiTLSKind);
+void ReleaseTrimeshCollidersCache(TrimeshCollidersCache *pccColliderCache);
+
+#endif // dTLS_ENABLED
+
+
+// Holds the colliders cache of the calling thread while a collider runs
+class TrimeshCollidersCacheHolder
 {
-    (void)uiTLSKind; // unused
+public:
+    explicit TrimeshCollidersCacheHolder(unsigned uiTLSKind):
+        m_pccColliderCache(AcquireTrimeshCollidersCache(uiTLSKind))
+    {
+    }
 
-    extern TrimeshCollidersCache g_ccTrimeshCollidersCache;
+    ~TrimeshCollidersCacheHolder()
+    {
+        ReleaseTrimeshCollidersCache(m_pccColliderCache);
+    }
 
-    return &g_ccTrimeshCollidersCache;
-}
+    TrimeshCollidersCache *GetCache() const { return m_pccColliderCache; }
 
-#endif // dTLS_ENABLED
+private:
+    TrimeshCollidersCache *m_pccColliderCache;
+};
 
 struct dxTriMeshData  : public dBase 
 {
@@ -213,12 +240,22 @@ struct dxTriMeshData  : public dBase
 
     uint8 meshFlags;
 
+    // changes each time the tree is built or refit, so caches made against it can tell
+    unsigned Serial;
+
+    // set by the application, see dGeomTriMeshDataSetUserKey
+    duint64 UserKey;
+
     dxTriMeshData();
     ~dxTriMeshData();
 
     void Build(const void* Vertices, int VertexCount,
         const void* Indices, int IndexCount);
 
+    /* Relocatable copy of the built data, see dGeomTriMeshDataSave */
+    size_t Save(void* buf, size_t bufSize) const;
+    bool Load(const void* buf, size_t bufSize);
+
     /* aabb in model space */
     dVector3 AABBCenter;
     dVector3 AABBExtents;
@@ -226,6 +263,10 @@ struct dxTriMeshData  : public dBase
     // data for use in collision resolution
     //const void* Normals;
     uint8* UseFlags;
+
+    // vertices and triangles owned by the data, when it was loaded
+    Point* OwnedVertices;
+    IndexedTriangle* OwnedTriangles;
 };
 
 struct dxTriMesh : public dxGeom
@@ -242,6 +283,7 @@ struct dxTriMesh : public dxGeom
     bool doSphereTC;
     bool doBoxTC;
     bool doCapsuleTC;
+    bool doTriMeshTC;
 
     // Functions
     dxTriMesh(dSpaceID Space, dTriMeshDataID Data);
@@ -281,6 +323,19 @@ struct dxTriMesh : public dxGeom
     };
     dArray<CapsuleTC> CapsuleTCCache;
 
+    struct TriMeshTC : public BVTCoherenceCache{
+        dxTriMesh* Geom;
+        unsigned Serial0;   // Serial of this mesh data when the cache was made
+        unsigned Serial1;   // Serial of the other mesh data
+    };
+    // allocated one by one, the OPCODE container in them can not be moved
+    dArray<TriMeshTC*> TriMeshTCCache;
+    // the meshes that have an entry for this one, which they drop when it is destroyed
+    dArray<dxTriMesh*> TriMeshTCUsers;
+
+    TriMeshTC* GetTriMeshTC(dxTriMesh* Other);
+    void RemoveTriMeshTC(dxTriMesh* Other);
+
 };
 
 #if 0
@@ -29,6 +29,7 @@
 #include "odemath.h"
 #include "collision_util.h"
 #include "collision_trimesh_internal.h"
+#include "threadingutils.h"
 
 void TrimeshCollidersCache::InitOPCODECaches()
 {
@@ -63,7 +64,14 @@ void TrimeshCollidersCache::InitOPCODECaches()
 }
 
 // Trimesh data
-dxTriMeshData::dxTriMeshData() : UseFlags( NULL )
+static volatile atomicord32 g_TriMeshDataSerial = 0;
+
+static unsigned NewTriMeshDataSerial()
+{
+    return (unsigned)ThrsafeIncrementIntUpToLimit(&g_TriMeshDataSerial, ~(atomicord32)0) + 1;
+}
+
+dxTriMeshData::dxTriMeshData() : Serial( 0 ), UserKey( 0 ), UseFlags( NULL ), OwnedVertices( NULL ), OwnedTriangles( NULL )
 {
 }
 
@@ -71,6 +79,8 @@ dxTriMeshData::~dxTriMeshData()
 {
     if ( UseFlags )
         delete [] UseFlags;
+    delete [] OwnedVertices;
+    delete [] OwnedTriangles;
 }
 
 void 
@@ -103,6 +113,7 @@ dxTriMeshData::Build(const void* Vertices,int VertexCount,
     TreeBuilder.mCanRemap = false;
 
     BVTree.Build(TreeBuilder);
+    Serial = NewTriMeshDataSerial();
 
     // compute model space AABB
     const char* verts = (const char*)Vertices;
@@ -144,6 +155,178 @@ dxTriMeshData::Build(const void* Vertices,int VertexCount,
     UseFlags = 0;
 }
 
+// dGeomTriMeshDataSave block: this header, then the vertices, the triangles, the
+// collision tree nodes (as AABBNoLeafTree::ExportNodes writes them) and the use
+// flags, each padded to 4 bytes
+#define dTRIMESH_SAVE_MAGIC    0x4D54646F // "odTM"
+#define dTRIMESH_SAVE_VERSION  1
+#define dTRIMESH_SAVE_USEFLAGS 0x100     // or'ed into flags with meshFlags
+
+struct dxTriMeshSaveHeader
+{
+    duint32 magic;
+    duint32 version;
+    duint32 indexSize;
+    duint32 realSize;
+    duint32 vertexCount;
+    duint32 triangleCount;
+    duint32 nodeCount;
+    duint32 flags;
+    dReal aabbCenter[3];
+    dReal aabbExtents[3];
+};
+
+static inline size_t SavePad(size_t size)
+{
+    return (size + 3) & ~(size_t)3;
+}
+
+static inline size_t SaveSize(udword vertexCount, udword triangleCount, udword nodeCount, bool useFlags)
+{
+    return SavePad(sizeof(dxTriMeshSaveHeader))
+        + SavePad(vertexCount * sizeof(Point))
+        + SavePad(triangleCount * sizeof(IndexedTriangle))
+        + nodeCount * OPC_NOLEAF_EXPORT_SIZE * sizeof(udword)
+        + (useFlags ? SavePad(triangleCount) : 0);
+}
+
+size_t dxTriMeshData::Save(void* buf, size_t bufSize) const
+{
+    if (!Mesh.IsValid())
+        return 0;
+
+    const AABBNoLeafTree* Tree = static_cast<const AABBNoLeafTree*>(BVTree.GetTree());
+    if (!BVTree.HasSingleNode() && !Tree)
+        return 0;
+
+    const udword VertexCount = Mesh.GetNbVertices();
+    const udword TriangleCount = Mesh.GetNbTriangles();
+    const udword NodeCount = BVTree.HasSingleNode() ? 0 : Tree->GetNbNodes();
+
+    const size_t Size = SaveSize(VertexCount, TriangleCount, NodeCount, UseFlags != NULL);
+    if (!buf || bufSize < Size)
+        return Size;
+
+    dxTriMeshSaveHeader Header;
+    memset(&Header, 0, sizeof(Header));
+    Header.magic = dTRIMESH_SAVE_MAGIC;
+    Header.version = dTRIMESH_SAVE_VERSION;
+    Header.indexSize = sizeof(dTriIndex);
+    Header.realSize = sizeof(dReal);
+    Header.vertexCount = VertexCount;
+    Header.triangleCount = TriangleCount;
+    Header.nodeCount = NodeCount;
+    Header.flags = UseFlags ? (meshFlags | dTRIMESH_SAVE_USEFLAGS) : 0;
+    dCopyVector3(Header.aabbCenter, AABBCenter);
+    dCopyVector3(Header.aabbExtents, AABBExtents);
+
+    uint8* Out = (uint8*)buf;
+    memset(Out, 0, Size);
+
+    memcpy(Out, &Header, sizeof(Header));
+    Out += SavePad(sizeof(Header));
+
+    memcpy(Out, Mesh.GetVerts(), VertexCount * sizeof(Point));
+    Out += SavePad(VertexCount * sizeof(Point));
+
+    memcpy(Out, Mesh.GetTris(), TriangleCount * sizeof(IndexedTriangle));
+    Out += SavePad(TriangleCount * sizeof(IndexedTriangle));
+
+    if (NodeCount)
+    {
+        // the block may not be aligned, the nodes are written through a copy
+        udword* Nodes = new udword[NodeCount * OPC_NOLEAF_EXPORT_SIZE];
+        Tree->ExportNodes(Nodes);
+        memcpy(Out, Nodes, NodeCount * OPC_NOLEAF_EXPORT_SIZE * sizeof(udword));
+        delete [] Nodes;
+        Out += NodeCount * OPC_NOLEAF_EXPORT_SIZE * sizeof(udword);
+    }
+
+    if (UseFlags)
+        memcpy(Out, UseFlags, TriangleCount);
+
+    return Size;
+}
+
+bool dxTriMeshData::Load(const void* buf, size_t bufSize)
+{
+    if (!buf || ((size_t)buf & 3) != 0 || bufSize < sizeof(dxTriMeshSaveHeader))
+        return false;
+
+    dxTriMeshSaveHeader Header;
+    memcpy(&Header, buf, sizeof(Header));
+
+    if (Header.magic != dTRIMESH_SAVE_MAGIC || Header.version != dTRIMESH_SAVE_VERSION ||
+        Header.indexSize != sizeof(dTriIndex) || Header.realSize != sizeof(dReal))
+        return false;
+
+    const udword VertexCount = Header.vertexCount;
+    const udword TriangleCount = Header.triangleCount;
+    const udword NodeCount = Header.nodeCount;
+    const bool HasUseFlags = (Header.flags & dTRIMESH_SAVE_USEFLAGS) != 0;
+
+    // bound the counts first, so the size below can not overflow
+    if (VertexCount == 0 || TriangleCount == 0 || VertexCount > bufSize / sizeof(Point) ||
+        TriangleCount > bufSize / sizeof(IndexedTriangle) ||
+        NodeCount > bufSize / (OPC_NOLEAF_EXPORT_SIZE * sizeof(udword)))
+        return false;
+
+    if (bufSize < SaveSize(VertexCount, TriangleCount, NodeCount, HasUseFlags))
+        return false;
+
+    const uint8* In = (const uint8*)buf + SavePad(sizeof(Header));
+
+    Point* Vertices = new Point[VertexCount];
+    memcpy((void*)Vertices, In, VertexCount * sizeof(Point));
+    In += SavePad(VertexCount * sizeof(Point));
+
+    IndexedTriangle* Triangles = new IndexedTriangle[TriangleCount];
+    memcpy((void*)Triangles, In, TriangleCount * sizeof(IndexedTriangle));
+    In += SavePad(TriangleCount * sizeof(IndexedTriangle));
+
+    for (udword i = 0; i < TriangleCount; i++)
+    {
+        if (Triangles[i].mVRef[0] >= VertexCount || Triangles[i].mVRef[1] >= VertexCount ||
+            Triangles[i].mVRef[2] >= VertexCount)
+        {
+            delete [] Vertices;
+            delete [] Triangles;
+            return false;
+        }
+    }
+
+    delete [] OwnedVertices;
+    delete [] OwnedTriangles;
+    OwnedVertices = Vertices;
+    OwnedTriangles = Triangles;
+
+    Mesh.SetNbTriangles(TriangleCount);
+    Mesh.SetNbVertices(VertexCount);
+    Mesh.SetPointers(OwnedTriangles, OwnedVertices);
+
+    Serial = NewTriMeshDataSerial();
+    if (!BVTree.Import(&Mesh, (const udword*)In, NodeCount))
+        return false;
+    In += NodeCount * OPC_NOLEAF_EXPORT_SIZE * sizeof(udword);
+
+    dCopyVector3(AABBCenter, Header.aabbCenter);
+    dCopyVector3(AABBExtents, Header.aabbExtents);
+
+    if (UseFlags)
+        delete [] UseFlags;
+    UseFlags = 0;
+    meshFlags = 0;
+
+    if (HasUseFlags)
+    {
+        UseFlags = new uint8[TriangleCount];
+        memcpy(UseFlags, In, TriangleCount);
+        meshFlags = (uint8)(Header.flags & 0xFF);
+    }
+
+    return true;
+}
+
 struct EdgeRecord
 {
     int VertIdx1;	// Index into vertex array for this edges vertices
@@ -477,6 +660,37 @@ void dGeomTriMeshDataSetBuffer(dTriMeshDataID g, unsigned char* buf)
     g->UseFlags = buf;
 }
 
+size_t dGeomTriMeshDataSave(dTriMeshDataID g, void* buf, size_t bufSize)
+{
+    dUASSERT(g, "argument not trimesh data");
+    return g->Save(buf, bufSize);
+}
+
+dTriMeshDataID dGeomTriMeshDataLoad(const void* buf, size_t bufSize)
+{
+    dxTriMeshData* Data = new dxTriMeshData();
+    if (!Data->Load(buf, bufSize))
+    {
+        delete Data;
+        return NULL;
+    }
+    return Data;
+}
+
+void dGeomTriMeshDataSetUserKey(dTriMeshDataID g, duint64 key)
+{
+    dUASSERT(g, "argument not trimesh data");
+
+    g->UserKey = key;
+}
+
+duint64 dGeomTriMeshDataGetUserKey(dTriMeshDataID g)
+{
+    dUASSERT(g, "argument not trimesh data");
+
+    return g->UserKey;
+}
+
 
 dxTriMesh::dxTriMesh(dSpaceID Space, dTriMeshDataID Data) : dxGeom(Space, 1)
 {
@@ -494,6 +708,7 @@ dxTriMesh::dxTriMesh(dSpaceID Space, dTriMeshDataID Data) : dxGeom(Space, 1)
     this->doSphereTC = false;
     this->doBoxTC = false;
     this->doCapsuleTC = false;
+    this->doTriMeshTC = false;
 
     SphereContactsMergeOption = (dxContactMergeOptions)MERGE_NORMALS__SPHERE_DEFAULT;
 
@@ -502,19 +717,122 @@ dxTriMesh::dxTriMesh(dSpaceID Space, dTriMeshDataID Data) : dxGeom(Space, 1)
 }
 
 dxTriMesh::~dxTriMesh(){
-    //
+    ClearTCCache();
+
+    // the other meshes drop their entries for this one
+    int n = TriMeshTCUsers.size();
+    for (int i = 0; i < n; i++)
+        TriMeshTCUsers[i]->RemoveTriMeshTC(this);
+}
+
+static void RemoveTriMeshFromArray(dArray<dxTriMesh*> &Array, dxTriMesh* TriMesh)
+{
+    int n = Array.size();
+    for (int i = 0; i < n; i++){
+        if (Array[i] == TriMesh){
+            Array.remove(i);
+            break;
+        }
+    }
+}
+
+// the entry of this mesh for the collides with Other, made if there is none
+dxTriMesh::TriMeshTC* dxTriMesh::GetTriMeshTC(dxTriMesh* Other)
+{
+    int n = TriMeshTCCache.size();
+    for (int i = 0; i < n; i++){
+        if (TriMeshTCCache[i]->Geom == Other)
+            return TriMeshTCCache[i];
+    }
+
+    TriMeshTC* triMeshTC = new TriMeshTC();
+    triMeshTC->Geom = Other;
+    triMeshTC->Serial0 = 0;
+    triMeshTC->Serial1 = 0;
+    TriMeshTCCache.push(triMeshTC);
+    Other->TriMeshTCUsers.push(this);
+    return triMeshTC;
+}
+
+void dxTriMesh::RemoveTriMeshTC(dxTriMesh* Other)
+{
+    int n = TriMeshTCCache.size();
+    for (int i = 0; i < n; i++){
+        if (TriMeshTCCache[i]->Geom == Other){
+            delete TriMeshTCCache[i];
+            TriMeshTCCache.remove(i);
+            break;
+        }
+    }
+}
+
+#if !dTLS_ENABLED
+
+// Colliders caches not in use. There are as many caches as trimesh collides
+// that ever ran at the same time
+static TrimeshCollidersCache *g_pccFreeTrimeshCollidersCaches = NULL;
+static volatile atomicord32 g_aoTrimeshCollidersCachesLock = 0;
+
+static void LockTrimeshCollidersCaches()
+{
+    while (!ThrsafeCompareExchange(&g_aoTrimeshCollidersCachesLock, 0, 1))
+    {
+    }
 }
 
+static void UnlockTrimeshCollidersCaches()
+{
+    ThrsafeExchange(&g_aoTrimeshCollidersCachesLock, 0);
+}
+
+/*extern */TrimeshCollidersCache *AcquireTrimeshCollidersCache(unsigned uiTLSKind)
+{
+    (void)uiTLSKind; // unused
+
+    LockTrimeshCollidersCaches();
+
+    TrimeshCollidersCache *pccColliderCache = g_pccFreeTrimeshCollidersCaches;
+    if (pccColliderCache != NULL)
+    {
+        g_pccFreeTrimeshCollidersCaches = pccColliderCache->pccNextFree;
+    }
+
+    UnlockTrimeshCollidersCaches();
+
+    if (pccColliderCache == NULL)
+    {
+        pccColliderCache = new TrimeshCollidersCache();
+    }
+
+    return pccColliderCache;
+}
+
+/*extern */void ReleaseTrimeshCollidersCache(TrimeshCollidersCache *pccColliderCache)
+{
+    LockTrimeshCollidersCaches();
+
+    pccColliderCache->pccNextFree = g_pccFreeTrimeshCollidersCaches;
+    g_pccFreeTrimeshCollidersCaches = pccColliderCache;
+
+    UnlockTrimeshCollidersCaches();
+}
+
+#endif // dTLS_ENABLED
+
 // Cleanup for allocations when shutting down ODE
 /*extern */void opcode_collider_cleanup()
 {
 #if !dTLS_ENABLED
-    // Clear TC caches
-    TrimeshCollidersCache *pccColliderCache = GetTrimeshCollidersCache(0);
-    pccColliderCache->Faces.Empty();
-    pccColliderCache->defaultSphereCache.TouchedPrimitives.Empty();
-    pccColliderCache->defaultBoxCache.TouchedPrimitives.Empty();
-    pccColliderCache->defaultCapsuleCache.TouchedPrimitives.Empty();
+    // Free the caches of the pool, no collide may be running now
+    TrimeshCollidersCache *pccColliderCache = g_pccFreeTrimeshCollidersCaches;
+    g_pccFreeTrimeshCollidersCaches = NULL;
+
+    while (pccColliderCache != NULL)
+    {
+        TrimeshCollidersCache *pccNextFree = pccColliderCache->pccNextFree;
+        delete pccColliderCache;
+        pccColliderCache = pccNextFree;
+    }
 #endif // dTLS_ENABLED
 }
 
@@ -539,6 +857,12 @@ void dxTriMesh::ClearTCCache()
         CapsuleTCCache[i].~CapsuleTC();
     }
     CapsuleTCCache.setSize(0);
+    n = TriMeshTCCache.size();
+    for( i = 0; i < n; ++i ) {
+        RemoveTriMeshFromArray(TriMeshTCCache[i]->Geom->TriMeshTCUsers, this);
+        delete TriMeshTCCache[i];
+    }
+    TriMeshTCCache.setSize(0);
 }
 
 /*
@@ -629,6 +953,7 @@ void dxTriMesh::computeAABB() {
 void dxTriMeshData::UpdateData()
 {
     BVTree.Refit();
+    Serial = NewTriMeshDataSerial();
 }
 
 
@@ -725,6 +1050,9 @@ void dGeomTriMeshEnableTC(dGeomID g, int geomClass, int enable)
     case dCapsuleClass:
         ((dxTriMesh*)g)->doCapsuleTC = (1 == enable);
         break;
+    case dTriMeshClass:
+        ((dxTriMesh*)g)->doTriMeshTC = (1 == enable);
+        break;
     }
 }
 
@@ -746,6 +1074,10 @@ int dGeomTriMeshIsTCEnabled(dGeomID g, int geomClass)
         if (((dxTriMesh*)g)->doCapsuleTC)
             return 1;
         break;
+    case dTriMeshClass:
+        if (((dxTriMesh*)g)->doTriMeshTC)
+            return 1;
+        break;
     }
     return 0;
 }
@@ -44,7 +44,8 @@ int dCollideRTL(dxGeom* TriGeom, dxGeom* RayGeom, int Flags, dContactGeom* Conta
     dxTriMesh* TriMesh = (dxTriMesh*)TriGeom;
     const unsigned uiTLSKind = TriMesh->getParentSpaceTLSKind();
     dIASSERT(uiTLSKind == RayGeom->getParentSpaceTLSKind()); // The colliding spaces must use matching cleanup method
-    TrimeshCollidersCache *pccColliderCache = GetTrimeshCollidersCache(uiTLSKind);
+    TrimeshCollidersCacheHolder ccHolder(uiTLSKind);
+    TrimeshCollidersCache *pccColliderCache = ccHolder.GetCache();
     RayCollider& Collider = pccColliderCache->_RayCollider;
 
     dReal Length = dGeomRayGetLength(RayGeom);
@@ -34,6 +34,7 @@
 #endif
 
 #include "collision_trimesh_internal.h"
+#include "collision_trimesh_batch.h"
 
 // Ripped from Opcode 1.1.
 static bool GetContactData(const dVector3& Center, dReal Radius, const dVector3 Origin, const dVector3 Edge0, 
@@ -294,7 +295,8 @@ int dCollideSTL(dxGeom* g1, dxGeom* SphereGeom, int Flags, dContactGeom* Contact
 
     const unsigned uiTLSKind = TriMesh->getParentSpaceTLSKind();
     dIASSERT(uiTLSKind == SphereGeom->getParentSpaceTLSKind()); // The colliding spaces must use matching cleanup method
-    TrimeshCollidersCache *pccColliderCache = GetTrimeshCollidersCache(uiTLSKind);
+    TrimeshCollidersCacheHolder ccHolder(uiTLSKind);
+    TrimeshCollidersCache *pccColliderCache = ccHolder.GetCache();
     SphereCollider& Collider = pccColliderCache->_SphereCollider;
 
     const dVector3& Position = *(const dVector3*)dGeomGetPosition(SphereGeom);
@@ -349,20 +351,26 @@ int dCollideSTL(dxGeom* g1, dxGeom* SphereGeom, int Flags, dContactGeom* Contact
             TriMesh->ArrayCallback(TriMesh, SphereGeom, Triangles, TriCount);
         }
 
-        int OutTriCount = 0;
-        for (int i = 0; i < TriCount; i++){
-            if (OutTriCount == (Flags & NUMC_MASK)){
-                break;
-            }
-
-            const int TriIndex = Triangles[i];
-
-            dVector3 dv[3];
-            if (!Callback(TriMesh, SphereGeom, TriIndex))
-                continue;
-
-            FetchTriangle(TriMesh, TriIndex, TLPosition, TLRotation, dv);
+        // triangles behind the sphere center or beyond its radius are
+        // rejected a batch at a time
+        dxTriangleBatchBounds Bounds;
+        dCopyVector3(Bounds.point, Position);
+        Bounds.below = REAL(0.0);
+        Bounds.above = Radius;
+        Bounds.aabb[0] = Position[0] - Radius;
+        Bounds.aabb[1] = Position[0] + Radius;
+        Bounds.aabb[2] = Position[1] - Radius;
+        Bounds.aabb[3] = Position[1] + Radius;
+        Bounds.aabb[4] = Position[2] - Radius;
+        Bounds.aabb[5] = Position[2] + Radius;
+
+        dxTriangleBatchWalker Walker(TriMesh, SphereGeom, Triangles, TriCount,
+            TLPosition, TLRotation, true, Bounds);
 
+        int OutTriCount = 0;
+        int TriIndex;
+        dVector3 *dv;
+        while (OutTriCount != (Flags & NUMC_MASK) && Walker.Next(TriIndex, dv)){
             dVector3& v0 = dv[0];
             dVector3& v1 = dv[1];
             dVector3& v2 = dv[2];
@@ -38,12 +38,6 @@
 #include "collision_trimesh_internal.h"
 
 
-#if !dTLS_ENABLED
-// Have collider cache instance unconditionally of OPCODE or GIMPACT selection
-/*extern */TrimeshCollidersCache g_ccTrimeshCollidersCache;
-#endif
-
-
 #define SMALL_ELT           REAL(2.5e-4)
 #define EXPANDED_ELT_THRESH REAL(1.0e-3)
 #define DISTANCE_EPSILON    REAL(1.0e-8)
@@ -671,7 +665,8 @@ int dCollideTTL(dxGeom* g1, dxGeom* g2, int Flags, dContactGeom* Contacts, int S
 
     const unsigned uiTLSKind = ((dxTriMesh*)g1)->getParentSpaceTLSKind();
     dIASSERT(uiTLSKind == ((dxTriMesh*)g2)->getParentSpaceTLSKind()); // The colliding spaces must use matching cleanup method
-    TrimeshCollidersCache *pccColliderCache = GetTrimeshCollidersCache(uiTLSKind);
+    TrimeshCollidersCacheHolder ccHolder(uiTLSKind);
+    TrimeshCollidersCache *pccColliderCache = ccHolder.GetCache();
     AABBTreeCollider& Collider = pccColliderCache->_AABBTreeCollider;
     BVTCache &ColCache = pccColliderCache->ColCache;
     CONTACT_KEY_HASH_TABLE &hashcontactset = pccColliderCache->_hashcontactset;
@@ -683,9 +678,33 @@ int dCollideTTL(dxGeom* g1, dxGeom* g2, int Flags, dContactGeom* Contacts, int S
     ClearContactSet(hashcontactset);
 
     // Collision query
-    BOOL IsOk = Collider.Collide(ColCache,
-        &MakeMatrix(TLPosition1, TLRotation1, amatrix),
-        &MakeMatrix(TLPosition2, TLRotation2, bmatrix));
+    BOOL IsOk;
+    dxTriMesh *TriMesh1 = (dxTriMesh*)g1;
+    if (TriMesh1->doTriMeshTC || ((dxTriMesh*)g2)->doTriMeshTC)
+    {
+        // the cache is kept by the first mesh, for each mesh it is collided with
+        dxTriMesh::TriMeshTC* triMeshTC = TriMesh1->GetTriMeshTC((dxTriMesh*)g2);
+
+        // a tree built again or refit since
+        if (triMeshTC->Serial0 != TriData1->Serial || triMeshTC->Serial1 != TriData2->Serial){
+            triMeshTC->ResetCoherence();
+            triMeshTC->Serial0 = TriData1->Serial;
+            triMeshTC->Serial1 = TriData2->Serial;
+        }
+
+        triMeshTC->Model0 = &TriData1->BVTree;
+        triMeshTC->Model1 = &TriData2->BVTree;
+
+        IsOk = Collider.Collide(*triMeshTC,
+            &MakeMatrix(TLPosition1, TLRotation1, amatrix),
+            &MakeMatrix(TLPosition2, TLRotation2, bmatrix));
+    }
+    else
+    {
+        IsOk = Collider.Collide(ColCache,
+            &MakeMatrix(TLPosition1, TLRotation1, amatrix),
+            &MakeMatrix(TLPosition2, TLRotation2, bmatrix));
+    }
 
     if (IsOk && Collider.GetContactStatus())
     {
@@ -41,12 +41,11 @@
 */
 
 
-#define dOU_ENABLED 0
-#define dATOMICS_ENABLED 0
+#define dOU_ENABLED 1
+#define dATOMICS_ENABLED 1
 #define dTLS_ENABLED 0
 
-#define dTHREADING_INTF_DISABLED 1
-/* #define dBUILTIN_THREADING_IMPL_ENABLED 1 */
+#define dBUILTIN_THREADING_IMPL_ENABLED 1
 
 /******************************************************************
  * SYSTEM SETTINGS - you shouldn't need to change these. If you
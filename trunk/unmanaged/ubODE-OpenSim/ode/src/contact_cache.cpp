@@ -0,0 +1,149 @@
+/*************************************************************************
+ *                                                                       *
+ * Open Dynamics Engine, Copyright (C) 2001,2002 Russell L. Smith.       *
+ * All rights reserved.  Email: russ@q12.org   Web: www.q12.org          *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of EITHER:                                  *
+ *   (1) The GNU Lesser General Public License as published by the Free  *
+ *       Software Foundation; either version 2.1 of the License, or (at  *
+ *       your option) any later version. The text of the GNU Lesser      *
+ *       General Public License is included with this library in the     *
+ *       file LICENSE.TXT.                                               *
+ *   (2) The BSD-style license that is included with this library in     *
+ *       the file LICENSE-BSD.TXT.                                       *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+ * LICENSE.TXT and LICENSE-BSD.TXT for more details.                     *
+ *                                                                       *
+ *************************************************************************/
+
+
+#include <ode/odeconfig.h>
+#include "config.h"
+#include "contact_cache.h"
+#include "objects.h"
+#include "matrix.h"
+#include "odemath.h"
+#include "joints/contact.h"
+
+
+static inline
+unsigned ContactCacheHash(const dxGeom *g1, const dxGeom *g2, int side1, int side2)
+{
+    size_t h = (size_t)g1 * 0x9E3779B1u;
+    h ^= ((size_t)g2 >> 4) + 0x7F4A7C15u + (h << 6) + (h >> 2);
+    h ^= (size_t)(unsigned)side1 * 0x85EBCA6Bu;
+    h ^= (size_t)(unsigned)side2 * 0xC2B2AE35u;
+    return (unsigned)(h ^ (h >> 15));
+}
+
+static inline
+bool IsWarmStartedJoint(const dxJoint *j)
+{
+    return j->type() == dJointTypeContact && (j->flags & dJOINT_DISABLED) == 0;
+}
+
+
+dxContactCache::~dxContactCache()
+{
+    if (entries != NULL)
+        dFree(entries, capacity * sizeof(Entry));
+}
+
+void dxContactCache::Reserve(unsigned needed)
+{
+    // keep the table at most half full
+    unsigned newcapacity = 64;
+    while (newcapacity < needed * 2)
+        newcapacity *= 2;
+
+    if (newcapacity != capacity)
+    {
+        if (entries != NULL)
+            dFree(entries, capacity * sizeof(Entry));
+        entries = (Entry *)dAlloc(newcapacity * sizeof(Entry));
+        capacity = newcapacity;
+    }
+
+    for (unsigned i = 0; i != capacity; ++i)
+        entries[i].g1 = NULL;
+    count = 0;
+}
+
+const dxContactCache::Entry *dxContactCache::Find(const dContactGeom &geom) const
+{
+    const unsigned mask = capacity - 1;
+    unsigned slot = ContactCacheHash(geom.g1, geom.g2, geom.side1, geom.side2) & mask;
+
+    // several contacts of one geom pair can share the sides (box on box),
+    // so take the closest one
+    const Entry *best = NULL;
+    dReal bestdist = dxCONTACT_CACHE_MATCH_DISTANCE * dxCONTACT_CACHE_MATCH_DISTANCE;
+    for (const Entry *e = entries + slot; e->g1 != NULL; e = entries + (slot = (slot + 1) & mask))
+    {
+        if (e->g1 == geom.g1 && e->g2 == geom.g2 && e->side1 == geom.side1 && e->side2 == geom.side2)
+        {
+            dReal dist = dCalcPointsDistanceSquare3(e->pos, geom.pos);
+            if (dist < bestdist)
+            {
+                bestdist = dist;
+                best = e;
+            }
+        }
+    }
+    return best;
+}
+
+void dxContactCache::SeedContactJoints(dxWorld *world) const
+{
+    for (dxJoint *j = world->firstjoint; j != NULL; j = (dxJoint *)j->next)
+    {
+        if (!IsWarmStartedJoint(j))
+            continue;
+
+        const Entry *e = count != 0 ? Find(((dxJointContact *)j)->contact.geom) : NULL;
+        if (e != NULL)
+        {
+            j->lambda[0] = e->lambda[0];
+            j->lambda[1] = e->lambda[1];
+            j->lambda[2] = e->lambda[2];
+        }
+        else
+            dSetZero(j->lambda, 3);
+    }
+}
+
+void dxContactCache::StoreContactJoints(dxWorld *world)
+{
+    Reserve((unsigned)world->nj);
+
+    const unsigned mask = capacity - 1;
+    for (dxJoint *j = world->firstjoint; j != NULL; j = (dxJoint *)j->next)
+    {
+        if (!IsWarmStartedJoint(j))
+            continue;
+
+        const dContactGeom &geom = ((dxJointContact *)j)->contact.geom;
+        if (geom.g1 == NULL)
+            continue;
+
+        unsigned slot = ContactCacheHash(geom.g1, geom.g2, geom.side1, geom.side2) & mask;
+        while (entries[slot].g1 != NULL)
+            slot = (slot + 1) & mask;
+
+        Entry *e = entries + slot;
+        e->g1 = geom.g1;
+        e->g2 = geom.g2;
+        e->side1 = geom.side1;
+        e->side2 = geom.side2;
+        dCopyVector3(e->pos, geom.pos);
+        // the normal impulse can only push
+        e->lambda[0] = j->lambda[0] > 0 ? j->lambda[0] : REAL(0.0);
+        e->lambda[1] = j->lambda[1];
+        e->lambda[2] = j->lambda[2];
+        ++count;
+    }
+}
@@ -0,0 +1,75 @@
+/*************************************************************************
+ *                                                                       *
+ * Open Dynamics Engine, Copyright (C) 2001,2002 Russell L. Smith.       *
+ * All rights reserved.  Email: russ@q12.org   Web: www.q12.org          *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of EITHER:                                  *
+ *   (1) The GNU Lesser General Public License as published by the Free  *
+ *       Software Foundation; either version 2.1 of the License, or (at  *
+ *       your option) any later version. The text of the GNU Lesser      *
+ *       General Public License is included with this library in the     *
+ *       file LICENSE.TXT.                                               *
+ *   (2) The BSD-style license that is included with this library in     *
+ *       the file LICENSE-BSD.TXT.                                       *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+ * LICENSE.TXT and LICENSE-BSD.TXT for more details.                     *
+ *                                                                       *
+ *************************************************************************/
+
+
+
+// Contact impulse cache used to warm start quickstep.
+// Contact joints are normally destroyed and recreated every step, so the
+// lambdas they reached are lost and the next solve starts from zero. The
+// cache remembers the normal and friction lambdas of every contact at the end
+// of a step, keyed by geom pair, side1/side2 feature ids and contact position.
+// Before the next step, each new contact joint that matches a remembered
+// contact gets those lambdas back in dxJoint::lambda, and quickstep uses them
+// as the starting point of the velocity solve.
+// The cache is rebuilt from the live contact joints after every step, so a
+// contact that stops being generated is forgotten one step later.
+
+#ifndef _ODE_CONTACT_CACHE_H_
+#define _ODE_CONTACT_CACHE_H_
+
+#include <ode/common.h>
+#include <ode/contact.h>
+#include "objects.h"
+
+// a cached contact matches a new one of the same geoms and sides if the contact
+// points are closer than this
+#define dxCONTACT_CACHE_MATCH_DISTANCE REAL(0.05)
+
+struct dxContactCache : public dBase
+{
+    struct Entry
+    {
+        dxGeom *g1, *g2;    // g1 NULL for an empty slot
+        int side1, side2;
+        dVector3 pos;
+        dReal lambda[3];    // normal, friction 1, friction 2
+    };
+
+    Entry *entries;
+    unsigned capacity;      // power of two, or 0
+    unsigned count;
+
+    dxContactCache(): entries(NULL), capacity(0), count(0) {}
+    ~dxContactCache();
+
+    // set dxJoint::lambda of the world contact joints from the cache. call before the step
+    void SeedContactJoints(dxWorld *world) const;
+    // rebuild the cache from dxJoint::lambda of the world contact joints. call after the step
+    void StoreContactJoints(dxWorld *world);
+
+private:
+    const Entry *Find(const dContactGeom &geom) const;
+    void Reserve(unsigned needed);
+};
+
+
+#endif
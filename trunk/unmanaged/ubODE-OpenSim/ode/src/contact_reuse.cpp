@@ -0,0 +1,384 @@
+/*************************************************************************
+ *                                                                       *
+ * Open Dynamics Engine, Copyright (C) 2001,2002 Russell L. Smith.       *
+ * All rights reserved.  Email: russ@q12.org   Web: www.q12.org          *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of EITHER:                                  *
+ *   (1) The GNU Lesser General Public License as published by the Free  *
+ *       Software Foundation; either version 2.1 of the License, or (at  *
+ *       your option) any later version. The text of the GNU Lesser      *
+ *       General Public License is included with this library in the     *
+ *       file LICENSE.TXT.                                               *
+ *   (2) The BSD-style license that is included with this library in     *
+ *       the file LICENSE-BSD.TXT.                                       *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+ * LICENSE.TXT and LICENSE-BSD.TXT for more details.                     *
+ *                                                                       *
+ *************************************************************************/
+
+
+#include <ode/odeconfig.h>
+#include "config.h"
+#include "contact_reuse.h"
+#include "collision_kernel.h"
+#include "collision_util.h"
+#include "odemath.h"
+#include "threadingutils.h"
+
+
+#define dMIN(A,B)  ((A)>(B) ? (B) : (A))
+#define dMAX(A,B)  ((B)>(A) ? (B) : (A))
+
+
+static const dReal identityR[12] = { REAL(1.0), 0, 0, 0,  0, REAL(1.0), 0, 0,  0, 0, REAL(1.0), 0 };
+static const dReal zeroPos[4] = { 0, 0, 0, 0 };
+
+static inline
+unsigned ContactReuseHash(const dxGeom *o1, const dxGeom *o2, int flags)
+{
+    size_t h = (size_t)o1 * 0x9E3779B1u;
+    h ^= ((size_t)o2 >> 4) + 0x7F4A7C15u + (h << 6) + (h >> 2);
+    h ^= (size_t)(unsigned)flags * 0x85EBCA6Bu;
+    return (unsigned)(h ^ (h >> 15));
+}
+
+// position and rotation of a geom, the world frame if it is not placeable
+static inline
+void GeomFrame(const dxGeom *g, const dReal *&pos, const dReal *&R)
+{
+    if (g->gflags & GEOM_PLACEABLE)
+    {
+        pos = g->final_posr->pos;
+        R = g->final_posr->R;
+    }
+    else
+    {
+        pos = zeroPos;
+        R = identityR;
+    }
+}
+
+// o1 rotation and position in the frame of o2
+static void RelativeFrame(const dxGeom *o1, const dxGeom *o2, dMatrix3 R, dVector3 t)
+{
+    const dReal *pos1, *R1, *pos2, *R2;
+    GeomFrame(o1, pos1, R1);
+    GeomFrame(o2, pos2, R2);
+
+    dMultiply1_333(R, R2, R1);
+    dVector3 d;
+    dSubtractVectors3(d, pos1, pos2);
+    dMultiply1_331(t, R2, d);
+}
+
+static dReal AABBRadius(const dxGeom *g)
+{
+    const dReal *pos, *R;
+    GeomFrame(g, pos, R);
+
+    dReal r = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        dReal e = dMAX(dFabs(g->aabb[i * 2] - pos[i]), dFabs(g->aabb[i * 2 + 1] - pos[i]));
+        r += e * e;
+    }
+    return dSqrt(r);
+}
+
+// the AABB size can only be compared up to the distance, as it changes when the geom turns
+static bool SameSize(const dReal *size, const dxGeom *g, dReal distance)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        dReal s = g->aabb[i * 2 + 1] - g->aabb[i * 2];
+        // infinite sizes are equal
+        if (s != size[i] && !(dFabs(s - size[i]) <= distance))
+            return false;
+    }
+    return true;
+}
+
+
+dxContactReuse::~dxContactReuse()
+{
+    if (pairs != NULL)
+        dFree(pairs, capacity * sizeof(Pair));
+}
+
+bool dxContactReuse::Reusable(const dxGeom *g)
+{
+    // rays are queries whose length can change at any time
+    return !IS_SPACE(g) && g->type != dRayClass;
+}
+
+void dxContactReuse::Lock()
+{
+    while (!ThrsafeCompareExchange(&lock, 0, 1))
+    {
+    }
+}
+
+void dxContactReuse::Unlock()
+{
+    ThrsafeExchange(&lock, 0);
+}
+
+dxContactReuse::Pair *dxContactReuse::Find(const dxGeom *o1, const dxGeom *o2, int flags)
+{
+    if (count == 0)
+        return NULL;
+
+    unsigned mask = capacity - 1;
+    unsigned slot = ContactReuseHash(o1, o2, flags) & mask;
+    for (;;)
+    {
+        Pair *p = pairs + slot;
+        if (p->o1 == NULL)
+            return NULL;
+        if (p->o1 == o1 && p->o2 == o2 && p->flags == flags
+            && p->serial1 == o1->serial && p->serial2 == o2->serial)
+            return p;
+        slot = (slot + 1) & mask;
+    }
+}
+
+dxContactReuse::Pair *dxContactReuse::Insert(dxGeom *o1, dxGeom *o2, int flags)
+{
+    if ((count + 1) * 2 > capacity)
+        Rebuild(count + 1);
+
+    unsigned mask = capacity - 1;
+    unsigned slot = ContactReuseHash(o1, o2, flags) & mask;
+    for (;;)
+    {
+        Pair *p = pairs + slot;
+        if (p->o1 == NULL)
+        {
+            p->o1 = o1;
+            p->o2 = o2;
+            p->serial1 = o1->serial;
+            p->serial2 = o2->serial;
+            p->flags = flags;
+            count++;
+            return p;
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
+void dxContactReuse::Rebuild(unsigned needed)
+{
+    // keep the table at most half full, and drop the pairs too old to be reused
+    unsigned newcapacity = 64;
+    while (newcapacity < needed * 2)
+        newcapacity *= 2;
+
+    Pair *newpairs = (Pair *)dAlloc(newcapacity * sizeof(Pair));
+    for (unsigned i = 0; i < newcapacity; i++)
+        newpairs[i].o1 = NULL;
+
+    dArray<Contact> newcontacts;
+    unsigned newcount = 0;
+    unsigned newmask = newcapacity - 1;
+
+    for (unsigned i = 0; i < capacity; i++)
+    {
+        const Pair &p = pairs[i];
+        if (p.o1 == NULL || step - p.step > (unsigned)maxsteps)
+            continue;
+
+        unsigned slot = ContactReuseHash(p.o1, p.o2, p.flags) & newmask;
+        while (newpairs[slot].o1 != NULL)
+            slot = (slot + 1) & newmask;
+
+        Pair &q = newpairs[slot];
+        q = p;
+        q.first = newcontacts.size();
+        newcontacts.setSize(q.first + p.count);
+        memcpy(newcontacts.data() + q.first, contacts.data() + p.first, p.count * sizeof(Contact));
+        newcount++;
+    }
+
+    if (pairs != NULL)
+        dFree(pairs, capacity * sizeof(Pair));
+    pairs = newpairs;
+    capacity = newcapacity;
+    count = newcount;
+    contacts.swap(newcontacts);
+}
+
+int dxContactReuse::Reuse(dxGeom *o1, dxGeom *o2, int flags, dContactGeom *contact, int skip)
+{
+    o1->recomputeAABB();
+    o2->recomputeAABB();
+
+    dMatrix3 R;
+    dVector3 t;
+    RelativeFrame(o1, o2, R, t);
+
+    Lock();
+
+    const Pair *p = Find(o1, o2, flags);
+    if (p == NULL || step - p->step > (unsigned)maxsteps
+        || p->type1 != o1->type || p->type2 != o2->type
+        || !SameSize(p->size1, o1, distance) || !SameSize(p->size2, o2, distance))
+    {
+        Unlock();
+        return -1;
+    }
+
+    // how far the points of o1 moved in the frame of o2, and those of o2 in
+    // the frame of o1. the contacts are in both geoms, so the smaller bounds them
+    dReal turn = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            dReal d = R[i * 4 + j] - p->R[i * 4 + j];
+            turn += d * d;
+        }
+    }
+    turn = dSqrt(turn);
+
+    dVector3 d, t2, oldt2;
+    dSubtractVectors3(d, t, p->t);
+    dReal move1 = dCalcVectorLength3(d);
+    dMultiply1_331(t2, R, t);
+    dMultiply1_331(oldt2, p->R, p->t);
+    dSubtractVectors3(d, t2, oldt2);
+    dReal move2 = dCalcVectorLength3(d);
+    if (turn > 0)
+    {
+        // no product with the infinite radius of planes when nothing turned
+        move1 += turn * p->radius1;
+        move2 += turn * p->radius2;
+    }
+    if (dMIN(move1, move2) > distance)
+    {
+        Unlock();
+        return -1;
+    }
+
+    const dReal *pos2, *R2;
+    GeomFrame(o2, pos2, R2);
+
+    int n = 0;
+    const Contact *c = contacts.data() + p->first;
+    for (int i = 0; i < p->count; i++, c++)
+    {
+        // where o1 has the point now, and how far it is from where o2 has it
+        dVector3 p1;
+        dMultiply0_331(p1, R, c->local1);
+        dAddVectors3(p1, p1, t);
+        dSubtractVectors3(d, p1, c->local2);
+
+        dReal depth = c->depth - dCalcVectorDot3(d, c->normal2);
+        if (depth < 0)
+            continue;
+
+        dVector3 local;
+        dAddScaledVectors3(local, c->local2, d, REAL(1.0), REAL(0.5));
+
+        dContactGeom *out = CONTACT(contact, n * skip);
+        dMultiply0_331(out->pos, R2, local);
+        dAddVectors3(out->pos, out->pos, pos2);
+        dMultiply0_331(out->normal, R2, c->normal2);
+        out->depth = depth;
+        out->g1 = c->g1;
+        out->g2 = c->g2;
+        out->side1 = c->side1;
+        out->side2 = c->side2;
+        n++;
+    }
+
+    Unlock();
+    return n;
+}
+
+void dxContactReuse::Store(dxGeom *o1, dxGeom *o2, int flags, const dContactGeom *contact, int skip, int n)
+{
+    if (n == 0)
+    {
+        // pairs without contacts are not kept, as there is nothing to follow
+        // the geoms with. forget what an earlier collide found
+        Lock();
+        Pair *p = Find(o1, o2, flags);
+        if (p != NULL)
+            p->step = step - (unsigned)maxsteps - 1;
+        Unlock();
+        return;
+    }
+
+    Pair pair;
+    pair.type1 = o1->type;
+    pair.type2 = o2->type;
+    RelativeFrame(o1, o2, pair.R, pair.t);
+    pair.radius1 = AABBRadius(o1);
+    pair.radius2 = AABBRadius(o2);
+    for (int i = 0; i < 3; i++)
+    {
+        pair.size1[i] = o1->aabb[i * 2 + 1] - o1->aabb[i * 2];
+        pair.size2[i] = o2->aabb[i * 2 + 1] - o2->aabb[i * 2];
+    }
+
+    const dReal *pos1, *R1, *pos2, *R2;
+    GeomFrame(o1, pos1, R1);
+    GeomFrame(o2, pos2, R2);
+
+    Lock();
+
+    Pair *p = Find(o1, o2, flags);
+    if (p == NULL)
+        p = Insert(o1, o2, flags);
+    p->type1 = pair.type1;
+    p->type2 = pair.type2;
+    p->step = step;
+    memcpy(p->R, pair.R, sizeof(dMatrix3));
+    dCopyVector3(p->t, pair.t);
+    p->radius1 = pair.radius1;
+    p->radius2 = pair.radius2;
+    memcpy(p->size1, pair.size1, sizeof(pair.size1));
+    memcpy(p->size2, pair.size2, sizeof(pair.size2));
+
+    // the old contacts of the pair stay in the array until the next rebuild
+    p->first = contacts.size();
+    p->count = n;
+    contacts.setSize(p->first + n);
+
+    Contact *c = contacts.data() + p->first;
+    for (int i = 0; i < n; i++, c++)
+    {
+        const dContactGeom *in = CONTACT(contact, i * skip);
+        dVector3 d;
+        dSubtractVectors3(d, in->pos, pos1);
+        dMultiply1_331(c->local1, R1, d);
+        dSubtractVectors3(d, in->pos, pos2);
+        dMultiply1_331(c->local2, R2, d);
+        dMultiply1_331(c->normal2, R2, in->normal);
+        c->depth = in->depth;
+        c->g1 = in->g1;
+        c->g2 = in->g2;
+        c->side1 = in->side1;
+        c->side2 = in->side2;
+    }
+
+    Unlock();
+}
+
+void dxContactReuse::StepDone()
+{
+    step++;
+
+    // rebuilding drops the pairs that got too old and the contacts replaced
+    // by newer ones
+    if (count != 0)
+    {
+        Lock();
+        Rebuild(count);
+        Unlock();
+    }
+}
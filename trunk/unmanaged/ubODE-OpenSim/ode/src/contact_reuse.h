@@ -0,0 +1,110 @@
+/*************************************************************************
+ *                                                                       *
+ * Open Dynamics Engine, Copyright (C) 2001,2002 Russell L. Smith.       *
+ * All rights reserved.  Email: russ@q12.org   Web: www.q12.org          *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of EITHER:                                  *
+ *   (1) The GNU Lesser General Public License as published by the Free  *
+ *       Software Foundation; either version 2.1 of the License, or (at  *
+ *       your option) any later version. The text of the GNU Lesser      *
+ *       General Public License is included with this library in the     *
+ *       file LICENSE.TXT.                                               *
+ *   (2) The BSD-style license that is included with this library in     *
+ *       the file LICENSE-BSD.TXT.                                       *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+ * LICENSE.TXT and LICENSE-BSD.TXT for more details.                     *
+ *                                                                       *
+ *************************************************************************/
+
+
+
+
+// Contact reuse across the substeps of a frame.
+// The plugin collides the spaces and steps the world several times per frame,
+// and resting or slowly moving prims find about the same contacts each time.
+// When enabled, dCollide keeps the contacts of each geom pair, with their
+// points in the frames of both geoms and the normal in the frame of the second
+// one. The next collides of the pair, while the two geoms have moved less than
+// the reuse distance from each other and the result is not older than the
+// reuse steps, carry the kept contacts along with the geoms instead of running
+// the collider: the point is put halfway between where each geom now has it and
+// the depth is changed by how far they got closer along the kept normal.
+// Contacts that come out with a negative depth are dropped. Any other pair,
+// or one whose geoms changed class or bounding box size, runs the collider and
+// its contacts are kept again. Pairs are also keyed by the creation serials of
+// the geoms, so a geom made at the address of a destroyed one starts afresh.
+
+#ifndef _ODE_CONTACT_REUSE_H_
+#define _ODE_CONTACT_REUSE_H_
+
+#include <ode/common.h>
+#include <ode/collision.h>
+#include "objects.h"
+#include "odeou.h"
+
+struct dxContactReuse : public dBase
+{
+    struct Contact
+    {
+        dVector3 local1;    // point in the frame of o1
+        dVector3 local2;    // point in the frame of o2
+        dVector3 normal2;   // normal in the frame of o2
+        dReal depth;
+        dxGeom *g1, *g2;
+        int side1, side2;
+    };
+
+    struct Pair
+    {
+        dxGeom *o1, *o2;    // o1 NULL for an empty slot
+        unsigned serial1, serial2;  // of o1 and o2, as a geom can be destroyed and its address reused
+        int flags;
+        int type1, type2;
+        unsigned step;      // world step the contacts were found for
+        dMatrix3 R;         // o1 rotation in the frame of o2
+        dVector3 t;         // o1 position in the frame of o2
+        dReal radius1, radius2;     // farthest AABB corner from each geom position
+        dReal size1[3], size2[3];   // AABB sizes
+        int first, count;   // in contacts
+    };
+
+    Pair *pairs;
+    unsigned capacity;      // power of two, or 0
+    unsigned count;
+    dArray<Contact> contacts;
+
+    unsigned step;          // world steps done
+    int maxsteps;
+    dReal distance;
+    volatile atomicord32 lock;
+
+    dxContactReuse(int _maxsteps, dReal _distance):
+        pairs(NULL), capacity(0), count(0), step(0),
+        maxsteps(_maxsteps), distance(_distance), lock(0) {}
+    ~dxContactReuse();
+
+    // write the kept contacts of o1 and o2 moved to where the geoms are now and
+    // return their number, or -1 if the collider has to run
+    int Reuse(dxGeom *o1, dxGeom *o2, int flags, dContactGeom *contact, int skip);
+    // keep the contacts the collider returned for o1 and o2
+    void Store(dxGeom *o1, dxGeom *o2, int flags, const dContactGeom *contact, int skip, int n);
+    // forget the pairs that got too old. call after each world step
+    void StepDone();
+
+    // geoms that can have their contacts kept
+    static bool Reusable(const dxGeom *g);
+
+private:
+    Pair *Find(const dxGeom *o1, const dxGeom *o2, int flags);
+    Pair *Insert(dxGeom *o1, dxGeom *o2, int flags);
+    void Rebuild(unsigned needed);
+    void Lock();
+    void Unlock();
+};
+
+
+#endif
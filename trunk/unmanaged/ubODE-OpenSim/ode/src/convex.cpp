@@ -37,6 +37,9 @@ By Rodrigo Hernandez
 #pragma warning(disable:4291)  // for VC++, no complaints about "no matching operator delete found"
 #endif
 
+// most points as far along a direction followed by the support search
+#define dCONVEX_PLATEAU_MAX 32
+
 #if 1
 #define dMIN(A,B)  ((A)>(B) ? (B) : (A))
 #define dMAX(A,B)  ((A)>(B) ? (A) : (B))
@@ -67,6 +70,8 @@ dxConvex::dxConvex (dSpaceID space,
     pointcount = _pointcount;
     polygons=_polygons;
     edges = NULL;
+    adjacencystart = NULL;
+    adjacency = NULL;
     FillEdges();
 #ifndef dNODEBUG
     // Check for properly build polygons by calculating the determinant
@@ -120,48 +125,170 @@ void dxConvex::computeAABB()
     }
 }
 
-/*! \brief Populates the edges set, should be called only once whenever the polygon array gets updated */
+/*! \brief Populates the edges set, the point adjacency and the extreme points,
+ should be called whenever the points or the polygon array get updated */
 void dxConvex::FillEdges()
 {
-    unsigned int *points_in_poly=polygons;
-    unsigned int *index=polygons+1;
     if (edges!=NULL) delete[] edges;
+    if (adjacency!=NULL) delete[] adjacency;
+    if (adjacencystart!=NULL) delete[] adjacencystart;
     edgecount = 0;
+
+    // every edge is a side of two polygons, so there are at most as many
+    // edges as polygon sides
+    unsigned int sidecount = 0;
+    unsigned int *points_in_poly=polygons;
+    for(unsigned int i=0;i<planecount;++i)
+    {
+        sidecount += *points_in_poly;
+        points_in_poly+=(*points_in_poly+1);
+    }
+
+    // edges found so far, listed from their lower point to find duplicates
+    const unsigned int noedge = ~0U;
+    unsigned int *pointedges = new unsigned int[pointcount];
+    for(unsigned int i=0;i<pointcount;++i) pointedges[i] = noedge;
+    unsigned int *nextedge = new unsigned int[sidecount];
+    edge *found = new edge[sidecount];
+
+    points_in_poly=polygons;
+    unsigned int *index=polygons+1;
     edge e;
-    bool isinset;
     for(unsigned int i=0;i<planecount;++i)
     {
         for(unsigned int j=0;j<*points_in_poly;++j)
         {
             e.first = dMIN(index[j],index[(j+1)%*points_in_poly]);
             e.second = dMAX(index[j],index[(j+1)%*points_in_poly]);
-            isinset=false;
-            for(unsigned int k=0;k<edgecount;++k)
+            unsigned int k;
+            for(k=pointedges[e.first];k!=noedge;k=nextedge[k])
             {
-                if((edges[k].first==e.first)&&(edges[k].second==e.second))
-                {
-                    isinset=true;
-                    break;
-                }
+                if(found[k].second==e.second) break;
             }
-            if(!isinset)
+            if(k==noedge)
             {
-                edge* tmp = new edge[edgecount+1];
-                if(edgecount!=0)
-                {
-                    memcpy(tmp,edges,(edgecount)*sizeof(edge));
-                    delete[] edges;
-                }
-                tmp[edgecount].first=e.first;
-                tmp[edgecount].second=e.second;
-                edges = tmp;
+                found[edgecount]=e;
+                nextedge[edgecount]=pointedges[e.first];
+                pointedges[e.first]=edgecount;
                 ++edgecount;
             }
         }
         points_in_poly+=(*points_in_poly+1);
         index=points_in_poly+1;
     }
+
+    edges = new edge[edgecount];
+    if(edgecount!=0) memcpy(edges,found,edgecount*sizeof(edge));
+
+    // edges of each point, in the order of the edges array
+    adjacencystart = new unsigned int[pointcount+1];
+    for(unsigned int i=0;i<=pointcount;++i) adjacencystart[i] = 0;
+    for(unsigned int k=0;k<edgecount;++k)
+    {
+        ++adjacencystart[edges[k].first+1];
+        ++adjacencystart[edges[k].second+1];
+    }
+    for(unsigned int i=0;i<pointcount;++i) adjacencystart[i+1] += adjacencystart[i];
+    adjacency = new unsigned int[2*edgecount+1];
+    for(unsigned int i=0;i<pointcount;++i) pointedges[i] = adjacencystart[i];
+    for(unsigned int k=0;k<edgecount;++k)
+    {
+        adjacency[pointedges[edges[k].first]++] = k;
+        adjacency[pointedges[edges[k].second]++] = k;
+    }
+
+    delete[] found;
+    delete[] nextedge;
+    delete[] pointedges;
+
+    // starting points for the support search
+    for(unsigned int a=0;a<6;++a) extremes[a] = 0;
+    for(unsigned int i=1;i<pointcount;++i)
+    {
+        for(unsigned int a=0;a<3;++a)
+        {
+            if(points[(i*3)+a]<points[(extremes[a*2]*3)+a]) extremes[a*2] = i;
+            if(points[(i*3)+a]>points[(extremes[(a*2)+1]*3)+a]) extremes[(a*2)+1] = i;
+        }
+    }
+}
+
+static unsigned int ConvexLinearSupport(const dReal *points, unsigned int pointcount, const dReal *rdir)
+{
+    unsigned int index=0;
+    dReal max = dCalcVectorDot3(points,rdir);
+    dReal tmp;
+    for (unsigned int i = 1; i < pointcount; ++i) 
+    {
+        tmp = dCalcVectorDot3(points+(i*3),rdir);
+        if (tmp > max) 
+        {
+            index=i;
+            max = tmp; 
+        }
+    }
+    return index;
+}
+
+/*! \brief Support mapping in the convex frame. The search climbs from an
+ extreme point to the neighbour furthest along the direction until none is
+ further, which on a convex hull is a furthest point. The points as far as
+ that one are then searched for the first of them, so the result is the same
+ as the linear search. */
+unsigned int dxConvex::SupportIndexClimb(const dReal *rdir) const
+{
+    unsigned int axis = 0;
+    if (dFabs(rdir[1]) > dFabs(rdir[axis])) axis = 1;
+    if (dFabs(rdir[2]) > dFabs(rdir[axis])) axis = 2;
+    unsigned int index = extremes[(axis*2)+(rdir[axis]>0?1:0)];
+    dReal max = dCalcVectorDot3(points+(index*3),rdir);
+
+    for(;;)
+    {
+        unsigned int best = index;
+        for(unsigned int k=adjacencystart[index];k!=adjacencystart[index+1];++k)
+        {
+            const edge &e = edges[adjacency[k]];
+            unsigned int other = e.first==index ? e.second : e.first;
+            dReal tmp = dCalcVectorDot3(points+(other*3),rdir);
+            if (tmp > max)
+            {
+                max = tmp;
+                best = other;
+            }
+        }
+        if (best == index) break;
+        index = best;
+    }
+
+    // a face or an edge may be across the direction
+    unsigned int plateau[dCONVEX_PLATEAU_MAX];
+    unsigned int plateaucount = 1;
+    plateau[0] = index;
+    unsigned int first = index;
+    for(unsigned int p=0;p!=plateaucount;++p)
+    {
+        unsigned int current = plateau[p];
+        for(unsigned int k=adjacencystart[current];k!=adjacencystart[current+1];++k)
+        {
+            const edge &e = edges[adjacency[k]];
+            unsigned int other = e.first==current ? e.second : e.first;
+            if (dCalcVectorDot3(points+(other*3),rdir) != max) continue;
+            unsigned int q;
+            for(q=0;q!=plateaucount;++q)
+            {
+                if (plateau[q]==other) break;
+            }
+            if (q!=plateaucount) continue;
+            if (plateaucount==dCONVEX_PLATEAU_MAX)
+                return ConvexLinearSupport(points, pointcount, rdir);
+            plateau[plateaucount++] = other;
+            if (other < first) first = other;
+        }
+    }
+    return first;
 }
+
 #if 0
 dxConvex::BSPNode* dxConvex::CreateNode(std::vector<Arc> Arcs,std::vector<Polygon> Polygons)
 {
@@ -230,6 +357,7 @@ void dGeomSetConvex (dGeomID g,dReal *_planes,unsigned int _planecount,
     s->points = _points;
     s->pointcount = _pointcount;
     s->polygons=_polygons;
+    s->FillEdges();
 }
 
 //****************************************************************************
@@ -801,9 +929,34 @@ int dCollideConvexCapsule (dxGeom *o1, dxGeom *o2,
     return 0;
 }
 
+inline dReal ComputePointValue(dxConvex& cvx,unsigned int index,dVector4 axis)
+{
+    dVector3 point;
+    dMultiply0_331(point,cvx.final_posr->R,cvx.points+(index*3));
+    point[0]+=cvx.final_posr->pos[0];
+    point[1]+=cvx.final_posr->pos[1];
+    point[2]+=cvx.final_posr->pos[2];
+    return dCalcVectorDot3(point,axis)-axis[3];
+}
+
+// the interval ends are the support points along and against the axis, not
+// inline so ComputeInterval stays small for the usual small hulls
+void ComputeIntervalSupport(dxConvex& cvx,dVector4 axis,dReal& min,dReal& max)
+{
+    dVector3 rdir;
+    dMultiply1_331(rdir,cvx.final_posr->R,axis);
+    max = ComputePointValue(cvx,cvx.SupportIndexClimb(rdir),axis);
+    dNegateVector3r4(rdir);
+    min = ComputePointValue(cvx,cvx.SupportIndexClimb(rdir),axis);
+}
+
 inline void ComputeInterval(dxConvex& cvx,dVector4 axis,dReal& min,dReal& max)
 {
-    /* TODO: Use Support points here */
+    if (cvx.pointcount >= dCONVEX_CLIMB_MIN_POINTS)
+    {
+        ComputeIntervalSupport(cvx,axis,min,max);
+        return;
+    }
     dVector3 point;
     dReal value;
     //fprintf(stdout,"Compute Interval Axis %f,%f,%f\n",axis[0],axis[1],axis[2]);
@@ -985,23 +1138,22 @@ inline bool CheckSATConvexEdges(dxConvex& cvx1,
     // invert direction
     dNegateVector3r4(dist);
     unsigned int s2 = cvx2.SupportIndex(dist);
-    for(unsigned int i = 0;i<cvx1.edgecount;++i)
+    // only the edges that contain the extremal vertices
+    for(unsigned int k1 = cvx1.adjacencystart[s1];k1!=cvx1.adjacencystart[s1+1];++k1)
     {
-        // Skip edge if it doesn't contain the extremal vertex
-        if((cvx1.edges[i].first!=s1)&&(cvx1.edges[i].second!=s1)) continue;
+        const dxConvex::edge &edge1 = cvx1.edges[cvx1.adjacency[k1]];
         // we only need to apply rotation here
-        dMultiply0_331(e1a,cvx1.final_posr->R,cvx1.points+(cvx1.edges[i].first*3));
-        dMultiply0_331(e1b,cvx1.final_posr->R,cvx1.points+(cvx1.edges[i].second*3));
+        dMultiply0_331(e1a,cvx1.final_posr->R,cvx1.points+(edge1.first*3));
+        dMultiply0_331(e1b,cvx1.final_posr->R,cvx1.points+(edge1.second*3));
         e1[0]=e1b[0]-e1a[0];
         e1[1]=e1b[1]-e1a[1];
         e1[2]=e1b[2]-e1a[2];
-        for(unsigned int j = 0;j<cvx2.edgecount;++j)
+        for(unsigned int k2 = cvx2.adjacencystart[s2];k2!=cvx2.adjacencystart[s2+1];++k2)
         {
-            // Skip edge if it doesn't contain the extremal vertex
-            if((cvx2.edges[j].first!=s2)&&(cvx2.edges[j].second!=s2)) continue;
+            const dxConvex::edge &edge2 = cvx2.edges[cvx2.adjacency[k2]];
             // we only need to apply rotation here
-            dMultiply0_331 (e2a,cvx2.final_posr->R,cvx2.points+(cvx2.edges[j].first*3));
-            dMultiply0_331 (e2b,cvx2.final_posr->R,cvx2.points+(cvx2.edges[j].second*3));
+            dMultiply0_331 (e2a,cvx2.final_posr->R,cvx2.points+(edge2.first*3));
+            dMultiply0_331 (e2b,cvx2.final_posr->R,cvx2.points+(edge2.second*3));
             e2[0]=e2b[0]-e2a[0];
             e2[1]=e2b[1]-e2a[1];
             e2[2]=e2b[2]-e2a[2];
@@ -1456,6 +1608,7 @@ int dCollideRayConvex (dxGeom *o1, dxGeom *o2, int flags,
 }
 #else
 // Ray - Convex collider by David Walters, June 2006
+// the planes are in the convex frame, so the ray is moved into it first
 int dCollideRayConvex( dxGeom *o1, dxGeom *o2,
                       int flags, dContactGeom *contact, int skip )
 {
@@ -1479,6 +1632,15 @@ int dCollideRayConvex( dxGeom *o1, dxGeom *o2,
     // Compute some useful info
     //
 
+    // ray start and direction in the convex frame
+    dVector3 start, dir, tmp;
+    dSubtractVectors3(tmp, ray->final_posr->pos, convex->final_posr->pos);
+    dMultiply1_331(start, convex->final_posr->R, tmp);
+    tmp[0] = ray->final_posr->R[0*4+2];
+    tmp[1] = ray->final_posr->R[1*4+2];
+    tmp[2] = ray->final_posr->R[2*4+2];
+    dMultiply1_331(dir, convex->final_posr->R, tmp);
+
     flag = 0;	// Assume start point is behind all planes.
 
     for ( unsigned int i = 0; i < convex->planecount; ++i )
@@ -1487,7 +1649,7 @@ int dCollideRayConvex( dxGeom *o1, dxGeom *o2,
         dReal* plane = convex->planes + ( i * 4 );
 
         // If alpha >= 0 then start point is outside of plane.
-        alpha = dCalcVectorDot3( plane, ray->final_posr->pos ) - plane[3];
+        alpha = dCalcVectorDot3( plane, start ) - plane[3];
 
         // If any alpha is positive, then
         // the ray start is _outside_ of the hull
@@ -1509,28 +1671,35 @@ int dCollideRayConvex( dxGeom *o1, dxGeom *o2,
     // Assume no contacts.
     contact->depth = dInfinity;
 
+    dVector3 pos;
+    dReal *best = NULL;
+
     for ( unsigned int i = 0; i < convex->planecount; ++i )
     {
         // Alias this plane.
         dReal* plane = convex->planes + ( i * 4 );
 
         // If alpha >= 0 then point is outside of plane.
-        alpha = nsign * ( dCalcVectorDot3( plane, ray->final_posr->pos ) - plane[3] );
+        alpha = nsign * ( dCalcVectorDot3( plane, start ) - plane[3] );
 
         // Compute [ plane-normal DOT ray-normal ], (/flip)
-        beta = dCalcVectorDot3_13( plane, ray->final_posr->R+2 ) * nsign;
+        beta = dCalcVectorDot3( plane, dir ) * nsign;
 
         // Ray is pointing at the plane? ( beta < 0 )
+        if ( beta >= -dEpsilon || alpha < 0 )
+            continue;
+
+        // Distance along the ray to the plane.
+        alpha = -alpha / beta;
+
         // Ray start to plane is within maximum ray length?
         // Ray start to plane is closer than the current best distance?
-        if ( beta < -dEpsilon &&
-            alpha >= 0 && alpha <= ray->length &&
-            alpha < contact->depth )
+        if ( alpha <= ray->length && alpha < contact->depth )
         {
             // Compute contact point on convex hull surface.
-            contact->pos[0] = ray->final_posr->pos[0] + alpha * ray->final_posr->R[0*4+2];
-            contact->pos[1] = ray->final_posr->pos[1] + alpha * ray->final_posr->R[1*4+2];
-            contact->pos[2] = ray->final_posr->pos[2] + alpha * ray->final_posr->R[2*4+2];
+            pos[0] = start[0] + alpha * dir[0];
+            pos[1] = start[1] + alpha * dir[1];
+            pos[2] = start[2] + alpha * dir[2];
 
             flag = 0;
 
@@ -1544,7 +1713,7 @@ int dCollideRayConvex( dxGeom *o1, dxGeom *o2,
                 dReal* planej = convex->planes + ( j * 4 );
 
                 // If beta >= 0 then start is outside of plane.
-                beta = dCalcVectorDot3( planej, contact->pos ) - plane[3];
+                beta = dCalcVectorDot3( planej, pos ) - planej[3];
 
                 // If any beta is positive, then the contact point
                 // is not on the surface of the convex hull - it's just
@@ -1559,15 +1728,12 @@ int dCollideRayConvex( dxGeom *o1, dxGeom *o2,
             // Contact point isn't outside hull's surface? then it's a good contact!
             if ( flag == 0 )
             {
-                // Store the contact normal, possibly flipped.
-                contact->normal[0] = nsign * plane[0];
-                contact->normal[1] = nsign * plane[1];
-                contact->normal[2] = nsign * plane[2];
+                best = plane;
 
                 // Store depth
                 contact->depth = alpha;
 
-                if ((flags & CONTACTS_UNIMPORTANT) && contact->depth <= ray->length )
+                if ((flags & CONTACTS_UNIMPORTANT))
                 {
                     // Break on any contact if contacts are not important
                     break;
@@ -1575,8 +1741,18 @@ int dCollideRayConvex( dxGeom *o1, dxGeom *o2,
             }
         }
     }
+
     // Contact?
-    return ( contact->depth <= ray->length );
+    if ( best == NULL )
+        return 0;
+
+    // Contact point and normal, possibly flipped, back in world space.
+    dAddScaledVector3(contact->pos, ray->final_posr->pos, tmp, contact->depth);
+    dMultiply0_331(contact->normal, convex->final_posr->R, best);
+    contact->normal[0] *= nsign;
+    contact->normal[1] *= nsign;
+    contact->normal[2] *= nsign;
+    return 1;
 }
 
 #endif
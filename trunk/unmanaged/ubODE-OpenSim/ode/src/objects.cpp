@@ -23,14 +23,20 @@
 // Object, body, and world methods.
 
 
+#include <stdlib.h>
 #include <ode/common.h>
 #include <ode/threading_impl.h>
 #include <ode/objects.h>
+#include <ode/odeinit.h>
 #include "config.h"
 #include "matrix.h"
 #include "objects.h"
+#include "contact_cache.h"
+#include "contact_reuse.h"
+#include "step_profile.h"
 #include "util.h"
 #include "threading_impl.h"
+#include "threadingutils.h"
 
 
 #define dWORLD_DEFAULT_GLOBAL_ERP REAL(0.2)
@@ -46,6 +52,26 @@
 static dThreadingImplementationID g_world_default_threading_impl = NULL;
 static const dThreadingFunctionsInfo *g_world_default_threading_functions = NULL;
 
+// the pool of dWorldSetStepSharedThreadPool. it is created by the first world
+// that asks for it and freed when the last world using it leaves it
+static dThreadingImplementationID g_shared_step_threading = NULL;
+static dThreadingThreadPoolID g_shared_step_pool = NULL;
+static unsigned g_shared_step_pool_threads = 0;
+static unsigned g_shared_step_pool_users = 0;
+static volatile atomicord32 g_shared_step_pool_lock = 0;
+
+static void LockSharedStepPool()
+{
+    while (!ThrsafeCompareExchange(&g_shared_step_pool_lock, 0, 1))
+    {
+    }
+}
+
+static void UnlockSharedStepPool()
+{
+    ThrsafeExchange(&g_shared_step_pool_lock, 0);
+}
+
 
 dObject::~dObject()
 {
@@ -72,7 +98,8 @@ dxDampingParameters::dxDampingParameters(void *):
 
 dxQuickStepParameters::dxQuickStepParameters(void *):
     num_iterations(20),
-    w(REAL(1.3))
+    w(REAL(1.3)),
+    warm_starting(REAL(0.0))
 {
 }
 
@@ -89,12 +116,27 @@ dxWorld::dxWorld():
     firstjoint(NULL),
     nb(0),
     nj(0),
+    awake_bodies(NULL),
+    awake_count(0),
+    awake_capacity(0),
+    awake_unsorted(false),
+    body_serial(0),
+    island_stamp(0),
     global_erp(dWORLD_DEFAULT_GLOBAL_ERP),
     global_cfm(dWORLD_DEFAULT_GLOBAL_CFM),
     adis(NULL),
     body_flags(0),
     islands_max_threads(dWORLDSTEP_THREADCOUNT_UNLIMITED),
     wmem(NULL),
+    default_threading(NULL),
+    default_threading_functions(NULL),
+    builtin_threading(NULL),
+    builtin_pool(NULL),
+    builtin_pool_threads(0),
+    builtin_pool_shared(false),
+    contact_cache(NULL),
+    contact_reuse(NULL),
+    profiler(NULL),
     qs(NULL),
     contactp(NULL),
     dampingp(NULL),
@@ -103,16 +145,89 @@ dxWorld::dxWorld():
 {
     dxThreadingBase::SetThreadingDefaultImplProvider(this);
 
+    // the self-threaded implementation keeps the posted calls in a list that
+    // is not locked, so each world has its own and worlds can be stepped by
+    // different threads at the same time
+    default_threading = dThreadingAllocateSelfThreadedImplementation();
+    if (default_threading != NULL)
+        default_threading_functions = dThreadingImplementationGetFunctions(default_threading);
+
     dSetZero (gravity, 4);
 }
 
 dxWorld::~dxWorld()
 {
+    FreeBuiltinThreadPool();
+
+    delete contact_cache;
+    delete contact_reuse;
+    delete profiler;
+
+    if (awake_bodies != NULL)
+        dFree(awake_bodies, awake_capacity * sizeof(dxBody *));
+
     if (wmem)
     {
         wmem->CleanupWorldReferences(this);
         wmem->Release();
     }
+
+    // after the working memory objects allocated with it are gone
+    if (default_threading != NULL)
+        dThreadingFreeImplementation(default_threading);
+}
+
+void dxWorld::AddAwakeBody(dxBody *b)
+{
+    dIASSERT(b->awake_index == -1);
+
+    if (awake_count == awake_capacity) {
+        unsigned newcapacity = awake_capacity != 0 ? awake_capacity * 2 : 64;
+        awake_bodies = (dxBody **)dRealloc(awake_bodies, awake_capacity * sizeof(dxBody *), newcapacity * sizeof(dxBody *));
+        awake_capacity = newcapacity;
+    }
+
+    // a body added at the end is out of order unless it is the newest one
+    if (awake_count != 0 && awake_bodies[awake_count - 1]->serial < b->serial)
+        awake_unsorted = true;
+
+    b->awake_index = (int)awake_count;
+    awake_bodies[awake_count++] = b;
+}
+
+void dxWorld::RemoveAwakeBody(dxBody *b)
+{
+    dIASSERT(b->awake_index >= 0 && (unsigned)b->awake_index < awake_count);
+    dIASSERT(awake_bodies[b->awake_index] == b);
+
+    unsigned index = (unsigned)b->awake_index;
+    dxBody *last = awake_bodies[--awake_count];
+    if (last != b) {
+        awake_bodies[index] = last;
+        last->awake_index = (int)index;
+        awake_unsorted = true;
+    }
+    b->awake_index = -1;
+}
+
+static int CompareBodySerialsNewestFirst(const void *a, const void *b)
+{
+    unsigned sa = (*(dxBody *const *)a)->serial;
+    unsigned sb = (*(dxBody *const *)b)->serial;
+    return sa < sb ? 1 : (sa > sb ? -1 : 0);
+}
+
+// Put the awake bodies in the order of the world body list, so islands are
+// found in the same order (and so solved the same way) as when the whole
+// list was searched.
+void dxWorld::SortAwakeBodies()
+{
+    if (awake_unsorted) {
+        qsort(awake_bodies, awake_count, sizeof(dxBody *), &CompareBodySerialsNewestFirst);
+        for (unsigned i = 0; i != awake_count; ++i)
+            awake_bodies[i]->awake_index = (int)i;
+        awake_unsorted = false;
+    }
 }
 
 bool dxWorld::InitializeDefaultThreading()
@@ -158,6 +273,150 @@ void dxWorld::AssignThreadingImpl(const dxThreadingFunctionsInfo *functions_info
     dxThreadingBase::AssignThreadingImpl(functions_info, threading_impl);
 }
 
+// Replace the world threading with a multi-threaded implementation served
+// by a pool of thread_count threads owned by the world.
+// thread_count of 0 returns the world to the default self-threaded implementation.
+bool dxWorld::AssignBuiltinThreadPool(unsigned thread_count)
+{
+    FreeBuiltinThreadPool();
+
+    if (thread_count == 0)
+        return true;
+
+    bool result = false;
+
+#if dBUILTIN_THREADING_IMPL_ENABLED
+    do {
+        dThreadingImplementationID threading = dThreadingAllocateMultiThreadedImplementation();
+        if (threading == NULL)
+            break;
+
+        dThreadingThreadPoolID pool = dThreadingAllocateThreadPool(thread_count, 0, dAllocateFlagBasicData, NULL);
+        if (pool == NULL)
+        {
+            dThreadingFreeImplementation(threading);
+            break;
+        }
+
+        dThreadingThreadPoolServeMultiThreadedImplementation(pool, threading);
+        AssignThreadingImpl(dThreadingImplementationGetFunctions(threading), threading);
+
+        builtin_threading = threading;
+        builtin_pool = pool;
+        builtin_pool_threads = thread_count;
+        result = true;
+    }
+    while (false);
+#endif // #if dBUILTIN_THREADING_IMPL_ENABLED
+
+    return result;
+}
+
+// Make the world step with the pool shared by all the worlds that call this,
+// creating it with thread_count threads if no world uses it yet.
+bool dxWorld::AssignSharedThreadPool(unsigned thread_count)
+{
+    FreeBuiltinThreadPool();
+
+    if (thread_count == 0)
+        return true;
+
+    bool result = false;
+
+#if dBUILTIN_THREADING_IMPL_ENABLED
+    LockSharedStepPool();
+
+    do {
+        if (g_shared_step_threading == NULL)
+        {
+            dThreadingImplementationID threading = dThreadingAllocateMultiThreadedImplementation();
+            if (threading == NULL)
+                break;
+
+            dThreadingThreadPoolID pool = dThreadingAllocateThreadPool(thread_count, 0, dAllocateFlagBasicData, NULL);
+            if (pool == NULL)
+            {
+                dThreadingFreeImplementation(threading);
+                break;
+            }
+
+            dThreadingThreadPoolServeMultiThreadedImplementation(pool, threading);
+
+            g_shared_step_threading = threading;
+            g_shared_step_pool = pool;
+            g_shared_step_pool_threads = thread_count;
+        }
+
+        ++g_shared_step_pool_users;
+
+        AssignThreadingImpl(dThreadingImplementationGetFunctions(g_shared_step_threading), g_shared_step_threading);
+
+        builtin_threading = g_shared_step_threading;
+        builtin_pool = g_shared_step_pool;
+        builtin_pool_threads = g_shared_step_pool_threads;
+        builtin_pool_shared = true;
+        result = true;
+    }
+    while (false);
+
+    UnlockSharedStepPool();
+#endif // #if dBUILTIN_THREADING_IMPL_ENABLED
+
+    return result;
+}
+
+void dxWorld::FreeBuiltinThreadPool()
+{
+    if (builtin_pool_shared)
+    {
+        // drop the stepping objects allocated with the shared threading while
+        // it is still there, then free the pool if no other world uses it
+        AssignThreadingImpl(NULL, NULL);
+
+        builtin_threading = NULL;
+        builtin_pool = NULL;
+        builtin_pool_threads = 0;
+        builtin_pool_shared = false;
+
+        dThreadingImplementationID threading = NULL;
+        dThreadingThreadPoolID pool = NULL;
+
+        LockSharedStepPool();
+
+        if (--g_shared_step_pool_users == 0)
+        {
+            threading = g_shared_step_threading;
+            pool = g_shared_step_pool;
+
+            g_shared_step_threading = NULL;
+            g_shared_step_pool = NULL;
+            g_shared_step_pool_threads = 0;
+        }
+
+        UnlockSharedStepPool();
+
+        if (threading != NULL)
+        {
+            dThreadingImplementationShutdownProcessing(threading);
+            dThreadingFreeThreadPool(pool);
+            dThreadingFreeImplementation(threading);
+        }
+    }
+    else if (builtin_threading != NULL)
+    {
+        // Release the pool threads before anything is freed, then drop the
+        // stepping objects that were allocated with this threading
+        dThreadingImplementationShutdownProcessing(builtin_threading);
+        dThreadingFreeThreadPool(builtin_pool);
+        AssignThreadingImpl(NULL, NULL);
+        dThreadingFreeImplementation(builtin_threading);
+
+        builtin_threading = NULL;
+        builtin_pool = NULL;
+        builtin_pool_threads = 0;
+    }
+}
+
 unsigned dxWorld::GetThreadingIslandsMaxThreadsCount(unsigned *out_active_thread_count_ptr/*=NULL*/) const
 {
     unsigned active_thread_count = RetrieveThreadingThreadCount();
@@ -178,6 +437,13 @@ dxWorldProcessContext *dxWorld::UnsafeGetWorldProcessingContext() const
 
 const dxThreadingFunctionsInfo *dxWorld::RetrieveThreadingDefaultImpl(dThreadingImplementationID &out_default_impl)
 {
+    if (default_threading != NULL)
+    {
+        out_default_impl = default_threading;
+        return default_threading_functions;
+    }
+
+    // the world could not allocate its own one
     out_default_impl = g_world_default_threading_impl;
     return g_world_default_threading_functions;
 }
@@ -29,6 +29,7 @@
 #include <ode/common.h>
 #include <ode/memory.h>
 #include <ode/mass.h>
+#include <ode/threading_impl.h>
 #include "error.h"
 #include "array.h"
 #include "threading_base.h"
@@ -36,6 +37,9 @@
 
 class dxStepWorkingMemory;
 class dxWorldProcessContext;
+struct dxContactCache;
+struct dxContactReuse;
+struct dxStepProfiler;
 
 // some body flags
 
@@ -70,9 +74,10 @@ struct dObject : public dBase {
     dObject *next;		// next object of this type in list
     dObject **tome;		// pointer to previous object's next ptr
     int tag;			// used by dynamics algorithms
+    unsigned island_stamp;	// dxWorld::island_stamp of the last island search that reached this object
     void *userdata;		// user settable data
 
-    explicit dObject(dxWorld *w): world(w), next(NULL), tome(NULL), tag(0), userdata(NULL) {}
+    explicit dObject(dxWorld *w): world(w), next(NULL), tome(NULL), tag(0), island_stamp(0), userdata(NULL) {}
     virtual ~dObject();
 };
 
@@ -106,6 +111,7 @@ struct dxDampingParameters {
 struct dxQuickStepParameters {
     int num_iterations;		// number of SOR iterations to perform
     dReal w;			// the SOR over-relaxation parameter
+    dReal warm_starting;	// fraction of last step contact lambdas to start from, 0 disables
 
     dxQuickStepParameters() {}
     explicit dxQuickStepParameters(void *);
@@ -154,6 +160,9 @@ struct dxBody : public dObject {
     dxDampingParameters dampingp; // damping parameters, depends on flags
     dReal max_angular_speed;      // limit the angular velocity to this magnitude
 
+    unsigned serial;              // creation order in the world, newest highest
+    int awake_index;              // index in dxWorld::awake_bodies, -1 if disabled
+
     dxBody(dxWorld *w);
 };
 
@@ -162,6 +171,11 @@ struct dxWorld : public dBase, public dxThreadingBase, private dxIThreadingDefau
     dxBody *firstbody;		// body linked list
     dxJoint *firstjoint;		// joint linked list
     int nb,nj;			// number of bodies and joints in lists
+    dxBody **awake_bodies;	// the enabled bodies. islands are only searched from these
+    unsigned awake_count, awake_capacity;
+    bool awake_unsorted;	// awake_bodies is not in body list order (newest first)
+    unsigned body_serial;	// serial of the next body created
+    unsigned island_stamp;	// incremented by every island search
     dVector3 gravity;		// gravity vector (m/s/s)
     dReal global_erp;		// global error reduction parameter
     dReal global_cfm;		// global constraint force mixing parameter
@@ -169,6 +183,15 @@ struct dxWorld : public dBase, public dxThreadingBase, private dxIThreadingDefau
     int body_flags;               // flags for new bodies
     unsigned islands_max_threads; // maximum threads to allocate for island processing
     dxStepWorkingMemory *wmem; // Working memory object for dWorldStep/dWorldQuickStep
+    dThreadingImplementationID default_threading; // self-threaded threading used when none is assigned
+    const dThreadingFunctionsInfo *default_threading_functions;
+    dThreadingImplementationID builtin_threading; // threading owned by the world (dWorldSetStepThreadPoolSize)
+    dThreadingThreadPoolID builtin_pool;          // pool threads serving builtin_threading
+    unsigned builtin_pool_threads;
+    bool builtin_pool_shared;     // builtin_threading is the shared pool one (dWorldSetStepSharedThreadPool)
+    dxContactCache *contact_cache; // contact lambdas kept for warm starting, NULL if disabled
+    dxContactReuse *contact_reuse; // contacts kept for the next substeps, NULL if disabled
+    dxStepProfiler *profiler;     // step timing, NULL if profiling is disabled
 
     dxQuickStepParameters qs;
     dxContactParameters contactp;
@@ -184,6 +207,14 @@ struct dxWorld : public dBase, public dxThreadingBase, private dxIThreadingDefau
     static void FinalizeDefaultThreading();
 
     void AssignThreadingImpl(const dxThreadingFunctionsInfo *functions_info, dThreadingImplementationID threading_impl);
+    bool AssignBuiltinThreadPool(unsigned thread_count);
+    bool AssignSharedThreadPool(unsigned thread_count);
+    void FreeBuiltinThreadPool();
+
+    // keep awake_bodies in step with the dxBodyDisabled flag. use dxBodySetEnabled/dxBodySetDisabled
+    void AddAwakeBody(dxBody *b);
+    void RemoveAwakeBody(dxBody *b);
+    void SortAwakeBodies();
     unsigned GetThreadingIslandsMaxThreadsCount(unsigned *out_active_thread_count_ptr=NULL) const;
     dxWorldProcessContext *UnsafeGetWorldProcessingContext() const;
 
@@ -192,4 +223,24 @@ private: // dxIThreadingDefaultImplProvider
 };
 
 
+// change the enabled state of a body. these are the only places the
+// dxBodyDisabled flag may be changed, so the world awake list stays exact
+
+static inline void dxBodySetEnabled(dxBody *b)
+{
+    if (b->flags & dxBodyDisabled) {
+        b->flags &= ~dxBodyDisabled;
+        b->world->AddAwakeBody(b);
+    }
+}
+
+static inline void dxBodySetDisabled(dxBody *b)
+{
+    if ((b->flags & dxBodyDisabled) == 0) {
+        b->flags |= dxBodyDisabled;
+        b->world->RemoveAwakeBody(b);
+    }
+}
+
+
 #endif // #ifndef _ODE__PRIVATE_OBJECTS_H_
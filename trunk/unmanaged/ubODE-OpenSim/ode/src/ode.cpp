@@ -37,9 +37,14 @@
 #include "joints/joints.h"
 #include "step.h"
 #include "quickstep.h"
+#include "contact_cache.h"
+#include "contact_reuse.h"
+#include "step_profile.h"
 #include "util.h"
 #include "odetls.h"
 
+#include <string.h>
+
 // misc defines
 #define ALLOCA dALLOCA16
 
@@ -223,7 +228,9 @@ void dWorldCheck (dxWorld *w)
 // body
 
 dxBody::dxBody(dxWorld *w) :
-dObject(w)
+dObject(w),
+serial(w->body_serial++),
+awake_index(-1)
 {
 
 }
@@ -261,6 +268,7 @@ dxBody *dBodyCreate (dxWorld *w)
     dSetZero (b->finite_rot_axis,4);
     addObjectToList (b,(dObject **) &w->firstbody);
     w->nb++;
+    w->AddAwakeBody(b);
 
     // set auto-disable parameters
     b->average_avel_buffer = b->average_lvel_buffer = 0; // no buffer at beginning
@@ -311,6 +319,8 @@ void dBodyDestroy (dxBody *b)
     }
     removeObjectFromList (b);
     b->world->nb--;
+    if (b->awake_index != -1)
+        b->world->RemoveAwakeBody(b);
 
     // delete the average buffers
     if(b->average_lvel_buffer)
@@ -826,7 +836,7 @@ int dBodyIsKinematic (dBodyID b)
 void dBodyEnable (dBodyID b)
 {
     dAASSERT (b);
-    b->flags &= ~dxBodyDisabled;
+    dxBodySetEnabled(b);
     b->adis_stepsleft = b->adis.idle_steps;
     b->adis_timeleft = b->adis.idle_time;
     // no code for average-processing needed here
@@ -836,7 +846,7 @@ void dBodyEnable (dBodyID b)
 void dBodyDisable (dBodyID b)
 {
     dAASSERT (b);
-    b->flags |= dxBodyDisabled;
+    dxBodySetDisabled(b);
 }
 
 
@@ -972,7 +982,7 @@ void dBodySetAutoDisableFlag (dBodyID b, int do_auto_disable)
     {
         b->flags &= ~dxBodyAutoDisable;
         // (mg) we should also reset the IsDisabled state to correspond to the DoDisabling flag
-        b->flags &= ~dxBodyDisabled;
+        dxBodySetEnabled(b);
         b->adis.idle_steps = dWorldGetAutoDisableSteps(b->world);
         b->adis.idle_time = dWorldGetAutoDisableTime(b->world);
         // resetting the average calculations too
@@ -1789,10 +1799,32 @@ void dWorldSetStepThreadingImplementation(dWorldID w,
 #if dTHREADING_INTF_DISABLED
     dUASSERT(functions_info == NULL && threading_impl == NULL, "Threading interface is not available");
 #else
+    w->FreeBuiltinThreadPool();
     w->AssignThreadingImpl(functions_info, threading_impl);
 #endif
 }
 
+int dWorldSetStepThreadPoolSize(dWorldID w, unsigned thread_count)
+{
+    dUASSERT (w,"bad world argument");
+
+    return w->AssignBuiltinThreadPool(thread_count);
+}
+
+int dWorldSetStepSharedThreadPool(dWorldID w, unsigned thread_count)
+{
+    dUASSERT (w,"bad world argument");
+
+    return w->AssignSharedThreadPool(thread_count);
+}
+
+unsigned dWorldGetStepThreadPoolSize(dWorldID w)
+{
+    dUASSERT (w,"bad world argument");
+
+    return w->builtin_pool_threads;
+}
+
 
 int dWorldStep (dWorldID w, dReal stepsize)
 {
@@ -1801,15 +1833,30 @@ int dWorldStep (dWorldID w, dReal stepsize)
 
     bool result = false;
 
+    dxStepProfiler *profiler = w->profiler;
+    duint64 profileStart = profiler != NULL ? dxStepProfileNow() : 0;
+
     dxWorldProcessIslandsInfo islandsinfo;
-    if (dxReallocateWorldProcessContext (w, islandsinfo, stepsize, &dxEstimateStepMemoryRequirements))
+    if (dxReallocateWorldProcessContext (w, islandsinfo, stepsize, &dxEstimateStepMemoryRequirements, false))
     {
-        if (dxProcessIslands (w, islandsinfo, stepsize, &dxStepIsland, &dxEstimateStepMaxCallCount))
+        if (profiler != NULL)
+            profiler->AddTime(dStepProfileIslands, profileStart);
+
+        if (dxProcessIslands (w, islandsinfo, stepsize, &dxStepIsland, NULL, &dxEstimateStepMaxCallCount))
         {
             result = true;
         }
     }
 
+    if (w->contact_reuse != NULL)
+        w->contact_reuse->StepDone();
+
+    if (profiler != NULL)
+    {
+        profiler->AddTime(dStepProfileStep, profileStart);
+        profiler->EndStep();
+    }
+
     return result;
 }
 
@@ -1820,19 +1867,105 @@ int dWorldQuickStep (dWorldID w, dReal stepsize)
 
     bool result = false;
 
+    dxStepProfiler *profiler = w->profiler;
+    duint64 profileStart = profiler != NULL ? dxStepProfileNow() : 0;
+
+    dxContactCache *contact_cache = w->contact_cache;
+    if (contact_cache != NULL)
+        contact_cache->SeedContactJoints(w);
+
+    duint64 islandsStart = profiler != NULL ? dxStepProfileNow() : 0;
+
     dxWorldProcessIslandsInfo islandsinfo;
-    if (dxReallocateWorldProcessContext (w, islandsinfo, stepsize, &dxEstimateQuickStepMemoryRequirements))
+    if (dxReallocateWorldProcessContext (w, islandsinfo, stepsize, &dxEstimateQuickStepMemoryRequirements, true))
     {
-        if (dxProcessIslands (w, islandsinfo, stepsize, &dxQuickStepIsland, &dxEstimateQuickStepMaxCallCount))
+        if (profiler != NULL)
+            profiler->AddTime(dStepProfileIslands, islandsStart);
+
+        if (dxProcessIslands (w, islandsinfo, stepsize, &dxQuickStepIsland, &dxQuickStepFreeBodies, &dxEstimateQuickStepMaxCallCount))
         {
             result = true;
         }
     }
 
+    if (contact_cache != NULL)
+        contact_cache->StoreContactJoints(w);
+
+    if (w->contact_reuse != NULL)
+        w->contact_reuse->StepDone();
+
+    if (profiler != NULL)
+    {
+        profiler->AddTime(dStepProfileStep, profileStart);
+        profiler->EndStep();
+    }
+
     return result;
 }
 
 
+// world step profiling
+
+int dWorldSetStepProfiling (dWorldID w, int enable)
+{
+    dAASSERT(w);
+    if (!enable)
+    {
+        delete w->profiler;
+        w->profiler = NULL;
+    }
+    else if (w->profiler == NULL)
+    {
+        w->profiler = new dxStepProfiler();
+    }
+    return 1;
+}
+
+int dWorldGetStepProfiling (dWorldID w)
+{
+    dAASSERT(w);
+    return w->profiler != NULL;
+}
+
+void dWorldResetStepProfile (dWorldID w)
+{
+    dAASSERT(w);
+    if (w->profiler != NULL)
+        w->profiler->Reset();
+}
+
+int dWorldGetStepProfile (dWorldID w, dWorldStepProfile *profile)
+{
+    dAASSERT(w && profile);
+    if (w->profiler == NULL)
+    {
+        memset(profile, 0, sizeof(*profile));
+        return 0;
+    }
+    w->profiler->GetProfile(profile);
+    return 1;
+}
+
+void dWorldStepProfileCollisionBegin (dWorldID w)
+{
+    dAASSERT(w);
+    dxStepProfiler *profiler = w->profiler;
+    if (profiler != NULL)
+        profiler->m_collisionStart = dxStepProfileNow();
+}
+
+void dWorldStepProfileCollisionEnd (dWorldID w)
+{
+    dAASSERT(w);
+    dxStepProfiler *profiler = w->profiler;
+    if (profiler != NULL && profiler->m_collisionStart != 0)
+    {
+        profiler->AddTime(dStepProfileCollision, profiler->m_collisionStart);
+        profiler->m_collisionStart = 0;
+    }
+}
+
+
 void dWorldImpulseToForce (dWorldID w, dReal stepsize,
                            dReal ix, dReal iy, dReal iz,
                            dVector3 force)
@@ -2045,6 +2178,62 @@ dReal dWorldGetQuickStepW (dWorldID w)
 }
 
 
+void dWorldSetQuickStepWarmStarting (dWorldID w, dReal factor)
+{
+    dAASSERT(w);
+    dUASSERT (factor >= 0 && factor <= 1,"warm starting factor must be in [0,1]");
+
+    if (factor > 0)
+    {
+        if (w->contact_cache == NULL)
+            w->contact_cache = new dxContactCache();
+    }
+    else
+    {
+        delete w->contact_cache;
+        w->contact_cache = NULL;
+        factor = 0;
+    }
+    w->qs.warm_starting = factor;
+}
+
+
+dReal dWorldGetQuickStepWarmStarting (dWorldID w)
+{
+    dAASSERT(w);
+    return w->qs.warm_starting;
+}
+
+
+void dWorldSetContactReuse (dWorldID w, int steps, dReal distance)
+{
+    dAASSERT(w);
+    dUASSERT (steps >= 0,"contact reuse steps must be >= 0");
+    dUASSERT (distance >= 0,"contact reuse distance must be >= 0");
+
+    // the kept contacts are dropped, they may have been found for other settings
+    delete w->contact_reuse;
+    w->contact_reuse = NULL;
+
+    if (steps > 0 && distance > 0)
+        w->contact_reuse = new dxContactReuse(steps, distance);
+}
+
+
+int dWorldGetContactReuseSteps (dWorldID w)
+{
+    dAASSERT(w);
+    return w->contact_reuse != NULL ? w->contact_reuse->maxsteps : 0;
+}
+
+
+dReal dWorldGetContactReuseDistance (dWorldID w)
+{
+    dAASSERT(w);
+    return w->contact_reuse != NULL ? w->contact_reuse->distance : 0;
+}
+
+
 void dWorldSetContactMaxCorrectingVel (dWorldID w, dReal vel)
 {
     dAASSERT(w);
@@ -36,6 +36,8 @@ ODE initialization/finalization code
 #include "odeou.h"
 #include "objects.h"
 #include "util.h"
+#include "quickstep_kernels.h"
+#include "collision_trimesh_batch.h"
 
 
 //****************************************************************************
@@ -280,6 +282,8 @@ static bool InitODEForMode(EODEINITMODE imInitMode)
                 break;
             }
             dInitColliders();
+            dxSelectQuickStepKernels();
+            dxSelectTrimeshBatchKernels();
         }
 
         bResult = true;
@@ -92,7 +92,11 @@ dxOSTerrainData::dxOSTerrainData() :	m_fWidth( 0 ),
 											m_nDepthSamples( 0 ),
 											m_bCopyHeightData( 0 ),
 											
-											m_pHeightData( NULL )
+											m_pHeightData( NULL ),
+
+											m_pCellNormals( NULL ),
+											m_pHeightPyramid( NULL ),
+											m_nPyramidLevels( 0 )
 {
 	memset( m_contacts, 0, sizeof( m_contacts ) );
 }
@@ -125,20 +129,166 @@ void dxOSTerrainData::SetData( int nWidthSamples, int nDepthSamples,
 
 
 // recomputes heights bounds
+// the top level of the height pyramid is a single block holding all cells
 void dxOSTerrainData::ComputeHeightBounds()
 {
-    int i;
-    dReal h;
+    dIASSERT( m_pHeightPyramid );
+    const float *top = m_pHeightPyramid + 2 * m_nPyramidLevelOffset[m_nPyramidLevels - 1];
+    m_fMinHeight = top[0];
+    m_fMaxHeight = top[1];
+}
+
+// (re)allocates and computes cell normals and the height pyramid for all cells
+void dxOSTerrainData::BuildCellData()
+{
+    delete [] m_pCellNormals;
+    delete [] m_pHeightPyramid;
+
+    int width = m_nWidthSamples - 1;
+    int depth = m_nDepthSamples - 1;
+
+    m_pCellNormals = new dReal[6 * width * depth];
+
+    int levels = 0;
+    int pairs = 0;
+    while (true)
+    {
+        dIASSERT( levels < OSTERRAINMAXPYRAMIDLEVELS );
+        m_nPyramidLevelOffset[levels] = pairs;
+        m_nPyramidLevelWidth[levels] = width;
+        m_nPyramidLevelDepth[levels] = depth;
+        pairs += width * depth;
+        levels++;
+        if (width == 1 && depth == 1)
+            break;
+        width = (width + 1) >> 1;
+        depth = (depth + 1) >> 1;
+    }
+    m_nPyramidLevels = levels;
+    m_pHeightPyramid = new float[2 * pairs];
+
+    UpdateCellData(0, 0, m_nWidthSamples - 1, m_nDepthSamples - 1);
+}
+
+// recomputes the data of all cells that have a corner in the given sample range
+void dxOSTerrainData::UpdateCellData(int minX, int minY, int maxX, int maxY)
+{
+    // cells x-1 and x share sample x
+    minX = dMAX(minX - 1, 0);
+    minY = dMAX(minY - 1, 0);
+    maxX = dMIN(maxX, m_nWidthSamples - 2);
+    maxY = dMIN(maxY, m_nDepthSamples - 2);
+    if (minX > maxX || minY > maxY)
+        return;
+
+    ComputeCellNormals(minX, minY, maxX, maxY);
+    ComputeHeightPyramid(minX, minY, maxX, maxY);
+    ComputeHeightBounds();
+}
+
+// computes normals of the cells in the given range
+// these must match the ones dCollideOSTerrainZone would get from the heights
+void dxOSTerrainData::ComputeCellNormals(int minX, int minY, int maxX, int maxY)
+{
+    for (int y = minY; y <= maxY; y++)
+    {
+        dReal *normals = m_pCellNormals + 6 * (minX + y * (m_nWidthSamples - 1));
+        for (int x = minX; x <= maxX; x++, normals += 6)
+        {
+            const dReal AHeight = GetHeightSafe(x, y);
+            const dReal BHeight = GetHeightSafe(x + 1, y);
+            const dReal CHeight = GetHeightSafe(x, y + 1);
+            const dReal DHeight = GetHeightSafe(x + 1, y + 1);
+
+            dV3CrossTerrain(normals, CHeight - DHeight, AHeight - CHeight);
+            dV3CrossTerrain(normals + 3, AHeight - BHeight, BHeight - DHeight);
+        }
+    }
+}
+
+// recomputes the pyramid blocks that hold cells of the given range
+void dxOSTerrainData::ComputeHeightPyramid(int minX, int minY, int maxX, int maxY)
+{
+    float *level = m_pHeightPyramid;
+    int width = m_nPyramidLevelWidth[0];
+
+    for (int y = minY; y <= maxY; y++)
+    {
+        const float *row = m_pHeightData + y * m_nWidthSamples;
+        const float *nextRow = row + m_nWidthSamples;
+        float *block = level + 2 * (minX + y * width);
+        for (int x = minX; x <= maxX; x++, block += 2)
+        {
+            float hmin = dMIN(row[x], row[x + 1]);
+            float hmax = dMAX(row[x], row[x + 1]);
+            hmin = dMIN(hmin, dMIN(nextRow[x], nextRow[x + 1]));
+            hmax = dMAX(hmax, dMAX(nextRow[x], nextRow[x + 1]));
+            block[0] = hmin;
+            block[1] = hmax;
+        }
+    }
+
+    for (int l = 1; l < m_nPyramidLevels; l++)
+    {
+        const float *below = level;
+        const int belowWidth = width;
+        const int belowDepth = m_nPyramidLevelDepth[l - 1];
 
-    m_fMinHeight = dInfinity;
-    m_fMaxHeight = -dInfinity;
-    int tot = m_nWidthSamples*m_nDepthSamples;
-    for (i=0; i < tot; i++)
+        level = m_pHeightPyramid + 2 * m_nPyramidLevelOffset[l];
+        width = m_nPyramidLevelWidth[l];
+
+        minX >>= 1;
+        minY >>= 1;
+        maxX >>= 1;
+        maxY >>= 1;
+
+        for (int y = minY; y <= maxY; y++)
+        {
+            float *block = level + 2 * (minX + y * width);
+            for (int x = minX; x <= maxX; x++, block += 2)
+            {
+                float hmin = dInfinity;
+                float hmax = -dInfinity;
+                for (int by = 2 * y; by <= 2 * y + 1 && by < belowDepth; by++)
+                {
+                    for (int bx = 2 * x; bx <= 2 * x + 1 && bx < belowWidth; bx++)
+                    {
+                        const float *child = below + 2 * (bx + by * belowWidth);
+                        hmin = dMIN(hmin, child[0]);
+                        hmax = dMAX(hmax, child[1]);
+                    }
+                }
+                block[0] = hmin;
+                block[1] = hmax;
+            }
+        }
+    }
+}
+
+// returns a height at least as high as all samples minX..maxX, minY..maxY
+// uses the pyramid level where the zone spans at most 3 blocks on each axis
+dReal dxOSTerrainData::GetZoneMaxHeight(int minX, int maxX, int minY, int maxY) const
+{
+    // cells of the zone
+    maxX--;
+    maxY--;
+
+    int span = dMAX(maxX - minX, maxY - minY) + 1;
+    int l = 0;
+    while (l + 1 < m_nPyramidLevels && (2 << l) <= span)
+        l++;
+
+    const float *level = m_pHeightPyramid + 2 * m_nPyramidLevelOffset[l];
+    const int width = m_nPyramidLevelWidth[l];
+
+    float hmax = -dInfinity;
+    for (int y = minY >> l; y <= (maxY >> l); y++)
     {
-        h = m_pHeightData[i];
-        if (h < m_fMinHeight)	m_fMinHeight = h;
-        if (h > m_fMaxHeight)	m_fMaxHeight = h;
+        const float *block = level + 2 * ((minX >> l) + y * width);
+        for (int x = minX >> l; x <= (maxX >> l); x++, block += 2)
+            hmax = dMAX(hmax, block[1]);
     }
+    return hmax;
 }
 
 // returns whether point is over terrain Cell triangle?
@@ -306,6 +456,8 @@ dxOSTerrainData::~dxOSTerrainData()
         dIASSERT( m_pHeightData );
         delete [] m_pHeightData;
     }
+    delete [] m_pCellNormals;
+    delete [] m_pHeightPyramid;
 }
 
 
@@ -457,8 +609,36 @@ ODE_API void dGeomOSTerrainDataBuild( dOSTerrainDataID d,
             sizeof( float ) * d->m_nWidthSamples * d->m_nDepthSamples );
     }
 
-    // Find height bounds
-    d->ComputeHeightBounds();
+    // Precompute cell normals and the height pyramid, and find height bounds
+    d->BuildCellData();
+}
+
+
+void dGeomOSTerrainDataUpdate( dOSTerrainDataID d, const float* pHeightData,
+                               int minX, int minY, int maxX, int maxY )
+{
+    dUASSERT( d, "Argument not OSTerrain data" );
+    dUASSERT( d->m_pHeightPyramid, "OSTerrain data not built" );
+
+    minX = dMAX( minX, 0 );
+    minY = dMAX( minY, 0 );
+    maxX = dMIN( maxX, d->m_nWidthSamples - 1 );
+    maxY = dMIN( maxY, d->m_nDepthSamples - 1 );
+    if ( minX > maxX || minY > maxY )
+        return;
+
+    if ( d->m_bCopyHeightData && pHeightData != NULL )
+    {
+        // copy the changed samples into our storage
+        for ( int y = minY; y <= maxY; y++ )
+        {
+            size_t first = (size_t)y * d->m_nWidthSamples + minX;
+            memcpy( (void*)(d->m_pHeightData + first), pHeightData + first,
+                sizeof( float ) * (maxX - minX + 1) );
+        }
+    }
+
+    d->UpdateCellData( minX, minY, maxX, maxY );
 }
 
 
@@ -794,12 +974,7 @@ int dxOSTerrain::dCollideOSTerrainZone( const int minX, const int maxX, const in
     bool isCCollide;
     bool isDCollide;
 
-    dReal dz1;
-    dReal dz2;
-
-    dReal AHeight;
     dReal BHeight;
-    dReal CHeight;
     dReal DHeight;
 
     dReal *plane;
@@ -810,6 +985,7 @@ int dxOSTerrain::dCollideOSTerrainZone( const int minX, const int maxX, const in
     {
         OSTerrainVertex *OSTerrainRow      = tempHeightBuffer[y_local];
         OSTerrainVertex *OSTerrainNextRow  = tempHeightBuffer[y_local + 1];
+        const dReal *cellNormals = m_p_data->GetCellNormals(minX, minY + y_local);
 
         // First A
         B = &OSTerrainRow[0];
@@ -823,14 +999,12 @@ int dxOSTerrain::dCollideOSTerrainZone( const int minX, const int maxX, const in
         isDCollide = DHeight > minO2Height;
         D->state = !(isDCollide);
 
-        for ( x_local = 0; x_local < maxX_local; x_local++)
+        for ( x_local = 0; x_local < maxX_local; x_local++, cellNormals += 6)
         {
             A = B;
-            AHeight = BHeight;
             isACollide = isBCollide;
 
             C = D;
-            CHeight = DHeight;
             isCCollide = isDCollide;
 
             B = &OSTerrainRow    [x_local + 1];
@@ -861,11 +1035,7 @@ int dxOSTerrain::dCollideOSTerrainZone( const int minX, const int maxX, const in
 
                 plane =  CurrTri->planeDef;
 
-                dz1 = CHeight - DHeight;
-                dz2 = AHeight - CHeight;
-
-                dV3CrossTerrain(plane, dz1, dz2);
-
+                dCopyVector3(plane, cellNormals);
                 plane[3] = dCalcVectorDot3(CurrTri->planeDef, C->vertex);
             }
 
@@ -887,11 +1057,7 @@ int dxOSTerrain::dCollideOSTerrainZone( const int minX, const int maxX, const in
 
                 plane =  CurrTri->planeDef;
 
-                dz1 = AHeight - BHeight;
-                dz2 = BHeight - DHeight;
-
-                dV3CrossTerrain(plane, dz1, dz2);
-
+                dCopyVector3(plane, cellNormals + 3);
                 plane[3] = dCalcVectorDot3(CurrTri->planeDef, B->vertex);
             }
         }
@@ -1304,8 +1470,10 @@ int dxOSTerrain::dCollideOSTerrainSphere(const int minX, const int maxX, const i
         topColide = true;
         botColide = true;
 
+        const dReal *cellNormals = m_p_data->GetCellNormals(minX, y);
+
         for (x = minX + 1, VtopColliedPtr = 1; x <= maxX;
-            x++, VtopColliedPtr++, tdist[0] -= REAL(1.0))
+            x++, VtopColliedPtr++, tdist[0] -= REAL(1.0), cellNormals += 6)
         {
             AHeight = BHeight;
             isACollide = isBCollide;
@@ -1354,9 +1522,7 @@ int dxOSTerrain::dCollideOSTerrainSphere(const int minX, const int maxX, const i
                     }
                     else
                     {
-                        dz1 = CHeight - DHeight;
-                        dz2 = AHeight - CHeight;
-                        dV3CrossTerrain(normA, dz1, dz2);
+                        dCopyVector3(normA, cellNormals);
 
                         k = dCalcVectorDot3(tdist, normA);
                         depth = radius - k;
@@ -1388,9 +1554,7 @@ int dxOSTerrain::dCollideOSTerrainSphere(const int minX, const int maxX, const i
                 {
                     if (isAorDCollide || isCCollide)
                     {
-                        dz1 = CHeight - DHeight;
-                        dz2 = AHeight - CHeight;
-                        dV3CrossTerrain(normA, dz1, dz2);
+                        dCopyVector3(normA, cellNormals);
 
                         k = dCalcVectorDot3(tdist, normA);
                         depth = radius - k;
@@ -1417,9 +1581,7 @@ int dxOSTerrain::dCollideOSTerrainSphere(const int minX, const int maxX, const i
 
                     if (isAorDCollide || isBCollide)
                     {
-                        dz1 = AHeight - BHeight;
-                        dz2 = BHeight - DHeight;
-                        dV3CrossTerrain(normB, dz1, dz2);
+                        dCopyVector3(normB, cellNormals + 3);
 
                         k = dCalcVectorDot3(tdist, normB);
                         depth = radius - k;
@@ -1627,6 +1789,221 @@ int dxOSTerrain::dCollideOSTerrainSphere(const int minX, const int maxX, const i
 }
 
 
+// ray against the cells it crosses
+// walks the cells under the ray in order (2D DDA), skipping whole blocks of the
+// height pyramid where the ray passes above or below all of their samples,
+// so the cost depends on the ray length and not on its AABB area.
+// hits are found in ray order, so the first one is the closest
+int dxOSTerrain::dCollideOSTerrainRay( const int minX, const int maxX, const int minY, const int maxY,
+                                        dxGeom* o2, const int numMaxContactsPossible,
+                                        int flags, dContactGeom* contact,
+                                        int skip )
+{
+    dIASSERT( o2->type == dRayClass );
+
+    const dxRay *ray = (dxRay*) o2;
+    const dReal *pos = ray->final_posr->pos;
+    const dReal *R = ray->final_posr->R;
+
+    const dReal offsetX = final_posr->pos[0] - m_p_data->m_fHalfWidth;
+    const dReal offsetY = final_posr->pos[1] - m_p_data->m_fHalfDepth;
+
+    // ray in sample coordinates
+    const dReal orig[3] = { pos[0] - offsetX, pos[1] - offsetY, pos[2] };
+    const dReal dir[3] = { R[2], R[6], R[10] };
+
+    // clip it to the zone
+    const dReal zoneMin[2] = { (dReal)minX, (dReal)minY };
+    const dReal zoneMax[2] = { (dReal)maxX, (dReal)maxY };
+    dReal tStart = 0;
+    dReal tEnd = ray->length;
+
+    for (int a = 0; a < 2; a++)
+    {
+        if (dir[a] == 0)
+        {
+            if (orig[a] < zoneMin[a] || orig[a] > zoneMax[a])
+                return 0;
+            continue;
+        }
+        dReal t0 = (zoneMin[a] - orig[a]) / dir[a];
+        dReal t1 = (zoneMax[a] - orig[a]) / dir[a];
+        if (t0 > t1)
+        {
+            const dReal tmp = t0;
+            t0 = t1;
+            t1 = tmp;
+        }
+        tStart = dMAX(tStart, t0);
+        tEnd = dMIN(tEnd, t1);
+    }
+    if (tStart > tEnd)
+        return 0;
+
+    const bool backfaceCull = (o2->gflags & RAY_BACKFACECULL) != 0;
+    const int numMaxContacts = (o2->gflags & (RAY_FIRSTCONTACT | RAY_CLOSEST_HIT)) ?
+        1 : numMaxContactsPossible;
+
+    const float *pyramid = m_p_data->m_pHeightPyramid;
+    const int topLevel = m_p_data->m_nPyramidLevels - 1;
+
+    int cx = (int)dFloor(orig[0] + tStart * dir[0]);
+    int cy = (int)dFloor(orig[1] + tStart * dir[1]);
+    cx = dMAX(dMIN(cx, maxX - 1), minX);
+    cy = dMAX(dMIN(cy, maxY - 1), minY);
+
+    int level = 0;
+    dReal t = tStart;
+    dReal lastHit = -dInfinity;
+    int numTerrainContacts = 0;
+
+    while (true)
+    {
+        const int bx = cx >> level;
+        const int by = cy >> level;
+
+        // where the ray leaves the block
+        dReal tExitX = dInfinity;
+        dReal tExitY = dInfinity;
+        if (dir[0] > 0)
+            tExitX = (((bx + 1) << level) - orig[0]) / dir[0];
+        else if (dir[0] < 0)
+            tExitX = ((bx << level) - orig[0]) / dir[0];
+        if (dir[1] > 0)
+            tExitY = (((by + 1) << level) - orig[1]) / dir[1];
+        else if (dir[1] < 0)
+            tExitY = ((by << level) - orig[1]) / dir[1];
+
+        const dReal tExit = dMIN(tExitX, tExitY);
+        const dReal tOut = dMIN(tExit, tEnd);
+
+        const dReal zIn = orig[2] + t * dir[2];
+        const dReal zOut = orig[2] + tOut * dir[2];
+        const float *block = pyramid + 2 * (m_p_data->m_nPyramidLevelOffset[level] +
+            bx + by * m_p_data->m_nPyramidLevelWidth[level]);
+
+        if (dMIN(zIn, zOut) > block[1] || dMAX(zIn, zOut) < block[0])
+        {
+            // ray passes all above or all below the block
+        }
+        else if (level > 0)
+        {
+            level--;
+            continue;
+        }
+        else
+        {
+            const dReal *cellNormals = m_p_data->GetCellNormals(cx, cy);
+            dReal hitDist[2];
+            const dReal *hitNormal[2];
+            int numHits = 0;
+
+            // triangle CAD has corner C at cx,cy+1, triangle BDA has corner B at cx+1,cy
+            for (int tri = 0; tri < 2; tri++)
+            {
+                const dReal *normal = cellNormals + 3 * tri;
+                const int vx = cx + tri;
+                const int vy = cy + 1 - tri;
+
+                const dReal k = dCalcVectorDot3(normal, dir);
+                if (k == 0)
+                    continue; // ray parallel to plane
+
+                // if alpha > 0 the starting point is below the plane
+                const dReal alpha = normal[0] * (vx - orig[0]) + normal[1] * (vy - orig[1]) +
+                    normal[2] * (m_p_data->GetHeightSafe(vx, vy) - orig[2]);
+                if (alpha > 0 && k > 0 && backfaceCull)
+                    continue;
+
+                const dReal dist = alpha / k;
+                if (dist < 0 || dist > ray->length)
+                    continue;
+                if (dist < t - OSTERRAINRAYEPSILON || dist > tOut + OSTERRAINRAYEPSILON)
+                    continue; // outside this cell
+
+                // CAD is the half of the cell where y is above x
+                const dReal side = (orig[1] + dist * dir[1] - cy) - (orig[0] + dist * dir[0] - cx);
+                if (tri == 0 ? side < -OSTERRAINRAYEPSILON : side > OSTERRAINRAYEPSILON)
+                    continue;
+
+                // on an edge the neighbour triangle may have reported it already
+                if (dFabs(dist - lastHit) < OSTERRAINRAYEPSILON)
+                    continue;
+                if (numHits == 1 && dFabs(dist - hitDist[0]) < OSTERRAINRAYEPSILON)
+                    continue;
+
+                hitDist[numHits] = dist;
+                hitNormal[numHits] = normal;
+                numHits++;
+            }
+
+            if (numHits == 2 && hitDist[1] < hitDist[0])
+            {
+                const dReal tmpDist = hitDist[0];
+                hitDist[0] = hitDist[1];
+                hitDist[1] = tmpDist;
+                const dReal *tmpNormal = hitNormal[0];
+                hitNormal[0] = hitNormal[1];
+                hitNormal[1] = tmpNormal;
+            }
+
+            for (int i = 0; i < numHits; i++)
+            {
+                dContactGeom *pContact = CONTACT(contact, numTerrainContacts*skip);
+                const dReal dist = hitDist[i];
+                pContact->pos[0] = pos[0] + dist * dir[0];
+                pContact->pos[1] = pos[1] + dist * dir[1];
+                pContact->pos[2] = pos[2] + dist * dir[2];
+                dCopyNegatedVector3(pContact->normal, hitNormal[i]);
+                pContact->depth = dist;
+                pContact->side1 = -1;
+                pContact->side2 = -1;
+                lastHit = dist;
+
+                numTerrainContacts++;
+                if (numTerrainContacts == numMaxContacts)
+                    return numTerrainContacts;
+            }
+        }
+
+        if (tExit >= tEnd)
+            break;
+
+        // move to the cell where the ray enters the next block
+        if (tExitX <= tExitY)
+        {
+            cx = dir[0] > 0 ? (bx + 1) << level : (bx << level) - 1;
+            if (cx < minX || cx >= maxX)
+                break;
+        }
+        else
+        {
+            cx = (int)dFloor(orig[0] + tExit * dir[0]);
+            cx = dMAX(dMIN(cx, ((bx + 1) << level) - 1), bx << level);
+            cx = dMAX(dMIN(cx, maxX - 1), minX);
+        }
+        if (tExitY <= tExitX)
+        {
+            cy = dir[1] > 0 ? (by + 1) << level : (by << level) - 1;
+            if (cy < minY || cy >= maxY)
+                break;
+        }
+        else
+        {
+            cy = (int)dFloor(orig[1] + tExit * dir[1]);
+            cy = dMAX(dMIN(cy, ((by + 1) << level) - 1), by << level);
+            cy = dMAX(dMIN(cy, maxY - 1), minY);
+        }
+
+        t = tExit;
+        if (level < topLevel)
+            level++;
+    }
+
+    return numTerrainContacts;
+}
+
+
 int dCollideOSTerrain( dxGeom *o1, dxGeom *o2, int flags, dContactGeom* contact, int skip )
 {
     dIASSERT( skip >= (int)sizeof(dContactGeom) );
@@ -1689,6 +2066,10 @@ int dCollideOSTerrain( dxGeom *o1, dxGeom *o2, int flags, dContactGeom* contact,
 	nMaxY = dMIN( nMaxY, tdata->m_nDepthSamples - 1 );
     dIASSERT ((nMinX < nMaxX) && (nMinY < nMaxY));
 
+    // entirely above the terrain under it?
+    if(o2->aabb[4] > tdata->GetZoneMaxHeight(nMinX, nMaxX, nMinY, nMaxY))
+        return 0;
+
     dContactGeom *pContact;
 
     numMaxTerrainContacts = (flags & NUMC_MASK);
@@ -1699,6 +2080,12 @@ int dCollideOSTerrain( dxGeom *o1, dxGeom *o2, int flags, dContactGeom* contact,
             nMinX,nMaxX,nMinY,nMaxY,o2,numMaxTerrainContacts - numTerrainContacts,
             flags,CONTACT(contact,numTerrainContacts*skip),skip	);
     }
+    else if(o2->type == dRayClass)
+    {
+        numTerrainContacts = terrain->dCollideOSTerrainRay(
+            nMinX,nMaxX,nMinY,nMaxY,o2,numMaxTerrainContacts - numTerrainContacts,
+            flags,CONTACT(contact,numTerrainContacts*skip),skip	);
+    }
     else    
     {
         numTerrainContacts = terrain->dCollideOSTerrainZone(
@@ -14,8 +14,14 @@
 
 #define OSTERRAINPLAINEPSILON 1e-02F
 
+// tolerance, in cells, of ray hits on cell and triangle edges
+#define OSTERRAINRAYEPSILON 1e-04F
+
 #define OSTERRAINMAXCONTACTPERCELL 10
 
+// enough for any terrain size an int can index
+#define OSTERRAINMAXPYRAMIDLEVELS 32
+
 class OSTerrainVertex;
 class OSTerrainEdge;
 class OSTerrainTriangle;
@@ -43,7 +49,18 @@ struct dxOSTerrainData
     int m_bCopyHeightData;     // Do we own the sample data?
 
     const float* m_pHeightData; // Sample data array
-    
+
+    // Data derived from the heights, rebuilt by dGeomOSTerrainDataBuild and
+    // kept up to date by dGeomOSTerrainDataUpdate.
+    // Cell x,y is the square between samples x..x+1 and y..y+1.
+    dReal* m_pCellNormals;      // per cell the normals of its triangles CAD and BDA, 3 dReals each
+    float* m_pHeightPyramid;    // min,max height pairs of square blocks of cells. level 0 has a block
+                                // per cell, each level above has blocks of 2x2 blocks of the one below
+    int m_nPyramidLevels;
+    int m_nPyramidLevelOffset[OSTERRAINMAXPYRAMIDLEVELS];   // first pair of each level
+    int m_nPyramidLevelWidth[OSTERRAINMAXPYRAMIDLEVELS];    // blocks on X axis
+    int m_nPyramidLevelDepth[OSTERRAINMAXPYRAMIDLEVELS];    // blocks on Y axis
+
     dContactGeom            m_contacts[OSTERRAINMAXCONTACTPERCELL];
 
     dxOSTerrainData();
@@ -55,6 +72,17 @@ struct dxOSTerrainData
 
     void ComputeHeightBounds();
 
+    void BuildCellData();
+    void UpdateCellData(int minX, int minY, int maxX, int maxY);
+    void ComputeCellNormals(int minX, int minY, int maxX, int maxY);
+    void ComputeHeightPyramid(int minX, int minY, int maxX, int maxY);
+    dReal GetZoneMaxHeight(int minX, int maxX, int minY, int maxY) const;
+
+    const dReal* GetCellNormals(int x, int y) const
+    {
+        return m_pCellNormals + 6 * (x + y * (m_nWidthSamples - 1));
+    }
+
     bool IsOnOSTerrain2  ( const OSTerrainVertex * const CellCorner, 
         const dReal * const pos,  const bool isABC) const;
 
@@ -131,6 +159,9 @@ struct dxOSTerrain : public dxGeom
     int dCollideOSTerrainZone( const int minX, const int maxX, const int minZ, const int maxZ,  
         dxGeom *o2, const int numMaxContacts,
         int flags, dContactGeom *contact, int skip );
+    int dCollideOSTerrainRay( const int minX, const int maxX, const int minZ, const int maxZ,
+        dxGeom *o2, const int numMaxContacts,
+        int flags, dContactGeom *contact, int skip );
 
 	enum
 	{
@@ -33,6 +33,8 @@
 #include "lcp.h"
 #include "util.h"
 #include "threadingutils.h"
+#include "quickstep_kernels.h"
+#include "step_profile.h"
 
 #include <new>
 
@@ -123,27 +125,6 @@ inline unsigned int CalculateOptimalThreadsCount(unsigned int complexity, unsign
 #define dxDECODE_INDEX(code)    ((unsigned int)((code) - 1))
 #define dxHEAD_INDEX            0
 
-//****************************************************************************
-// special matrix multipliers
-
-// multiply block of B matrix (q x 6) with 12 dReal per row with C vector (q)
-static void Multiply1_12q1 (dReal *A, const dReal *B, const dReal *C, unsigned int q)
-{
-    dIASSERT (q>0 && A && B && C);
-
-    dZeroVector3(A);
-    dZeroVector3(A + 3);
-
-    dReal s;
-
-    for(unsigned int i = 0, k = 0; i < q; k += 12, i++)
-    {
-        s = C[i]; //C[i] and B[n+k] cannot overlap because its value has been read into a temporary.
-        dAddScaledVector3(A, &B[k], s);
-        dAddScaledVector3(A + 3, &B[k + 3], s);
-    }
-}
-
 //***************************************************************************
 // testing stuff
 
@@ -521,23 +502,21 @@ void compute_invM_JT (volatile atomicord32 *mi_storage, dReal *iMJ,
         size_t mi_offset = (size_t)mi * 12;
         dReal *iMJ_ptr = iMJ + mi_offset;
         const dReal *J_ptr = J + mi_offset;
-        dReal bm;
+        const dxQuickStepKernels *kernels = g_quickstep_kernels;
         while (true)
         {
             int b1 = jb[(size_t)mi*2];
             int b2 = jb[(size_t)mi*2+1];
 
-            bm = body[(unsigned)b1]->invMass;
-            dCopyScaledVector3(iMJ_ptr, J_ptr, bm);
             const dReal *invIrow1 = invI + 12*(size_t)(unsigned)b1;
-            dMultiply0_331 (iMJ_ptr + 3, invIrow1, J_ptr + 3);
-
             if (b2 != -1)
             {
-                bm = body[(unsigned)b2]->invMass;
-                dCopyScaledVector3(iMJ_ptr + 6, J_ptr + 6, bm);
                 const dReal *invIrow2 = invI + 12*(size_t)(unsigned)b2;
-                dMultiply0_331 (iMJ_ptr + 9, invIrow2, J_ptr + 9);
+                kernels->compute_invM_JT_row(iMJ_ptr, J_ptr, body[(unsigned)b1]->invMass, invIrow1, body[(unsigned)b2]->invMass, invIrow2);
+            }
+            else
+            {
+                kernels->compute_invM_JT_row(iMJ_ptr, J_ptr, body[(unsigned)b1]->invMass, invIrow1, REAL(0.0), NULL);
             }
         
             if (++mi == miend)
@@ -769,8 +748,10 @@ void dxQuickStepIsland(const dxStepperProcessingCallContext *callContext)
 //    if (allowedThreads == 1)
     {
         IFTIMING(dTimerStart("preprocessing"));
+        dxStepProfileMark(callContext->m_profileLap, dStepProfileStage0);
         dxQuickStepIsland_Stage0_Bodies(stage0BodiesCallContext);
         dxQuickStepIsland_Stage0_Joints(stage0JointsCallContext);
+        dxStepProfileMark(callContext->m_profileLap, dStepProfileStage1);
         dxQuickStepIsland_Stage1(stage1CallContext);
     }
 /*
@@ -798,6 +779,86 @@ void dxQuickStepIsland(const dxStepperProcessingCallContext *callContext)
 */
 }    
 
+// compute the inverse inertia tensor of a body in the global frame into invIrow
+// and add the gyroscopic torque to its torque accumulator
+static inline 
+void dxQuickStepBodyInertia(dReal *invIrow, dxBody *b, dReal h)
+{
+    dMatrix3 tmp;
+    // compute inverse inertia tensor in global frame
+    dMultiply2_333 (tmp,b->invI,b->posr.R);
+    dMultiply0_333 (invIrow,b->posr.R,tmp);
+
+    // Don't apply gyroscopic torques to bodies
+    // if not flagged or the body is kinematic
+    if ((b->flags & dxBodyGyroscopic)&& (b->invMass>0) && b->invMass < 1e6)
+    {
+        dMatrix3 I;
+        // compute inertia tensor in global frame
+        dMultiply2_333 (tmp,b->mass.I,b->posr.R);
+        dMultiply0_333 (I,b->posr.R,tmp);
+        // compute rotational force
+        if(b->invMass > 1e6)
+        {
+            // Explicit computation
+            dMultiply0_331 (tmp,I,b->avel);
+            dSubtractVectorCross3r4(b->tacc,b->avel,tmp);
+        }
+        else
+        {
+            // Do the implicit computation based on 
+            //"Stabilizing Gyroscopic Forces in Rigid Multibody Simulations"
+            // (Lacoursière 2006)
+            dVector3 L; // Compute angular momentum
+            dMultiply0_331(L,I,b->avel);
+
+            // Compute a new effective 'inertia tensor'
+            // for the implicit step: the cross-product 
+            // matrix of the angular momentum plus the
+            // old tensor scaled by the timestep.  
+            // Itild may not be symmetric pos-definite, 
+            // but we can still use it to compute implicit
+            // gyroscopic torques.
+            dMatrix3 Itild = {0};
+            dScaleVector3r4(tmp, L, h);
+            dSetCrossMatrixMinus(Itild , tmp, 4);
+            for (int ii = 0; ii < 12; ++ii)
+              Itild[ii] += I[ii];
+
+            // Scale momentum by inverse time to get 
+            // a sort of "torque"
+            dScaleVector3r4(L,dRecip(h)); 
+            // Invert the pseudo-tensor
+            dMatrix3 itInv;
+            // This is a closed-form inversion.
+            // It's probably not numerically stable
+            // when dealing with small masses with
+            // a large asymmetry.
+            // An LU decomposition might be better.
+            if (dInvertMatrix3(itInv,Itild)!=0)
+            {
+                // "Divide" the original tensor
+                // by the pseudo-tensor (on the right)
+                dMultiply0_333(Itild,I,itInv);
+                // Subtract an identity matrix
+                Itild[0]-=1; Itild[5]-=1; Itild[10]-=1;
+
+                // This new inertia matrix rotates the 
+                // momentum to get a new set of torques
+                // that will work correctly when applied
+                // to the old inertia matrix as explicit
+                // torques with a semi-implicit update
+                // step.
+                dVector3 tau0;
+                dMultiply0_331(tau0,Itild,L);
+                dAddVector3r4(b->tacc, tau0);
+                // Add the gyro torques to the torque 
+                // accumulator
+            }
+        }
+    }
+}
+
 static 
 int dxQuickStepIsland_Stage0_Bodies_Callback(void *_callContext, dcallindex_t callInstanceIndex, dCallReleaseeID callThisReleasee)
 {
@@ -877,85 +938,10 @@ void dxQuickStepIsland_Stage0_Bodies(dxQuickStepperStage0BodiesCallContext *call
     // accumulator. I and invI are a vertical stack of 3x4 matrices, one per body.
     {
         dReal *invI = callContext->m_invI;
+        dReal h = callContext->m_stepperCallContext->m_stepSize;
         unsigned int bodyIndex;
         while ((bodyIndex = ThrsafeIncrementIntUpToLimit(&callContext->m_inertiaBodyIndex, nb)) != nb) {
-            dReal *invIrow = invI + (size_t)bodyIndex * 12;
-            dxBody *b = body[bodyIndex];
-
-            dMatrix3 tmp;
-            // compute inverse inertia tensor in global frame
-            dMultiply2_333 (tmp,b->invI,b->posr.R);
-            dMultiply0_333 (invIrow,b->posr.R,tmp);
-
-            // Don't apply gyroscopic torques to bodies
-            // if not flagged or the body is kinematic
-            if ((b->flags & dxBodyGyroscopic)&& (b->invMass>0) && b->invMass < 1e6)
-            {
-                dMatrix3 I;
-                // compute inertia tensor in global frame
-                dMultiply2_333 (tmp,b->mass.I,b->posr.R);
-                dMultiply0_333 (I,b->posr.R,tmp);
-                // compute rotational force
-                if(b->invMass > 1e6)
-                {
-                    // Explicit computation
-                    dMultiply0_331 (tmp,I,b->avel);
-                    dSubtractVectorCross3r4(b->tacc,b->avel,tmp);
-                }
-                else
-                {
-                    // Do the implicit computation based on 
-                    //"Stabilizing Gyroscopic Forces in Rigid Multibody Simulations"
-                    // (Lacoursière 2006)
-                    dReal h = callContext->m_stepperCallContext->m_stepSize; // Step size
-                    dVector3 L; // Compute angular momentum
-                    dMultiply0_331(L,I,b->avel);
-
-                    // Compute a new effective 'inertia tensor'
-                    // for the implicit step: the cross-product 
-                    // matrix of the angular momentum plus the
-                    // old tensor scaled by the timestep.  
-                    // Itild may not be symmetric pos-definite, 
-                    // but we can still use it to compute implicit
-                    // gyroscopic torques.
-                    dMatrix3 Itild = {0};
-                    dScaleVector3r4(tmp, L, h);
-                    dSetCrossMatrixMinus(Itild , tmp, 4);
-                    for (int ii = 0; ii < 12; ++ii)
-                      Itild[ii] += I[ii];
-
-                    // Scale momentum by inverse time to get 
-                    // a sort of "torque"
-                    dScaleVector3r4(L,dRecip(h)); 
-                    // Invert the pseudo-tensor
-                    dMatrix3 itInv;
-                    // This is a closed-form inversion.
-                    // It's probably not numerically stable
-                    // when dealing with small masses with
-                    // a large asymmetry.
-                    // An LU decomposition might be better.
-                    if (dInvertMatrix3(itInv,Itild)!=0)
-                    {
-                        // "Divide" the original tensor
-                        // by the pseudo-tensor (on the right)
-                        dMultiply0_333(Itild,I,itInv);
-                        // Subtract an identity matrix
-                        Itild[0]-=1; Itild[5]-=1; Itild[10]-=1;
-
-                        // This new inertia matrix rotates the 
-                        // momentum to get a new set of torques
-                        // that will work correctly when applied
-                        // to the old inertia matrix as explicit
-                        // torques with a semi-implicit update
-                        // step.
-                        dVector3 tau0;
-                        dMultiply0_331(tau0,Itild,L);
-                        dAddVector3r4(b->tacc, tau0);
-                        // Add the gyro torques to the torque 
-                        // accumulator
-                    }
-                }
-            }
+            dxQuickStepBodyInertia(invI + (size_t)bodyIndex * 12, body[bodyIndex], h);
         }
     }
 }
@@ -1101,10 +1087,12 @@ void dxQuickStepIsland_Stage1(dxQuickStepperStage1CallContext *stage1CallContext
 //        if (allowedThreads == 1)
         {
             IFTIMING (dTimerNow ("create J"));
+            dxStepProfileMark(callContext->m_profileLap, dStepProfileStage2);
             dxQuickStepIsland_Stage2a(stage2CallContext);
             IFTIMING (dTimerNow ("compute rhs_tmp"));
             dxQuickStepIsland_Stage2b(stage2CallContext);
             dxQuickStepIsland_Stage2c(stage2CallContext);
+            dxStepProfileMark(callContext->m_profileLap, dStepProfileStage3);
             dxQuickStepIsland_Stage3(stage3CallContext);
         }
 /*
@@ -1479,6 +1467,7 @@ void dxQuickStepIsland_Stage3(dxQuickStepperStage3CallContext *stage3CallContext
 
 //        if (singleThreadedExecution)
         {
+            dxStepProfileMark(callContext->m_profileLap, dStepProfileStage4);
             dxQuickStepIsland_Stage4a(stage4CallContext);
 
             IFTIMING (dTimerNow ("solving LCP problem"));
@@ -1489,6 +1478,7 @@ void dxQuickStepIsland_Stage3(dxQuickStepperStage3CallContext *stage3CallContext
             
             dxWorld *world = callContext->m_world;
             const unsigned int num_iterations = world->qs.num_iterations;
+            unsigned int iterations_done = 0;
 
             if (IsSORConstraintsReorderRequiredForIteration(0)) {
                 stage4CallContext->ResetSOR_ConstraintsReorderVariables(0);
@@ -1500,6 +1490,7 @@ void dxQuickStepIsland_Stage3(dxQuickStepperStage3CallContext *stage3CallContext
 //                    stage4CallContext->ResetSOR_ConstraintsReorderVariables(0);
 //                    dxQuickStepIsland_Stage4LCP_ConstraintsShuffling(stage4CallContext, iteration);
 //                }
+                ++iterations_done;
                 if(dxQuickStepIsland_Stage4LCP_STIteration(stage4CallContext,true) < REAL(0.0001))
                     break;
             }
@@ -1511,10 +1502,14 @@ void dxQuickStepIsland_Stage3(dxQuickStepperStage3CallContext *stage3CallContext
 //                    stage4CallContext->ResetSOR_ConstraintsReorderVariables(0);
 //                    dxQuickStepIsland_Stage4LCP_ConstraintsShuffling(stage4CallContext, iteration);
 //                }
+                ++iterations_done;
                 if(dxQuickStepIsland_Stage4LCP_STIteration(stage4CallContext,false) < REAL(0.0001))
                     break;
             }
 
+            if (callContext->m_profileLap != NULL)
+                world->profiler->AddLCP(m, iterations_done);
+
             dxQuickStepIsland_Stage4b(stage4CallContext);
             dxQuickStepIsland_Stage5(stage5CallContext);
         }
@@ -2518,25 +2513,16 @@ dReal dxQuickStepIsland_Stage4LCP_IterationStep(dxQuickStepperStage4CallContext
     size_t index_offset = (size_t)index*12;
     dReal delta;
 
+    const dxQuickStepKernels *kernels = g_quickstep_kernels;
+
     {
   //      const dReal *cfm = localContext->m_cfm;
   //      delta = rhs[index] - old_lambda * cfm[index];
-        delta = rhs[index];
-
-        dReal *J = localContext->m_J;
-        const dReal *J_ptr = J + index_offset;
-        // @@@ potential optimization: SIMD-ize this and the b2 >= 0 case
-
-        delta -= dCalcVectorDot3(fc_ptr1, J_ptr);
-        delta -= dCalcVectorDot3(fc_ptr1 + 3, J_ptr + 3);
-        // @@@ potential optimization: handle 1-body constraints in a separate
-        //     loop to avoid the cost of test & jump?
         if (b2 != -1)
-        {
             fc_ptr2 = fc + 6*(size_t)(unsigned)b2;
-            delta -= dCalcVectorDot3(fc_ptr2, J_ptr + 6);
-            delta -= dCalcVectorDot3(fc_ptr2 + 3, J_ptr + 9);
-        }
+
+        dReal *J = localContext->m_J;
+        delta = kernels->row_delta(rhs[index], J + index_offset, fc_ptr1, fc_ptr2);
     }
 
     {
@@ -2585,30 +2571,28 @@ dReal dxQuickStepIsland_Stage4LCP_IterationStep(dxQuickStepperStage4CallContext
 
     {
         dReal *iMJ = stage4CallContext->m_iMJ;
-        const dReal *iMJ_ptr = iMJ + index_offset;
         // update fc.
-        // @@@ potential optimization: SIMD for this and the b2 >= 0 case
-        dAddScaledVector3(fc_ptr1, iMJ_ptr, delta);
-        dAddScaledVector3(fc_ptr1 + 3, iMJ_ptr + 3, delta);
-        // @@@ potential optimization: handle 1-body constraints in a separate
-        //     loop to avoid the cost of test & jump?
-        if (fc_ptr2)
-        {
-            dAddScaledVector3(fc_ptr2, iMJ_ptr + 6, delta);
-            dAddScaledVector3(fc_ptr2 + 3, iMJ_ptr + 9, delta);
-        }
+        kernels->row_update(fc_ptr1, fc_ptr2, iMJ + index_offset, delta);
     }
     return dFabs(lambda[index] - old_lambda);
 }
 
+// contact joints carry their lambdas to the next step in dxJoint::lambda,
+// see contact_cache.h
 static inline 
-bool IsStage4bJointInfosIterationRequired(const dxQuickStepperLocalContext *localContext)
+bool IsContactWarmStartingEnabled(const dxWorld *world)
+{
+    return world->qs.warm_starting > 0 && world->contact_cache != NULL;
+}
+
+static inline 
+bool IsStage4bJointInfosIterationRequired(const dxWorld *world, const dxQuickStepperLocalContext *localContext)
 {
     return 
 #ifdef WARM_STARTING
         true ||      
 #endif
-        localContext->m_mfb > 0;
+        localContext->m_mfb > 0 || IsContactWarmStartingEnabled(world);
 }
 
 static 
@@ -2621,7 +2605,7 @@ int dxQuickStepIsland_Stage4LCP_IterationSync_Callback(void *_stage4CallContext,
     const dxQuickStepperLocalContext *localContext = stage4CallContext->m_localContext;
     
      unsigned int stage4b_allowedThreads = 1;
-    if (IsStage4bJointInfosIterationRequired(localContext)) {
+    if (IsStage4bJointInfosIterationRequired(callContext->m_world, localContext)) {
         unsigned int allowedThreads = callContext->m_stepperAllowedThreads;
         dIASSERT(allowedThreads >= stage4b_allowedThreads);
         stage4b_allowedThreads += CalculateOptimalThreadsCount<dxQUICKSTEPISLAND_STAGE4B_STEP>(localContext->m_nj, allowedThreads - stage4b_allowedThreads);
@@ -2662,6 +2646,46 @@ void dxQuickStepIsland_Stage4MID(dxQuickStepperStage4CallContext *stage4CallCont
             dCopyScaledVector3(cforceMIDcurr, cforcecurr, stepsize);
             dCopyScaledVector3(cforceMIDcurr + 3, cforcecurr + 3, stepsize);
         }
+
+#ifndef WARM_STARTING
+        dxWorld *world = callContext->m_world;
+        if (IsContactWarmStartingEnabled(world))
+        {
+            // start the velocity solve of contacts from the impulses they had
+            // last step. joint->lambda is swapped for the position solve result
+            // so Stage4b can tell what the velocity solve added
+            const dReal factor = world->qs.warm_starting;
+            const dxQuickStepKernels *kernels = g_quickstep_kernels;
+            dReal *lambda = stage4CallContext->m_lambda;
+            const dReal *iMJ = stage4CallContext->m_iMJ;
+            const int *jb = localContext->m_jb;
+            const unsigned int *mindex = localContext->m_mindex;
+            const dJointWithInfo1 *jointinfos = localContext->m_jointinfos;
+            unsigned int nj = localContext->m_nj;
+
+            for (unsigned int ji = 0; ji != nj; ++ji)
+            {
+                dxJoint *joint = jointinfos[ji].joint;
+                if (joint->type() != dJointTypeContact)
+                    continue;
+
+                unsigned int index = mindex[2 * (size_t)ji];
+                unsigned int infom = jointinfos[ji].info.m;
+                for (unsigned int j = 0; j != infom; ++index, ++j)
+                {
+                    dReal warm = joint->lambda[j] * factor;
+                    joint->lambda[j] = lambda[index];
+                    if (warm != 0)
+                    {
+                        lambda[index] += warm;
+                        int b2 = jb[(size_t)index * 2 + 1];
+                        kernels->row_update(cforce + 6 * (size_t)(unsigned)jb[(size_t)index * 2],
+                            b2 != -1 ? cforce + 6 * (size_t)(unsigned)b2 : NULL, iMJ + (size_t)index * 12, warm);
+                    }
+                }
+            }
+        }
+#endif
 /*
         dSetZero(cforce,(size_t)nb * 6);
         dReal *lambda = stage4CallContext->m_lambda;
@@ -2707,7 +2731,9 @@ void dxQuickStepIsland_Stage4b(dxQuickStepperStage4CallContext *stage4CallContex
     // note that the SOR method overwrites rhs and J at this point, so
     // they should not be used again.
 
-    if (IsStage4bJointInfosIterationRequired(localContext)) {
+    dxWorld *world = callContext->m_world;
+    if (IsStage4bJointInfosIterationRequired(world, localContext)) {
+        const bool warmStarting = IsContactWarmStartingEnabled(world);
         dReal data[6];
         dReal *Jcopy = localContext->m_Jcopy;
         const dReal *lambda = stage4CallContext->m_lambda;
@@ -2733,6 +2759,14 @@ void dxQuickStepIsland_Stage4b(dxQuickStepperStage4CallContext *stage4CallContex
                 unsigned int infom = jicurr->info.m;
 #ifdef WARM_STARTING
                 memcpy(joint->lambda, lambdacurr, infom * sizeof(dReal));
+#else
+                if (warmStarting && joint->type() == dJointTypeContact) {
+                    // keep only what the velocity solve added, Stage4MID left the
+                    // position solve lambdas in joint->lambda
+                    for (unsigned int j = 0; j != infom; ++j) {
+                        joint->lambda[j] = lambdacurr[j] - joint->lambda[j];
+                    }
+                }
 #endif
 
                 // straightforward computation of joint constraint forces:
@@ -2740,13 +2774,13 @@ void dxQuickStepIsland_Stage4b(dxQuickStepperStage4CallContext *stage4CallContex
                 // where feedback was requested
                 dJointFeedback *fb = joint->feedback;
                 if (fb != NULL) {
-                    Multiply1_12q1 (data, Jcopyrow, lambdacurr, infom);
+                    g_quickstep_kernels->multiply1_12q1 (data, Jcopyrow, lambdacurr, infom);
                     dCopyVector3(fb->f1, data);
                     dCopyVector3(fb->t1, data + 3);
 
                     if (joint->node[1].body)
                     {
-                        Multiply1_12q1 (data, Jcopyrow+6, lambdacurr, infom);
+                        g_quickstep_kernels->multiply1_12q1 (data, Jcopyrow+6, lambdacurr, infom);
                         dCopyVector3(fb->f2, data);
                         dCopyVector3(fb->t2, data + 3);
                     }
@@ -2784,6 +2818,8 @@ void dxQuickStepIsland_Stage5(dxQuickStepperStage5CallContext *stage5CallContext
     stage5CallContext = NULL; // WARNING! stage3CallContext is not valid after this point!
     dIVERIFY(stage5CallContext == NULL); // To suppress unused variable assignment warnings
 
+    dxStepProfileMark(callContext->m_profileLap, dStepProfileStage5);
+
     dxQuickStepperStage6CallContext *stage6CallContext = (dxQuickStepperStage6CallContext *)memarena->AllocateBlock(sizeof(dxQuickStepperStage6CallContext));
     stage6CallContext->Initialize(callContext, localContext);
 
@@ -2792,6 +2828,7 @@ void dxQuickStepIsland_Stage5(dxQuickStepperStage5CallContext *stage5CallContext
 
 //    if (allowedThreads == 1) {
         IFTIMING (dTimerNow ("compute velocity update"));
+        dxStepProfileMark(callContext->m_profileLap, dStepProfileStage6);
         dxQuickStepIsland_Stage6a(stage6CallContext);
         dxQuickStepIsland_Stage6_VelocityCheck(stage6CallContext);
         IFTIMING (dTimerNow ("update position and tidy up"));
@@ -3001,6 +3038,40 @@ void dxQuickStepIsland_Stage6c(dxQuickStepperStage6CallContext *stage6CallContex
     }
 }
 
+// Step islands of one body and no joints.
+// This is what dxQuickStepIsland does for such an island (stages 0, 6a and 6b
+// with m == 0), without the memory arena, call contexts and threaded call
+// that every island costs. The results are the same.
+/*extern */
+void dxQuickStepFreeBodies(dxWorld *world, dxBody * const *body, unsigned int nb, dReal stepsize)
+{
+    const dReal *gravity = world->gravity;
+    dxBody *const *const bodyend = body + nb;
+    for (dxBody *const *bodycurr = body; bodycurr != bodyend; bodycurr++)
+    {
+        dxBody *b = *bodycurr;
+        b->tag = 0;
+
+        if ((b->flags & dxBodyNoGravity) == 0)
+        {
+            dAddScaledVector3r4(b->facc, gravity, b->mass.mass);
+        }
+
+        dMatrix3 invI;
+        dxQuickStepBodyInertia(invI, b, stepsize);
+
+        // add stepsize * invM * fe to the body velocity
+        dReal body_invMass_mul_stepsize = stepsize * b->invMass;
+        dAddScaledVector3r4(b->lvel, b->facc, body_invMass_mul_stepsize);
+        dScaleVector3r4(b->tacc, stepsize);
+        dMultiplyAdd0_331 (b->avel, invI, b->tacc);
+
+        dxStepBody (b,stepsize);
+        dSetZero (b->facc,3);
+        dSetZero (b->tacc,3);
+    }
+}
+
 #ifdef USE_CG_LCP
 static size_t EstimateGR_LCPMemoryRequirements(unsigned int m)
 {
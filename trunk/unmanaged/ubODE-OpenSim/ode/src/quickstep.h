@@ -34,6 +34,7 @@ unsigned dxEstimateQuickStepMaxCallCount(
     unsigned activeThreadCount, unsigned allowedThreadCount);
 
 void dxQuickStepIsland(const dxStepperProcessingCallContext *callContext);
+void dxQuickStepFreeBodies(dxWorld *world, dxBody * const *body, unsigned int nb, dReal stepsize);
 
 
 #endif
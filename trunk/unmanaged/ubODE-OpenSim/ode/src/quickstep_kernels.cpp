@@ -0,0 +1,280 @@
+/*************************************************************************
+ *                                                                       *
+ * Open Dynamics Engine, Copyright (C) 2001,2002 Russell L. Smith.       *
+ * All rights reserved.  Email: russ@q12.org   Web: www.q12.org          *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of EITHER:                                  *
+ *   (1) The GNU Lesser General Public License as published by the Free  *
+ *       Software Foundation; either version 2.1 of the License, or (at  *
+ *       your option) any later version. The text of the GNU Lesser      *
+ *       General Public License is included with this library in the     *
+ *       file LICENSE.TXT.                                               *
+ *   (2) The BSD-style license that is included with this library in     *
+ *       the file LICENSE-BSD.TXT.                                       *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+ * LICENSE.TXT and LICENSE-BSD.TXT for more details.                     *
+ *                                                                       *
+ *************************************************************************/
+
+
+// quickstep solver kernels with run time selection (see quickstep_kernels.h)
+
+#include <ode/common.h>
+#include <ode/odemath.h>
+#include "config.h"
+#include "error.h"
+#include "quickstep_kernels.h"
+
+#if defined(dSINGLE) && (defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64))
+#define dxQUICKSTEP_SSE_KERNELS 1
+#else
+#define dxQUICKSTEP_SSE_KERNELS 0
+#endif
+
+#if dxQUICKSTEP_SSE_KERNELS
+#include <xmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// 32 bit gcc builds may not be compiled for SSE. The SSE kernels are only
+// called after the CPU was checked, so build just them for it.
+#if defined(__GNUC__) && !defined(__SSE__)
+#define dxSSE_KERNEL __attribute__((target("sse")))
+#else
+#define dxSSE_KERNEL
+#endif
+#endif
+
+
+//****************************************************************************
+// scalar kernels
+
+static void Multiply1_12q1_Scalar (dReal *A, const dReal *B, const dReal *C, unsigned int q)
+{
+    dIASSERT (q>0 && A && B && C);
+
+    dZeroVector3(A);
+    dZeroVector3(A + 3);
+
+    dReal s;
+
+    for(unsigned int i = 0, k = 0; i < q; k += 12, i++)
+    {
+        s = C[i]; //C[i] and B[n+k] cannot overlap because its value has been read into a temporary.
+        dAddScaledVector3(A, &B[k], s);
+        dAddScaledVector3(A + 3, &B[k + 3], s);
+    }
+}
+
+static void ComputeInvMJTRow_Scalar (dReal *iMJ_row, const dReal *J_row, 
+    dReal invMass1, const dReal *invI1, dReal invMass2, const dReal *invI2)
+{
+    dCopyScaledVector3(iMJ_row, J_row, invMass1);
+    dMultiply0_331 (iMJ_row + 3, invI1, J_row + 3);
+
+    if (invI2 != NULL)
+    {
+        dCopyScaledVector3(iMJ_row + 6, J_row + 6, invMass2);
+        dMultiply0_331 (iMJ_row + 9, invI2, J_row + 9);
+    }
+}
+
+static dReal RowDelta_Scalar (dReal rhs, const dReal *J_row, const dReal *fc1, const dReal *fc2)
+{
+    dReal delta = rhs;
+
+    delta -= dCalcVectorDot3(fc1, J_row);
+    delta -= dCalcVectorDot3(fc1 + 3, J_row + 3);
+    if (fc2 != NULL)
+    {
+        delta -= dCalcVectorDot3(fc2, J_row + 6);
+        delta -= dCalcVectorDot3(fc2 + 3, J_row + 9);
+    }
+    return delta;
+}
+
+static void RowUpdate_Scalar (dReal *fc1, dReal *fc2, const dReal *iMJ_row, dReal delta)
+{
+    dAddScaledVector3(fc1, iMJ_row, delta);
+    dAddScaledVector3(fc1 + 3, iMJ_row + 3, delta);
+    if (fc2 != NULL)
+    {
+        dAddScaledVector3(fc2, iMJ_row + 6, delta);
+        dAddScaledVector3(fc2 + 3, iMJ_row + 9, delta);
+    }
+}
+
+static const dxQuickStepKernels g_scalar_kernels =
+{
+    &Multiply1_12q1_Scalar,
+    &ComputeInvMJTRow_Scalar,
+    &RowDelta_Scalar,
+    &RowUpdate_Scalar,
+    "scalar"
+};
+
+
+//****************************************************************************
+// SSE kernels
+//
+// fc holds 6 dReal per body, so the 12 values (fc1, fc2) used by one row are
+// gathered in 3 registers matching the 3 quarters of the J and iMJ rows:
+// fc1[0..3], (fc1[4..5], fc2[0..1]) and fc2[2..5].
+// compute_invM_JT, the fc update and Multiply1_12q1 do the same operations in
+// the same order as the scalar code and give the same results. The row delta
+// adds the 12 products in a different order so it may differ in the last bits.
+
+#if dxQUICKSTEP_SSE_KERNELS
+
+dxSSE_KERNEL
+static void Multiply1_12q1_SSE (dReal *A, const dReal *B, const dReal *C, unsigned int q)
+{
+    dIASSERT (q>0 && A && B && C);
+
+    __m128 a0 = _mm_setzero_ps();
+    __m128 a1 = _mm_setzero_ps();
+
+    for(unsigned int i = 0, k = 0; i < q; k += 12, i++)
+    {
+        __m128 s = _mm_set1_ps(C[i]);
+        a0 = _mm_add_ps(a0, _mm_mul_ps(s, _mm_loadu_ps(B + k)));
+        // only 2 more values: B may be the second half of the last row
+        a1 = _mm_add_ps(a1, _mm_mul_ps(s, _mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)(B + k + 4))));
+    }
+
+    _mm_storeu_ps(A, a0);
+    _mm_storel_pi((__m64 *)(A + 4), a1);
+}
+
+// (l0, l1) to res[0..1] and (l2, a0, a1, a2) to res[2..5]
+dxSSE_KERNEL
+static inline void StoreLinearAngular (dReal *res, __m128 l, __m128 a)
+{
+    _mm_storel_pi((__m64 *)res, l);
+    __m128 t = _mm_shuffle_ps(a, l, _MM_SHUFFLE(2, 2, 0, 0)); // a0 a0 l2 l2
+    _mm_storeu_ps(res + 2, _mm_shuffle_ps(t, a, _MM_SHUFFLE(2, 1, 0, 2)));
+}
+
+// res(3) = invI * j(3) for a body inverse inertia stored as 3 padded rows
+dxSSE_KERNEL
+static inline __m128 MultiplyInertia (const dReal *invI, const dReal *j)
+{
+    __m128 c0 = _mm_loadu_ps(invI);
+    __m128 c1 = _mm_loadu_ps(invI + 4);
+    __m128 c2 = _mm_loadu_ps(invI + 8);
+    __m128 c3 = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+    __m128 res = _mm_mul_ps(c0, _mm_set1_ps(j[0]));
+    res = _mm_add_ps(res, _mm_mul_ps(c1, _mm_set1_ps(j[1])));
+    res = _mm_add_ps(res, _mm_mul_ps(c2, _mm_set1_ps(j[2])));
+    return res;
+}
+
+dxSSE_KERNEL
+static void ComputeInvMJTRow_SSE (dReal *iMJ_row, const dReal *J_row, 
+    dReal invMass1, const dReal *invI1, dReal invMass2, const dReal *invI2)
+{
+    __m128 l = _mm_mul_ps(_mm_loadu_ps(J_row), _mm_set1_ps(invMass1));
+    StoreLinearAngular(iMJ_row, l, MultiplyInertia(invI1, J_row + 3));
+
+    if (invI2 != NULL)
+    {
+        l = _mm_mul_ps(_mm_loadu_ps(J_row + 6), _mm_set1_ps(invMass2));
+        StoreLinearAngular(iMJ_row + 6, l, MultiplyInertia(invI2, J_row + 9));
+    }
+}
+
+dxSSE_KERNEL
+static dReal RowDelta_SSE (dReal rhs, const dReal *J_row, const dReal *fc1, const dReal *fc2)
+{
+    __m128 f1 = _mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)(fc1 + 4));
+    __m128 sum = _mm_mul_ps(_mm_loadu_ps(fc1), _mm_loadu_ps(J_row));
+
+    if (fc2 != NULL)
+    {
+        f1 = _mm_loadh_pi(f1, (const __m64 *)fc2);
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(fc2 + 2), _mm_loadu_ps(J_row + 8)));
+    }
+    // J_row[6..7] of a single body row are zero, as are the matching f1 lanes
+    sum = _mm_add_ps(sum, _mm_mul_ps(f1, _mm_loadu_ps(J_row + 4)));
+
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 1, 1, 1)));
+    return rhs - _mm_cvtss_f32(sum);
+}
+
+dxSSE_KERNEL
+static void RowUpdate_SSE (dReal *fc1, dReal *fc2, const dReal *iMJ_row, dReal delta)
+{
+    __m128 d = _mm_set1_ps(delta);
+
+    __m128 f = _mm_loadu_ps(fc1);
+    _mm_storeu_ps(fc1, _mm_add_ps(f, _mm_mul_ps(d, _mm_loadu_ps(iMJ_row))));
+
+    f = _mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)(fc1 + 4));
+    if (fc2 != NULL)
+    {
+        f = _mm_loadh_pi(f, (const __m64 *)fc2);
+        f = _mm_add_ps(f, _mm_mul_ps(d, _mm_loadu_ps(iMJ_row + 4)));
+        _mm_storel_pi((__m64 *)(fc1 + 4), f);
+        _mm_storeh_pi((__m64 *)fc2, f);
+
+        f = _mm_loadu_ps(fc2 + 2);
+        _mm_storeu_ps(fc2 + 2, _mm_add_ps(f, _mm_mul_ps(d, _mm_loadu_ps(iMJ_row + 8))));
+    }
+    else
+    {
+        // iMJ_row[6..11] is not set for single body rows, only use 2 values
+        __m128 m = _mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)(iMJ_row + 4));
+        _mm_storel_pi((__m64 *)(fc1 + 4), _mm_add_ps(f, _mm_mul_ps(d, m)));
+    }
+}
+
+static const dxQuickStepKernels g_sse_kernels =
+{
+    &Multiply1_12q1_SSE,
+    &ComputeInvMJTRow_SSE,
+    &RowDelta_SSE,
+    &RowUpdate_SSE,
+    "SSE"
+};
+
+static bool CPUHasSSE()
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    return true; // SSE is part of the x86-64 base instruction set
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 25)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse") != 0;
+#endif
+}
+
+#endif // dxQUICKSTEP_SSE_KERNELS
+
+
+//****************************************************************************
+// selection
+
+const dxQuickStepKernels *g_quickstep_kernels = &g_scalar_kernels;
+
+void dxSelectQuickStepKernels()
+{
+    const dxQuickStepKernels *kernels = &g_scalar_kernels;
+
+#if dxQUICKSTEP_SSE_KERNELS
+    if (CPUHasSSE())
+        kernels = &g_sse_kernels;
+#endif
+
+    g_quickstep_kernels = kernels;
+}
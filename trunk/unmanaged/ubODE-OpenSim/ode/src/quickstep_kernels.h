@@ -0,0 +1,62 @@
+/*************************************************************************
+ *                                                                       *
+ * Open Dynamics Engine, Copyright (C) 2001,2002 Russell L. Smith.       *
+ * All rights reserved.  Email: russ@q12.org   Web: www.q12.org          *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of EITHER:                                  *
+ *   (1) The GNU Lesser General Public License as published by the Free  *
+ *       Software Foundation; either version 2.1 of the License, or (at  *
+ *       your option) any later version. The text of the GNU Lesser      *
+ *       General Public License is included with this library in the     *
+ *       file LICENSE.TXT.                                               *
+ *   (2) The BSD-style license that is included with this library in     *
+ *       the file LICENSE-BSD.TXT.                                       *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+ * LICENSE.TXT and LICENSE-BSD.TXT for more details.                     *
+ *                                                                       *
+ *************************************************************************/
+
+
+// Inner kernels of the quickstep solver, working on 12 dReal constraint rows
+// (linear and angular parts for body 1, then for body 2).
+// A scalar and, on x86 single precision builds, an SSE version of each kernel
+// exist. The version to use is selected once at library initialization from
+// the features of the CPU the library runs on, so one binary can run on any
+// processor.
+
+#ifndef _ODE_QUICKSTEP_KERNELS_H_
+#define _ODE_QUICKSTEP_KERNELS_H_
+
+#include <ode/common.h>
+
+
+struct dxQuickStepKernels
+{
+    // A(6) = B' * C for a block of q rows of B with 12 dReal per row
+    void (*multiply1_12q1)(dReal *A, const dReal *B, const dReal *C, unsigned int q);
+
+    // iMJ row = inv(M) * J row. invI2 is NULL for a single body constraint
+    void (*compute_invM_JT_row)(dReal *iMJ_row, const dReal *J_row, 
+        dReal invMass1, const dReal *invI1, dReal invMass2, const dReal *invI2);
+
+    // returns rhs - J row * (fc1, fc2). fc2 is NULL for a single body constraint
+    dReal (*row_delta)(dReal rhs, const dReal *J_row, const dReal *fc1, const dReal *fc2);
+
+    // (fc1, fc2) += delta * iMJ row. fc2 is NULL for a single body constraint
+    void (*row_update)(dReal *fc1, dReal *fc2, const dReal *iMJ_row, dReal delta);
+
+    const char *name;
+};
+
+// kernels in use. valid (scalar) even before dxSelectQuickStepKernels() is called
+extern const dxQuickStepKernels *g_quickstep_kernels;
+
+// pick the fastest kernels the CPU supports. called from library initialization
+void dxSelectQuickStepKernels();
+
+
+#endif
@@ -0,0 +1,172 @@
+/*************************************************************************
+ *                                                                       *
+ * Open Dynamics Engine, Copyright (C) 2001,2002 Russell L. Smith.       *
+ * All rights reserved.  Email: russ@q12.org   Web: www.q12.org          *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of EITHER:                                  *
+ *   (1) The GNU Lesser General Public License as published by the Free  *
+ *       Software Foundation; either version 2.1 of the License, or (at  *
+ *       your option) any later version. The text of the GNU Lesser      *
+ *       General Public License is included with this library in the     *
+ *       file LICENSE.TXT.                                               *
+ *   (2) The BSD-style license that is included with this library in     *
+ *       the file LICENSE-BSD.TXT.                                       *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+ * LICENSE.TXT and LICENSE-BSD.TXT for more details.                     *
+ *                                                                       *
+ *************************************************************************/
+
+
+#include <ode/common.h>
+#include <ode/objects.h>
+#include "config.h"
+#include "objects.h"
+#include "step_profile.h"
+
+#include <string.h>
+#include <algorithm>
+
+#ifdef WIN32
+#include "windows.h"
+#else
+#include <time.h>
+#endif
+
+
+// moving averages are taken over about this many steps
+#define dxSTEPPROFILE_AVERAGE_STEPS 32
+
+
+duint64 dxStepProfileNow()
+{
+#ifdef WIN32
+    static LARGE_INTEGER frequency;
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (duint64)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (duint64)ts.tv_sec * 1000000000u + (duint64)ts.tv_nsec;
+#endif
+}
+
+
+static inline 
+unsigned StepProfileIslandSizeClass(unsigned bodies)
+{
+    unsigned sizeClass = 0;
+    for (unsigned limit = 1; bodies > limit && sizeClass != dSTEPPROFILE_ISLAND_SIZE_CLASSES - 1; limit <<= 1) {
+        ++sizeClass;
+    }
+    return sizeClass;
+}
+
+// moving average that is a plain mean until it has seen enough samples
+static inline 
+double StepProfileAverage(double average, double sample, unsigned samples)
+{
+    unsigned weight = samples < dxSTEPPROFILE_AVERAGE_STEPS ? samples : dxSTEPPROFILE_AVERAGE_STEPS;
+    return average + (sample - average) / (double)weight;
+}
+
+
+dxStepProfiler::dxStepProfiler()
+{
+    Reset();
+}
+
+void dxStepProfiler::Reset()
+{
+    // all members are plain data
+    memset(this, 0, sizeof(*this));
+}
+
+void dxStepProfiler::AddIsland(unsigned bodies, duint64 time)
+{
+    unsigned sizeClass = StepProfileIslandSizeClass(bodies);
+    ThrsafeAdd(&m_islandTime[sizeClass], (atomicord32)time);
+    ThrsafeAdd(&m_islandCount[sizeClass], 1);
+    ThrsafeAdd(&m_time[dStepProfileIsland], (atomicord32)time);
+    ThrsafeAdd(&m_count[dStepProfileIsland], 1);
+}
+
+void dxStepProfiler::EndStep()
+{
+    unsigned steps = ++m_steps;
+    float *history = m_history[(steps - 1) % dSTEPPROFILE_WINDOW];
+
+    for (unsigned part = 0; part != dStepProfileCount; ++part) {
+        double seconds = (double)m_time[part] * 1e-9;
+        m_last[part] = seconds;
+        m_lastCount[part] = m_count[part];
+        m_average[part] = StepProfileAverage(m_average[part], seconds, steps);
+        history[part] = (float)seconds;
+        m_time[part] = 0;
+        m_count[part] = 0;
+    }
+
+    m_lastLcpRows = m_lcpRows;
+    m_lastLcpIterations = m_lcpIterations;
+    m_lcpIterationsAverage = StepProfileAverage(m_lcpIterationsAverage, (double)m_lcpIterations, steps);
+    m_lcpRows = 0;
+    m_lcpIterations = 0;
+
+    for (unsigned sizeClass = 0; sizeClass != dSTEPPROFILE_ISLAND_SIZE_CLASSES; ++sizeClass) {
+        unsigned count = m_islandCount[sizeClass];
+        double seconds = (double)m_islandTime[sizeClass] * 1e-9;
+        m_lastIslandCount[sizeClass] = count;
+        m_lastIslandTime[sizeClass] = seconds;
+        if (count != 0) {
+            unsigned samples = ++m_islandSamples[sizeClass];
+            m_islandAverage[sizeClass] = StepProfileAverage(m_islandAverage[sizeClass], seconds / count, samples);
+        }
+        m_islandTime[sizeClass] = 0;
+        m_islandCount[sizeClass] = 0;
+    }
+}
+
+void dxStepProfiler::GetProfile(dWorldStepProfile *profile) const
+{
+    memset(profile, 0, sizeof(*profile));
+
+    unsigned window = m_steps < dSTEPPROFILE_WINDOW ? m_steps : dSTEPPROFILE_WINDOW;
+    profile->steps = m_steps;
+    profile->window = window;
+
+    float samples[dSTEPPROFILE_WINDOW];
+    for (unsigned part = 0; part != dStepProfileCount; ++part) {
+        dStepProfileTiming *timing = profile->stage + part;
+        timing->last = m_last[part];
+        timing->count = m_lastCount[part];
+        timing->average = m_average[part];
+
+        if (window != 0) {
+            for (unsigned i = 0; i != window; ++i) {
+                samples[i] = m_history[i][part];
+            }
+            std::sort(samples, samples + window);
+            timing->p50 = samples[(window - 1) * 50 / 100];
+            timing->p90 = samples[(window - 1) * 90 / 100];
+            timing->p99 = samples[(window - 1) * 99 / 100];
+            timing->max = samples[window - 1];
+        }
+    }
+
+    profile->lcp_rows = m_lastLcpRows;
+    profile->lcp_iterations = m_lastLcpIterations;
+    profile->lcp_iterations_average = m_lcpIterationsAverage;
+
+    for (unsigned sizeClass = 0; sizeClass != dSTEPPROFILE_ISLAND_SIZE_CLASSES; ++sizeClass) {
+        profile->island_count[sizeClass] = m_lastIslandCount[sizeClass];
+        profile->island_time[sizeClass] = m_lastIslandTime[sizeClass];
+        profile->island_average[sizeClass] = m_islandAverage[sizeClass];
+    }
+}
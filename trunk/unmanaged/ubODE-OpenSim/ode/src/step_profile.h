@@ -0,0 +1,137 @@
+/*************************************************************************
+ *                                                                       *
+ * Open Dynamics Engine, Copyright (C) 2001,2002 Russell L. Smith.       *
+ * All rights reserved.  Email: russ@q12.org   Web: www.q12.org          *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of EITHER:                                  *
+ *   (1) The GNU Lesser General Public License as published by the Free  *
+ *       Software Foundation; either version 2.1 of the License, or (at  *
+ *       your option) any later version. The text of the GNU Lesser      *
+ *       General Public License is included with this library in the     *
+ *       file LICENSE.TXT.                                               *
+ *   (2) The BSD-style license that is included with this library in     *
+ *       the file LICENSE-BSD.TXT.                                       *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+ * LICENSE.TXT and LICENSE-BSD.TXT for more details.                     *
+ *                                                                       *
+ *************************************************************************/
+
+
+// Step profiler. Records the wall time of the parts of a world step and
+// keeps short histories of them for dWorldGetStepProfile.
+//
+// Times are added up during a step in nanoseconds, with atomic adds since
+// islands may be stepped by several threads. EndStep, called by the stepping
+// function on its own thread once all islands are done, moves the sums into
+// the history. A 32 bit sum limits a part to about 4 seconds per step.
+
+#ifndef _ODE_STEP_PROFILE_H_
+#define _ODE_STEP_PROFILE_H_
+
+#include <ode/common.h>
+#include <ode/objects.h>
+#include "objects.h"
+#include "threadingutils.h"
+
+
+// monotonic clock, in nanoseconds
+duint64 dxStepProfileNow();
+
+
+struct dxStepProfiler : public dBase
+{
+    dxStepProfiler();
+
+    void Reset();
+
+    void AddTime(unsigned part, duint64 start)
+    {
+        ThrsafeAdd(&m_time[part], (atomicord32)(dxStepProfileNow() - start));
+        ThrsafeAdd(&m_count[part], 1);
+    }
+
+    void AddIsland(unsigned bodies, duint64 time);
+
+    void AddLCP(unsigned rows, unsigned iterations)
+    {
+        ThrsafeAdd(&m_lcpRows, rows);
+        ThrsafeAdd(&m_lcpIterations, iterations);
+    }
+
+    void EndStep();
+    void GetProfile(dWorldStepProfile *profile) const;
+
+    // this step so far
+    volatile atomicord32 m_time[dStepProfileCount];
+    volatile atomicord32 m_count[dStepProfileCount];
+    volatile atomicord32 m_islandTime[dSTEPPROFILE_ISLAND_SIZE_CLASSES];
+    volatile atomicord32 m_islandCount[dSTEPPROFILE_ISLAND_SIZE_CLASSES];
+    volatile atomicord32 m_lcpRows, m_lcpIterations;
+
+    // previous steps
+    unsigned m_steps;
+    double m_last[dStepProfileCount];
+    unsigned m_lastCount[dStepProfileCount];
+    double m_average[dStepProfileCount];
+    float m_history[dSTEPPROFILE_WINDOW][dStepProfileCount]; // ring, indexed by m_steps
+    unsigned m_lastLcpRows, m_lastLcpIterations;
+    double m_lcpIterationsAverage;
+    unsigned m_lastIslandCount[dSTEPPROFILE_ISLAND_SIZE_CLASSES];
+    double m_lastIslandTime[dSTEPPROFILE_ISLAND_SIZE_CLASSES];
+    double m_islandAverage[dSTEPPROFILE_ISLAND_SIZE_CLASSES];
+    unsigned m_islandSamples[dSTEPPROFILE_ISLAND_SIZE_CLASSES];
+
+    duint64 m_collisionStart;   // 0 if not in collision
+};
+
+
+// Times one island through the stepper stages. The stepper marks the start
+// of each stage; the time since the previous mark goes to the previous stage.
+// Each island call context has its own, so marks need no synchronization.
+struct dxStepProfileLap
+{
+    void BeginIsland(dxStepProfiler *profiler, unsigned bodies)
+    {
+        m_profiler = profiler;
+        m_bodies = bodies;
+        m_stage = dStepProfileCount;
+        m_islandStart = m_stageStart = dxStepProfileNow();
+    }
+
+    void Mark(unsigned stage)
+    {
+        duint64 now = dxStepProfileNow();
+        if (m_stage != dStepProfileCount) {
+            ThrsafeAdd(&m_profiler->m_time[m_stage], (atomicord32)(now - m_stageStart));
+            ThrsafeAdd(&m_profiler->m_count[m_stage], 1);
+        }
+        m_stage = stage;
+        m_stageStart = now;
+    }
+
+    void EndIsland()
+    {
+        Mark(dStepProfileCount);
+        m_profiler->AddIsland(m_bodies, m_stageStart - m_islandStart);
+    }
+
+    dxStepProfiler *m_profiler;
+    duint64 m_islandStart, m_stageStart;
+    unsigned m_stage;   // dStepProfileCount before the first mark
+    unsigned m_bodies;
+};
+
+static inline 
+void dxStepProfileMark(dxStepProfileLap *lap, unsigned stage)
+{
+    if (lap != NULL) {
+        lap->Mark(stage);
+    }
+}
+
+
+#endif // #ifndef _ODE_STEP_PROFILE_H_
@@ -54,13 +54,13 @@
 #endif
 
 
-#if !HAVE_CLOCK_GETTIME
+// Premake builds do not run the configure check for clock_gettime. Any
+// system whose <time.h> defines CLOCK_MONOTONIC already provides it.
+#if !HAVE_CLOCK_GETTIME && !defined(CLOCK_MONOTONIC)
 
 #include <sys/time.h>
 
-#if !defined(CLOCK_MONOTONIC)
 #define CLOCK_MONOTONIC 2
-#endif
 
 static inline 
 int clock_gettime(int clock_type, timespec *ts)
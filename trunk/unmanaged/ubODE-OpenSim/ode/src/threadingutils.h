@@ -147,5 +147,29 @@ size_t ThrsafeIncrementSizeUpToLimit(volatile size_t *storagePointer, size_t lim
 }
 
 
+// loads and stores of a value other threads may access at the same time,
+// atomic but not ordered with other memory accesses
+static inline 
+atomicord32 ThrsafeLoadRelaxed(const volatile atomicord32 *paoSource)
+{
+#if defined(__GNUC__)
+    return __atomic_load_n(paoSource, __ATOMIC_RELAXED);
+#else
+    // aligned 32 bit volatile accesses are atomic with MSVC
+    return *paoSource;
+#endif
+}
+
+static inline 
+void ThrsafeStoreRelaxed(volatile atomicord32 *paoDestination, atomicord32 aoValue)
+{
+#if defined(__GNUC__)
+    __atomic_store_n(paoDestination, aoValue, __ATOMIC_RELAXED);
+#else
+    *paoDestination = aoValue;
+#endif
+}
+
+
 
 #endif // _ODE_THREADINGUTILS_H_
@@ -26,6 +26,7 @@
 #include "joints/joint.h"
 #include "util.h"
 #include "threadingutils.h"
+#include "step_profile.h"
 
 #include <new>
 
@@ -387,6 +388,9 @@ struct dxSingleIslandCallContext
         m_stepperArena(stepperArena), m_arenaInitialState(arenaInitialState), 
         m_stepperCallContext(islandsProcessingContext->m_world, islandsProcessingContext->m_stepSize, islandsProcessingContext->m_stepperAllowedThreads, stepperArena, islandBodiesStart, islandJointsStart)
     {
+        if (islandsProcessingContext->m_world->profiler != NULL) {
+            m_stepperCallContext.m_profileLap = &m_profileLap;
+        }
     }
 
     void AssignIslandSearchProgress(size_t islandIndex)
@@ -413,11 +417,25 @@ struct dxSingleIslandCallContext
         m_stepperCallContext.AssignStepperCallFinalReleasee(finalReleasee);
     }
 
+    // steppers are allowed a single thread (see dxProcessIslands) and do all
+    // the work of an island in the call, so the lap is over when it returns
+    void CallStepper(dstepper_fn_t stepper)
+    {
+        if (m_stepperCallContext.m_profileLap == NULL) {
+            stepper(&m_stepperCallContext);
+        } else {
+            m_profileLap.BeginIsland(m_stepperCallContext.m_world->profiler, m_stepperCallContext.m_islandBodiesCount);
+            stepper(&m_stepperCallContext);
+            m_profileLap.EndIsland();
+        }
+    }
+
     dxIslandsProcessingCallContext  *m_islandsProcessingContext;
     size_t                          m_islandIndex;
     dxWorldProcessMemArena          *m_stepperArena;
     void                            *m_arenaInitialState;
     dxStepperProcessingCallContext  m_stepperCallContext;
+    dxStepProfileLap                m_profileLap;
 };
 
 
@@ -426,9 +444,12 @@ struct dxSingleIslandCallContext
 
 void dInternalHandleAutoDisabling (dxWorld *world, dReal stepsize)
 {
-    dxBody *bb;
-    for ( bb=world->firstbody; bb; bb=(dxBody*)bb->next )
+    // only awake bodies can go to sleep. walk the awake list backwards so
+    // bodies disabled here (swapped out with the last entry) don't hide others
+    for ( unsigned i = world->awake_count; i-- != 0; )
     {
+        dxBody *bb = world->awake_bodies[i];
+
         // don't freeze objects mid-air (patch 1586738)
         if ( bb->firstjoint == NULL ) continue;
 
@@ -533,7 +554,7 @@ void dInternalHandleAutoDisabling (dxWorld *world, dReal stepsize)
         // disable the body if it's idle for a long enough time
         if ( bb->adis_stepsleft <= 0 && bb->adis_timeleft <= 0 )
         {
-            bb->flags |= dxBodyDisabled; // set the disable flag
+            dxBodySetDisabled(bb); // set the disable flag
 
             // disabling bodies should also include resetting the velocity
             // should prevent jittering in big "islands"
@@ -644,18 +665,8 @@ void dxStepBody (dxBody *b, dReal h)
     dSafeNormalize4(b->q);
     dQtoR (b->q, b->posr.R);
 
-    // notify all attached geoms that this body has moved
-    dxWorldProcessContext *world_process_context = b->world->UnsafeGetWorldProcessingContext(); 
-    for (dxGeom *geom = b->geom; geom; geom = dGeomGetBodyNext (geom))
-    {
-        world_process_context->LockForStepbodySerialization();
-        dGeomMoved (geom);
-        world_process_context->UnlockForStepbodySerialization();
-    }
-
-    // notify the user
-    if (b->moved_callback != NULL)
-        b->moved_callback(b);
+    // attached geoms and the user are notified later by dxNotifyBodyMoved(),
+    // once all islands are stepped
 
     // damping
     if (b->flags & dxBodyLinearDamping)
@@ -681,6 +692,23 @@ void dxStepBody (dxBody *b, dReal h)
 }
 
 
+// notify all attached geoms and the user that body b has moved.
+// this is not done in dxStepBody() because islands may be stepped by several
+// threads at once: dGeomMoved() reorders the space dirty lists and the moved
+// callback is user code. running both on the thread that called the step
+// function, in island order, keeps them serial and makes the next collision
+// pass independent of the number of threads used.
+
+void dxNotifyBodyMoved (dxBody *b)
+{
+    for (dxGeom *geom = b->geom; geom; geom = dGeomGetBodyNext (geom))
+        dGeomMoved (geom);
+
+    if (b->moved_callback != NULL)
+        b->moved_callback(b);
+}
+
+
 //****************************************************************************
 // island processing
 
@@ -712,7 +740,7 @@ static size_t EstimateIslandProcessingMemoryRequirements(dxWorld *world)
 
 static size_t BuildIslandsAndEstimateStepperMemoryRequirements(
     dxWorldProcessIslandsInfo &islandsinfo, dxWorldProcessMemArena *memarena, 
-    dxWorld *world, dReal stepsize, dmemestimate_fn_t stepperestimate)
+    dxWorld *world, dReal stepsize, dmemestimate_fn_t stepperestimate, bool separateFreeBodies)
 {
     size_t maxreq = 0;
 
@@ -727,6 +755,9 @@ static size_t BuildIslandsAndEstimateStepperMemoryRequirements(
     // make arrays for body and joint lists (for a single island) to go into
     dxBody **body = memarena->AllocateArray<dxBody *>(nb);
     dxJoint **joint = memarena->AllocateArray<dxJoint *>(nj);
+    // free bodies are put at the end of the body array, growing down, so they
+    // never overlap the islands
+    dxBody **freebody = body + nb;
 
     BEGIN_STATE_SAVE(memarena, stackstate) {
         // allocate a stack of unvisited bodies in the island. the maximum size of
@@ -736,81 +767,97 @@ static size_t BuildIslandsAndEstimateStepperMemoryRequirements(
         unsigned int stackalloc = (nj < nb) ? nj : nb;
         dxBody **stack = memarena->AllocateArray<dxBody *>(stackalloc);
 
-        {
-            // set all body/joint tags to 0
-            for (dxBody *b=world->firstbody; b; b=(dxBody*)b->next) b->tag = 0;
-            for (dxJoint *j=world->firstjoint; j; j=(dxJoint*)j->next) j->tag = 0;
+        // objects are visited in this search if their island_stamp is the new
+        // world stamp. this replaces resetting the tag of every body and joint,
+        // so a world of mostly sleeping bodies is not walked in full each step
+        unsigned stamp = ++world->island_stamp;
+        if (stamp == 0) {
+            for (dxBody *b=world->firstbody; b; b=(dxBody*)b->next) b->island_stamp = 0;
+            for (dxJoint *j=world->firstjoint; j; j=(dxJoint*)j->next) j->island_stamp = 0;
+            stamp = world->island_stamp = 1;
         }
 
+        // seeds are taken from the awake bodies, in world body list order,
+        // so islands come out the same as from a search of the whole list
+        world->SortAwakeBodies();
+
         sizescurr = islandsizes;
         dxBody **bodystart = body;
         dxJoint **jointstart = joint;
-        for (dxBody *bb=world->firstbody; bb; bb=(dxBody*)bb->next) {
-            // get bb = the next enabled, untagged body, and tag it
-            if (!bb->tag) {
-                if (!(bb->flags & dxBodyDisabled)) {
-                    bb->tag = 1;
-
-                    dxBody **bodycurr = bodystart;
-                    dxJoint **jointcurr = jointstart;
-
-                    // tag all bodies and joints starting from bb.
-                    *bodycurr++ = bb;
-
-                    unsigned int stacksize = 0;
-                    dxBody *b = bb;
-
-                    while (true) {
-                        // traverse and tag all body's joints, add untagged connected bodies
-                        // to stack
-                        for (dxJointNode *n=b->firstjoint; n; n=n->next) {
-                            dxJoint *njoint = n->joint;
-                            if (!njoint->tag) {
-                                if (njoint->isEnabled()) {
-                                    njoint->tag = 1;
-                                    *jointcurr++ = njoint;
-
-                                    dxBody *nbody = n->body;
-                                    // Body disabled flag is not checked here. This is how auto-enable works.
-                                    if (nbody && nbody->tag <= 0) {
-                                        nbody->tag = 1;
-                                        // Make sure all bodies are in the enabled state.
-                                        nbody->flags &= ~dxBodyDisabled;
-                                        stack[stacksize++] = nbody;
-                                    }
-                                } else {
-                                    njoint->tag = -1; // Used in Step to prevent search over disabled joints (not needed for QuickStep so far)
+        // bodies enabled by the search are appended to awake_bodies, which may
+        // move it. they are already visited, so index it and stop at the old count
+        for (unsigned seed = 0, seedcount = world->awake_count; seed != seedcount; ++seed) {
+            dxBody *bb = world->awake_bodies[seed];
+            // get bb = the next enabled, unvisited body, and tag it
+            if (bb->island_stamp != stamp) {
+                bb->island_stamp = stamp;
+                bb->tag = 1;
+
+                dxBody **bodycurr = bodystart;
+                dxJoint **jointcurr = jointstart;
+
+                // tag all bodies and joints starting from bb.
+                *bodycurr++ = bb;
+
+                unsigned int stacksize = 0;
+                dxBody *b = bb;
+
+                while (true) {
+                    // traverse and tag all body's joints, add untagged connected bodies
+                    // to stack
+                    for (dxJointNode *n=b->firstjoint; n; n=n->next) {
+                        dxJoint *njoint = n->joint;
+                        if (njoint->island_stamp != stamp) {
+                            njoint->island_stamp = stamp;
+                            if (njoint->isEnabled()) {
+                                njoint->tag = 1;
+                                *jointcurr++ = njoint;
+
+                                dxBody *nbody = n->body;
+                                // Body disabled flag is not checked here. This is how auto-enable works.
+                                if (nbody && nbody->island_stamp != stamp) {
+                                    nbody->island_stamp = stamp;
+                                    nbody->tag = 1;
+                                    // Make sure all bodies are in the enabled state.
+                                    dxBodySetEnabled(nbody);
+                                    stack[stacksize++] = nbody;
                                 }
+                            } else {
+                                njoint->tag = -1; // Used in Step to prevent search over disabled joints (not needed for QuickStep so far)
                             }
                         }
-                        dIASSERT(stacksize <= (unsigned int)world->nb);
-                        dIASSERT(stacksize <= (unsigned int)world->nj);
-
-                        if (stacksize == 0) {
-                            break;
-                        }
-
-                        b = stack[--stacksize];	// pop body off stack
-                        *bodycurr++ = b;	// put body on body list
                     }
+                    dIASSERT(stacksize <= (unsigned int)world->nb);
+                    dIASSERT(stacksize <= (unsigned int)world->nj);
 
-                    unsigned int bcount = (unsigned int)(bodycurr - bodystart);
-                    unsigned int jcount = (unsigned int)(jointcurr - jointstart);
-                    dIASSERT((size_t)(bodycurr - bodystart) <= (size_t)UINT_MAX);
-                    dIASSERT((size_t)(jointcurr - jointstart) <= (size_t)UINT_MAX);
+                    if (stacksize == 0) {
+                        break;
+                    }
 
-                    sizescurr[dxISE_BODIES_COUNT] = bcount;
-                    sizescurr[dxISE_JOINTS_COUNT] = jcount;
-                    sizescurr += dxISE__MAX;
+                    b = stack[--stacksize];	// pop body off stack
+                    *bodycurr++ = b;	// put body on body list
+                }
 
-                    size_t islandreq = stepperestimate(bodystart, bcount, jointstart, jcount);
-                    maxreq = (maxreq > islandreq) ? maxreq : islandreq;
+                unsigned int bcount = (unsigned int)(bodycurr - bodystart);
+                unsigned int jcount = (unsigned int)(jointcurr - jointstart);
+                dIASSERT((size_t)(bodycurr - bodystart) <= (size_t)UINT_MAX);
+                dIASSERT((size_t)(jointcurr - jointstart) <= (size_t)UINT_MAX);
 
-                    bodystart = bodycurr;
-                    jointstart = jointcurr;
-                } else {
-                    bb->tag = -1; // Not used so far (assigned to retain consistency with joints)
+                if (separateFreeBodies && jcount == 0) {
+                    dIASSERT(bcount == 1);
+                    *--freebody = bb;
+                    continue;
                 }
+
+                sizescurr[dxISE_BODIES_COUNT] = bcount;
+                sizescurr[dxISE_JOINTS_COUNT] = jcount;
+                sizescurr += dxISE__MAX;
+
+                size_t islandreq = stepperestimate(bodystart, bcount, jointstart, jcount);
+                maxreq = (maxreq > islandreq) ? maxreq : islandreq;
+
+                bodystart = bodycurr;
+                jointstart = jointcurr;
             }
         }
     } END_STATE_SAVE(memarena, stackstate);
@@ -818,32 +865,38 @@ static size_t BuildIslandsAndEstimateStepperMemoryRequirements(
 # ifndef dNODEBUG
     // if debugging, check that all objects (except for disabled bodies,
     // unconnected joints, and joints that are connected to disabled bodies)
-    // were tagged.
+    // were visited, and that the awake list matches the body flags.
     {
+        unsigned stamp = world->island_stamp;
+        unsigned awake = 0;
         for (dxBody *b=world->firstbody; b; b=(dxBody*)b->next) {
             if (b->flags & dxBodyDisabled) {
-                if (b->tag > 0) dDebug (0,"disabled body tagged");
+                if (b->island_stamp == stamp) dDebug (0,"disabled body tagged");
+                if (b->awake_index != -1) dDebug (0,"disabled body in awake list");
             }
             else {
-                if (b->tag <= 0) dDebug (0,"enabled body not tagged");
+                if (b->island_stamp != stamp) dDebug (0,"enabled body not tagged");
+                if (b->awake_index < 0 || world->awake_bodies[b->awake_index] != b) dDebug (0,"enabled body not in awake list");
+                awake++;
             }
         }
+        if (awake != world->awake_count) dDebug (0,"awake list has wrong size");
         for (dxJoint *j=world->firstjoint; j; j=(dxJoint*)j->next) {
             if ( (( j->node[0].body && (j->node[0].body->flags & dxBodyDisabled)==0 ) ||
                 (j->node[1].body && (j->node[1].body->flags & dxBodyDisabled)==0) )
                 && 
                 j->isEnabled() ) {
-                    if (j->tag <= 0) dDebug (0,"attached enabled joint not tagged");
+                    if (j->island_stamp != stamp || j->tag <= 0) dDebug (0,"attached enabled joint not tagged");
             }
             else {
-                if (j->tag > 0) dDebug (0,"unattached or disabled joint tagged");
+                if (j->island_stamp == stamp && j->tag > 0) dDebug (0,"unattached or disabled joint tagged");
             }
         }
     }
 # endif
 
     size_t islandcount = ((size_t)(sizescurr - islandsizes) / dxISE__MAX);
-    islandsinfo.AssignInfo(islandcount, islandsizes, body, joint);
+    islandsinfo.AssignInfo(islandcount, islandsizes, body, joint, freebody, (unsigned int)(body + nb - freebody));
 
     return maxreq;
 }
@@ -873,7 +926,8 @@ static unsigned EstimateIslandProcessingSimultaneousCallsMaximumCount(unsigned a
 // bodies will not be included in the simulation. disabled bodies are
 // re-enabled if they are found to be part of an active island.
 bool dxProcessIslands (dxWorld *world, const dxWorldProcessIslandsInfo &islandsInfo, 
-    dReal stepSize, dstepper_fn_t stepper, dmaxcallcountestimate_fn_t maxCallCountEstimator)
+    dReal stepSize, dstepper_fn_t stepper, dfreebodiesstepper_fn_t freeBodiesStepper/*=NULL*/, 
+    dmaxcallcountestimate_fn_t maxCallCountEstimator)
 {
     bool result = false;
 
@@ -893,7 +947,9 @@ bool dxProcessIslands (dxWorld *world, const dxWorldProcessIslandsInfo &islandsI
         dIASSERT(islandsAllowedThreadCount != 0);
         dIASSERT(activeThreadCount >= islandsAllowedThreadCount);
 
-        unsigned stepperAllowedThreadCount = islandsAllowedThreadCount; // For now, set stepper allowed threads equal to island stepping threads
+        // Each island is stepped by a single thread. Islands do not share bodies or joints,
+        // so this gives the same results whatever the number of island threads is.
+        unsigned stepperAllowedThreadCount = 1;
 
         unsigned simultaneousCallsCount = EstimateIslandProcessingSimultaneousCallsMaximumCount(activeThreadCount, islandsAllowedThreadCount, stepperAllowedThreadCount, maxCallCountEstimator);
         if (!world->PreallocateResourcesForThreadedCalls(simultaneousCallsCount)) {
@@ -912,6 +968,21 @@ bool dxProcessIslands (dxWorld *world, const dxWorldProcessIslandsInfo &islandsI
         world->PostThreadedCallsGroup(NULL, islandsAllowedThreadCount, groupReleasee, 
             &dxIslandsProcessingCallContext::ThreadedProcessJobStart_Callback, (void *)&callContext, "World Islands Stepping Start");
 
+        // Free bodies need no island setup at all. Step them here in one batch,
+        // while the island threads are busy with the islands that have joints
+        const unsigned int freeBodiesCount = islandsInfo.GetFreeBodiesCount();
+        if (freeBodiesCount != 0) {
+            dIASSERT(freeBodiesStepper != NULL);
+            dxStepProfiler *profiler = world->profiler;
+            duint64 profileStart = profiler != NULL ? dxStepProfileNow() : 0;
+
+            freeBodiesStepper(world, islandsInfo.GetFreeBodiesArray(), freeBodiesCount, stepSize);
+
+            if (profiler != NULL) {
+                profiler->AddTime(dStepProfileFreeBodies, profileStart);
+            }
+        }
+
         // Wait until group completes (since jobs were the dependencies of the group the group is going to complete only after all the jobs end)
         world->WaitThreadedCallExclusively(NULL, pcwGroupCallWait, NULL, "World Islands Stepping Wait");
 
@@ -919,6 +990,21 @@ bool dxProcessIslands (dxWorld *world, const dxWorldProcessIslandsInfo &islandsI
             break;
         }
 
+        // All steppers are done. Notify geoms and users in island order, on this thread
+        const unsigned int *islandSizes = islandsInfo.GetIslandSizes();
+        const size_t islandsCount = islandsInfo.GetIslandsCount();
+        dxBody *const *islandBody = islandsInfo.GetBodiesArray();
+        for (size_t islandIndex = 0; islandIndex != islandsCount; ++islandIndex) {
+            dxBody *const *islandBodiesEnd = islandBody + islandSizes[islandIndex * dxISE__MAX + dxISE_BODIES_COUNT];
+            for (; islandBody != islandBodiesEnd; ++islandBody) {
+                dxNotifyBodyMoved(*islandBody);
+            }
+        }
+        dxBody *const *freeBody = islandsInfo.GetFreeBodiesArray();
+        for (dxBody *const *const freeBodiesEnd = freeBody + freeBodiesCount; freeBody != freeBodiesEnd; ++freeBody) {
+            dxNotifyBodyMoved(*freeBody);
+        }
+
         result = true;
     }
     while (false);
@@ -988,47 +1074,57 @@ void dxIslandsProcessingCallContext::ThreadedProcessIslandSearch(dxSingleIslandC
     const size_t islandsCount = islandsInfo.GetIslandsCount();
     size_t islandToProcess = ObtainNextIslandToBeProcessed(islandsCount);
 
-    if (islandToProcess != islandsCount) {
+    while (true) {
+        if (islandToProcess == islandsCount) {
+            finalizeJob = true;
+            break;
+        }
+
         // First time, the counts are zeros and on next passes, adding counts will skip island that has just been processed by stepper
         dxBody *const *islandBodiesStart = stepperCallContext->GetSelectedIslandBodiesEnd();
         dxJoint *const *islandJointsStart = stepperCallContext->GetSelectedIslandJointsEnd();
         size_t islandIndex = stepperCallContext->m_islandIndex;
 
-        for (; ; ++islandIndex) {
-            unsigned int bcount = islandSizes[islandIndex * dxISE__MAX + dxISE_BODIES_COUNT];
-            unsigned int jcount = islandSizes[islandIndex * dxISE__MAX + dxISE_JOINTS_COUNT];
+        for (; islandIndex != islandToProcess; ++islandIndex) {
+            islandBodiesStart += islandSizes[islandIndex * dxISE__MAX + dxISE_BODIES_COUNT];
+            islandJointsStart += islandSizes[islandIndex * dxISE__MAX + dxISE_JOINTS_COUNT];
+        }
 
-            if (islandIndex == islandToProcess) {
-                // Store selected island details
-                stepperCallContext->AssignIslandSelection(islandBodiesStart, islandJointsStart, bcount, jcount);
+        unsigned int bcount = islandSizes[islandIndex * dxISE__MAX + dxISE_BODIES_COUNT];
+        unsigned int jcount = islandSizes[islandIndex * dxISE__MAX + dxISE_JOINTS_COUNT];
 
-                // Store next island index to continue search from
-                ++islandIndex;
-                stepperCallContext->AssignIslandSearchProgress(islandIndex);
+        // Store selected island details
+        stepperCallContext->AssignIslandSelection(islandBodiesStart, islandJointsStart, bcount, jcount);
 
-                // Restore saved stepper memory arena position
-                stepperCallContext->RestoreSavedMemArenaStateForStepper();
+        // Store next island index to continue search from
+        ++islandIndex;
+        stepperCallContext->AssignIslandSearchProgress(islandIndex);
 
-                dCallReleaseeID nextSearchReleasee;
+        // Restore saved stepper memory arena position
+        stepperCallContext->RestoreSavedMemArenaStateForStepper();
 
-                // Summary fault flag may be omitted as any failures will automatically propagate to dependent releasee (i.e. to m_groupReleasee)
-                m_world->PostThreadedCallForUnawareReleasee(NULL, &nextSearchReleasee, 1, m_groupReleasee, NULL, 
-                    &dxIslandsProcessingCallContext::ThreadedProcessIslandSearch_Callback, (void *)stepperCallContext, 0, "World Islands Stepping Selection");
+        if (m_stepperAllowedThreads == 1) {
+            // A stepper allowed a single thread does all its work in the call and
+            // posts nothing. Run it right here and go on with the next island,
+            // rather than paying two threaded calls per island. Most islands of a
+            // region are a single body with a few contacts, so this matters.
+            stepperCallContext->CallStepper(m_stepper);
 
-                stepperCallContext->AssignStepperCallFinalReleasee(nextSearchReleasee);
+            islandToProcess = ObtainNextIslandToBeProcessed(islandsCount);
+            continue;
+        }
 
-                m_world->PostThreadedCall(NULL, NULL, 0, nextSearchReleasee, NULL, 
-                    &dxIslandsProcessingCallContext::ThreadedProcessIslandStepper_Callback, (void *)stepperCallContext, 0, "Island Stepping Job Start");
+        dCallReleaseeID nextSearchReleasee;
 
-                break;
-            }
+        // Summary fault flag may be omitted as any failures will automatically propagate to dependent releasee (i.e. to m_groupReleasee)
+        m_world->PostThreadedCallForUnawareReleasee(NULL, &nextSearchReleasee, 1, m_groupReleasee, NULL, 
+            &dxIslandsProcessingCallContext::ThreadedProcessIslandSearch_Callback, (void *)stepperCallContext, 0, "World Islands Stepping Selection");
 
-            islandBodiesStart += bcount;
-            islandJointsStart += jcount;
-        }
-    }
-    else {
-        finalizeJob = true;
+        stepperCallContext->AssignStepperCallFinalReleasee(nextSearchReleasee);
+
+        m_world->PostThreadedCall(NULL, NULL, 0, nextSearchReleasee, NULL, 
+            &dxIslandsProcessingCallContext::ThreadedProcessIslandStepper_Callback, (void *)stepperCallContext, 0, "Island Stepping Job Start");
+        break;
     }
 
     if (finalizeJob) {
@@ -1051,7 +1147,7 @@ int dxIslandsProcessingCallContext::ThreadedProcessIslandStepper_Callback(void *
 
 void dxIslandsProcessingCallContext::ThreadedProcessIslandStepper(dxSingleIslandCallContext *stepperCallContext)
 {
-    m_stepper(&stepperCallContext->m_stepperCallContext);
+    stepperCallContext->CallStepper(m_stepper);
 }
 
 size_t dxIslandsProcessingCallContext::ObtainNextIslandToBeProcessed(size_t islandsCount)
@@ -1149,7 +1245,7 @@ size_t dxWorldProcessMemArena::AdjustArenaSizeForReserveRequirements(size_t aren
 
 
 bool dxReallocateWorldProcessContext (dxWorld *world, dxWorldProcessIslandsInfo &islandsInfo, 
-    dReal stepSize, dmemestimate_fn_t stepperEstimate)
+    dReal stepSize, dmemestimate_fn_t stepperEstimate, bool separateFreeBodies)
 {
     bool result = false;
 
@@ -1185,7 +1281,7 @@ bool dxReallocateWorldProcessContext (dxWorld *world, dxWorldProcessIslandsInfo
         }
         dIASSERT(islandsArena->IsStructureValid());
 
-        size_t stepperReq = BuildIslandsAndEstimateStepperMemoryRequirements(islandsInfo, islandsArena, world, stepSize, stepperEstimate);
+        size_t stepperReq = BuildIslandsAndEstimateStepperMemoryRequirements(islandsInfo, islandsArena, world, stepSize, stepperEstimate, separateFreeBodies);
         dIASSERT(stepperReq == dEFFICIENT_SIZE(stepperReq));
 
         size_t stepperReqWithCallContext = stepperReq + dEFFICIENT_SIZE(sizeof(dxSingleIslandCallContext));
@@ -62,6 +62,7 @@
 
 void dInternalHandleAutoDisabling (dxWorld *world, dReal stepsize);
 void dxStepBody (dxBody *b, dReal h);
+void dxNotifyBodyMoved (dxBody *b);
 
 
 struct dxWorldProcessMemoryManager:
@@ -271,33 +272,43 @@ private:
 
 struct dxWorldProcessIslandsInfo
 {
-    void AssignInfo(size_t islandcount, unsigned int const *islandsizes, dxBody *const *bodies, dxJoint *const *joints)
+    void AssignInfo(size_t islandcount, unsigned int const *islandsizes, dxBody *const *bodies, dxJoint *const *joints,
+        dxBody *const *freebodies, unsigned int freebodycount)
     {
         m_IslandCount = islandcount;
         m_pIslandSizes = islandsizes;
         m_pBodies = bodies;
         m_pJoints = joints;
+        m_pFreeBodies = freebodies;
+        m_FreeBodyCount = freebodycount;
     }
 
     size_t GetIslandsCount() const { return m_IslandCount; }
     unsigned int const *GetIslandSizes() const { return m_pIslandSizes; }
     dxBody *const *GetBodiesArray() const { return m_pBodies; }
     dxJoint *const *GetJointsArray() const { return m_pJoints; }
+    // islands of one body and no joints, kept out of the islands when the stepper can batch them
+    dxBody *const *GetFreeBodiesArray() const { return m_pFreeBodies; }
+    unsigned int GetFreeBodiesCount() const { return m_FreeBodyCount; }
 
 private:
     size_t                  m_IslandCount;
     unsigned int const      *m_pIslandSizes;
     dxBody *const           *m_pBodies;
     dxJoint *const          *m_pJoints;
+    dxBody *const           *m_pFreeBodies;
+    unsigned int            m_FreeBodyCount;
 };
 
+struct dxStepProfileLap;
+
 struct dxStepperProcessingCallContext
 {
     dxStepperProcessingCallContext(dxWorld *world, dReal stepSize, unsigned stepperAllowedThreads, 
         dxWorldProcessMemArena *stepperArena, dxBody *const *islandBodiesStart, dxJoint *const *islandJointsStart): 
         m_world(world), m_stepSize(stepSize), m_stepperArena(stepperArena), m_finalReleasee(NULL), 
         m_islandBodiesStart(islandBodiesStart), m_islandJointsStart(islandJointsStart), m_islandBodiesCount(0), m_islandJointsCount(0),
-        m_stepperAllowedThreads(stepperAllowedThreads)
+        m_stepperAllowedThreads(stepperAllowedThreads), m_profileLap(NULL)
     {
     }
 
@@ -327,6 +338,7 @@ struct dxStepperProcessingCallContext
     unsigned                m_islandBodiesCount;
     unsigned                m_islandJointsCount;
 	unsigned                m_stepperAllowedThreads;
+    dxStepProfileLap        *m_profileLap;  // NULL unless the world is profiling
 };
 
 #define BEGIN_STATE_SAVE(memarena, state) void *state = memarena->SaveState();
@@ -334,16 +346,21 @@ struct dxStepperProcessingCallContext
 
 typedef void (*dstepper_fn_t) (const dxStepperProcessingCallContext *callContext);
 typedef unsigned (*dmaxcallcountestimate_fn_t) (unsigned activeThreadCount, unsigned allowedThreadCount);
+// steps a batch of bodies that have no joints, without any per-island setup
+typedef void (*dfreebodiesstepper_fn_t) (dxWorld *world, dxBody * const *body, unsigned int nb, dReal stepSize);
 
 bool dxProcessIslands (dxWorld *world, const dxWorldProcessIslandsInfo &islandsInfo, 
-                       dReal stepSize, dstepper_fn_t stepper, dmaxcallcountestimate_fn_t maxCallCountEstimator);
+                       dReal stepSize, dstepper_fn_t stepper, dfreebodiesstepper_fn_t freeBodiesStepper/*=NULL*/,
+                       dmaxcallcountestimate_fn_t maxCallCountEstimator);
 
 
 typedef size_t (*dmemestimate_fn_t) (dxBody * const *body, unsigned int nb, 
                                      dxJoint * const *_joint, unsigned int _nj);
 
+// separateFreeBodies: put islands of one body and no joints in the free bodies array
+// instead of the islands, for a stepper that has a dfreebodiesstepper_fn_t
 bool dxReallocateWorldProcessContext (dxWorld *world, dxWorldProcessIslandsInfo &islandsinfo, 
-                                      dReal stepsize, dmemestimate_fn_t stepperestimate);
+                                      dReal stepsize, dmemestimate_fn_t stepperestimate, bool separateFreeBodies);
 
 dxWorldProcessMemArena *dxAllocateTemporaryWorldProcessMemArena(
     size_t memreq, const dxWorldProcessMemoryManager *memmgr/*=NULL*/, const dxWorldProcessMemoryReserveInfo *reserveinfo/*=NULL*/);
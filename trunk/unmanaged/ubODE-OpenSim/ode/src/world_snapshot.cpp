@@ -0,0 +1,602 @@
+/*************************************************************************
+ *                                                                       *
+ * Open Dynamics Engine, Copyright (C) 2001-2003 Russell L. Smith.       *
+ * All rights reserved.  Email: russ@q12.org   Web: www.q12.org          *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of EITHER:                                  *
+ *   (1) The GNU Lesser General Public License as published by the Free  *
+ *       Software Foundation; either version 2.1 of the License, or (at  *
+ *       your option) any later version. The text of the GNU Lesser      *
+ *       General Public License is included with this library in the     *
+ *       file LICENSE.TXT.                                               *
+ *   (2) The BSD-style license that is included with this library in     *
+ *       the file LICENSE-BSD.TXT.                                       *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+ * LICENSE.TXT and LICENSE-BSD.TXT for more details.                     *
+ *                                                                       *
+ *************************************************************************/
+
+// dWorldSnapshot / dWorldRestore.
+// The block is a header, the world parameters, then each body of the world
+// list followed by its geoms, then each joint of the world list that is not
+// a contact. Objects are matched by their position in the lists, so the
+// block holds no pointers. Values are copied as they are in memory, so a
+// block is only good for the same build, which the header checks as far as
+// it can. Restore reads the whole block once to check it against the world
+// before changing anything.
+
+#include <ode/common.h>
+#include <ode/objects.h>
+#include <ode/collision.h>
+#include "config.h"
+#include "objects.h"
+#include "joints/joints.h"
+#include "collision_kernel.h"
+#include "collision_util.h"
+#include "collision_trimesh_internal.h"
+
+#include <string.h>
+
+#define dWORLD_SNAPSHOT_MAGIC   0x5357646F // "odWS"
+#define dWORLD_SNAPSHOT_VERSION 1
+
+struct dxWorldSnapshotHeader
+{
+    duint32 magic;
+    duint32 version;
+    duint32 realSize;
+    duint32 pointerSize;
+    duint32 bodyCount;
+    duint32 jointCount;
+};
+
+// sizes the block, and writes it when buf is large enough
+class dxSnapshotWriter
+{
+public:
+    dxSnapshotWriter(void *buf, size_t bufSize): m_out((uint8 *)buf), m_capacity(buf ? bufSize : 0), m_size(0) {}
+
+    template<class T> void Put(const T &value) { PutBytes(&value, sizeof(T)); }
+
+    void PutBytes(const void *data, size_t size)
+    {
+        if (m_size + size <= m_capacity)
+            memcpy(m_out + m_size, data, size);
+        m_size += size;
+    }
+
+    size_t Size() const { return m_size; }
+
+private:
+    uint8 *m_out;
+    size_t m_capacity;
+    size_t m_size;
+};
+
+class dxSnapshotReader
+{
+public:
+    dxSnapshotReader(const void *buf, size_t bufSize): m_in((const uint8 *)buf), m_left(buf ? bufSize : 0) {}
+
+    template<class T> bool Get(T &value) { return GetBytes(&value, sizeof(T)); }
+
+    bool GetBytes(void *data, size_t size)
+    {
+        if (size > m_left)
+            return false;
+        memcpy(data, m_in, size);
+        m_in += size;
+        m_left -= size;
+        return true;
+    }
+
+    // the next size bytes, or NULL if the block is shorter
+    const uint8 *Skip(size_t size)
+    {
+        if (size > m_left)
+            return NULL;
+        const uint8 *data = m_in;
+        m_in += size;
+        m_left -= size;
+        return data;
+    }
+
+    bool AtEnd() const { return m_left == 0; }
+
+private:
+    const uint8 *m_in;
+    size_t m_left;
+};
+
+
+static bool IsSavedJoint(const dxJoint *j)
+{
+    // contacts are made again by the next collide
+    return j->type() != dJointTypeContact;
+}
+
+// the joint type members follow the dxJoint ones, the last of which is lambda.
+// starting there and not at sizeof(dxJoint) also copies members a compiler put
+// in the tail padding of dxJoint
+static size_t JointDataOffset(const dxJoint *j)
+{
+    return (size_t)((const uint8 *)(j->lambda + 6) - (const uint8 *)j);
+}
+
+static duint32 CountGeoms(const dxBody *b)
+{
+    duint32 count = 0;
+    for (const dxGeom *g = b->geom; g != NULL; g = g->body_next)
+        count++;
+    return count;
+}
+
+static duint64 GeomKey(dxGeom *g)
+{
+    if (g->type == dTriMeshClass)
+    {
+        const dxTriMeshData *data = ((dxTriMesh *)g)->Data;
+        return data != NULL ? data->UserKey : 0;
+    }
+    return 0;
+}
+
+
+//****************************************************************************
+// snapshot
+
+static void WriteWorld(dxSnapshotWriter &out, dxWorld *w)
+{
+    out.Put(w->gravity);
+    out.Put(w->global_erp);
+    out.Put(w->global_cfm);
+    out.Put(w->adis);
+    out.Put(w->body_flags);
+    out.Put(w->qs);
+    out.Put(w->contactp);
+    out.Put(w->dampingp);
+    out.Put(w->max_angular_speed);
+
+    int reuseSteps = dWorldGetContactReuseSteps(w);
+    dReal reuseDistance = dWorldGetContactReuseDistance(w);
+    out.Put(reuseSteps);
+    out.Put(reuseDistance);
+}
+
+static void WriteGeom(dxSnapshotWriter &out, dxGeom *g)
+{
+    int type = g->type;
+    int enabled = dGeomIsEnabled(g);
+    unsigned long category = g->category_bits;
+    unsigned long collide = g->collide_bits;
+    int hasOffset = g->offset_posr != NULL;
+    duint64 key = GeomKey(g);
+
+    out.Put(type);
+    out.Put(key);
+    out.Put(enabled);
+    out.Put(category);
+    out.Put(collide);
+    out.Put(hasOffset);
+    if (hasOffset)
+    {
+        out.Put(g->offset_posr->pos);
+        out.Put(g->offset_posr->R);
+    }
+}
+
+static void WriteBody(dxSnapshotWriter &out, dxBody *b)
+{
+    out.Put(b->flags);
+    out.Put(b->mass);
+    out.Put(b->invI);
+    out.Put(b->invMass);
+    out.Put(b->posr.pos);
+    out.Put(b->posr.R);
+    out.Put(b->q);
+    out.Put(b->lvel);
+    out.Put(b->avel);
+    out.Put(b->facc);
+    out.Put(b->tacc);
+    out.Put(b->finite_rot_axis);
+    out.Put(b->adis);
+    out.Put(b->adis_timeleft);
+    out.Put(b->adis_stepsleft);
+    out.Put(b->average_counter);
+    out.Put(b->average_ready);
+    out.Put(b->dampingp);
+    out.Put(b->max_angular_speed);
+
+    duint32 samples = b->average_lvel_buffer != NULL ? b->adis.average_samples : 0;
+    out.Put(samples);
+    if (samples != 0)
+    {
+        out.PutBytes(b->average_lvel_buffer, samples * sizeof(dVector3));
+        out.PutBytes(b->average_avel_buffer, samples * sizeof(dVector3));
+    }
+
+    duint32 geomCount = CountGeoms(b);
+    out.Put(geomCount);
+    for (dxGeom *g = b->geom; g != NULL; g = g->body_next)
+        WriteGeom(out, g);
+}
+
+static void WriteJoint(dxSnapshotWriter &out, dxJoint *j)
+{
+    int type = j->type();
+    int body0 = j->node[0].body != NULL ? j->node[0].body->tag : -1;
+    int body1 = j->node[1].body != NULL ? j->node[1].body->tag : -1;
+    size_t offset = JointDataOffset(j);
+    duint32 dataSize = (duint32)(j->size() - offset);
+
+    out.Put(type);
+    out.Put(body0);
+    out.Put(body1);
+    out.Put(j->flags);
+    out.Put(j->lambda);
+    out.Put(dataSize);
+    out.PutBytes((const uint8 *)j + offset, dataSize);
+}
+
+static void WriteSnapshot(dxSnapshotWriter &out, dxWorld *w)
+{
+    dxWorldSnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = dWORLD_SNAPSHOT_MAGIC;
+    header.version = dWORLD_SNAPSHOT_VERSION;
+    header.realSize = sizeof(dReal);
+    header.pointerSize = sizeof(void *);
+
+    // number the bodies for the joints
+    int index = 0;
+    for (dxBody *b = w->firstbody; b != NULL; b = (dxBody *)b->next)
+        b->tag = index++;
+    header.bodyCount = (duint32)index;
+
+    for (dxJoint *j = w->firstjoint; j != NULL; j = (dxJoint *)j->next)
+    {
+        if (IsSavedJoint(j))
+            header.jointCount++;
+    }
+
+    out.Put(header);
+    WriteWorld(out, w);
+
+    for (dxBody *b = w->firstbody; b != NULL; b = (dxBody *)b->next)
+        WriteBody(out, b);
+
+    for (dxJoint *j = w->firstjoint; j != NULL; j = (dxJoint *)j->next)
+    {
+        if (IsSavedJoint(j))
+            WriteJoint(out, j);
+    }
+}
+
+size_t dWorldSnapshot(dWorldID w, void *buf, size_t bufSize)
+{
+    dAASSERT(w);
+
+    dxSnapshotWriter sizer(NULL, 0);
+    WriteSnapshot(sizer, w);
+
+    const size_t size = sizer.Size();
+    if (buf != NULL && bufSize >= size)
+    {
+        dxSnapshotWriter out(buf, bufSize);
+        WriteSnapshot(out, w);
+    }
+
+    return size;
+}
+
+
+//****************************************************************************
+// restore
+
+// each Read function checks its record against the world object and, when
+// apply is set, also copies it into the object
+
+// dGeomMoved leaves a geom that is already dirty where it is in its space
+// list, so the pairs of the list spaces would come in an order set by the
+// steps before the restore. moving every geom of the world to the front, in
+// the block order, gives the same order after each restore. the sap and
+// quadtree spaces keep dirty lists of their own and are left alone.
+static void MoveGeomToFront(dxGeom *g)
+{
+    dGeomMoved(g);
+
+    for (dxGeom *geom = g; geom->parent_space != NULL; geom = geom->parent_space)
+    {
+        dxSpace *parent = geom->parent_space;
+        if (parent->type == dSweepAndPruneSpaceClass || parent->type == dQuadTreeSpaceClass)
+            break;
+        parent->dirty(geom);
+    }
+}
+
+static bool ReadWorld(dxSnapshotReader &in, dxWorld *w, bool apply)
+{
+    dVector3 gravity;
+    dReal erp, cfm;
+    dxAutoDisable adis;
+    int bodyFlags;
+    dxQuickStepParameters qs;
+    dxContactParameters contactp;
+    dxDampingParameters dampingp;
+    dReal maxAngularSpeed;
+    int reuseSteps;
+    dReal reuseDistance;
+
+    if (!in.Get(gravity) || !in.Get(erp) || !in.Get(cfm) || !in.Get(adis) || !in.Get(bodyFlags) ||
+        !in.Get(qs) || !in.Get(contactp) || !in.Get(dampingp) || !in.Get(maxAngularSpeed) ||
+        !in.Get(reuseSteps) || !in.Get(reuseDistance))
+        return false;
+
+    if (qs.warm_starting < 0 || qs.warm_starting > 1 || reuseSteps < 0 || reuseDistance < 0)
+        return false;
+
+    if (apply)
+    {
+        memcpy(w->gravity, gravity, sizeof(dVector3));
+        w->global_erp = erp;
+        w->global_cfm = cfm;
+        w->adis = adis;
+        w->body_flags = bodyFlags;
+        w->qs = qs;
+        w->contactp = contactp;
+        w->dampingp = dampingp;
+        w->max_angular_speed = maxAngularSpeed;
+
+        // the kept contacts refer to geoms that are not in the block
+        dWorldSetQuickStepWarmStarting(w, 0);
+        dWorldSetQuickStepWarmStarting(w, qs.warm_starting);
+        dWorldSetContactReuse(w, reuseSteps, reuseDistance);
+    }
+
+    return true;
+}
+
+static bool ReadGeom(dxSnapshotReader &in, dxGeom *g, bool apply)
+{
+    int type, enabled, hasOffset;
+    duint64 key;
+    unsigned long category, collide;
+
+    if (!in.Get(type) || !in.Get(key) || !in.Get(enabled) || !in.Get(category) ||
+        !in.Get(collide) || !in.Get(hasOffset))
+        return false;
+
+    if (type != g->type || key != GeomKey(g))
+        return false;
+
+    dVector3 pos;
+    dMatrix3 R;
+    if (hasOffset && (!in.Get(pos) || !in.Get(R)))
+        return false;
+
+    if (apply)
+    {
+        if (hasOffset)
+        {
+            // creates the offset if the geom has none
+            dGeomSetOffsetPosition(g, pos[0], pos[1], pos[2]);
+            memcpy(g->offset_posr->pos, pos, sizeof(dVector3));
+            memcpy(g->offset_posr->R, R, sizeof(dMatrix3));
+        }
+        else if (g->offset_posr != NULL)
+        {
+            dGeomClearOffset(g);
+        }
+
+        dGeomSetCategoryBits(g, category);
+        dGeomSetCollideBits(g, collide);
+
+        if (enabled)
+            dGeomEnable(g);
+        else
+            dGeomDisable(g);
+
+        MoveGeomToFront(g);
+    }
+
+    return true;
+}
+
+static bool ReadBody(dxSnapshotReader &in, dxBody *b, bool apply)
+{
+    unsigned flags;
+    dMass mass;
+    dMatrix3 invI;
+    dReal invMass;
+    dVector3 pos;
+    dMatrix3 R;
+    dQuaternion q;
+    dVector3 lvel, avel, facc, tacc, finiteRotAxis;
+    dxAutoDisable adis;
+    dReal adisTimeLeft;
+    int adisStepsLeft;
+    unsigned averageCounter;
+    int averageReady;
+    dxDampingParameters dampingp;
+    dReal maxAngularSpeed;
+    duint32 samples;
+
+    if (!in.Get(flags) || !in.Get(mass) || !in.Get(invI) || !in.Get(invMass) || !in.Get(pos) ||
+        !in.Get(R) || !in.Get(q) || !in.Get(lvel) || !in.Get(avel) || !in.Get(facc) ||
+        !in.Get(tacc) || !in.Get(finiteRotAxis) || !in.Get(adis) || !in.Get(adisTimeLeft) ||
+        !in.Get(adisStepsLeft) || !in.Get(averageCounter) || !in.Get(averageReady) ||
+        !in.Get(dampingp) || !in.Get(maxAngularSpeed) || !in.Get(samples))
+        return false;
+
+    // bodies have buffers for all their samples
+    if (samples != adis.average_samples || (samples != 0 && averageCounter >= samples))
+        return false;
+
+    const uint8 *averages = NULL;
+    if (samples != 0)
+    {
+        if (samples > ~(size_t)0 / (2 * sizeof(dVector3)))
+            return false;
+        averages = in.Skip(2 * samples * sizeof(dVector3));
+        if (averages == NULL)
+            return false;
+    }
+
+    duint32 geomCount;
+    if (!in.Get(geomCount) || geomCount != CountGeoms(b))
+        return false;
+
+    if (apply)
+    {
+        b->flags = (flags & ~dxBodyDisabled) | (b->flags & dxBodyDisabled);
+        if (flags & dxBodyDisabled)
+            dxBodySetDisabled(b);
+        else
+            dxBodySetEnabled(b);
+
+        b->mass = mass;
+        memcpy(b->invI, invI, sizeof(dMatrix3));
+        b->invMass = invMass;
+        memcpy(b->posr.pos, pos, sizeof(dVector3));
+        memcpy(b->posr.R, R, sizeof(dMatrix3));
+        memcpy(b->q, q, sizeof(dQuaternion));
+        memcpy(b->lvel, lvel, sizeof(dVector3));
+        memcpy(b->avel, avel, sizeof(dVector3));
+        memcpy(b->facc, facc, sizeof(dVector3));
+        memcpy(b->tacc, tacc, sizeof(dVector3));
+        memcpy(b->finite_rot_axis, finiteRotAxis, sizeof(dVector3));
+
+        if (b->adis.average_samples != samples || (b->average_lvel_buffer != NULL) != (samples != 0))
+            dBodySetAutoDisableAverageSamplesCount(b, samples);
+        b->adis = adis;
+        if (samples != 0)
+        {
+            memcpy(b->average_lvel_buffer, averages, samples * sizeof(dVector3));
+            memcpy(b->average_avel_buffer, averages + samples * sizeof(dVector3), samples * sizeof(dVector3));
+        }
+        b->adis_timeleft = adisTimeLeft;
+        b->adis_stepsleft = adisStepsLeft;
+        b->average_counter = averageCounter;
+        b->average_ready = averageReady;
+        b->dampingp = dampingp;
+        b->max_angular_speed = maxAngularSpeed;
+    }
+
+    for (dxGeom *g = b->geom; g != NULL; g = g->body_next)
+    {
+        if (!ReadGeom(in, g, apply))
+            return false;
+    }
+
+    return true;
+}
+
+static bool ReadJoint(dxSnapshotReader &in, dxJoint *j, dxBody *const *bodies, duint32 bodyCount, bool apply)
+{
+    int type, body0, body1;
+    unsigned flags;
+    dReal lambda[6];
+    duint32 dataSize;
+
+    if (!in.Get(type) || !in.Get(body0) || !in.Get(body1) || !in.Get(flags) || !in.Get(lambda) ||
+        !in.Get(dataSize))
+        return false;
+
+    const size_t offset = JointDataOffset(j);
+    if (type != (int)j->type() || dataSize != j->size() - offset)
+        return false;
+
+    if (body0 < -1 || body0 >= (int)bodyCount || body1 < -1 || body1 >= (int)bodyCount ||
+        (body0 == body1 && body0 != -1))
+        return false;
+
+    const uint8 *data = in.Skip(dataSize);
+    if (data == NULL)
+        return false;
+
+    if (apply)
+    {
+        dxBody *b0 = body0 != -1 ? bodies[body0] : NULL;
+        dxBody *b1 = body1 != -1 ? bodies[body1] : NULL;
+        if (j->node[0].body != b0 || j->node[1].body != b1)
+            dJointAttach(j, b0, b1);
+
+        // the group the joint is in does not change
+        j->flags = (flags & ~dJOINT_INGROUP) | (j->flags & dJOINT_INGROUP);
+        memcpy(j->lambda, lambda, sizeof(lambda));
+        memcpy((uint8 *)j + offset, data, dataSize);
+    }
+
+    return true;
+}
+
+static bool ReadSnapshot(dxSnapshotReader &in, dxWorld *w, dxBody *const *bodies, bool apply)
+{
+    dxWorldSnapshotHeader header;
+    if (!in.Get(header))
+        return false;
+
+    if (header.magic != dWORLD_SNAPSHOT_MAGIC || header.version != dWORLD_SNAPSHOT_VERSION ||
+        header.realSize != sizeof(dReal) || header.pointerSize != sizeof(void *) ||
+        header.bodyCount != (duint32)w->nb)
+        return false;
+
+    duint32 jointCount = 0;
+    for (dxJoint *j = w->firstjoint; j != NULL; j = (dxJoint *)j->next)
+    {
+        if (IsSavedJoint(j))
+            jointCount++;
+    }
+    if (header.jointCount != jointCount)
+        return false;
+
+    if (!ReadWorld(in, w, apply))
+        return false;
+
+    for (duint32 i = 0; i != header.bodyCount; i++)
+    {
+        if (!ReadBody(in, bodies[i], apply))
+            return false;
+    }
+
+    for (dxJoint *j = w->firstjoint; j != NULL; j = (dxJoint *)j->next)
+    {
+        if (IsSavedJoint(j) && !ReadJoint(in, j, bodies, header.bodyCount, apply))
+            return false;
+    }
+
+    return in.AtEnd();
+}
+
+int dWorldRestore(dWorldID w, const void *buf, size_t bufSize)
+{
+    dAASSERT(w);
+
+    const size_t bodiesSize = (w->nb != 0 ? w->nb : 1) * sizeof(dxBody *);
+    dxBody **bodies = (dxBody **)dAlloc(bodiesSize);
+
+    int index = 0;
+    for (dxBody *b = w->firstbody; b != NULL; b = (dxBody *)b->next)
+        bodies[index++] = b;
+
+    // check everything first, so a bad block leaves the world as it was
+    bool result = false;
+    {
+        dxSnapshotReader in(buf, bufSize);
+        result = ReadSnapshot(in, w, bodies, false);
+    }
+    if (result)
+    {
+        dxSnapshotReader in(buf, bufSize);
+        result = ReadSnapshot(in, w, bodies, true);
+        dIASSERT(result);
+    }
+
+    dFree(bodies, bodiesSize);
+
+    return result;
+}
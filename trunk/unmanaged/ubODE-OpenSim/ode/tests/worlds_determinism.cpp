@@ -0,0 +1,247 @@
+/*************************************************************************
+ *                                                                       *
+ * Open Dynamics Engine, Copyright (C) 2001,2002 Russell L. Smith.       *
+ * All rights reserved.  Email: russ@q12.org   Web: www.q12.org          *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of EITHER:                                  *
+ *   (1) The GNU Lesser General Public License as published by the Free  *
+ *       Software Foundation; either version 2.1 of the License, or (at  *
+ *       your option) any later version. The text of the GNU Lesser      *
+ *       General Public License is included with this library in the     *
+ *       file LICENSE.TXT.                                               *
+ *   (2) The BSD-style license that is included with this library in     *
+ *       the file LICENSE-BSD.TXT.                                       *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the files    *
+ * LICENSE.TXT and LICENSE-BSD.TXT for more details.                     *
+ *                                                                       *
+ *************************************************************************/
+
+
+// Checks that independent worlds stepped from several threads at once end up
+// where they do when stepped one after the other. Each world is a pile of
+// boxes and spheres falling on a trimesh, so the trimesh colliders caches,
+// the threading implementation and the step memory are all used by the
+// threads together. The worlds are run one after the other first, then built
+// again and run with one thread each, first stepping alone and then with a
+// shared stepping pool. Returns 0 if every world got the same body positions
+// and rotations each time.
+
+#include <ode/ode.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+
+#define NUM_WORLDS  4
+#define NUM_BODIES  100
+#define NUM_STEPS   150
+#define MAX_CONTACTS 8
+#define GRID        16
+
+
+struct World
+{
+    dWorldID world;
+    dSpaceID space;
+    dJointGroupID contacts;
+    unsigned seed;
+    unsigned long hash;
+};
+
+static dTriMeshDataID terrainData;
+static dReal terrainVertices[(GRID + 1) * (GRID + 1) * 3];
+static dTriIndex terrainIndices[GRID * GRID * 6];
+
+
+// a small generator of our own, as rand() is shared by the threads
+static float Random(unsigned &seed)
+{
+    seed = seed * 1103515245u + 12345u;
+    return (float)((seed >> 8) & 0xFFFF) / 65536.0f;
+}
+
+static void NearCallback(void *data, dGeomID o1, dGeomID o2)
+{
+    World *w = (World *)data;
+    dBodyID b1 = dGeomGetBody(o1);
+    dBodyID b2 = dGeomGetBody(o2);
+    if (b1 == NULL && b2 == NULL)
+        return;
+
+    dContact contact[MAX_CONTACTS];
+    memset(contact, 0, sizeof(contact));
+    int n = dCollide(o1, o2, MAX_CONTACTS, &contact[0].geom, sizeof(dContact));
+    for (int i = 0; i < n; i++)
+    {
+        contact[i].surface.mode = dContactBounce;
+        contact[i].surface.mu = 0.5;
+        contact[i].surface.bounce = 0.1;
+        dJointID c = dJointCreateContact(w->world, w->contacts, contact + i);
+        dJointAttach(c, b1, b2);
+    }
+}
+
+static void BuildTerrain()
+{
+    for (int j = 0; j <= GRID; j++)
+    {
+        for (int i = 0; i <= GRID; i++)
+        {
+            dReal *v = terrainVertices + 3 * (j * (GRID + 1) + i);
+            v[0] = i * REAL(0.5);
+            v[1] = j * REAL(0.5);
+            v[2] = REAL(0.3) * dSin(i * REAL(0.7)) * dCos(j * REAL(0.5));
+        }
+    }
+
+    int k = 0;
+    for (int j = 0; j < GRID; j++)
+    {
+        for (int i = 0; i < GRID; i++)
+        {
+            int a = j * (GRID + 1) + i;
+            int c = a + GRID + 1;
+            terrainIndices[k++] = a;
+            terrainIndices[k++] = a + 1;
+            terrainIndices[k++] = c;
+            terrainIndices[k++] = a + 1;
+            terrainIndices[k++] = c + 1;
+            terrainIndices[k++] = c;
+        }
+    }
+
+    terrainData = dGeomTriMeshDataCreate();
+    dGeomTriMeshDataBuildSingle(terrainData, terrainVertices, 3 * sizeof(dReal), (GRID + 1) * (GRID + 1),
+        terrainIndices, k, 3 * sizeof(dTriIndex));
+}
+
+static void CreateWorld(World *w, int shared)
+{
+    w->world = dWorldCreate();
+    w->space = dHashSpaceCreate(0);
+    w->contacts = dJointGroupCreate(0);
+    dWorldSetGravity(w->world, 0, 0, REAL(-9.8));
+    dWorldSetQuickStepNumIterations(w->world, 20);
+    if (shared)
+        dWorldSetStepSharedThreadPool(w->world, 2);
+
+    dCreatePlane(w->space, 0, 0, 1, -1);
+    dCreateTriMesh(w->space, terrainData, NULL, NULL, NULL);
+
+    unsigned seed = w->seed;
+    for (int i = 0; i < NUM_BODIES; i++)
+    {
+        dBodyID b = dBodyCreate(w->world);
+        dGeomID g;
+        dMass m;
+        if (i & 1)
+        {
+            g = dCreateBox(w->space, REAL(0.5), REAL(0.5), REAL(0.5));
+            dMassSetBox(&m, 1, REAL(0.5), REAL(0.5), REAL(0.5));
+        }
+        else
+        {
+            g = dCreateSphere(w->space, REAL(0.3));
+            dMassSetSphere(&m, 1, REAL(0.3));
+        }
+        dBodySetMass(b, &m);
+        dGeomSetBody(g, b);
+        dReal x = Random(seed) * (GRID * REAL(0.5));
+        dReal y = Random(seed) * (GRID * REAL(0.5));
+        dReal z = 1 + Random(seed) * 8;
+        dBodySetPosition(b, x, y, z);
+    }
+}
+
+static void DestroyWorld(World *w)
+{
+    dJointGroupDestroy(w->contacts);
+    dSpaceDestroy(w->space);
+    dWorldDestroy(w->world);
+}
+
+static void RunWorld(World *w)
+{
+    for (int i = 0; i < NUM_STEPS; i++)
+    {
+        dSpaceCollide(w->space, w, &NearCallback);
+        dWorldQuickStep(w->world, REAL(0.02));
+        dJointGroupEmpty(w->contacts);
+    }
+
+    // FNV-1a of the body positions and rotations, bit for bit
+    unsigned long hash = 2166136261u;
+    for (int i = 0; i < dSpaceGetNumGeoms(w->space); i++)
+    {
+        dBodyID b = dGeomGetBody(dSpaceGetGeom(w->space, i));
+        if (b == NULL)
+            continue;
+        const unsigned char *p = (const unsigned char *)dBodyGetPosition(b);
+        for (size_t k = 0; k < 3 * sizeof(dReal); k++)
+            hash = ((hash ^ p[k]) * 16777619u) & 0xFFFFFFFFu;
+        p = (const unsigned char *)dBodyGetQuaternion(b);
+        for (size_t k = 0; k < 4 * sizeof(dReal); k++)
+            hash = ((hash ^ p[k]) * 16777619u) & 0xFFFFFFFFu;
+    }
+    w->hash = hash;
+}
+
+static void *WorldThread(void *data)
+{
+    dAllocateODEDataForThread(dAllocateMaskAll);
+    RunWorld((World *)data);
+    return NULL;
+}
+
+// runs the worlds together and returns the number of them that ended up
+// elsewhere than in the serial run
+static int RunConcurrent(World *worlds, const unsigned long *expected, int shared)
+{
+    pthread_t threads[NUM_WORLDS];
+    for (int i = 0; i < NUM_WORLDS; i++)
+        CreateWorld(worlds + i, shared);
+    for (int i = 0; i < NUM_WORLDS; i++)
+        pthread_create(threads + i, NULL, &WorldThread, worlds + i);
+    for (int i = 0; i < NUM_WORLDS; i++)
+        pthread_join(threads[i], NULL);
+
+    int mismatches = 0;
+    for (int i = 0; i < NUM_WORLDS; i++)
+    {
+        if (worlds[i].hash != expected[i])
+            mismatches++;
+        DestroyWorld(worlds + i);
+    }
+    return mismatches;
+}
+
+int main()
+{
+    dInitODE2(0);
+    dAllocateODEDataForThread(dAllocateMaskAll);
+    BuildTerrain();
+
+    World worlds[NUM_WORLDS];
+    unsigned long expected[NUM_WORLDS];
+    for (int i = 0; i < NUM_WORLDS; i++)
+    {
+        worlds[i].seed = i + 1;
+        CreateWorld(worlds + i, 0);
+        RunWorld(worlds + i);
+        expected[i] = worlds[i].hash;
+        DestroyWorld(worlds + i);
+    }
+
+    int alone = RunConcurrent(worlds, expected, 0);
+    int shared = RunConcurrent(worlds, expected, 1);
+    printf("%d worlds, mismatches: %d stepping alone, %d with a shared pool\n", NUM_WORLDS, alone, shared);
+
+    dGeomTriMeshDataDestroy(terrainData);
+    dCloseODE();
+    return alone != 0 || shared != 0;
+}